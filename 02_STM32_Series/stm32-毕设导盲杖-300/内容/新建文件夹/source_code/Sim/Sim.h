@@ -0,0 +1,35 @@
+#ifndef __SIM_H
+#define __SIM_H
+
+#include "stm32f10x.h"
+
+/*
+ * 主机端模拟器 (Linux), 用于在 PC 上验证固件模块
+ *
+ * - 外设 (0x40000000) 和内核外设 (0xE0000000) 两段地址用 mmap 映射到进程中的同一地址,
+ *   固件和标准外设库照常读写寄存器
+ * - 虚拟时间以 us 为单位, 由测试程序调用 Sim_Run 推进; 每一步先调用 Sim_StepHook, 再模拟 SysTick、TIM2-TIM4 计数、
+ *   比较和 TIM2 CH1-CH4 (PA0-PA3) 输入捕获, 再像 NVIC 一样调用已使能且有标志的中断服务函数
+ * - 写 0 清除的 SR 由模拟器保存; 固件通过 TIM_ClearITPendingBit / TIM_ClearFlag 清除,
+ *   GPIO_SetBits / GPIO_ResetBits / GPIO_WriteBit 立即生效并通知 Sim_OutputHook
+ *   (链接时 --wrap 截获), 不支持直接写这些寄存器
+ * - 固件的忙等 Delay_us / Delay_ms 同样被截获, 改为推进虚拟时间 (期间照常进入中断);
+ *   没有截获的循环读寄存器的等待在模拟器中不会结束
+ * - 中断服务函数只在固件函数返回后、时间推进时调用, 不会打断固件代码
+ */
+
+#define SIM_CLOCK           72000000    // 定时器时钟 (Hz)
+
+extern uint64_t Sim_Now;                // 虚拟时间 (us)
+
+/* 每推进 1us 先调用一次 (外部电路模型在此改变输入), 由测试程序设置 */
+extern void (*Sim_StepHook)(void);
+
+/* 输出引脚变化通知 (pins 为 GPIO_Pin_x 掩码, level 为新电平), 由测试程序设置 */
+extern void (*Sim_OutputHook)(GPIO_TypeDef *port, uint16_t pins, uint8_t level);
+
+void Sim_Init(void);
+void Sim_Run(uint64_t us);
+void Sim_SetInput(GPIO_TypeDef *port, uint16_t pins, uint8_t level);
+
+#endif
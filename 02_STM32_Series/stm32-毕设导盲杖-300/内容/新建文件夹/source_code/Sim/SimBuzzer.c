@@ -0,0 +1,176 @@
+/**
+  ******************************************************************************
+  * @file    SimBuzzer.c
+  * @brief   蜂鸣器测试 - SysTick 推进 System/Buzzer.c 的播放序列, 每 1ms 检查 PWM 输出
+  * @note    用法: ./buzzer_test [-v]
+  *          System/Buzzer.c 和 System/Delay.c 原样编译. 每个 SysTick 之后读 TIM1 和 PB14 的配置:
+  *          发声 = PB14 复用推挽、CH2N 输出打开、主输出打开、计数、OC2M 为 PWM1, 音调 = 1MHz / (ARR + 1);
+  *          与按序列 (音调、时长、间隔、重复) 算出的时间表逐毫秒比较. 另外检查:
+  *          - Buzzer_Play / Buzzer_Beep 立即返回 (不占用虚拟时间)
+  *          - 播放中替换序列、停止, 以及 Buzzer_On / Off / Toggle
+  *          全部通过时退出码为 0, 否则为 1
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Sim.h"
+#include "Delay.h"
+#include "Buzzer.h"
+
+#define US_PER_TICK     1000
+
+static int Verbose;
+static int Fail;
+
+/* 当前输出: 发声时返回音调 (Hz), 静音返回 0 */
+static unsigned Output(void)
+{
+    unsigned pin = 14 - 8;
+    int af_pp = ((BUZZER_PORT->CRH >> (pin * 4)) & 0xF) == 0xB;
+    int pwm = ((BUZZER_TIM->CCMR1 & TIM_CCMR1_OC2M) >> 12) == 6;
+    int on = (BUZZER_TIM->CCER & TIM_CCER_CC2NE) && (BUZZER_TIM->BDTR & TIM_BDTR_MOE) &&
+             (BUZZER_TIM->CR1 & TIM_CR1_CEN);
+
+    if (!af_pp || !on || !(BUZZER_TIM->CCER & TIM_CCER_CC2NP))
+        return 0xFFFF;              // 配置错误: 引脚不受 PWM 控制, 或静音时引脚为低 (会响)
+    if (!pwm)
+        return 0;
+    if (BUZZER_TIM->PSC != SIM_CLOCK / 1000000 - 1 || BUZZER_TIM->CCR2 != (BUZZER_TIM->ARR + 1) / 2)
+        return 0xFFFE;              // 不是 1MHz 计数或占空比不是 50%
+    return 1000000 / (BUZZER_TIM->ARR + 1);
+}
+
+/* 1MHz 计数能输出的最接近的音调 */
+static unsigned Quantize(unsigned freq)
+{
+    return freq ? 1000000 / (1000000 / freq) : 0;
+}
+
+/* 按序列算出第 k 个 tick 之后应有的音调; 序列结束后为 0 */
+static unsigned Expect(const Buzzer_Pattern_TypeDef *p, unsigned k)
+{
+    unsigned pass, i, t = 0, on;
+
+    for (pass = 0; p->Repeat == 0 || pass < p->Repeat; pass++)
+        for (i = 0; i < p->Num; i++)
+        {
+            on = p->Notes[i].OnMs ? p->Notes[i].OnMs : 1;
+            if (k < t + on)
+                return Quantize(p->Notes[i].Freq);
+            if (k < t + on + p->Notes[i].OffMs)
+                return 0;
+            t += on + p->Notes[i].OffMs;
+        }
+    return 0;
+}
+
+/* 逐 tick 比较 ticks 个毫秒, expect_busy_end: 此后 Buzzer_IsBusy 应为 0 (-1 不检查) */
+static void Check(const char *name, const Buzzer_Pattern_TypeDef *p, unsigned ticks, int expect_busy_end)
+{
+    unsigned k, out, exp, bad = 0;
+
+    for (k = 0; k <= ticks; k++)
+    {
+        if (k)
+            Sim_Run(US_PER_TICK);
+        out = Output();
+        exp = Expect(p, k);
+        if (Verbose)
+            printf("  %s %4ums  %5u Hz (expect %u)\n", name, k, out, exp);
+        if (out != exp || (expect_busy_end >= 0 && Buzzer_IsBusy() != (k < (unsigned)expect_busy_end)))
+        {
+            if (!bad)
+                printf("  %s: at %ums output %uHz busy %d, expected %uHz\n", name, k, out, Buzzer_IsBusy(), exp);
+            bad++;
+        }
+    }
+    printf("%-10s %4u ms  %s\n", name, ticks, bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+/* 调用固件函数, 检查没有占用虚拟时间 */
+#define CALL(expr) do { uint64_t t0 = Sim_Now; expr; if (Sim_Now != t0) { printf("  %s blocked %lluus\n", #expr, (unsigned long long)(Sim_Now - t0)); Fail++; } } while (0)
+
+static void Expect1(const char *what, unsigned freq)
+{
+    unsigned out = Output();
+    if (out != freq)
+    {
+        printf("  %s: output %uHz, expected %uHz\n", what, out, freq);
+        Fail++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static const Buzzer_Note_TypeDef melody[] = {{2000, 30, 20}, {0, 10, 0}, {1000, 10, 40}};
+    static const Buzzer_Pattern_TypeDef melody3 = {melody, 3, 3};
+    static const Buzzer_Note_TypeDef alarm[] = {{1500, 20, 30}};
+    static const Buzzer_Pattern_TypeDef alarm_loop = {alarm, 1, 0};
+    static const Buzzer_Note_TypeDef beep[] = {{BUZZER_FREQ, 50, 0}};
+    static const Buzzer_Pattern_TypeDef beep1 = {beep, 1, 1};
+    uint32_t tick;
+    int opt, fail;
+
+    while ((opt = getopt(argc, argv, "v")) != -1)
+    {
+        if (opt == 'v')
+            Verbose = 1;
+        else
+        {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Sim_Init();
+    Delay_Init();
+    Buzzer_Init();
+    Expect1("after init", 0);
+
+    // 在两个 tick 之间开始, 之后每次前进 1ms 都正好经过一个 tick
+    tick = Delay_GetTick();
+    while (Delay_GetTick() == tick)
+        Sim_Run(1);
+    Sim_Run(US_PER_TICK / 10);
+
+    CALL(Buzzer_Play(&melody3));
+    Check("melody x3", &melody3, 400, 330);
+
+    CALL(Buzzer_Play(&alarm_loop));
+    Check("loop", &alarm_loop, 2000, 9999);
+    CALL(Buzzer_Play(&alarm_loop));
+    Check("restart", &alarm_loop, 35, -1);
+    CALL(Buzzer_Play(&melody3));         // 播放中替换
+    Check("replace", &melody3, 100, -1);
+    CALL(Buzzer_Stop());
+    Expect1("stop", 0);
+    if (Buzzer_IsBusy())
+    {
+        printf("  still busy after Buzzer_Stop\n");
+        Fail++;
+    }
+    Check("stopped", &(Buzzer_Pattern_TypeDef){melody, 0, 1}, 50, 0);
+
+    CALL(Buzzer_Beep(50));
+    Check("beep", &beep1, 80, 50);
+
+    fail = Fail;
+    CALL(Buzzer_On());
+    Expect1("on", BUZZER_FREQ);
+    Sim_Run(100 * US_PER_TICK);
+    Expect1("on after 100ms", BUZZER_FREQ);
+    CALL(Buzzer_Toggle());
+    Expect1("toggle off", 0);
+    CALL(Buzzer_Toggle());
+    Expect1("toggle on", BUZZER_FREQ);
+    CALL(Buzzer_Off());
+    Expect1("off", 0);
+    printf("%-10s %s\n", "on/off", Fail != fail ? "FAIL" : "ok");
+
+    printf(Fail ? "FAIL\n" : "PASS\n");
+    return Fail ? 1 : 0;
+}
@@ -0,0 +1,355 @@
+/**
+  ******************************************************************************
+  * @file    SimCore.c
+  * @brief   模拟器核心 - 地址映射、虚拟时间、定时器、SysTick 与 GPIO 模型、中断分发
+  * @note    每推进 1us: 调用 Sim_StepHook, SysTick 和各定时器按时钟计数, 检查比较匹配、溢出和 TIM2 输入捕获,
+  *          然后调用标志与中断使能都有效、且 NVIC 已使能的中断服务函数,
+  *          直到没有待处理的中断 (同一时刻进入次数过多视为标志未清除, 退出)
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE                     // MAP_FIXED_NOREPLACE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "Sim.h"
+
+#define SIM_IRQ_STORM       1000        // 同一时刻连续进入中断的上限
+
+/* 映射到进程中的地址段 */
+static const struct
+{
+    uintptr_t Base;
+    size_t Size;
+} Sim_Regions[] = {
+    {0x40000000, 0x30000},      // APB1 / APB2 / AHB 外设
+    {0xE0000000, 0x100000},     // 内核外设 (NVIC / SCB / SysTick)
+};
+
+/* 已建模的定时器 (弱引用: 固件没有定义的中断服务函数为空) */
+extern void TIM2_IRQHandler(void) __attribute__((weak));
+extern void TIM3_IRQHandler(void) __attribute__((weak));
+extern void TIM4_IRQHandler(void) __attribute__((weak));
+extern void SysTick_Handler(void) __attribute__((weak));
+
+typedef struct
+{
+    TIM_TypeDef *Tim;
+    IRQn_Type Irq;
+    void (*Handler)(void);
+    GPIO_TypeDef *InPort;       // CH1-CH4 输入引脚 (InPin, InPin+1, ...), 0 为不模拟捕获
+    uint8_t InPin;
+    uint16_t Sr;                // 状态寄存器 (写 0 清除, 由模拟器保存)
+    uint16_t Cnt;
+    uint8_t In[4];              // 上一步的输入电平
+} Sim_Tim_TypeDef;
+
+static Sim_Tim_TypeDef Sim_Tims[] = {
+    {TIM2, TIM2_IRQn, 0, GPIOA, 0},
+    {TIM3, TIM3_IRQn, 0, 0, 0},
+    {TIM4, TIM4_IRQn, 0, 0, 0},
+};
+#define SIM_TIM_NUM     (sizeof(Sim_Tims) / sizeof(Sim_Tims[0]))
+
+static uint8_t Sim_SysTickPending;
+
+uint32_t SystemCoreClock = SIM_CLOCK;
+uint64_t Sim_Now = 0;
+void (*Sim_StepHook)(void) = 0;
+void (*Sim_OutputHook)(GPIO_TypeDef *port, uint16_t pins, uint8_t level) = 0;
+
+/*-------------- 链接时截获的外设库函数 --------------*/
+
+static Sim_Tim_TypeDef *Sim_FindTim(TIM_TypeDef *tim)
+{
+    unsigned i;
+    for (i = 0; i < SIM_TIM_NUM; i++)
+        if (Sim_Tims[i].Tim == tim)
+            return &Sim_Tims[i];
+    return 0;
+}
+
+static void Sim_ClearSr(TIM_TypeDef *tim, uint16_t flags)
+{
+    Sim_Tim_TypeDef *t = Sim_FindTim(tim);
+    if (t)
+    {
+        t->Sr &= ~flags;
+        tim->SR = t->Sr;
+    }
+}
+
+void __wrap_TIM_ClearITPendingBit(TIM_TypeDef *TIMx, uint16_t TIM_IT)
+{
+    Sim_ClearSr(TIMx, TIM_IT);
+}
+
+void __wrap_TIM_ClearFlag(TIM_TypeDef *TIMx, uint16_t TIM_FLAG)
+{
+    Sim_ClearSr(TIMx, TIM_FLAG);
+}
+
+static void Sim_Output(GPIO_TypeDef *port, uint16_t pins, uint8_t level)
+{
+    uint16_t old = port->ODR;
+    port->ODR = level ? (old | pins) : (old & ~pins);
+    if (Sim_OutputHook && (port->ODR ^ old))
+        Sim_OutputHook(port, (port->ODR ^ old) & pins, level);
+}
+
+void __wrap_GPIO_SetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    Sim_Output(GPIOx, GPIO_Pin, 1);
+}
+
+void __wrap_GPIO_ResetBits(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    Sim_Output(GPIOx, GPIO_Pin, 0);
+}
+
+void __wrap_GPIO_WriteBit(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, BitAction BitVal)
+{
+    Sim_Output(GPIOx, GPIO_Pin, BitVal != Bit_RESET);
+}
+
+/* 忙等延时: 推进虚拟时间, 期间照常进入中断 (与真实的忙等被中断打断相同) */
+void __wrap_Delay_us(uint32_t us)
+{
+    Sim_Run(us);
+}
+
+void __wrap_Delay_ms(uint32_t ms)
+{
+    Sim_Run((uint64_t)ms * 1000);
+}
+
+/*-------------- SysTick 模型 --------------*/
+
+/* 24 位向下计数, 减到 0 后下一个时钟重装 LOAD 并置 COUNTFLAG, TICKINT 时挂起中断 */
+static void Sim_SysTickStep(void)
+{
+    uint32_t ticks, val;
+
+    if (!(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk))
+        return;
+    ticks = (SysTick->CTRL & SysTick_CTRL_CLKSOURCE_Msk) ? SIM_CLOCK / 1000000u : SIM_CLOCK / 8000000u;
+    val = SysTick->VAL & SysTick_VAL_CURRENT_Msk;
+    while (ticks)
+    {
+        if (val >= ticks)
+        {
+            val -= ticks;
+            ticks = 0;
+        }
+        else
+        {
+            ticks -= val + 1;
+            val = SysTick->LOAD & SysTick_LOAD_RELOAD_Msk;
+            SysTick->CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+            if (SysTick->CTRL & SysTick_CTRL_TICKINT_Msk)
+                Sim_SysTickPending = 1;
+        }
+    }
+    SysTick->VAL = val;
+}
+
+/*-------------- 定时器模型 --------------*/
+
+static volatile uint16_t *Sim_Ccr(TIM_TypeDef *tim, int ch)
+{
+    volatile uint16_t *ccr[4] = {&tim->CCR1, &tim->CCR2, &tim->CCR3, &tim->CCR4};
+    return ccr[ch];
+}
+
+/* 通道的 CCxS: 0 输出比较, 1 直接输入, 2 间接输入 (相邻通道的引脚) */
+static int Sim_CcSel(TIM_TypeDef *tim, int ch)
+{
+    uint16_t ccmr = (ch < 2) ? tim->CCMR1 : tim->CCMR2;
+    return (ccmr >> ((ch & 1) * 8)) & 3;
+}
+
+static void Sim_SetSr(Sim_Tim_TypeDef *t, uint16_t flags)
+{
+    t->Sr |= flags;
+    t->Tim->SR = t->Sr;
+}
+
+/* 计数器加 1 并检查溢出和比较匹配 */
+static void Sim_TimCount(Sim_Tim_TypeDef *t)
+{
+    TIM_TypeDef *tim = t->Tim;
+    int ch;
+
+    if (t->Cnt >= tim->ARR)
+    {
+        t->Cnt = 0;
+        Sim_SetSr(t, TIM_FLAG_Update);
+    }
+    else
+        t->Cnt++;
+    for (ch = 0; ch < 4; ch++)
+        if (Sim_CcSel(tim, ch) == 0 && t->Cnt == *Sim_Ccr(tim, ch))
+            Sim_SetSr(t, TIM_FLAG_CC1 << ch);
+}
+
+/* 输入捕获: 通道所选引脚出现 CCxP 所设的边沿时锁存计数值 */
+static void Sim_TimCapture(Sim_Tim_TypeDef *t)
+{
+    TIM_TypeDef *tim = t->Tim;
+    uint8_t in[4];
+    int ch, sel, ti;
+
+    if (!t->InPort)
+        return;
+    for (ch = 0; ch < 4; ch++)
+        in[ch] = (t->InPort->IDR >> (t->InPin + ch)) & 1;
+    for (ch = 0; ch < 4; ch++)
+    {
+        sel = Sim_CcSel(tim, ch);
+        if (sel == 0 || sel == 3 || !(tim->CCER & (TIM_CCER_CC1E << (ch * 4))))
+            continue;
+        ti = (sel == 1) ? ch : (ch ^ 1);
+        if (in[ti] == t->In[ti] || in[ti] == ((tim->CCER >> (ch * 4 + 1)) & 1))
+            continue;               // 没有变化, 或不是所选的边沿 (CCxP=0 上升沿, 1 下降沿)
+        if (t->Sr & (TIM_FLAG_CC1 << ch))
+            Sim_SetSr(t, TIM_FLAG_CC1OF << ch);
+        *Sim_Ccr(tim, ch) = t->Cnt;
+        Sim_SetSr(t, TIM_FLAG_CC1 << ch);
+    }
+    memcpy(t->In, in, sizeof(in));
+}
+
+static void Sim_TimStep(Sim_Tim_TypeDef *t)
+{
+    TIM_TypeDef *tim = t->Tim;
+    uint32_t ticks, i;
+
+    if (tim->EGR & TIM_EGR_UG)      // 软件更新事件: 计数器清零
+    {
+        tim->EGR = 0;
+        t->Cnt = 0;
+    }
+    if (tim->CR1 & TIM_CR1_CEN)
+    {
+        if (SIM_CLOCK % ((tim->PSC + 1) * 1000000u) != 0)
+        {
+            fprintf(stderr, "sim: TIM PSC=%u 不是 1MHz 的整数倍计数, 不支持\n", tim->PSC);
+            exit(2);
+        }
+        ticks = SIM_CLOCK / 1000000u / (tim->PSC + 1);
+        for (i = 0; i < ticks; i++)
+            Sim_TimCount(t);
+        tim->CNT = t->Cnt;
+    }
+    Sim_TimCapture(t);
+}
+
+/*-------------- 中断分发 --------------*/
+
+static int Sim_IrqEnabled(IRQn_Type irq)
+{
+    return (NVIC->ISER[irq >> 5] >> (irq & 31)) & 1;
+}
+
+static void Sim_Dispatch(void)
+{
+    unsigned i, n;
+    int pending;
+
+    for (n = 0; n < SIM_IRQ_STORM; n++)
+    {
+        pending = 0;
+        if (Sim_SysTickPending && SysTick_Handler)
+        {
+            Sim_SysTickPending = 0;
+            SysTick_Handler();
+            pending = 1;
+        }
+        for (i = 0; i < SIM_TIM_NUM; i++)
+        {
+            Sim_Tim_TypeDef *t = &Sim_Tims[i];
+            if ((t->Sr & t->Tim->DIER & 0xFF) && Sim_IrqEnabled(t->Irq) && t->Handler)
+            {
+                t->Handler();
+                pending = 1;
+            }
+        }
+        if (!pending)
+            return;
+    }
+    fprintf(stderr, "sim: 中断标志未清除 (t=%lluus)\n", (unsigned long long)Sim_Now);
+    exit(2);
+}
+
+/*-------------- 接口 --------------*/
+
+/**
+  * @brief  映射外设地址, 复位模型; 须在调用任何固件函数之前
+  */
+void Sim_Init(void)
+{
+    unsigned i;
+    static int mapped = 0;
+
+    if (!mapped)
+    {
+        for (i = 0; i < sizeof(Sim_Regions) / sizeof(Sim_Regions[0]); i++)
+        {
+            void *p = mmap((void *)Sim_Regions[i].Base, Sim_Regions[i].Size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+            if (p != (void *)Sim_Regions[i].Base)
+            {
+                perror("sim: mmap");
+                exit(2);
+            }
+        }
+        mapped = 1;
+    }
+    for (i = 0; i < sizeof(Sim_Regions) / sizeof(Sim_Regions[0]); i++)
+        memset((void *)Sim_Regions[i].Base, 0, Sim_Regions[i].Size);
+
+    Sim_Tims[0].Handler = TIM2_IRQHandler;
+    Sim_Tims[1].Handler = TIM3_IRQHandler;
+    Sim_Tims[2].Handler = TIM4_IRQHandler;
+    for (i = 0; i < SIM_TIM_NUM; i++)
+    {
+        Sim_Tims[i].Sr = 0;
+        Sim_Tims[i].Cnt = 0;
+        memset(Sim_Tims[i].In, 0, sizeof(Sim_Tims[i].In));
+        Sim_Tims[i].Tim->ARR = 0xFFFF;      // 复位值
+    }
+    Sim_SysTickPending = 0;
+    Sim_Now = 0;
+    Sim_StepHook = 0;
+    Sim_OutputHook = 0;
+}
+
+/**
+  * @brief  设置输入引脚电平 (IDR), 下一步推进时生效
+  */
+void Sim_SetInput(GPIO_TypeDef *port, uint16_t pins, uint8_t level)
+{
+    port->IDR = level ? (port->IDR | pins) : (port->IDR & ~pins);
+}
+
+/**
+  * @brief  推进虚拟时间, 期间按时间顺序调用中断服务函数
+  */
+void Sim_Run(uint64_t us)
+{
+    uint64_t end = Sim_Now + us;
+    unsigned i;
+
+    Sim_Dispatch();                 // 固件刚打开的中断
+    while (Sim_Now < end)
+    {
+        Sim_Now++;
+        if (Sim_StepHook)
+            Sim_StepHook();
+        Sim_SysTickStep();
+        for (i = 0; i < SIM_TIM_NUM; i++)
+            Sim_TimStep(&Sim_Tims[i]);
+        Sim_Dispatch();
+    }
+}
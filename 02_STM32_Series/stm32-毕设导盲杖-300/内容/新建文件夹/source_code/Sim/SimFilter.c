@@ -0,0 +1,210 @@
+/**
+  ******************************************************************************
+  * @file    SimFilter.c
+  * @brief   距离滤波测试 - 把记录的回波序列送入 System/DistFilter.c, 与真实距离比较
+  * @note    用法: ./filter_test [-v] 序列文件...
+  *          序列格式见 traces/make_traces.py. 文件中的 "# check" 行:
+  *            dist <mm>        距离误差不超过 mm
+  *            closing <mm/s>   接近速度误差不超过 mm/s
+  *            ttc <%>          真实接近速度 >= 300mm/s 时, 碰撞时间误差不超过百分之几
+  *            no_ttc           碰撞时间始终不短于 FALSE_TTC_MS (不会误报)
+  *            reacquire <n>    目标出现后 n 个样本内跟上, 消失后 n 个样本内报告没有目标
+  *          起始、目标出现/消失、速度改变之后的一段过渡期不检查距离和速度.
+  *          全部通过时退出码为 0, 否则为 1
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "DistFilter.h"
+
+#define TRACE_MAX           4096
+#define SETTLE_DIST         6           // 过渡期 (样本): 距离
+#define SETTLE_VEL          12          // 过渡期 (样本): 速度
+#define FALSE_TTC_MS        4000        // no_ttc: 短于此值算误报
+#define TTC_MIN_CLOSING     300         // ttc: 只在真实接近速度不低于此值时检查
+
+typedef struct
+{
+    uint32_t T;                 // ms
+    uint32_t Echo;              // us, 0 为无回波
+    int32_t Truth;              // mm, -1 为没有目标
+} Sample_TypeDef;
+
+static Sample_TypeDef Trace[TRACE_MAX];
+static int Verbose;
+
+/* 检查项, -1 为不检查 */
+static struct
+{
+    int Dist, Closing, Ttc, NoTtc, Reacquire;
+} Check;
+
+static int Load(const char *path, int *n)
+{
+    char line[256];
+    FILE *fp = fopen(path, "r");
+    int value;
+
+    if (!fp)
+    {
+        perror(path);
+        return -1;
+    }
+    memset(&Check, 0xFF, sizeof(Check));
+    Check.NoTtc = 0;
+    *n = 0;
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (line[0] == '#')
+        {
+            if (sscanf(line, "# check dist %d", &value) == 1) Check.Dist = value;
+            else if (sscanf(line, "# check closing %d", &value) == 1) Check.Closing = value;
+            else if (sscanf(line, "# check ttc %d", &value) == 1) Check.Ttc = value;
+            else if (sscanf(line, "# check reacquire %d", &value) == 1) Check.Reacquire = value;
+            else if (strncmp(line, "# check no_ttc", 14) == 0) Check.NoTtc = 1;
+            continue;
+        }
+        if (*n < TRACE_MAX && sscanf(line, "%u %u %d", &Trace[*n].T, &Trace[*n].Echo, &Trace[*n].Truth) == 3)
+            (*n)++;
+    }
+    fclose(fp);
+    return 0;
+}
+
+static int Run(const char *path)
+{
+    DistFilter_TypeDef f;
+    int n, i, fail = 0;
+    int settle_dist = 0, settle_vel = 0, since_change = 0;
+    int32_t truth_vel = 0, prev_vel = 0, dist, closing, max_dist_err = 0, max_vel_err = 0;
+    uint32_t ttc, truth_ttc, min_ttc = DISTFILTER_TTC_NONE;
+    int ttc_err, max_ttc_err = 0;
+    unsigned dt;
+
+    if (Load(path, &n) < 0 || n == 0)
+        return 1;
+
+    DistFilter_Init(&f);
+    for (i = 0; i < n; i++)
+    {
+        const Sample_TypeDef *s = &Trace[i];
+        int32_t mm = s->Echo ? (int32_t)((s->Echo * 1715u + 5000) / 10000) : DISTFILTER_NONE;
+        int appeared = 0;
+
+        dt = i ? s->T - Trace[i - 1].T : 0;
+        DistFilter_Update(&f, mm, dt);
+        dist = DistFilter_GetDistance(&f);
+        closing = DistFilter_GetClosing(&f);
+        ttc = DistFilter_GetTtc(&f);
+
+        // 真实的接近速度; 出现/消失/变速后进入过渡期
+        if (i == 0 || (s->Truth < 0) != (Trace[i - 1].Truth < 0))
+        {
+            appeared = 1;
+            truth_vel = 0;
+            since_change = 0;
+        }
+        else if (s->Truth >= 0)
+            truth_vel = (Trace[i - 1].Truth - s->Truth) * 1000 / (int32_t)dt;
+        if (appeared || abs(truth_vel - prev_vel) > 100)
+        {
+            settle_dist = SETTLE_DIST;
+            settle_vel = SETTLE_VEL;
+        }
+        prev_vel = truth_vel;
+        since_change++;
+
+        if (Verbose)
+            printf("  %6ums  raw %5d  truth %5d  dist %5d  closing %6d  ttc %6d\n", s->T, mm, s->Truth,
+                   dist, closing, ttc == DISTFILTER_TTC_NONE ? -1 : (int)ttc);
+
+        if (Check.Reacquire >= 0 && since_change == Check.Reacquire + 1 &&
+            (s->Truth < 0) != (dist < 0))
+        {
+            printf("  %ums: %s not followed within %d samples\n", s->T,
+                   s->Truth < 0 ? "target loss" : "new target", Check.Reacquire);
+            fail++;
+        }
+        if (Check.NoTtc && ttc < min_ttc)
+            min_ttc = ttc;
+
+        if (settle_dist > 0)
+            settle_dist--;
+        else if (Check.Dist >= 0)
+        {
+            int32_t err = (s->Truth < 0 || dist < 0) ? ((s->Truth < 0) == (dist < 0) ? 0 : 99999)
+                                                    : abs(dist - s->Truth);
+            if (err > max_dist_err)
+                max_dist_err = err;
+        }
+        if (settle_vel > 0)
+            settle_vel--;
+        else if (s->Truth >= 0)
+        {
+            if (Check.Closing >= 0 && abs(closing - truth_vel) > max_vel_err)
+                max_vel_err = abs(closing - truth_vel);
+            if (Check.Ttc >= 0 && truth_vel >= TTC_MIN_CLOSING)
+            {
+                truth_ttc = (uint32_t)s->Truth * 1000 / truth_vel;
+                ttc_err = ttc == DISTFILTER_TTC_NONE ? 100 : abs((int)ttc - (int)truth_ttc) * 100 / (int)truth_ttc;
+                if (ttc_err > max_ttc_err)
+                    max_ttc_err = ttc_err;
+            }
+        }
+    }
+
+    printf("%-24s %4d samples", path, n);
+    if (Check.Dist >= 0)
+    {
+        printf("  dist err %dmm (<=%d)", max_dist_err, Check.Dist);
+        fail += max_dist_err > Check.Dist;
+    }
+    if (Check.Closing >= 0)
+    {
+        printf("  closing err %dmm/s (<=%d)", max_vel_err, Check.Closing);
+        fail += max_vel_err > Check.Closing;
+    }
+    if (Check.Ttc >= 0)
+    {
+        printf("  ttc err %d%% (<=%d)", max_ttc_err, Check.Ttc);
+        fail += max_ttc_err > Check.Ttc;
+    }
+    if (Check.NoTtc)
+    {
+        if (min_ttc == DISTFILTER_TTC_NONE)
+            printf("  no ttc");
+        else
+            printf("  min ttc %ums (>=%d)", min_ttc, FALSE_TTC_MS);
+        fail += min_ttc < FALSE_TTC_MS;
+    }
+    printf("  %s\n", fail ? "FAIL" : "ok");
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    int opt, i, fail = 0;
+
+    while ((opt = getopt(argc, argv, "v")) != -1)
+    {
+        if (opt == 'v')
+            Verbose = 1;
+        else
+        {
+            fprintf(stderr, "usage: %s [-v] 序列文件...\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "usage: %s [-v] 序列文件...\n", argv[0]);
+        return 2;
+    }
+    for (i = optind; i < argc; i++)
+        fail += Run(argv[i]) != 0;
+    printf(fail ? "FAIL\n" : "PASS\n");
+    return fail ? 1 : 0;
+}
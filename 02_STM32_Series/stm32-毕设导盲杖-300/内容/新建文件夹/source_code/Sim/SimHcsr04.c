@@ -0,0 +1,256 @@
+/**
+  ******************************************************************************
+  * @file    SimHcsr04.c
+  * @brief   超声波阵列测试 - HC-SR04 模块与声波传播模型, 检查轮流触发的速率和防串扰规则
+  * @note    用法: ./hcsr04_sim [-t 每个场景的秒数] [-v]
+  *          System/HCSR04.c 原样编译, 在几个障碍物场景中各运行一段虚拟时间:
+  *          - 每次结果与本模块回波的理论宽度一致 (没有被别的模块的声波提前结束)
+  *          - 任意两次触发间隔不小于 HCSR04_SLOT_MIN_US, 同一模块不小于 HCSR04_REPEAT_MIN_US
+  *          - 每个模块的测量次数符合 HCSR04_PERIOD_US
+  *          全部通过时退出码为 0, 否则为 1
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Sim.h"
+#include "HCSR04.h"
+
+#define SOUND_CM_PER_US     0.0343      // 声速
+#define MOD_RISE_US         450         // 触发结束到 Echo 变高 (模块发 8 个 40kHz 脉冲)
+#define MOD_TIMEOUT_US      38000       // 收不到回波时 Echo 的高电平宽度
+#define MOD_HEAR_CM         1000        // 声程超过此值 (约 5m 处的反射) 太弱, 收不到
+#define PING_MAX            16          // 保留最近几次发射, 更早的已经衰减
+
+typedef struct
+{
+    const char *Name;
+    int Dist[HCSR04_NUM];       // 各模块正前方障碍物距离 (cm), 0 为没有
+} Scene_TypeDef;
+
+static const Scene_TypeDef Scenes[] = {
+    {"corridor",  {150, 80, 300}},
+    {"near+far",  {30, 390, 0}},
+    {"open",      {0, 0, 0}},
+    {"close",     {5, 12, 20}},
+    {"beyond",    {450, 200, 120}},     // 超出量程的反射仍能听到
+};
+
+static const HCSR04_Sensor_TypeDef Sensors[HCSR04_NUM] = HCSR04_SENSORS;
+
+/* 模块状态 */
+static struct
+{
+    uint64_t TrigRise;          // Trig 变高的时刻, 0 表示低
+    uint64_t Emit;              // 发射 (Echo 变高) 的时刻, 0 表示空闲
+    uint64_t Fall;              // Echo 将变低的时刻
+    int Listening;              // Echo 为高
+    int Foreign;                // Fall 来自别的模块的声波
+} Mod[HCSR04_NUM];
+
+static struct
+{
+    int Sensor;
+    uint64_t Emit;
+} Pings[PING_MAX];
+static int PingNext;
+
+static const Scene_TypeDef *Scene;
+static int Verbose;
+
+/* 检查结果 */
+static struct
+{
+    unsigned Results, Wrong, Crosstalk, Triggers, ShortPulse;
+    uint64_t LastTrig;          // 本模块上次触发时刻
+    uint64_t MinRepeat;         // 本模块两次触发的最小间隔
+} Stat[HCSR04_NUM];
+static uint64_t LastTrigAny, MinGap;      // 相邻两次触发 (任意模块) 的最小间隔
+
+/* 声程 (cm): 模块 from 发射, 模块 to 接收; 0 为收不到 */
+static int Path(int from, int to)
+{
+    int d = Scene->Dist[from];
+    int path;
+
+    if (!d)
+        return 0;
+    if (from == to)
+        path = 2 * d;
+    else
+        path = d + (Scene->Dist[to] ? Scene->Dist[to] : d);     // 经障碍物散射到旁边的模块
+    return path <= MOD_HEAR_CM ? path : 0;
+}
+
+static uint64_t Arrival(int from, uint64_t emit, int to)
+{
+    int path = Path(from, to);
+    return path ? emit + (uint64_t)(path / SOUND_CM_PER_US + 0.5) : 0;
+}
+
+/* 理论回波宽度: 本模块的反射, 超出量程为 HCSR04_NO_ECHO */
+static uint32_t Expected(int sensor)
+{
+    int path = Path(sensor, sensor);
+    uint32_t us = path ? (uint32_t)(path / SOUND_CM_PER_US + 0.5) : 0;
+    return us > HCSR04_ECHO_MAX_US ? HCSR04_NO_ECHO : us;
+}
+
+/* 声波 (from, emit) 先于 to 原定的回波到达时, 提前结束 to 的 Echo */
+static void Hear(int from, uint64_t emit, int to)
+{
+    uint64_t t = Arrival(from, emit, to);
+
+    if (t > Mod[to].Emit && t < Mod[to].Fall)
+    {
+        Mod[to].Fall = t;
+        Mod[to].Foreign = (from != to);
+    }
+}
+
+static void OnOutput(GPIO_TypeDef *port, uint16_t pins, uint8_t level)
+{
+    int i;
+
+    for (i = 0; i < HCSR04_NUM; i++)
+    {
+        if (Sensors[i].TrigPort != port || !(pins & Sensors[i].TrigPin))
+            continue;
+        if (level)
+        {
+            Mod[i].TrigRise = Sim_Now;
+            Stat[i].Triggers++;
+            if (Stat[i].LastTrig && Sim_Now - Stat[i].LastTrig < Stat[i].MinRepeat)
+                Stat[i].MinRepeat = Sim_Now - Stat[i].LastTrig;
+            Stat[i].LastTrig = Sim_Now;
+            if (LastTrigAny && Sim_Now - LastTrigAny < MinGap)
+                MinGap = Sim_Now - LastTrigAny;
+            LastTrigAny = Sim_Now;
+            continue;
+        }
+        if (Sim_Now - Mod[i].TrigRise < 10)
+            Stat[i].ShortPulse++;
+        else if (!Mod[i].Emit)              // 正在测量时模块不响应触发
+            Mod[i].Emit = Sim_Now + MOD_RISE_US;
+        Mod[i].TrigRise = 0;
+    }
+}
+
+static void OnStep(void)
+{
+    int i, j, k;
+
+    for (i = 0; i < HCSR04_NUM; i++)
+    {
+        if (Mod[i].Emit == Sim_Now)
+        {
+            // 发射: 本模块开始听, 已在听的模块也可能收到这次的声波
+            Mod[i].Listening = 1;
+            Mod[i].Fall = Sim_Now + MOD_TIMEOUT_US;
+            Mod[i].Foreign = 0;
+            Sim_SetInput(Sensors[i].EchoPort, Sensors[i].EchoPin, 1);
+            for (k = 0; k < PING_MAX; k++)
+                if (Pings[k].Emit)
+                    Hear(Pings[k].Sensor, Pings[k].Emit, i);
+            Pings[PingNext].Sensor = i;
+            Pings[PingNext].Emit = Sim_Now;
+            PingNext = (PingNext + 1) % PING_MAX;
+            for (j = 0; j < HCSR04_NUM; j++)
+                if (Mod[j].Listening)
+                    Hear(i, Sim_Now, j);
+        }
+        if (Mod[i].Listening && Mod[i].Fall == Sim_Now)
+        {
+            // 别的模块的声波在量程内结束了 Echo, 会被当作本模块的回波
+            if (Mod[i].Foreign && Sim_Now - Mod[i].Emit <= HCSR04_ECHO_MAX_US)
+                Stat[i].Crosstalk++;
+            Mod[i].Listening = 0;
+            Mod[i].Emit = 0;
+            Sim_SetInput(Sensors[i].EchoPort, Sensors[i].EchoPin, 0);
+        }
+    }
+}
+
+static void OnEcho(uint8_t sensor, uint32_t echo_us)
+{
+    uint32_t expect = Expected(sensor);
+    int diff = (int)echo_us - (int)expect;
+
+    Stat[sensor].Results++;
+    if (diff < -1 || diff > 1 || (expect == HCSR04_NO_ECHO) != (echo_us == HCSR04_NO_ECHO))
+        Stat[sensor].Wrong++;
+    if (Verbose)
+        printf("  %9.3fms  #%u  %5uus  %6.1fcm  (expect %uus)\n", Sim_Now / 1000.0, sensor,
+               echo_us, echo_us * HCSR04_CM_PER_US, expect);
+}
+
+/* 运行一个场景, 返回失败项数 */
+static int RunScene(const Scene_TypeDef *scene, double seconds)
+{
+    uint64_t us = (uint64_t)(seconds * 1e6);
+    double expect_rate = 1e6 / HCSR04_PERIOD_US;
+    int i, fail = 0;
+
+    Scene = scene;
+    memset(Mod, 0, sizeof(Mod));
+    memset(Pings, 0, sizeof(Pings));
+    memset(Stat, 0, sizeof(Stat));
+    PingNext = 0;
+    LastTrigAny = 0;
+    MinGap = UINT64_MAX;
+    for (i = 0; i < HCSR04_NUM; i++)
+        Stat[i].MinRepeat = UINT64_MAX;
+
+    Sim_Init();
+    Sim_StepHook = OnStep;
+    Sim_OutputHook = OnOutput;
+    HCSR04_Init();
+    HCSR04_Run(OnEcho);
+    Sim_Run(us);
+    HCSR04_Stop();
+
+    printf("%-10s min gap %lluus (>= %u), per-sensor %.2fHz expected\n", scene->Name,
+           (unsigned long long)MinGap, (unsigned)HCSR04_SLOT_MIN_US, expect_rate);
+    if (MinGap < HCSR04_SLOT_MIN_US)
+        fail++;
+    for (i = 0; i < HCSR04_NUM; i++)
+    {
+        double rate = Stat[i].Results / seconds;
+        int ok = Stat[i].Wrong == 0 && Stat[i].Crosstalk == 0 && Stat[i].ShortPulse == 0 &&
+                 Stat[i].MinRepeat >= HCSR04_REPEAT_MIN_US &&
+                 Stat[i].Results + 1 >= (unsigned)(expect_rate * seconds);
+        printf("  #%d %4dcm  results %4u  %6.2fHz  repeat %lluus  wrong %u  crosstalk %u  %s\n",
+               i, scene->Dist[i], Stat[i].Results, rate, (unsigned long long)Stat[i].MinRepeat,
+               Stat[i].Wrong, Stat[i].Crosstalk, ok ? "ok" : "FAIL");
+        fail += !ok;
+    }
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 10;
+    unsigned i;
+    int opt, fail = 0;
+
+    while ((opt = getopt(argc, argv, "t:v")) != -1)
+    {
+        switch (opt)
+        {
+            case 't': seconds = atof(optarg); break;
+            case 'v': Verbose = 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-t 每个场景的秒数] [-v]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    printf("%d sensors, slot %uus, period %uus, range %dcm\n", HCSR04_NUM,
+           (unsigned)HCSR04_SLOT_US, (unsigned)HCSR04_PERIOD_US, HCSR04_RANGE_MAX_CM);
+    for (i = 0; i < sizeof(Scenes) / sizeof(Scenes[0]); i++)
+        fail += RunScene(&Scenes[i], seconds);
+    printf(fail ? "FAIL\n" : "PASS\n");
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+/**
+  ******************************************************************************
+  * @file    SimSched.c
+  * @brief   调度器测试 - SysTick 时基驱动 System/Sched.c, 检查周期、期限和超时计数
+  * @note    用法: ./sched_test [-t 每个场景的秒数] [-v]
+  *          System/Delay.c 和 System/Sched.c 原样编译, SysTick 由模拟器计数并进入 SysTick_Handler.
+  *          任务用 Delay_ms 模拟执行时间 (虚拟时间推进, 期间照常进入中断). 检查:
+  *          - 毫秒计数与虚拟时间一致
+  *          - 没有被耽误的任务准时执行 (就绪时刻 = 错开 + n x 周期), 次数符合周期, 没有累积漂移
+  *          - 被长任务耽误的任务: 超时和跳过的次数与预计相同, 之后回到原来的节拍
+  *          全部通过时退出码为 0, 否则为 1
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Sim.h"
+#include "Delay.h"
+#include "Sched.h"
+
+#define TASK_MAX        6
+
+typedef struct
+{
+    const char *Name;
+    uint16_t Period, Deadline, Offset;
+    uint16_t Cost;              // 每次执行的时间 (ms)
+    uint16_t CostEvery;         // 每几次执行中有一次耗时 Cost, 0 为每次
+    /* 预计 (每秒): 超时次数, 跳过次数; -1 为不检查 */
+    int Overruns, Skips;
+} TaskSpec_TypeDef;
+
+typedef struct
+{
+    const char *Name;
+    TaskSpec_TypeDef Tasks[TASK_MAX];
+} Scene_TypeDef;
+
+static const Scene_TypeDef Scenes[] = {
+    // 导盲杖主程序的任务表, 每个任务都很短
+    {"cane", {
+        {"measure", 10, 10, 0, 0, 0, 0, 0},
+        {"alarm", 10, 10, 1, 0, 0, 0, 0},
+        {"key", 10, 20, 2, 0, 0, 0, 0},
+        {"report", 200, 50, 3, 0, 0, 0, 0},
+        {"display", 50, 100, 4, 0, 0, 0, 0},
+    }},
+    // 显示任务每 100ms 执行一次、每次 25ms (1-26ms): 10ms 任务的 10ms 就绪到 26ms 才执行, 超时,
+    // 20ms 已过, 跳过; 20ms 任务的 5ms 就绪 26ms 执行, 未超过 30ms 期限, 25ms 跳过
+    {"slow display", {
+        {"fast", 10, 10, 0, 0, 0, 10, 10},
+        {"medium", 20, 30, 5, 0, 0, 0, 10},
+        {"display", 100, 100, 1, 25, 0, 0, 0},
+    }},
+    // 偶尔一次 35ms (例如重画整屏), 5 次中 1 次即每秒 2 次: 每次 10ms 任务超时 1 次、跳过 2 个周期
+    {"occasional", {
+        {"fast", 10, 10, 0, 0, 0, 2, 4},
+        {"display", 100, 100, 1, 35, 5, 0, 0},
+    }},
+};
+
+static const Scene_TypeDef *Scene;
+static Sched_Task_TypeDef Tasks[TASK_MAX];
+static int TaskNum;
+static uint32_t Tick0;          // 场景开始时的毫秒计数 (计数不随 Sim_Init 清零)
+static int Verbose;
+
+/* 每个任务的执行记录 */
+static struct
+{
+    unsigned Runs;
+    unsigned Late;              // 晚于节拍上的就绪时刻开始
+    unsigned Early;             // 早于就绪时刻开始 (错误)
+    uint32_t Expect;            // 下一个节拍上的就绪时刻
+} Stat[TASK_MAX];
+
+static void Task(int i)
+{
+    const TaskSpec_TypeDef *spec = &Scene->Tasks[i];
+    uint32_t now = Delay_GetTick() - Tick0;
+
+    // 没有被耽误时应正好在就绪时刻开始, 被耽误之后仍回到错开 + n x 周期的节拍上
+    if (now < Stat[i].Expect)
+        Stat[i].Early++;
+    else if (now > Stat[i].Expect)
+        Stat[i].Late++;
+    if (Verbose)
+        printf("  %7ums  %s\n", now, spec->Name);
+    Stat[i].Runs++;
+    if (spec->Cost && (spec->CostEvery == 0 || Stat[i].Runs % spec->CostEvery == 0))
+        Delay_ms(spec->Cost);
+    Stat[i].Expect = spec->Offset + ((now - spec->Offset) / spec->Period + 1) * spec->Period;
+}
+
+#define TASK_FN(n)  static void Task##n(void) { Task(n); }
+TASK_FN(0) TASK_FN(1) TASK_FN(2) TASK_FN(3) TASK_FN(4) TASK_FN(5)
+static void (*const TaskFns[TASK_MAX])(void) = {Task0, Task1, Task2, Task3, Task4, Task5};
+
+/* 运行一个场景, 返回失败项数 */
+static int RunScene(const Scene_TypeDef *scene, double seconds)
+{
+    uint64_t end;
+    uint32_t tick;
+    int i, fail = 0;
+
+    Scene = scene;
+    memset(Tasks, 0, sizeof(Tasks));
+    memset(Stat, 0, sizeof(Stat));
+    Sim_Init();
+    Delay_Init();
+    Tick0 = Delay_GetTick();
+
+    for (TaskNum = 0; TaskNum < TASK_MAX && scene->Tasks[TaskNum].Name; TaskNum++)
+    {
+        const TaskSpec_TypeDef *spec = &scene->Tasks[TaskNum];
+        Tasks[TaskNum].Name = spec->Name;
+        Tasks[TaskNum].Run = TaskFns[TaskNum];
+        Tasks[TaskNum].Period = spec->Period;
+        Tasks[TaskNum].Deadline = spec->Deadline;
+        Tasks[TaskNum].Offset = spec->Offset;
+        Stat[TaskNum].Expect = spec->Offset;
+    }
+    Sched_Init(Tasks, TaskNum);
+
+    // 与 Sched_Run 相同, 没有就绪的任务时让时间前进
+    end = Sim_Now + (uint64_t)(seconds * 1e6);
+    while (Sim_Now < end)
+        if (!Sched_Poll())
+            Sim_Run(1);
+
+    tick = Delay_GetTick() - Tick0;
+    printf("%-12s tick %ums at %.3fs\n", scene->Name, tick, Sim_Now / 1e6);
+    if (tick != Sim_Now / 1000)
+    {
+        printf("  tick does not match virtual time\n");
+        fail++;
+    }
+    for (i = 0; i < TaskNum; i++)
+    {
+        const TaskSpec_TypeDef *spec = &scene->Tasks[i];
+        const Sched_Task_TypeDef *t = &Tasks[i];
+        unsigned releases = (tick - spec->Offset) / spec->Period + 1;
+        int ok = t->Runs == Stat[i].Runs && Stat[i].Early == 0 &&
+                 (unsigned)(t->Runs + t->Skips) + 1 >= releases && t->Runs + t->Skips <= releases;
+        if (spec->Overruns >= 0 && t->Overruns != (unsigned)(spec->Overruns * seconds + 0.5))
+            ok = 0;
+        if (spec->Skips >= 0 && t->Skips != (unsigned)(spec->Skips * seconds + 0.5))
+            ok = 0;
+        if (spec->Overruns == 0 && spec->Skips == 0 && Stat[i].Late)
+            ok = 0;                 // 不受影响的任务必须准时
+        printf("  %-8s period %3ums  runs %5u  late %4u  overruns %4u  skips %4u  max latency %3ums  %s\n",
+               t->Name, t->Period, t->Runs, Stat[i].Late, t->Overruns, t->Skips, t->MaxLatency,
+               ok ? "ok" : "FAIL");
+        fail += !ok;
+    }
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 10;
+    unsigned i;
+    int opt, fail = 0;
+
+    while ((opt = getopt(argc, argv, "t:v")) != -1)
+    {
+        switch (opt)
+        {
+            case 't': seconds = atof(optarg); break;
+            case 'v': Verbose = 1; break;
+            default:
+                fprintf(stderr, "usage: %s [-t 每个场景的秒数] [-v]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    for (i = 0; i < sizeof(Scenes) / sizeof(Scenes[0]); i++)
+        fail += RunScene(&Scenes[i], seconds);
+    printf(fail ? "FAIL\n" : "PASS\n");
+    return fail ? 1 : 0;
+}
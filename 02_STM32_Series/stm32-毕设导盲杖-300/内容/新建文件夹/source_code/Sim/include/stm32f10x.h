@@ -0,0 +1,17 @@
+/*
+ * 模拟器用的 stm32f10x.h 包装: 先包含 Start/stm32f10x.h 取得寄存器定义和外设库,
+ * 再把中断开关和 WFI 换成空操作. 模拟器只在固件函数返回后才调用中断服务函数,
+ * 主程序不会被中断打断, 关中断无需实现. core_cm3.h 中 GCC 分支的内联汇编函数
+ * 因不再被调用, 不会生成代码.
+ */
+
+#ifndef __SIM_STM32F10X_H
+#define __SIM_STM32F10X_H
+
+#include_next "stm32f10x.h"
+
+#define __disable_irq()     ((void)0)
+#define __enable_irq()      ((void)0)
+#define __WFI()             ((void)0)
+
+#endif
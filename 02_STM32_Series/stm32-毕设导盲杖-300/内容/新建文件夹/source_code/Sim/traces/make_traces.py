@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+生成距离滤波测试用的回波序列 (filter_test 的输入)
+
+格式与串口记录相同, 每行: 时刻(ms) 回波宽度(us, 0=无回波) 真实距离(mm, -1=没有目标)
+以 # 开头的行为注释, "# check ..." 行为 filter_test 的检查项.
+真实距离按场景生成, 回波宽度加上 HC-SR04 常见的误差: 几 mm 的抖动、偶发的错误近回波
+(地面、旁边的物体) 和丢失的回波. 固定随机种子, 每次生成的结果相同.
+
+用法: python3 make_traces.py   (在本目录生成 *.txt)
+"""
+
+import random
+
+PERIOD_MS = 91          # 三个模块轮流测量时每个模块的周期
+US_PER_MM = 10000 / 1715
+
+
+def write(name, title, checks, truth, spike=0.05, drop=0.05, seed=1):
+    rnd = random.Random(seed)
+    lines = [f'# {title}', '# 合成数据: 真实距离 + 抖动 +-3mm, 错误近回波 {:.0%}, 丢失 {:.0%}'.format(spike, drop)]
+    lines += [f'# check {c}' for c in checks]
+    for i, mm in enumerate(truth):
+        t = i * PERIOD_MS
+        if mm < 0:
+            echo = 0 if rnd.random() > spike else round(rnd.uniform(150, 1500) * US_PER_MM)
+        else:
+            r = rnd.random()
+            if r < drop:
+                echo = 0
+            elif r < drop + spike:
+                echo = round(rnd.uniform(150, max(200, mm * 0.8)) * US_PER_MM)
+            else:
+                echo = round((mm + rnd.gauss(0, 1.5)) * US_PER_MM)
+        lines.append(f'{t} {echo} {round(mm)}')
+    with open(name, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+def ramp(start, speed_mm_s, n):
+    return [start - speed_mm_s * i * PERIOD_MS / 1000 for i in range(n)]
+
+
+def main():
+    # 以 1m/s 走向墙, 在 40cm 处停下
+    walk = [mm for mm in ramp(3000, 1000, 80) if mm >= 400]
+    write('approach_wall.txt', '以 1m/s 走向墙, 40cm 处停下',
+          ['dist 40', 'closing 150', 'ttc 25'],
+          walk + [400] * 30, seed=1)
+
+    # 站在 1.5m 外的人, 较多错误回波
+    write('stationary.txt', '1.5m 外静止目标, 错误近回波和丢失各 10%',
+          ['dist 20', 'closing 60', 'no_ttc'],
+          [1500] * 120, spike=0.10, drop=0.10, seed=2)
+
+    # 空旷 -> 行人突然出现在 80cm -> 离开
+    write('step_in.txt', '空旷, 行人在 80cm 处出现 3 秒后离开',
+          ['dist 20', 'reacquire 4', 'no_ttc'],
+          [-1] * 30 + [800] * 33 + [-1] * 30, seed=3)
+
+    # 走向远处的墙时, 行人从侧面走到前方 90cm 处, 继续走近后停下
+    write('cut_in.txt', '以 0.8m/s 走向 3m 外的墙, 行人切入到 90cm 处',
+          ['dist 40', 'closing 150', 'ttc 25'],
+          ramp(3000, 800, 20) + ramp(900, 800, 10) + [300] * 20, seed=5)
+
+    # 斜着经过一根柱子: 先以 1.2m/s 接近, 再远离
+    near = ramp(2500, 1200, 18)
+    write('pass_by.txt', '经过柱子: 以 1.2m/s 接近到约 60cm 后远离',
+          ['dist 50', 'closing 200', 'ttc 30'],
+          near + near[::-1], seed=4)
+
+
+if __name__ == '__main__':
+    main()
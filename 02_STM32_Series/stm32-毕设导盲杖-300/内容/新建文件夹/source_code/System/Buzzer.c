@@ -1,29 +1,180 @@
 #include "Buzzer.h"
 #include "Delay.h"
 
+/*
+ * BUZZER_TIM 以 1MHz 计数, 周期 = 1000000 / 音调, CCR2 为半个周期 (PWM1).
+ * 只用互补输出 CH2N, 极性取反: 静音时强制 OC2REF 无效, 引脚保持高电平 (不响).
+ * 序列状态只在关中断时修改, SysTick 中断中的 Buzzer_Tick 读到的总是完整的状态.
+ */
+
+static const Buzzer_Pattern_TypeDef *volatile Buzzer_Pattern = 0;  // 正在播放的序列, 0 为没有
+static uint8_t Buzzer_Index;                        // 当前音
+static uint8_t Buzzer_Done;                         // 已播放完的遍数
+static uint8_t Buzzer_InGap;                        // 1: 当前音的间隔
+static uint16_t Buzzer_Left;                        // 当前阶段剩余 ms
+static uint8_t Buzzer_Sounding;                     // 1: 正在发声
+
+// Buzzer_Beep 用的单音序列
+static Buzzer_Note_TypeDef Buzzer_BeepNote = {BUZZER_FREQ, 0, 0};
+static const Buzzer_Pattern_TypeDef Buzzer_BeepPattern = {&Buzzer_BeepNote, 1, 1};
+
 /**
- * @brief  初始化蜂鸣器
+ * @brief  初始化蜂鸣器 (PWM 输出, 静音), 并挂到 1ms 时基上
  */
 void Buzzer_Init(void)
 {
     GPIO_InitTypeDef GPIO_InitStructure;
-    
-    RCC_APB2PeriphClockCmd(BUZZER_RCC, ENABLE);
-    
+    TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+    TIM_OCInitTypeDef TIM_OCInitStructure;
+
+    RCC_APB2PeriphClockCmd(BUZZER_RCC | RCC_APB2Periph_AFIO, ENABLE);
+    RCC_APB2PeriphClockCmd(BUZZER_TIM_RCC, ENABLE);
+
     GPIO_InitStructure.GPIO_Pin = BUZZER_PIN;
-    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_Out_PP;
+    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_PP;
     GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
     GPIO_Init(BUZZER_PORT, &GPIO_InitStructure);
-    
-    GPIO_SetBits(BUZZER_PORT, BUZZER_PIN);
+
+    TIM_TimeBaseStructure.TIM_Period = 1000000 / BUZZER_FREQ - 1;
+    TIM_TimeBaseStructure.TIM_Prescaler = SystemCoreClock / 1000000 - 1;
+    TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+    TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+    TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
+    TIM_TimeBaseInit(BUZZER_TIM, &TIM_TimeBaseStructure);
+
+    TIM_OCStructInit(&TIM_OCInitStructure);
+    TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_PWM1;
+    TIM_OCInitStructure.TIM_OutputState = TIM_OutputState_Disable;
+    TIM_OCInitStructure.TIM_OutputNState = TIM_OutputNState_Enable;
+    TIM_OCInitStructure.TIM_Pulse = 1000000 / BUZZER_FREQ / 2;
+    TIM_OCInitStructure.TIM_OCNPolarity = TIM_OCNPolarity_Low;      // OC2REF 无效时引脚为高
+    TIM_OCInitStructure.TIM_OCNIdleState = TIM_OCNIdleState_Set;
+    TIM_OC2Init(BUZZER_TIM, &TIM_OCInitStructure);
+    TIM_OC2PreloadConfig(BUZZER_TIM, TIM_OCPreload_Enable);         // 改音调在周期结束时生效, 没有毛刺
+    TIM_ARRPreloadConfig(BUZZER_TIM, ENABLE);
+    TIM_ForcedOC2Config(BUZZER_TIM, TIM_ForcedAction_InActive);
+
+    TIM_Cmd(BUZZER_TIM, ENABLE);
+    TIM_CtrlPWMOutputs(BUZZER_TIM, ENABLE);
+
+    Buzzer_Sounding = 0;
+    Delay_SetTickHook(Buzzer_Tick);
+}
+
+/**
+ * @brief  以 freq 发声, 0 为静音
+ */
+static void Buzzer_Tone(uint16_t freq)
+{
+    uint16_t period;
+
+    if(freq == 0)
+    {
+        TIM_ForcedOC2Config(BUZZER_TIM, TIM_ForcedAction_InActive);
+        Buzzer_Sounding = 0;
+        return;
+    }
+    if(freq < BUZZER_FREQ_MIN) freq = BUZZER_FREQ_MIN;
+    if(freq > BUZZER_FREQ_MAX) freq = BUZZER_FREQ_MAX;
+    period = 1000000 / freq;
+    TIM_SetAutoreload(BUZZER_TIM, period - 1);
+    TIM_SetCompare2(BUZZER_TIM, period / 2);
+    if(!Buzzer_Sounding)
+        TIM_SelectOCxM(BUZZER_TIM, TIM_Channel_2, TIM_OCMode_PWM1);
+    Buzzer_Sounding = 1;
+}
+
+/**
+ * @brief  开始当前音 (Buzzer_Index)
+ */
+static void Buzzer_StartNote(void)
+{
+    const Buzzer_Note_TypeDef *note = &Buzzer_Pattern->Notes[Buzzer_Index];
+
+    Buzzer_InGap = 0;
+    Buzzer_Left = note->OnMs ? note->OnMs : 1;
+    Buzzer_Tone(note->Freq);
+}
+
+/**
+ * @brief  推进播放序列, 由 SysTick 中断每 1ms 调用一次
+ */
+void Buzzer_Tick(void)
+{
+    const Buzzer_Pattern_TypeDef *pattern = Buzzer_Pattern;
+
+    if(pattern == 0) return;
+    if(--Buzzer_Left) return;
+
+    // 响完进入间隔
+    if(!Buzzer_InGap)
+    {
+        Buzzer_Tone(0);
+        Buzzer_InGap = 1;
+        Buzzer_Left = pattern->Notes[Buzzer_Index].OffMs;
+        if(Buzzer_Left) return;
+    }
+
+    // 下一个音, 序列结束时重复或停止
+    if(++Buzzer_Index >= pattern->Num)
+    {
+        Buzzer_Index = 0;
+        if(pattern->Repeat && ++Buzzer_Done >= pattern->Repeat)
+        {
+            Buzzer_Pattern = 0;
+            return;
+        }
+    }
+    Buzzer_StartNote();
 }
 
 /**
- * @brief  蜂鸣器开启
+ * @brief  从头播放序列, 替换正在播放的
+ * @param  pattern: 序列, 0 或没有音时等于 Buzzer_Stop
+ */
+void Buzzer_Play(const Buzzer_Pattern_TypeDef *pattern)
+{
+    __disable_irq();
+    if(pattern == 0 || pattern->Num == 0)
+    {
+        Buzzer_Pattern = 0;
+        Buzzer_Tone(0);
+    }
+    else
+    {
+        Buzzer_Pattern = pattern;
+        Buzzer_Index = 0;
+        Buzzer_Done = 0;
+        Buzzer_StartNote();
+    }
+    __enable_irq();
+}
+
+/**
+ * @brief  停止播放并静音
+ */
+void Buzzer_Stop(void)
+{
+    Buzzer_Play(0);
+}
+
+/**
+ * @brief  是否还在播放序列
+ */
+uint8_t Buzzer_IsBusy(void)
+{
+    return Buzzer_Pattern != 0;
+}
+
+/**
+ * @brief  蜂鸣器开启 (默认音调持续发声, 停止正在播放的序列)
  */
 void Buzzer_On(void)
 {
-    GPIO_ResetBits(BUZZER_PORT, BUZZER_PIN);
+    __disable_irq();
+    Buzzer_Pattern = 0;
+    Buzzer_Tone(BUZZER_FREQ);
+    __enable_irq();
 }
 
 /**
@@ -31,7 +182,7 @@ void Buzzer_On(void)
  */
 void Buzzer_Off(void)
 {
-    GPIO_SetBits(BUZZER_PORT, BUZZER_PIN);
+    Buzzer_Stop();
 }
 
 /**
@@ -39,24 +190,18 @@ void Buzzer_Off(void)
  */
 void Buzzer_Toggle(void)
 {
-    if(GPIO_ReadOutputDataBit(BUZZER_PORT, BUZZER_PIN) == SET)
-        GPIO_ResetBits(BUZZER_PORT, BUZZER_PIN);
+    if(Buzzer_Sounding)
+        Buzzer_Off();
     else
-        GPIO_SetBits(BUZZER_PORT, BUZZER_PIN);
+        Buzzer_On();
 }
 
 /**
- * @brief  无源蜂鸣器发声（产生方波）
+ * @brief  默认音调响 ms 毫秒, 立即返回
  * @param  ms: 发声时间(毫秒)
  */
 void Buzzer_Beep(uint16_t ms)
 {
-    uint16_t i;
-    for(i = 0; i < ms; i++)
-    {
-        GPIO_ResetBits(BUZZER_PORT, BUZZER_PIN);
-        Delay_us(500);
-        GPIO_SetBits(BUZZER_PORT, BUZZER_PIN);
-        Delay_us(500);
-    }
+    Buzzer_BeepNote.OnMs = ms; // 只在开始一个音时读取, 由下面的 Buzzer_Play 开始
+    Buzzer_Play(&Buzzer_BeepPattern);
 }
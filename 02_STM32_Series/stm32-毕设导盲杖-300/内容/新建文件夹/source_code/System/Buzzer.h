@@ -4,11 +4,41 @@
 #include "stm32f10x.h"
 #include "pin_config.h"
 
+/*
+ * 无源蜂鸣器: BUZZER_TIM 通道 2 输出 50% 占空比的方波发声, 不占用 CPU.
+ * 播放序列 (音调、时长、间隔、重复次数) 由 SysTick 中断每 1ms 推进, 调用者不等待.
+ */
+
+/*============== 参数定义 ==============*/
+#define BUZZER_FREQ             1000        // 默认音调 (Hz)
+#define BUZZER_FREQ_MIN         20          // 可设的音调范围 (Hz), 定时器 1MHz 计数
+#define BUZZER_FREQ_MAX         20000
+
+/* 一个音: 响 OnMs 后静音 OffMs; Freq 为 0 时整个音都静音 */
+typedef struct
+{
+    uint16_t Freq;
+    uint16_t OnMs;
+    uint16_t OffMs;
+} Buzzer_Note_TypeDef;
+
+/* 播放序列; 须在播放期间一直有效 (用 static const 定义) */
+typedef struct
+{
+    const Buzzer_Note_TypeDef *Notes;
+    uint8_t Num;
+    uint8_t Repeat;                         // 整个序列播放几遍, 0 为一直重复
+} Buzzer_Pattern_TypeDef;
+
 /*============== 函数声明 ==============*/
 void Buzzer_Init(void);
 void Buzzer_On(void);
 void Buzzer_Off(void);
 void Buzzer_Toggle(void);
 void Buzzer_Beep(uint16_t ms);
+void Buzzer_Play(const Buzzer_Pattern_TypeDef *pattern);
+void Buzzer_Stop(void);
+uint8_t Buzzer_IsBusy(void);
+void Buzzer_Tick(void);
 
 #endif
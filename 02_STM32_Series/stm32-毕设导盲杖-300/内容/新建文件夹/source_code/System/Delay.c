@@ -1,47 +1,74 @@
 #include "stm32f10x.h"
+#include "Delay.h"
 
 static uint8_t fac_us = 0;
-static uint16_t fac_ms = 0;
+static volatile uint32_t s_tick_ms = 0;
+static void (*s_tick_hook)(void) = 0;
 
 /**
-  * @brief  初始化延时函数，由SystemInit调用或在main中初始化
+  * @brief  初始化延时函数和 1ms 时基，由SystemInit调用或在main中初始化
   * @param  无
   * @retval 无
   */
 void Delay_Init(void)
 {
     // 系统时钟频率 SystemCoreClock 单位为Hz
-    // SysTick的时钟源选择HCLK/8 或 HCLK
-    // 这里我们选择外部时钟源 HCLK/8
-    SysTick_CLKSourceConfig(SysTick_CLKSource_HCLK_Div8);
-    
-    fac_us = SystemCoreClock / 8000000;  // 比如72MHz/8M=9, 8MHz/8M=1
-    fac_ms = (uint16_t)fac_us * 1000;
+    // SysTick 用 HCLK 计数, 每 1ms 中断一次, 一直运行; 延时函数只读取计数值, 不再开关 SysTick
+    fac_us = SystemCoreClock / 1000000;  // 比如72MHz/1M=72
+    SysTick_Config(SystemCoreClock / 1000);
+}
+
+/**
+  * @brief  SysTick 中断: 毫秒计数, 再调用挂接的函数
+  */
+void SysTick_Handler(void)
+{
+    s_tick_ms++;
+    if(s_tick_hook) s_tick_hook();
+}
+
+/**
+  * @brief  设置每 1ms 在 SysTick 中断中调用的函数 (须很短), 0 为不调用
+  */
+void Delay_SetTickHook(void (*hook)(void))
+{
+    s_tick_hook = hook;
+}
+
+/**
+  * @brief  上电以来的毫秒数 (约 49.7 天回绕, 比较时用差值)
+  * @retval ms
+  */
+uint32_t Delay_GetTick(void)
+{
+    return s_tick_ms;
 }
 
 /**
   * @brief  微秒级延时
   * @param  xus 延时时长
   * @retval 无
+  * @note   累计 SysTick 计数值的减少量, 关中断时也能使用
   */
 void Delay_us(uint32_t xus)
 {
-    uint32_t temp;
-    
-    // 如果没有初始化，尝试自动初始化（假设默认72MHz或自动计算）
+    uint32_t ticks, elapsed = 0, reload, last, now;
+
+    // 如果没有初始化，尝试自动初始化
     if(fac_us == 0) Delay_Init();
-    
-    SysTick->LOAD = xus * fac_us;           // 时间加载
-    SysTick->VAL = 0x00;                    // 清空计数器
-    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk; // 开始倒数
-    
-    do
+
+    ticks = xus * fac_us;
+    reload = SysTick->LOAD + 1;
+    last = SysTick->VAL;
+    while(elapsed < ticks)
     {
-        temp = SysTick->CTRL;
-    } while((temp & 0x01) && !(temp & (1<<16))); // 等待时间到达
-    
-    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk; // 关闭计数器
-    SysTick->VAL = 0x00;                       // 清空计数器
+        now = SysTick->VAL;
+        if(now != last)
+        {
+            elapsed += (now < last) ? (last - now) : (last + reload - now); // 向下计数, 经过重装时加上一圈
+            last = now;
+        }
+    }
 }
 
 /**
@@ -51,21 +78,10 @@ void Delay_us(uint32_t xus)
   */
 void Delay_ms(uint32_t xms)
 {
-    uint32_t temp;
-    
-    if(fac_us == 0) Delay_Init();
-    
-    SysTick->LOAD = (uint32_t)xms * fac_ms;
-    SysTick->VAL = 0x00;
-    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
-    
-    do
+    while(xms--)
     {
-        temp = SysTick->CTRL;
-    } while((temp & 0x01) && !(temp & (1<<16)));
-    
-    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
-    SysTick->VAL = 0x00;
+        Delay_us(1000);
+    }
 }
 
 /**
@@ -79,4 +95,4 @@ void Delay_s(uint32_t xs)
 	{
 		Delay_ms(1000);
 	}
-} 
+}
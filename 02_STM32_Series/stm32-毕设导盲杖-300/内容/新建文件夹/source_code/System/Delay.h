@@ -1,7 +1,11 @@
 #ifndef __DELAY_H
 #define __DELAY_H
 
+#include <stdint.h>
+
 void Delay_Init(void);
+uint32_t Delay_GetTick(void);
+void Delay_SetTickHook(void (*hook)(void));
 void Delay_us(uint32_t us);
 void Delay_ms(uint32_t ms);
 void Delay_s(uint32_t s);
@@ -0,0 +1,180 @@
+#include "DistFilter.h"
+
+/*
+ * 捕获: 没有在跟踪时, 窗口中有效样本的中值附近 (DistFilter_Gate) 有 3 个以上样本才开始跟踪,
+ *       零星的错误回波不会被当作目标; 初始速度取最早与最近样本连线的斜率.
+ * 跟踪: 预测 = 位置 + 速度 x 间隔, 残差 = 样本 - 预测, 位置 += alpha x 残差, 速度 += beta x 残差 / 间隔.
+ *       残差超过门限的样本 (错误近回波、旁边的物体) 判为离群, 不参加更新;
+ *       连续 DISTFILTER_REACQUIRE 个都离群则认为目标真的变了 (新的障碍物进入), 重新捕获.
+ *       跟踪时不直接用中值: 中值对移动目标有两个样本的滞后, 停步、掉头时速度估计会过冲.
+ * 丢失: 连续 DISTFILTER_LOST 次无回波则认为目标离开, 清空窗口.
+ */
+
+#define DISTFILTER_START        ((DISTFILTER_MEDIAN_N + 1) / 2)     // 开始跟踪所需的有效样本数
+
+/**
+ * @brief  清空滤波状态
+ */
+void DistFilter_Init(DistFilter_TypeDef *f)
+{
+    uint8_t i;
+
+    for(i = 0; i < DISTFILTER_MEDIAN_N; i++)
+        f->Window[i] = DISTFILTER_NONE;
+    f->Count = 0;
+    f->Next = 0;
+    f->Tracking = 0;
+    f->Outliers = 0;
+    f->Misses = 0;
+    f->Pos = 0;
+    f->Vel = 0;
+}
+
+static int32_t DistFilter_Abs(int32_t v)
+{
+    return v < 0 ? -v : v;
+}
+
+/* 离群门限 (mm): 远处回波误差和目标在一个周期内的移动都更大 */
+static int32_t DistFilter_Gate(int32_t mm)
+{
+    int32_t gate = mm * DISTFILTER_GATE_PCT / 100;
+    return gate < DISTFILTER_GATE_MIN_MM ? DISTFILTER_GATE_MIN_MM : gate;
+}
+
+/**
+ * @brief  窗口中有效样本 (有回波且未被判为离群) 的中值, 偶数个时取较大的一个 (错误回波多为偏近)
+ * @param  rejected: 第 i 位为 1 表示 Window[i] 是离群
+ * @param  n: 返回有效样本数
+ * @retval mm, 没有有效样本时为 DISTFILTER_NONE
+ */
+static int32_t DistFilter_Median(const DistFilter_TypeDef *f, uint8_t rejected, uint8_t *n)
+{
+    int16_t sorted[DISTFILTER_MEDIAN_N];
+    int16_t v;
+    uint8_t i, j;
+
+    *n = 0;
+    for(i = 0; i < f->Count; i++)
+    {
+        v = f->Window[i];
+        if(v == DISTFILTER_NONE || (rejected & (1u << i))) continue;
+        for(j = *n; j > 0 && sorted[j - 1] > v; j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+        (*n)++;
+    }
+    return *n ? sorted[*n / 2] : DISTFILTER_NONE;
+}
+
+/**
+ * @brief  没有在跟踪时: 与中值相差超过门限的样本判为离群, 其余仍有 DISTFILTER_START 个则开始跟踪
+ */
+static void DistFilter_Start(DistFilter_TypeDef *f, uint16_t dt_ms)
+{
+    int32_t med, first = 0, last = 0;
+    uint8_t i, n, age, oldest = 0, newest = DISTFILTER_MEDIAN_N, rejected = 0;
+
+    med = DistFilter_Median(f, 0, &n);
+    if(n < DISTFILTER_START) return;
+    for(i = 0; i < f->Count; i++)
+        if(f->Window[i] != DISTFILTER_NONE && DistFilter_Abs(f->Window[i] - med) > DistFilter_Gate(med))
+            rejected |= 1u << i;
+    med = DistFilter_Median(f, rejected, &n);
+    if(n < DISTFILTER_START) return;
+
+    // 初始速度: 最早与最近的有效样本连线的斜率 (目标可能已在移动)
+    for(i = 0; i < f->Count; i++)
+    {
+        if(f->Window[i] == DISTFILTER_NONE || (rejected & (1u << i))) continue;
+        age = (f->Next + DISTFILTER_MEDIAN_N - 1 - i) % DISTFILTER_MEDIAN_N;
+        if(age >= oldest) { oldest = age; first = f->Window[i]; }
+        if(age < newest) { newest = age; last = f->Window[i]; }
+    }
+    f->Vel = (last - first) * 16 * 1000 / ((oldest - newest) * dt_ms);
+    f->Pos = (last << 4) + f->Vel * newest * dt_ms / 1000;
+    f->Tracking = 1;
+    f->Outliers = 0;
+}
+
+/**
+ * @brief  加入一次测量结果
+ * @param  mm: 原始距离 (mm), DISTFILTER_NONE 表示无回波
+ * @param  dt_ms: 距上一次测量的时间 (ms)
+ */
+void DistFilter_Update(DistFilter_TypeDef *f, int32_t mm, uint16_t dt_ms)
+{
+    int32_t pred, resid;
+    uint8_t slot = f->Next;
+
+    if(mm < 0 || mm > DISTFILTER_FAR_MM) mm = DISTFILTER_NONE;
+    if(dt_ms == 0) dt_ms = 1;
+
+    f->Window[slot] = (int16_t)mm;
+    f->Next = (slot + 1) % DISTFILTER_MEDIAN_N;
+    if(f->Count < DISTFILTER_MEDIAN_N) f->Count++;
+
+    if(mm == DISTFILTER_NONE)
+    {
+        if(++f->Misses >= DISTFILTER_LOST)
+        {
+            DistFilter_Init(f);                 // 目标离开, 旧样本作废
+            return;
+        }
+    }
+    else
+    {
+        f->Misses = 0;
+        if(f->Tracking)
+        {
+            pred = f->Pos + f->Vel * dt_ms / 1000;
+            resid = (mm << 4) - pred;
+            if(DistFilter_Abs(resid) <= DistFilter_Gate(pred >> 4) * 16)
+            {
+                f->Outliers = 0;
+                f->Pos = pred + resid * DISTFILTER_ALPHA_Q8 / 256;
+                f->Vel += resid * DISTFILTER_BETA_Q8 * 1000 / 256 / dt_ms;
+                return;
+            }
+            if(++f->Outliers >= DISTFILTER_REACQUIRE)
+                f->Tracking = 0;                // 目标变了, 下面从窗口中相近的样本重新开始
+        }
+    }
+
+    if(f->Tracking)
+        f->Pos += f->Vel * dt_ms / 1000;        // 无回波或离群: 沿用预测
+    else
+        DistFilter_Start(f, dt_ms);
+}
+
+/**
+ * @brief  当前距离
+ * @retval 距离(mm), DISTFILTER_NONE 表示没有目标
+ */
+int32_t DistFilter_GetDistance(const DistFilter_TypeDef *f)
+{
+    if(!f->Tracking) return DISTFILTER_NONE;
+    return f->Pos < 0 ? 0 : (f->Pos + 8) >> 4;
+}
+
+/**
+ * @brief  接近速度
+ * @retval mm/s, 靠近为正, 远离为负; 没有目标时为 0
+ */
+int32_t DistFilter_GetClosing(const DistFilter_TypeDef *f)
+{
+    if(!f->Tracking) return 0;
+    return -f->Vel / 16;
+}
+
+/**
+ * @brief  碰撞时间: 按当前接近速度走完当前距离所需的时间
+ * @retval ms, 不在靠近 (或慢于 DISTFILTER_VMIN_MM_S) 时为 DISTFILTER_TTC_NONE
+ */
+uint32_t DistFilter_GetTtc(const DistFilter_TypeDef *f)
+{
+    int32_t closing = DistFilter_GetClosing(f);
+
+    if(closing < DISTFILTER_VMIN_MM_S) return DISTFILTER_TTC_NONE;
+    return (uint32_t)DistFilter_GetDistance(f) * 1000 / closing;
+}
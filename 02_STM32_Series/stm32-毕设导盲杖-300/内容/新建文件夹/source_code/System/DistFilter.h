@@ -0,0 +1,44 @@
+#ifndef __DISTFILTER_H
+#define __DISTFILTER_H
+
+#include <stdint.h>
+
+/*
+ * 距离滤波: 5 点滑动中值确认目标, 再用带离群门限的 alpha-beta 跟踪器估计距离和接近速度.
+ * 全部为整数运算, 状态放在调用者提供的结构体中, 每个超声波模块一个.
+ */
+
+/*============== 参数定义 ==============*/
+#define DISTFILTER_MEDIAN_N     5           // 中值窗口
+#define DISTFILTER_NONE         (-1)        // 输入: 无回波; 输出: 没有目标
+#define DISTFILTER_FAR_MM       5000        // 超过此距离按无回波处理
+#define DISTFILTER_GATE_PCT     15          // 样本与预测相差超过距离的百分之几视为离群
+#define DISTFILTER_GATE_MIN_MM  100         // 近处的门限不小于此值
+#define DISTFILTER_REACQUIRE    3           // 连续离群次数达到此值, 认为目标真的变了, 重新跟踪
+#define DISTFILTER_LOST         3           // 连续无回波次数达到此值, 认为目标离开
+#define DISTFILTER_ALPHA_Q8     128         // 位置增益 0.5 (Q8)
+#define DISTFILTER_BETA_Q8      43          // 速度增益 0.168 = alpha^2 / (2 - alpha) (Q8)
+#define DISTFILTER_VMIN_MM_S    100         // 接近速度低于此值不计算碰撞时间
+#define DISTFILTER_TTC_NONE     0xFFFFFFFFUL
+
+/* 一个模块的滤波状态; 位置、速度为 1/16 mm、1/16 mm/s */
+typedef struct
+{
+    int16_t Window[DISTFILTER_MEDIAN_N];    // 最近的原始距离 (mm), DISTFILTER_NONE 为无回波
+    uint8_t Count;                          // 窗口中的样本数
+    uint8_t Next;                           // 下一个样本写入的位置
+    uint8_t Tracking;                       // 1: 跟踪器已初始化
+    uint8_t Outliers;                       // 连续离群次数
+    uint8_t Misses;                         // 连续无回波次数
+    int32_t Pos;                            // 距离
+    int32_t Vel;                            // 距离变化率, 接近为负
+} DistFilter_TypeDef;
+
+/*============== 函数声明 ==============*/
+void DistFilter_Init(DistFilter_TypeDef *f);
+void DistFilter_Update(DistFilter_TypeDef *f, int32_t mm, uint16_t dt_ms);
+int32_t DistFilter_GetDistance(const DistFilter_TypeDef *f);
+int32_t DistFilter_GetClosing(const DistFilter_TypeDef *f);
+uint32_t DistFilter_GetTtc(const DistFilter_TypeDef *f);
+
+#endif
@@ -1,55 +1,242 @@
 #include "HCSR04.h"
-#include "Delay.h"
+
+/*
+ * 多个模块轮流测量, 全部由 TIM2 中断推进, 主循环不参与:
+ *   TIM2 以 1MHz 自由计数, CH1 输出比较划分时隙: 时隙开始拉高 Trig, HCSR04_TRIG_US 后拉低,
+ *   之后打开该模块 Echo 所在通道的捕获中断, 先捕获上升沿再切换为下降沿, 宽度 = 两次捕获之差
+ *   (16 位回绕相减, 1us 分辨率). 时隙结束时还没有下降沿则以 HCSR04_NO_ECHO 结束, 换下一个模块.
+ * 每个时隙只开一个捕获中断, 别的模块 Echo 上的变化不会被当作回波; 时隙长度见 HCSR04.h
+ */
+
+#define HCSR04_IDLE             0xFF        // HCSR04_Active: 未运行
+#define HCSR04_IT(channel)      ((uint16_t)(TIM_IT_CC1 << ((channel) >> 2)))    // 通道对应的中断位
+
+static const HCSR04_Sensor_TypeDef HCSR04_Sensors[HCSR04_NUM] = HCSR04_SENSORS;
+
+static HCSR04_Callback HCSR04_Done = 0;
+static volatile uint32_t HCSR04_Echo[HCSR04_NUM];   // 各模块最近一次的结果 (us)
+static uint8_t HCSR04_Active = HCSR04_IDLE;         // 当前时隙的模块
+static uint8_t HCSR04_InPulse;                      // 1: 正在发触发脉冲, 下次比较时拉低 Trig
+static uint8_t HCSR04_Pending;                      // 1: 本时隙的回波还没有结束
+static uint8_t HCSR04_Rising;                       // 1: 等上升沿, 0: 等下降沿
+static uint16_t HCSR04_SlotStart;                   // 本时隙开始的计数值
+static uint16_t HCSR04_Rise;                        // 上升沿时刻
 
 /**
- * @brief  初始化HC-SR04超声波模块
+ * @brief  初始化超声波模块阵列 (引脚和 TIM2, 不开始测量)
  */
 void HCSR04_Init(void)
 {
     GPIO_InitTypeDef GPIO_InitStructure;
-    
-    RCC_APB2PeriphClockCmd(HCSR04_TRIG_RCC | HCSR04_ECHO_RCC, ENABLE);
-    
-    // Trig - 推挽输出
-    GPIO_InitStructure.GPIO_Pin = HCSR04_TRIG_PIN;
-    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_Out_PP;
-    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
-    GPIO_Init(HCSR04_TRIG_PORT, &GPIO_InitStructure);
-    
-    // Echo - 浮空输入
-    GPIO_InitStructure.GPIO_Pin = HCSR04_ECHO_PIN;
-    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN_FLOATING;
-    GPIO_Init(HCSR04_ECHO_PORT, &GPIO_InitStructure);
-    
-    GPIO_ResetBits(HCSR04_TRIG_PORT, HCSR04_TRIG_PIN);
-}
-
-/**
- * @brief  获取超声波测量距离
- * @retval 距离(cm)，-1表示超时
- */
-float HCSR04_GetDistance(void)
-{
-    uint32_t timeout;
-    uint32_t time_us = 0;
-    
-    // 发送10us触发脉冲
-    GPIO_SetBits(HCSR04_TRIG_PORT, HCSR04_TRIG_PIN);
-    Delay_us(15);
-    GPIO_ResetBits(HCSR04_TRIG_PORT, HCSR04_TRIG_PIN);
-    
-    // 等待Echo变高
-    timeout = 100000;
-    while(GPIO_ReadInputDataBit(HCSR04_ECHO_PORT, HCSR04_ECHO_PIN) == RESET)
-        if(--timeout == 0) return -1;
-    
-    // 测量高电平时间
-    while(GPIO_ReadInputDataBit(HCSR04_ECHO_PORT, HCSR04_ECHO_PIN) == SET)
-    {
-        Delay_us(1);
-        time_us++;
-        if(time_us > 50000) return -1;
-    }
-    
-    return (float)time_us * 0.017f;
+    TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+    TIM_ICInitTypeDef TIM_ICInitStructure;
+    TIM_OCInitTypeDef TIM_OCInitStructure;
+    NVIC_InitTypeDef NVIC_InitStructure;
+    uint8_t i;
+
+    RCC_APB2PeriphClockCmd(HCSR04_RCC, ENABLE);
+    RCC_APB1PeriphClockCmd(HCSR04_TIM_RCC, ENABLE);
+
+    // 时基: 1MHz 自由计数
+    TIM_TimeBaseStructure.TIM_Period = 0xFFFF;
+    TIM_TimeBaseStructure.TIM_Prescaler = SystemCoreClock / 1000000 - 1;
+    TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+    TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+    TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
+    TIM_TimeBaseInit(HCSR04_TIM, &TIM_TimeBaseStructure);
+
+    TIM_ICInitStructure.TIM_ICPolarity = TIM_ICPolarity_Rising;
+    TIM_ICInitStructure.TIM_ICSelection = TIM_ICSelection_DirectTI;
+    TIM_ICInitStructure.TIM_ICPrescaler = TIM_ICPSC_DIV1;
+    TIM_ICInitStructure.TIM_ICFilter = 0x3;                // 8 个时钟滤波, 去掉毛刺
+
+    for(i = 0; i < HCSR04_NUM; i++)
+    {
+        // Trig - 推挽输出
+        GPIO_InitStructure.GPIO_Pin = HCSR04_Sensors[i].TrigPin;
+        GPIO_InitStructure.GPIO_Mode = GPIO_Mode_Out_PP;
+        GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+        GPIO_Init(HCSR04_Sensors[i].TrigPort, &GPIO_InitStructure);
+        GPIO_ResetBits(HCSR04_Sensors[i].TrigPort, HCSR04_Sensors[i].TrigPin);
+
+        // Echo - 浮空输入 (定时器输入捕获)
+        GPIO_InitStructure.GPIO_Pin = HCSR04_Sensors[i].EchoPin;
+        GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN_FLOATING;
+        GPIO_Init(HCSR04_Sensors[i].EchoPort, &GPIO_InitStructure);
+
+        TIM_ICInitStructure.TIM_Channel = HCSR04_Sensors[i].Channel;
+        TIM_ICInit(HCSR04_TIM, &TIM_ICInitStructure);
+        HCSR04_Echo[i] = HCSR04_NO_ECHO;
+    }
+
+    // CH1: 时隙比较, 不输出到引脚
+    TIM_OCStructInit(&TIM_OCInitStructure);
+    TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_Timing;
+    TIM_OC1Init(HCSR04_TIM, &TIM_OCInitStructure);
+
+    NVIC_InitStructure.NVIC_IRQChannel = HCSR04_TIM_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+
+    TIM_Cmd(HCSR04_TIM, ENABLE);
+}
+
+/**
+ * @brief  开始轮流测量, 直到 HCSR04_Stop; 每个模块每 HCSR04_PERIOD_US 测一次
+ * @param  callback: 每次测量完成时在中断中调用, 可为 0 (只用 HCSR04_GetDistance 取结果)
+ */
+void HCSR04_Run(HCSR04_Callback callback)
+{
+    if(HCSR04_Active != HCSR04_IDLE) return;
+
+    HCSR04_Done = callback;
+    HCSR04_Active = HCSR04_NUM - 1;         // 第一个时隙从 0 号开始
+    HCSR04_InPulse = 0;
+    HCSR04_Pending = 0;
+
+    TIM_SetCompare1(HCSR04_TIM, TIM_GetCounter(HCSR04_TIM) + 10);
+    TIM_ClearITPendingBit(HCSR04_TIM, TIM_IT_CC1);
+    TIM_ITConfig(HCSR04_TIM, TIM_IT_CC1, ENABLE);
+}
+
+/**
+ * @brief  停止测量, 未完成的一次作废
+ */
+void HCSR04_Stop(void)
+{
+    uint8_t i;
+
+    __disable_irq();
+    TIM_ITConfig(HCSR04_TIM, TIM_IT_CC1 | TIM_IT_CC2 | TIM_IT_CC3 | TIM_IT_CC4, DISABLE);
+    HCSR04_Active = HCSR04_IDLE;
+    HCSR04_Done = 0;
+    __enable_irq();
+
+    for(i = 0; i < HCSR04_NUM; i++)
+        GPIO_ResetBits(HCSR04_Sensors[i].TrigPort, HCSR04_Sensors[i].TrigPin);
+}
+
+/**
+ * @brief  取某个模块最近一次的测量结果
+ * @retval 距离(cm)，-1表示超出量程或还没有结果
+ */
+float HCSR04_GetDistance(uint8_t sensor)
+{
+    uint32_t echo_us;
+
+    if(sensor >= HCSR04_NUM) return -1;
+    echo_us = HCSR04_Echo[sensor];
+    if(echo_us == HCSR04_NO_ECHO) return -1;
+    return (float)echo_us * HCSR04_CM_PER_US;
+}
+
+static uint16_t HCSR04_GetCapture(uint16_t channel)
+{
+    switch(channel)
+    {
+        case TIM_Channel_1: return TIM_GetCapture1(HCSR04_TIM);
+        case TIM_Channel_2: return TIM_GetCapture2(HCSR04_TIM);
+        case TIM_Channel_3: return TIM_GetCapture3(HCSR04_TIM);
+        default:            return TIM_GetCapture4(HCSR04_TIM);
+    }
+}
+
+static void HCSR04_SetPolarity(uint16_t channel, uint16_t polarity)
+{
+    switch(channel)
+    {
+        case TIM_Channel_1: TIM_OC1PolarityConfig(HCSR04_TIM, polarity); break;
+        case TIM_Channel_2: TIM_OC2PolarityConfig(HCSR04_TIM, polarity); break;
+        case TIM_Channel_3: TIM_OC3PolarityConfig(HCSR04_TIM, polarity); break;
+        default:            TIM_OC4PolarityConfig(HCSR04_TIM, polarity); break;
+    }
+}
+
+/**
+ * @brief  结束当前模块的本次测量并交出结果
+ */
+static void HCSR04_Finish(uint32_t echo_us)
+{
+    TIM_ITConfig(HCSR04_TIM, HCSR04_IT(HCSR04_Sensors[HCSR04_Active].Channel), DISABLE);
+    HCSR04_Pending = 0;
+    HCSR04_Echo[HCSR04_Active] = echo_us;
+    if(HCSR04_Done) HCSR04_Done(HCSR04_Active, echo_us);
+}
+
+/**
+ * @brief  当前模块 Echo 的边沿
+ */
+static void HCSR04_Capture(void)
+{
+    const HCSR04_Sensor_TypeDef *s = &HCSR04_Sensors[HCSR04_Active];
+    uint16_t now = HCSR04_GetCapture(s->Channel);
+    uint16_t width;
+
+    if(!HCSR04_Pending) return;
+    if(HCSR04_Rising)
+    {
+        HCSR04_Rise = now;
+        HCSR04_Rising = 0;
+        HCSR04_SetPolarity(s->Channel, TIM_ICPolarity_Falling);
+        return;
+    }
+    width = now - HCSR04_Rise;
+    HCSR04_Finish(width > HCSR04_ECHO_MAX_US ? HCSR04_NO_ECHO : width);
+}
+
+/**
+ * @brief  时隙比较: 时隙开始时触发下一个模块, 触发脉冲结束时开始等回波
+ */
+static void HCSR04_Slot(void)
+{
+    const HCSR04_Sensor_TypeDef *s;
+
+    if(!HCSR04_InPulse)
+    {
+        if(HCSR04_Pending) HCSR04_Finish(HCSR04_NO_ECHO);  // 时隙内没有完整回波
+
+        HCSR04_Active = (HCSR04_Active + 1) % HCSR04_NUM;
+        s = &HCSR04_Sensors[HCSR04_Active];
+        HCSR04_SlotStart = TIM_GetCapture1(HCSR04_TIM);
+        GPIO_SetBits(s->TrigPort, s->TrigPin);
+        TIM_SetCompare1(HCSR04_TIM, HCSR04_SlotStart + HCSR04_TRIG_US);
+        HCSR04_InPulse = 1;
+    }
+    else
+    {
+        s = &HCSR04_Sensors[HCSR04_Active];
+        GPIO_ResetBits(s->TrigPort, s->TrigPin);
+
+        // 之前残留的捕获作废, 从上升沿开始
+        HCSR04_SetPolarity(s->Channel, TIM_ICPolarity_Rising);
+        TIM_ClearITPendingBit(HCSR04_TIM, HCSR04_IT(s->Channel));
+        TIM_ITConfig(HCSR04_TIM, HCSR04_IT(s->Channel), ENABLE);
+        HCSR04_Rising = 1;
+        HCSR04_Pending = 1;
+
+        TIM_SetCompare1(HCSR04_TIM, HCSR04_SlotStart + HCSR04_SLOT_US);
+        HCSR04_InPulse = 0;
+    }
+}
+
+/**
+ * @brief  回波捕获与时隙中断
+ * @note   先处理捕获: 下降沿与时隙结束同时到达时回波仍算数
+ */
+void HCSR04_TIM_IRQHandler(void)
+{
+    if(HCSR04_Active == HCSR04_IDLE) return;
+
+    if(TIM_GetITStatus(HCSR04_TIM, HCSR04_IT(HCSR04_Sensors[HCSR04_Active].Channel)) != RESET)
+    {
+        TIM_ClearITPendingBit(HCSR04_TIM, HCSR04_IT(HCSR04_Sensors[HCSR04_Active].Channel));
+        HCSR04_Capture();
+    }
+    if(TIM_GetITStatus(HCSR04_TIM, TIM_IT_CC1) != RESET)
+    {
+        TIM_ClearITPendingBit(HCSR04_TIM, TIM_IT_CC1);
+        HCSR04_Slot();
+    }
 }
@@ -4,8 +4,43 @@
 #include "stm32f10x.h"
 #include "pin_config.h"
 
+/*============== 参数定义 ==============*/
+#define HCSR04_NO_ECHO          0           // 回调参数: 超出量程或无回波
+#define HCSR04_CM_PER_US        0.01715f    // 声速 343m/s, 往返除以 2
+#define HCSR04_RANGE_MAX_CM     400         // 量程, 决定时隙长度
+#define HCSR04_ECHO_MAX_US      (HCSR04_RANGE_MAX_CM * 100000UL / 1715)    // 量程对应的回波宽度
+#define HCSR04_TRIG_US          15          // 触发脉冲宽度 (手册要求 >= 10us)
+#define HCSR04_ECHO_DELAY_US    1000        // 触发结束到回波开始 (模块先发 8 个 40kHz 脉冲)
+#define HCSR04_GUARD_US         6000        // 余波衰减: 量程外约 5m 内的反射仍落在本时隙
+#define HCSR04_REPEAT_MIN_US    60000       // 同一模块两次触发的最小间隔 (手册建议)
+
+/*
+ * 时隙: 任一时刻只有一个模块在测, 下一个模块在上一个触发后至少一个时隙才触发,
+ * 即使回波早已返回 (声波仍在空中, 可能被别的模块收到). 时隙为
+ * 回波延迟 + 量程回波宽度 + 余波衰减, 且 N 个时隙不短于同一模块的最小重复间隔
+ */
+#define HCSR04_SLOT_MIN_US      (HCSR04_TRIG_US + HCSR04_ECHO_DELAY_US + HCSR04_ECHO_MAX_US + HCSR04_GUARD_US)
+#define HCSR04_SLOT_US          ((HCSR04_SLOT_MIN_US * HCSR04_NUM >= HCSR04_REPEAT_MIN_US) ? \
+                                 HCSR04_SLOT_MIN_US : (HCSR04_REPEAT_MIN_US + HCSR04_NUM - 1) / HCSR04_NUM)
+#define HCSR04_PERIOD_US        (HCSR04_SLOT_US * HCSR04_NUM)   // 每个模块的测量周期
+
+/* 阵列中一个模块的引脚 (pin_config.h 的 HCSR04_SENSORS) */
+typedef struct
+{
+    GPIO_TypeDef *TrigPort;
+    uint16_t TrigPin;
+    GPIO_TypeDef *EchoPort;
+    uint16_t EchoPin;
+    uint16_t Channel;           // Echo 所接的 TIM 捕获通道 TIM_Channel_x
+} HCSR04_Sensor_TypeDef;
+
+/* 测量完成回调, 在定时器中断中调用; echo_us 为回波高电平宽度 (us), 超出量程为 HCSR04_NO_ECHO */
+typedef void (*HCSR04_Callback)(uint8_t sensor, uint32_t echo_us);
+
 /*============== 函数声明 ==============*/
 void HCSR04_Init(void);
-float HCSR04_GetDistance(void);
+void HCSR04_Run(HCSR04_Callback callback);
+void HCSR04_Stop(void);
+float HCSR04_GetDistance(uint8_t sensor);
 
 #endif
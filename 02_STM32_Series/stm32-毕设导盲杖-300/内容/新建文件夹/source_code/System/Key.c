@@ -1,5 +1,4 @@
 #include "Key.h"
-#include "Delay.h"
 
 /**
  * @brief  初始化所有按键
@@ -33,39 +32,44 @@ void Key_Init(void)
 }
 
 /**
- * @brief  扫描按键（带消抖）
- * @retval 按键值
+ * @brief  当前按下的按键 (多个时取编号最小的)
+ */
+static uint8_t Key_Read(void)
+{
+    if(GPIO_ReadInputDataBit(KEY1_PORT, KEY1_PIN) == RESET) return KEY1_PRESSED;
+    if(GPIO_ReadInputDataBit(KEY2_PORT, KEY2_PIN) == RESET) return KEY2_PRESSED;
+    if(GPIO_ReadInputDataBit(KEY3_PORT, KEY3_PIN) == RESET) return KEY3_PRESSED;
+    if(GPIO_ReadInputDataBit(KEY4_PORT, KEY4_PIN) == RESET) return KEY4_PRESSED;
+    if(GPIO_ReadInputDataBit(KEY5_PORT, KEY5_PIN) == RESET) return KEY5_PRESSED;
+    if(GPIO_ReadInputDataBit(KEY6_PORT, KEY6_PIN) == RESET) return KEY6_PRESSED;
+    return KEY_NONE;
+}
+
+/**
+ * @brief  扫描按键（带消抖）, 不阻塞
+ * @retval 按键值, 每次按下只返回一次
+ * @note   须周期调用 (约 10ms): 连续两次扫描都按下同一个键才算按下, 调用间隔就是消抖时间
  */
 uint8_t Key_Scan(void)
 {
     static uint8_t key_up = 1;
+    static uint8_t last = KEY_NONE;
+    uint8_t key = Key_Read();
     
-    if(key_up && (GPIO_ReadInputDataBit(KEY1_PORT, KEY1_PIN) == RESET ||
-                  GPIO_ReadInputDataBit(KEY2_PORT, KEY2_PIN) == RESET ||
-                  GPIO_ReadInputDataBit(KEY3_PORT, KEY3_PIN) == RESET ||
-                  GPIO_ReadInputDataBit(KEY4_PORT, KEY4_PIN) == RESET ||
-                  GPIO_ReadInputDataBit(KEY5_PORT, KEY5_PIN) == RESET ||
-                  GPIO_ReadInputDataBit(KEY6_PORT, KEY6_PIN) == RESET))
+    if(key == KEY_NONE)
     {
-        Delay_ms(10);
-        key_up = 0;
-        
-        if(GPIO_ReadInputDataBit(KEY1_PORT, KEY1_PIN) == RESET) return KEY1_PRESSED;
-        if(GPIO_ReadInputDataBit(KEY2_PORT, KEY2_PIN) == RESET) return KEY2_PRESSED;
-        if(GPIO_ReadInputDataBit(KEY3_PORT, KEY3_PIN) == RESET) return KEY3_PRESSED;
-        if(GPIO_ReadInputDataBit(KEY4_PORT, KEY4_PIN) == RESET) return KEY4_PRESSED;
-        if(GPIO_ReadInputDataBit(KEY5_PORT, KEY5_PIN) == RESET) return KEY5_PRESSED;
-        if(GPIO_ReadInputDataBit(KEY6_PORT, KEY6_PIN) == RESET) return KEY6_PRESSED;
+        key_up = 1; // 全部松开
+        last = KEY_NONE;
+        return KEY_NONE;
     }
-    else if(GPIO_ReadInputDataBit(KEY1_PORT, KEY1_PIN) == SET &&
-            GPIO_ReadInputDataBit(KEY2_PORT, KEY2_PIN) == SET &&
-            GPIO_ReadInputDataBit(KEY3_PORT, KEY3_PIN) == SET &&
-            GPIO_ReadInputDataBit(KEY4_PORT, KEY4_PIN) == SET &&
-            GPIO_ReadInputDataBit(KEY5_PORT, KEY5_PIN) == SET &&
-            GPIO_ReadInputDataBit(KEY6_PORT, KEY6_PIN) == SET)
+    if(!key_up) return KEY_NONE;
+    if(key != last)
     {
-        key_up = 1;
+        last = key; // 第一次看到, 下次扫描仍按下才确认
+        return KEY_NONE;
     }
     
-    return KEY_NONE;
+    key_up = 0;
+    last = KEY_NONE;
+    return key;
 }
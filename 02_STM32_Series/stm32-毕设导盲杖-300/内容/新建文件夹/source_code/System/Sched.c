@@ -0,0 +1,73 @@
+#include "stm32f10x.h"
+#include "Sched.h"
+#include "Delay.h"
+
+static Sched_Task_TypeDef *s_tasks;
+static uint8_t s_num;
+
+/**
+ * @brief  设置任务表, 清零统计; 任务表须一直有效
+ */
+void Sched_Init(Sched_Task_TypeDef *tasks, uint8_t num)
+{
+    uint32_t now = Delay_GetTick();
+    uint8_t i;
+
+    for(i = 0; i < num; i++)
+    {
+        tasks[i].Release = now + tasks[i].Offset;
+        tasks[i].Runs = 0;
+        tasks[i].Overruns = 0;
+        tasks[i].Skips = 0;
+        tasks[i].MaxLatency = 0;
+    }
+    s_tasks = tasks;
+    s_num = num;
+}
+
+/**
+ * @brief  执行一个已就绪的任务 (表中最靠前的)
+ * @retval 1: 执行了一个任务; 0: 没有就绪的任务
+ */
+uint8_t Sched_Poll(void)
+{
+    Sched_Task_TypeDef *t;
+    uint32_t now = Delay_GetTick(), latency;
+    uint8_t i;
+
+    for(i = 0; i < s_num; i++)
+    {
+        t = &s_tasks[i];
+        if((int32_t)(now - t->Release) < 0) continue;
+
+        t->Run();
+
+        now = Delay_GetTick();
+        latency = now - t->Release;
+        if(latency > t->Deadline && t->Overruns < 0xFFFF) t->Overruns++;
+        if(latency > t->MaxLatency) t->MaxLatency = latency > 0xFFFF ? 0xFFFF : latency;
+        t->Runs++;
+
+        // 下一个就绪时刻; 已经过去的周期不再补执行
+        t->Release += t->Period;
+        while((int32_t)(now - t->Release) > 0)
+        {
+            t->Release += t->Period;
+            if(t->Skips < 0xFFFF) t->Skips++;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  主循环: 依次执行就绪的任务, 都没有就绪时睡眠到下一个中断 (SysTick 每 1ms 一次). 不返回
+ */
+void Sched_Run(void)
+{
+    while(1)
+    {
+        if(!Sched_Poll())
+            __WFI();
+    }
+}
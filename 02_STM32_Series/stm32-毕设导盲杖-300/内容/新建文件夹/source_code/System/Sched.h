@@ -0,0 +1,33 @@
+#ifndef __SCHED_H
+#define __SCHED_H
+
+#include <stdint.h>
+
+/*
+ * 协作式调度: 任务按 SysTick 毫秒时基周期就绪, 每次执行完才返回 (不抢占).
+ * 同时就绪时任务表中靠前的先执行; 每执行完一个任务重新从表头查找, 短任务不会被排在长任务之后太久.
+ * 就绪时刻固定为 Offset + n x Period, 执行晚了也不会累积漂移.
+ */
+
+/* 任务; 前五项由使用者填写, 其余由调度器维护 */
+typedef struct
+{
+    const char *Name;
+    void (*Run)(void);
+    uint16_t Period;            // 周期 (ms)
+    uint16_t Deadline;          // 从就绪到执行完的期限 (ms), 超过计一次超时
+    uint16_t Offset;            // 第一次就绪距 Sched_Init 的时间 (ms), 用来错开各任务
+
+    uint32_t Release;           // 下次就绪时刻
+    uint32_t Runs;              // 执行次数
+    uint16_t Overruns;          // 执行完时已超过期限的次数
+    uint16_t Skips;             // 前面的任务太久, 整个周期错过而跳过的次数
+    uint16_t MaxLatency;        // 就绪到执行完的最长时间 (ms)
+} Sched_Task_TypeDef;
+
+/*============== 函数声明 ==============*/
+void Sched_Init(Sched_Task_TypeDef *tasks, uint8_t num);
+uint8_t Sched_Poll(void);
+void Sched_Run(void);
+
+#endif
@@ -7,8 +7,10 @@
 
 #include "stm32f10x.h"
 #include "Delay.h"
+#include "Sched.h"
 #include "pin_config.h"
 #include "HCSR04.h"
+#include "DistFilter.h"
 #include "Buzzer.h"
 #include "LED.h"
 #include "USART.h"
@@ -21,8 +23,12 @@
 #define MIN_ALARM_THRESHOLD         5
 #define MAX_ALARM_THRESHOLD         200
 #define THRESHOLD_STEP              5
-#define MEASURE_INTERVAL_MS         100
 #define REPORT_INTERVAL_MS          200
+#define MEASURE_PERIOD_MS           10
+#define ALARM_PERIOD_MS             10
+#define KEY_PERIOD_MS               10      // 也是按键消抖时间
+#define DISPLAY_PERIOD_MS           50
+#define ALARM_TTC_MS                2000    // 碰撞时间短于此值时报警 (快速走近时距离阈值来不及)
 #define USART_BAUDRATE              9600
 
 // ... 全局变量不变 ...
@@ -30,18 +36,46 @@ float g_distance = 0;
 uint16_t g_alarm_threshold = DEFAULT_ALARM_THRESHOLD;
 uint8_t g_alarm_enable = 1;
 uint8_t g_alarm_mode = 1;
+uint32_t g_ttc_ms = DISTFILTER_TTC_NONE; // 各方向中最短的碰撞时间
 
-static uint32_t g_report_timer = 0;
-static uint32_t g_measure_timer = 0;
 static uint32_t g_led_timer = 0;
 static uint8_t g_display_need_update = 1; // 显示更新标志
+static volatile uint8_t g_echo_ready[HCSR04_NUM]; // 有新的测量结果, 由测量完成中断置位
+static volatile uint32_t g_echo_us[HCSR04_NUM];
+static DistFilter_TypeDef g_filter[HCSR04_NUM];
 
 void System_Init(void);
 void Distance_Measure(void);
+static void Distance_OnEcho(uint8_t sensor, uint32_t echo_us);
 void Alarm_Process(void);
 void Key_Process(void);
 void WIFI_Report(void);
 void Update_Display(void);
+void Display_Process(void);
+
+// 任务表: 同时就绪时靠前的先执行
+static Sched_Task_TypeDef g_tasks[] = {
+    // 名称       函数              周期(ms)             期限(ms) 错开(ms)
+    {"measure",  Distance_Measure, MEASURE_PERIOD_MS,   10,      0},
+    {"alarm",    Alarm_Process,    ALARM_PERIOD_MS,     10,      1},
+    {"key",      Key_Process,      KEY_PERIOD_MS,       20,      2},
+    {"report",   WIFI_Report,      REPORT_INTERVAL_MS,  50,      3},
+    {"display",  Display_Process,  DISPLAY_PERIOD_MS,   100,     4},
+};
+#define TASK_NUM    (sizeof(g_tasks) / sizeof(g_tasks[0]))
+
+// 报警声, 由近到远: 越近音调越高、越急促 (Buzzer 在 SysTick 中断中播放, 不占用任务时间)
+static const Buzzer_Note_TypeDef g_alarm_notes[] = {
+    // 音调(Hz) 响(ms) 停(ms)
+    {2000,      20,    30},     // 50ms 一声
+    {1500,      30,    70},     // 100ms 一声
+    {1000,      40,    160},    // 200ms 一声
+};
+static const Buzzer_Pattern_TypeDef g_alarm_patterns[] = {
+    {&g_alarm_notes[0], 1, 0},
+    {&g_alarm_notes[1], 1, 0},
+    {&g_alarm_notes[2], 1, 0},
+};
 
 int main(void)
 {
@@ -65,23 +99,20 @@ int main(void)
     OLED_ShowString(4, 1, "Mode: S  Alm:ON");
     OLED_UpdateScreen();
     
-    while(1)
-    {
-        Distance_Measure();   
-        Alarm_Process();      
-        Key_Process();        
-        WIFI_Report();        
-        
-        // 集中刷新屏幕 (仅当需要时)
-        if(g_display_need_update)
-        {
-            Update_Display();
-            OLED_UpdateScreen(); // 将显存一次性写入
-            g_display_need_update = 0;
-        }
-        
-        Delay_ms(10);
-    }
+    HCSR04_Run(Distance_OnEcho); // 超声波阵列开始轮流测量, 由定时器中断推进
+    
+    Sched_Init(g_tasks, TASK_NUM);
+    Sched_Run(); // 各任务按周期执行, 不返回
+}
+
+// 集中刷新屏幕 (仅当需要时)
+void Display_Process(void)
+{
+    if(!g_display_need_update) return;
+    
+    Update_Display();
+    OLED_UpdateScreen(); // 将显存一次性写入
+    g_display_need_update = 0;
 }
 
 void Update_Display(void)
@@ -101,21 +132,44 @@ void Update_Display(void)
     OLED_ShowString(4, 14, g_alarm_enable ? "ON " : "OFF");
 }
 
+// 测量完成回调 (定时器中断中执行), 只保存回波宽度, 滤波在主循环中进行
+static void Distance_OnEcho(uint8_t sensor, uint32_t echo_us)
+{
+    g_echo_us[sensor] = echo_us;
+    g_echo_ready[sensor] = 1;
+}
+
 void Distance_Measure(void)
 {
-    g_measure_timer += 10;
-    if(g_measure_timer >= MEASURE_INTERVAL_MS)
+    uint8_t i, updated = 0;
+    int32_t mm;
+    uint32_t ttc, new_ttc = DISTFILTER_TTC_NONE;
+    float new_dist = 999.9;
+    
+    for(i = 0; i < HCSR04_NUM; i++)
     {
-        g_measure_timer = 0;
-        float new_dist = HCSR04_GetDistance();
-        
-        if(new_dist < 0 || new_dist > 400) new_dist = 999.9;
-        
-        if((int)(new_dist*10) != (int)(g_distance*10)) // 仅变化时刷新
-        {
-            g_distance = new_dist;
-            g_display_need_update = 1;
-        }
+        if(!g_echo_ready[i]) continue;
+        g_echo_ready[i] = 0;
+        mm = (g_echo_us[i] == HCSR04_NO_ECHO) ? DISTFILTER_NONE : (int32_t)(g_echo_us[i] * 1715 / 10000);
+        DistFilter_Update(&g_filter[i], mm, HCSR04_PERIOD_US / 1000);
+        updated = 1;
+    }
+    if(!updated) return;
+    
+    // 取各方向中最近的障碍物和最短的碰撞时间
+    for(i = 0; i < HCSR04_NUM; i++)
+    {
+        mm = DistFilter_GetDistance(&g_filter[i]);
+        if(mm >= 0 && mm <= HCSR04_RANGE_MAX_CM * 10 && mm / 10.0f < new_dist) new_dist = mm / 10.0f;
+        ttc = DistFilter_GetTtc(&g_filter[i]);
+        if(ttc < new_ttc) new_ttc = ttc;
+    }
+    g_ttc_ms = new_ttc;
+    
+    if((int)(new_dist*10) != (int)(g_distance*10)) // 仅变化时刷新
+    {
+        g_distance = new_dist;
+        g_display_need_update = 1;
     }
 }
 
@@ -149,20 +203,37 @@ void Key_Process(void)
 
 void WIFI_Report(void)
 {
+    static uint32_t last_faults = 0;
     char buf[64];
-    g_report_timer += 10;
-    if(g_report_timer >= REPORT_INTERVAL_MS)
+    uint32_t faults = 0;
+    uint8_t i;
+    
+    sprintf(buf, "D:%.1f T:%d\r\n", g_distance, g_alarm_threshold);
+    USART1_SendString(buf);
+    
+    // 有任务超时或跳过周期时报告各任务的 超时次数/跳过次数/最长延迟(ms)
+    for(i = 0; i < TASK_NUM; i++)
+        faults += g_tasks[i].Overruns + g_tasks[i].Skips;
+    if(faults == last_faults) return;
+    last_faults = faults;
+    USART1_SendString("OVR");
+    for(i = 0; i < TASK_NUM; i++)
     {
-        g_report_timer = 0;
-        sprintf(buf, "D:%.1f T:%d\r\n", g_distance, g_alarm_threshold);
+        sprintf(buf, " %s:%u/%u/%u", g_tasks[i].Name, g_tasks[i].Overruns, g_tasks[i].Skips, g_tasks[i].MaxLatency);
         USART1_SendString(buf);
     }
+    USART1_SendString("\r\n");
 }
 
 // ... 这里的其他函数(System_Init, Alarm_Process)保持不变，仅省略以节省空间 ...
 void System_Init(void)
 {
+    uint8_t i;
+    
+    NVIC_PriorityGroupConfig(NVIC_PriorityGroup_2);
     HCSR04_Init();
+    for(i = 0; i < HCSR04_NUM; i++)
+        DistFilter_Init(&g_filter[i]);
     Buzzer_Init();
     LED_Init();
     USART1_Init(USART_BAUDRATE);
@@ -172,40 +243,43 @@ void System_Init(void)
 
 void Alarm_Process(void)
 {
-    static uint8_t buzzer_cycle = 0;
+    static const Buzzer_Pattern_TypeDef *playing = 0;
+    const Buzzer_Pattern_TypeDef *pattern = 0;
+    uint16_t blink_period;
+    uint8_t level;
     
-    if(!g_alarm_enable)
+    // 距离低于阈值, 或以当前速度很快会撞上
+    if(g_alarm_enable && ((g_distance > 0 && g_distance < g_alarm_threshold) || g_ttc_ms < ALARM_TTC_MS))
     {
-        Buzzer_Off();
-        LED_Off();
-        return;
-    }
-    
-    if(g_distance > 0 && g_distance < g_alarm_threshold)
-    {
-        g_led_timer += 10;
-        uint16_t blink_period = (g_alarm_mode == 1) ? 100 : 
-            (g_distance < g_alarm_threshold/4) ? 50 : 
-            (g_distance < g_alarm_threshold/2) ? 100 : 200;
+        level = (g_alarm_mode == 1) ? 1 : 
+            (g_distance < g_alarm_threshold/4 || g_ttc_ms < ALARM_TTC_MS/4) ? 0 : 
+            (g_distance < g_alarm_threshold/2 || g_ttc_ms < ALARM_TTC_MS/2) ? 1 : 2;
+        pattern = &g_alarm_patterns[level];
         
+        // LED 与报警声同一节奏
+        g_led_timer += ALARM_PERIOD_MS;
+        blink_period = pattern->Notes[0].OnMs + pattern->Notes[0].OffMs;
         if(g_led_timer >= blink_period)
         {
             g_led_timer = 0;
             LED_Toggle();
         }
-        
-        buzzer_cycle++;
-        if(buzzer_cycle >= 5)
-        {
-            buzzer_cycle = 0;
-            Buzzer_Beep(20); 
-        }
     }
     else
     {
-        Buzzer_Off();
         LED_Off();
         g_led_timer = 0;
-        buzzer_cycle = 0;
+    }
+    
+    // 紧急程度变化时才切换报警声; 被按键提示音打断后重新开始
+    if(pattern != playing)
+    {
+        playing = pattern;
+        if(pattern) Buzzer_Play(pattern);
+        else Buzzer_Stop();
+    }
+    else if(pattern && !Buzzer_IsBusy())
+    {
+        Buzzer_Play(pattern);
     }
 }
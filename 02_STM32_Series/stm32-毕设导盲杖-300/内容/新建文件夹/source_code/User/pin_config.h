@@ -10,19 +10,30 @@
 
 #include "stm32f10x.h"
 
-/*-------------- HC-SR04 超声波模块引脚 --------------*/
-#define HCSR04_TRIG_PORT        GPIOA
-#define HCSR04_TRIG_PIN         GPIO_Pin_0       // PA2 - Trig
-#define HCSR04_TRIG_RCC         RCC_APB2Periph_GPIOA
-
-#define HCSR04_ECHO_PORT        GPIOA
-#define HCSR04_ECHO_PIN         GPIO_Pin_1       // PA1 - Echo
-#define HCSR04_ECHO_RCC         RCC_APB2Periph_GPIOA
+/*-------------- HC-SR04 超声波模块阵列 --------------*/
+// Echo 接 TIM2 的输入捕获通道 CH2-CH4 (PA1-PA3), 每个模块一个通道; CH1 比较作时隙定时, 不占引脚
+// 增减模块时修改 HCSR04_NUM 和下表 (最多 3 个), 表中顺序即轮流触发的顺序
+#define HCSR04_NUM              3
+#define HCSR04_SENSORS                                                              \
+{                                                                                   \
+    /* Trig 端口, Trig 引脚, Echo 端口, Echo 引脚, 捕获通道 */                      \
+    {GPIOA, GPIO_Pin_0, GPIOA, GPIO_Pin_1, TIM_Channel_2},  /* 0 正前: PA0 / PA1 */ \
+    {GPIOA, GPIO_Pin_4, GPIOA, GPIO_Pin_2, TIM_Channel_3},  /* 1 左前: PA4 / PA2 */ \
+    {GPIOA, GPIO_Pin_5, GPIOA, GPIO_Pin_3, TIM_Channel_4},  /* 2 右前: PA5 / PA3 */ \
+}
+#define HCSR04_RCC              RCC_APB2Periph_GPIOA
+
+#define HCSR04_TIM              TIM2
+#define HCSR04_TIM_RCC          RCC_APB1Periph_TIM2
+#define HCSR04_TIM_IRQn         TIM2_IRQn
+#define HCSR04_TIM_IRQHandler   TIM2_IRQHandler
 
 /*-------------- 无源蜂鸣器引脚 --------------*/
 #define BUZZER_PORT             GPIOB
-#define BUZZER_PIN              GPIO_Pin_14      // PB12
+#define BUZZER_PIN              GPIO_Pin_14      // PB14 - TIM1_CH2N, 低电平响
 #define BUZZER_RCC              RCC_APB2Periph_GPIOB
+#define BUZZER_TIM              TIM1             // 通道 2 互补输出 PWM 发声
+#define BUZZER_TIM_RCC          RCC_APB2Periph_TIM1
 
 /*-------------- LED指示灯引脚 --------------*/
 #define LED_PORT                GPIOB
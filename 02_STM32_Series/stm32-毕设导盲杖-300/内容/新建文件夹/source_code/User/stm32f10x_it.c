@@ -127,14 +127,7 @@ void PendSV_Handler(void)
 {
 }
 
-/**
-  * @brief  This function handles SysTick Handler.
-  * @param  None
-  * @retval None
-  */
-void SysTick_Handler(void)
-{
-}
+/* SysTick_Handler: 1ms 时基, 见 System/Delay.c */
 
 /******************************************************************************/
 /*                 STM32F10x Peripherals Interrupt Handlers                   */
@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @file    CapState.c
+  * @brief   采样状态机 - IDLE / ARMED / TRIGGERED / DONE / UPLOADING
+  * @note    采样过程由中断推进 (TRIGGER / FULL), 主循环只发起 (START / ABORT)
+  *          和发送 (UPLOAD / SENT), 不再阻塞等待采样结束.
+  *          CS_Event() 不可重入: 采样相关中断为同一抢占优先级, 互不打断;
+  *          主循环中调用时需关中断保护.
+  *          事件是否被接受由返回值告知, 停止定时器/DMA 等动作由调用方据此执行.
+  ******************************************************************************
+  */
+
+#include "CapState.h"
+
+/**
+  * @brief  初始化状态机
+  * @param  cs: 状态机
+  * @retval 无
+  */
+void CS_Init(CapState_TypeDef *cs)
+{
+    cs->State = CS_IDLE;
+    cs->Result = CS_RESULT_NONE;
+    cs->Notify = 0;
+    cs->Triggered = 0;
+}
+
+/**
+  * @brief  处理一个事件
+  * @param  cs: 状态机
+  * @param  event: 事件 CS_EV_xxx
+  * @note   当前状态下无效的事件被忽略, 例如中止后迟到的 FULL, 采样中再次 START
+  * @retval 1: 事件被接受, 0: 被忽略
+  */
+uint8_t CS_Event(CapState_TypeDef *cs, uint8_t event)
+{
+    switch (event)
+    {
+    case CS_EV_START:
+        if (cs->State != CS_IDLE && cs->State != CS_DONE)
+            return 0;
+        cs->State = CS_ARMED;
+        cs->Result = CS_RESULT_NONE;
+        cs->Notify = 0;
+        cs->Triggered = 0;
+        return 1;
+
+    case CS_EV_TRIGGER:
+        if (cs->State != CS_ARMED)
+            return 0;
+        cs->State = CS_TRIGGERED;
+        cs->Triggered = 1;
+        return 1;
+
+    case CS_EV_FULL:
+        if (cs->State != CS_ARMED && cs->State != CS_TRIGGERED)
+            return 0;
+        cs->State = CS_DONE;
+        cs->Result = CS_RESULT_FULL;
+        cs->Notify = 1;
+        return 1;
+
+    case CS_EV_ABORT:
+        /* 中止由命令发起, 应答中已说明, 不再通知主循环自动发送 */
+        if (cs->State != CS_ARMED && cs->State != CS_TRIGGERED)
+            return 0;
+        cs->State = CS_DONE;
+        cs->Result = CS_RESULT_ABORTED;
+        return 1;
+
+    case CS_EV_UPLOAD:
+        if (cs->State != CS_DONE)
+            return 0;
+        cs->State = CS_UPLOADING;
+        return 1;
+
+    case CS_EV_SENT:
+        /* 数据仍在缓冲区中, 可再次发送 */
+        if (cs->State != CS_UPLOADING)
+            return 0;
+        cs->State = CS_DONE;
+        return 1;
+
+    default:
+        return 0;
+    }
+}
+
+/**
+  * @brief  取走采满通知 (在主循环中调用)
+  * @param  cs: 状态机
+  * @retval 1: 自上次调用以来有采样采满, 0: 无
+  */
+uint8_t CS_TakeDone(CapState_TypeDef *cs)
+{
+    if (!cs->Notify)
+        return 0;
+    cs->Notify = 0;
+    return 1;
+}
+
+/**
+  * @brief  是否正在采样 (此时不能修改采样参数)
+  * @param  cs: 状态机
+  * @retval 1: ARMED / TRIGGERED, 0: 其他
+  */
+uint8_t CS_IsBusy(const CapState_TypeDef *cs)
+{
+    return cs->State == CS_ARMED || cs->State == CS_TRIGGERED;
+}
+
+/**
+  * @brief  状态名称 (用于 STATUS 应答)
+  * @param  state: 状态 CS_xxx
+  * @retval 名称字符串
+  */
+const char *CS_Name(uint8_t state)
+{
+    static const char *const name[] = {"IDLE", "ARMED", "TRIGGERED", "DONE", "UPLOADING"};
+
+    if (state > CS_UPLOADING)
+        return "?";
+    return name[state];
+}
@@ -0,0 +1,41 @@
+#ifndef __CAPSTATE_H
+#define __CAPSTATE_H
+
+#include <stdint.h>
+
+/* 采样状态 */
+#define CS_IDLE         0       // 空闲, 缓冲区中没有数据
+#define CS_ARMED        1       // 已启动: 采集触发前样本并等待触发 (无触发时直接采样)
+#define CS_TRIGGERED    2       // 已触发, 采集触发后样本
+#define CS_DONE         3       // 采样结束, 数据可发送
+#define CS_UPLOADING    4       // 正在发送数据
+
+/* 事件 */
+#define CS_EV_START     0       // 开始采样 (主循环)
+#define CS_EV_TRIGGER   1       // 检测到触发 (中断)
+#define CS_EV_FULL      2       // 样本采满 (中断)
+#define CS_EV_ABORT     3       // 中止采样, 保留已采数据 (主循环)
+#define CS_EV_UPLOAD    4       // 开始发送数据 (主循环)
+#define CS_EV_SENT      5       // 数据发送完毕 (主循环)
+
+/* 采样结束原因 */
+#define CS_RESULT_NONE      0   // 尚未结束
+#define CS_RESULT_FULL      1   // 采满
+#define CS_RESULT_ABORTED   2   // 被 ABORT 中止
+
+/* 采样状态机 - 全部状态 x 事件的转移测试见 Sim/SimCapState.c */
+typedef struct
+{
+    volatile uint8_t State;     // 当前状态 CS_xxx
+    volatile uint8_t Result;    // 最近一次采样的结束原因 CS_RESULT_xxx
+    volatile uint8_t Notify;    // 采满后置位, 由主循环用 CS_TakeDone() 取走
+    volatile uint8_t Triggered; // 最近一次采样是否经过 TRIGGERED 状态
+} CapState_TypeDef;
+
+void CS_Init(CapState_TypeDef *cs);
+uint8_t CS_Event(CapState_TypeDef *cs, uint8_t event);
+uint8_t CS_TakeDone(CapState_TypeDef *cs);
+uint8_t CS_IsBusy(const CapState_TypeDef *cs);
+const char *CS_Name(uint8_t state);
+
+#endif
@@ -2,115 +2,607 @@
   ******************************************************************************
   * @file    CommandParser.c
   * @brief   命令解析器 - 解析PC发送的控制命令
+  * @note    一行可含多条以 ';' 分隔的命令 (如 "RATE 0 71;COUNT 4096;CAP"),
+  *          依次执行, 每条回复一行; 某条出错后其余命令不执行, 各回复
+  *          "ERR: SKIPPED", 因此回复行数总等于命令条数.
+  *          每条命令在原缓冲区内按空格切分, 关键字按命令表精确匹配,
+  *          数值参数检查格式和范围, 不分配内存.
   ******************************************************************************
   */
 
+#include <errno.h>
 #include <string.h>
 #include <stdlib.h>
 #include "CommandParser.h"
 #include "LogicAnalyzer.h"
+#include "CapState.h"
+#include "Measure.h"
 #include "Serial.h"
 
+#define CMD_MAX_TOKENS      7       // 关键字 + 子关键字 + 最多 5 个参数 (TRIG SEQ)
+#define CMD_F_IDLE          0x01    // 采样进行中拒绝执行
+#define CMD_RATE_MAX_HZ     36000000    // 定时器时钟 72MHz, ARR 至少为 1
+#define CMD_BAUD_MAX_ERR    200         // 波特率误差上限 (0.01%), 两端合计约 4% 以内可可靠收发
+
+/* 命令表项. 带子关键字的表项 (TRIG POS) 须排在同名关键字 (TRIG) 之前 */
+typedef struct
+{
+    const char *Name;                           // 关键字
+    const char *Sub;                            // 子关键字, 无则为 0
+    uint8_t MinArgs;                            // 参数个数 (不含关键字)
+    uint8_t MaxArgs;
+    uint8_t Flags;                              // CMD_F_xxx
+    int (*Handler)(char **argv, uint8_t argc);  // argv: 参数
+    const char *Usage;                          // 参数个数不对时的提示
+} CMD_Entry;
+
 /**
-  * @brief  解析并执行命令
-  * @param  cmd: 命令字符串
-  * @retval 0: 成功, -1: 无效命令
+  * @brief  采样进行中时拒绝修改采样参数或发送数据的命令
+  * @param  无
+  * @retval 1: 正在采样 (已回复错误), 0: 可以执行
   */
-int CMD_Parse(char *cmd)
+static uint8_t CMD_Busy(void)
 {
-    /* 跳过前导空格 */
-    while (*cmd == ' ') cmd++;
-    
-    /* RATE <psc> <arr> - 设置采样率 */
-    if (strncmp(cmd, "RATE", 4) == 0)
-    {
-        cmd += 4;
-        uint16_t psc = atoi(cmd);
-        while (*cmd && *cmd != ' ') cmd++;
-        uint16_t arr = atoi(cmd);
-        
+    if (!LA_IsBusy())
+        return 0;
+    Serial_Printf("ERR: BUSY (%s), send ABORT first\r\n", CS_Name(LA_GetState()));
+    return 1;
+}
+
+/**
+  * @brief  解析数值参数 (十进制, 或 0x 前缀十六进制), 整串须为数字
+  * @note   前导 0 仍按十进制 ("010" 为 10), 不按 C 语言的八进制解释
+  * @param  text: 参数
+  * @param  min, max: 允许范围
+  * @param  value: 输出
+  * @retval 1: 成功, 0: 格式或范围错误 (已回复错误)
+  */
+static uint8_t CMD_Number(const char *text, uint32_t min, uint32_t max, uint32_t *value)
+{
+    char *end;
+    unsigned long v;
+    int base = (text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) ? 16 : 10;
+
+    if (*text >= '0' && *text <= '9')
+    {
+        errno = 0;
+        v = strtoul(text, &end, base);
+        if (*end == '\0' && errno == 0 && v >= min && v <= max)
+        {
+            *value = v;
+            return 1;
+        }
+    }
+    Serial_Printf("ERR: Bad value '%s' (%lu-%lu)\r\n", text, (unsigned long)min, (unsigned long)max);
+    return 0;
+}
+
+/* RATE MAX | RATE <Hz>[k|M] | RATE <psc> <arr> - 设置采样率 */
+static int CMD_Rate(char **argv, uint8_t argc)
+{
+    uint32_t value, scale = 1;
+
+    if (argc == 2)
+    {
+        uint32_t psc, arr;
+        /* ARR=0 时计数器停止 */
+        if (!CMD_Number(argv[0], 0, 65535, &psc) || !CMD_Number(argv[1], 1, 65535, &arr))
+            return -1;
         LA_SetSampleRate(psc, arr);
         Serial_Printf("OK: RATE PSC=%d ARR=%d\r\n", psc, arr);
         return 0;
     }
-    
-    /* COUNT <n> - 设置采样数量 */
-    if (strncmp(cmd, "COUNT", 5) == 0)
-    {
-        cmd += 5;
-        uint16_t count = atoi(cmd);
-        
-        LA_SetSampleCount(count);
-        Serial_Printf("OK: COUNT=%d\r\n", count);
+
+    if (strcmp(argv[0], "MAX") == 0)
+    {
+        if (LA_GetChannelMask() != 0xFF)
+        {
+            Serial_SendString("ERR: RATE MAX needs CHAN 0xFF\r\n");
+            return -1;
+        }
+        uint32_t rate = LA_SetTurbo();
+        Serial_Printf("OK: RATE MAX ACTUAL=%uHz (DMA burst, no trigger/stream)\r\n", rate);
         return 0;
     }
-    
-    /* TRIG <pin> <edge> - 设置触发条件 */
-    if (strncmp(cmd, "TRIG", 4) == 0)
-    {
-        cmd += 4;
-        uint8_t pin = atoi(cmd);
-        while (*cmd && *cmd != ' ') cmd++;
-        uint8_t edge = atoi(cmd);
-        
-        LA_SetTrigger(pin, edge);
-        Serial_Printf("OK: TRIG PIN=%d EDGE=%d\r\n", pin, edge);
-        return 0;
+
+    /* 频率可带 k/M 后缀 */
+    size_t len = strlen(argv[0]);
+    char unit = argv[0][len - 1];
+    if (unit == 'k' || unit == 'K')
+        scale = 1000;
+    else if (unit == 'M')
+        scale = 1000000;
+    if (scale != 1)
+        argv[0][len - 1] = '\0';
+
+    if (!CMD_Number(argv[0], 1, CMD_RATE_MAX_HZ / scale, &value))
+        return -1;
+    value *= scale;
+    uint32_t actual = LA_SetSampleRateHz(value);
+    Serial_Printf("OK: RATE %uHz ACTUAL=%uHz\r\n", value, actual);
+    return 0;
+}
+
+/* COUNT <n> - 设置采样数量 (超过上限时取上限) */
+static int CMD_Count(char **argv, uint8_t argc)
+{
+    uint32_t count;
+
+    if (!CMD_Number(argv[0], 1, 0xFFFFFFFF, &count))
+        return -1;
+    LA_SetSampleCount(count);
+    Serial_Printf("OK: COUNT=%u MAXCOUNT=%u\r\n", LA_GetSampleCount(), LA_GetMaxSampleCount());
+    return 0;
+}
+
+/* CHAN <mask> - 设置采样通道, 只采部分通道时打包存储 */
+static int CMD_Chan(char **argv, uint8_t argc)
+{
+    uint32_t mask;
+
+    if (!CMD_Number(argv[0], 1, 0xFF, &mask))
+        return -1;
+    if (mask != 0xFF && LA_IsTurbo())
+    {
+        Serial_SendString("ERR: CHAN packing not available at RATE MAX\r\n");
+        return -1;
     }
-    
-    /* NOTRIG - 禁用触发 */
-    if (strncmp(cmd, "NOTRIG", 6) == 0)
+
+    LA_SetChannelMask(mask);
+    Serial_Printf("OK: CHAN=0x%02X MAXCOUNT=%u COUNT=%u\r\n",
+                  LA_GetChannelMask(), LA_GetMaxSampleCount(), LA_GetSampleCount());
+    return 0;
+}
+
+/* TRIG POS <percent> - 设置触发前样本占比 */
+static int CMD_TrigPos(char **argv, uint8_t argc)
+{
+    uint32_t percent;
+
+    if (!CMD_Number(argv[0], 0, 100, &percent))
+        return -1;
+    LA_SetTriggerPosition(percent);
+    Serial_Printf("OK: TRIG POS=%d%%\r\n", LA_GetTriggerPosition());
+    return 0;
+}
+
+/* TRIG PAT <val> <mask> - 值/掩码匹配触发 */
+static int CMD_TrigPat(char **argv, uint8_t argc)
+{
+    uint32_t value, mask;
+
+    if (!CMD_Number(argv[0], 0, 0xFF, &value) || !CMD_Number(argv[1], 1, 0xFF, &mask))
+        return -1;
+    LA_SetPatternTrigger(value, mask);
+    Serial_Printf("OK: TRIG PAT VAL=0x%02X MASK=0x%02X\r\n", value, mask);
+    return 0;
+}
+
+/* TRIG ANY <mask> - 掩码内任一通道跳变触发 */
+static int CMD_TrigAny(char **argv, uint8_t argc)
+{
+    uint32_t mask;
+
+    if (!CMD_Number(argv[0], 1, 0xFF, &mask))
+        return -1;
+    LA_SetAnyEdgeTrigger(mask);
+    Serial_Printf("OK: TRIG ANY MASK=0x%02X\r\n", mask);
+    return 0;
+}
+
+/* TRIG SEQ <valA> <maskA> <valB> <maskB> <n> - 状态A之后 n 个样本内出现状态B */
+static int CMD_TrigSeq(char **argv, uint8_t argc)
+{
+    uint32_t v[4], window;
+
+    for (uint8_t i = 0; i < 4; i++)
     {
-        LA_DisableTrigger();
-        Serial_SendString("OK: TRIGGER DISABLED\r\n");
-        return 0;
+        if (!CMD_Number(argv[i], 0, 0xFF, &v[i]))
+            return -1;
     }
-    
-    /* CAP - 开始采样 */
-    if (strncmp(cmd, "CAP", 3) == 0)
+    if (!CMD_Number(argv[4], 1, 65535, &window))
+        return -1;
+
+    LA_SetSequenceTrigger(v[0], v[1], v[2], v[3], window);
+    Serial_Printf("OK: TRIG SEQ A=0x%02X/0x%02X B=0x%02X/0x%02X N=%u\r\n",
+                  v[0], v[1], v[2], v[3], window);
+    return 0;
+}
+
+/* TRIG <pin> <edge> - 设置边沿触发 */
+static int CMD_Trig(char **argv, uint8_t argc)
+{
+    uint32_t pin, edge;
+
+    if (!CMD_Number(argv[0], 0, 7, &pin) || !CMD_Number(argv[1], 0, 1, &edge))
+        return -1;
+    LA_SetTrigger(pin, edge);
+    Serial_Printf("OK: TRIG PIN=%d EDGE=%d\r\n", pin, edge);
+    return 0;
+}
+
+/* NOTRIG - 禁用触发 */
+static int CMD_NoTrig(char **argv, uint8_t argc)
+{
+    LA_DisableTrigger();
+    Serial_SendString("OK: TRIGGER DISABLED\r\n");
+    return 0;
+}
+
+/* CAP - 开始采样 */
+static int CMD_Cap(char **argv, uint8_t argc)
+{
+    Serial_SendString("OK: CAPTURING...\r\n");
+    LA_StartCapture();
+    return 0;
+}
+
+/* ABORT - 中止采样, 保留已采到的数据 */
+static int CMD_Abort(char **argv, uint8_t argc)
+{
+    if (!LA_Abort())
     {
-        Serial_SendString("OK: CAPTURING...\r\n");
-        LA_StartCapture();
-        return 0;
+        Serial_SendString("ERR: Not capturing\r\n");
+        return -1;
     }
-    
-    /* STATUS - 查询状态 */
-    if (strncmp(cmd, "STATUS", 6) == 0)
+    Serial_SendString("OK: ABORTED\r\n");
+    return 0;
+}
+
+/* STREAM - 开始流式采样 */
+static int CMD_Stream(char **argv, uint8_t argc)
+{
+    if (LA_IsTurbo())
     {
-        if (LA_IsCaptureComplete())
-        {
-            Serial_SendString("STATUS: READY\r\n");
-        }
-        else
-        {
-            Serial_SendString("STATUS: CAPTURING\r\n");
-        }
-        return 0;
+        Serial_SendString("ERR: STREAM not available at RATE MAX\r\n");
+        return -1;
+    }
+    Serial_SendString("OK: STREAMING...\r\n");
+    LA_StartStream();
+    return 0;
+}
+
+/* STOP - 停止流式采样 */
+static int CMD_Stop(char **argv, uint8_t argc)
+{
+    LA_StopStream();
+    Serial_Printf("OK: STREAM STOPPED DROPPED=%u\r\n", LA_GetDroppedCount());
+    return 0;
+}
+
+/* STATUS - 查询状态 */
+static int CMD_Status(char **argv, uint8_t argc)
+{
+    if (LA_IsStreaming())
+    {
+        Serial_Printf("STATUS: STREAMING DROPPED=%u\r\n", LA_GetDroppedCount());
+    }
+    else if (LA_IsBusy())
+    {
+        Serial_Printf("STATUS: %s\r\n", CS_Name(LA_GetState()));
+    }
+    else if (LA_IsCaptureComplete())
+    {
+        Serial_Printf("STATUS: READY MAXCOUNT=%u DATA=%s", LA_GetMaxSampleCount(),
+                      (LA_GetResult() == CS_RESULT_ABORTED) ? "ABORTED" : "FULL");
+        if (LA_GetOverrunCount())
+            Serial_Printf(" OVERRUN=%u", LA_GetOverrunCount());
+        Serial_SendString("\r\n");
     }
+    else
+    {
+        Serial_Printf("STATUS: READY MAXCOUNT=%u\r\n", LA_GetMaxSampleCount());
+    }
+    return 0;
+}
+
+/* SEND - 发送数据 */
+static int CMD_Send(char **argv, uint8_t argc)
+{
+    LA_SendData();
+    return 0;
+}
+
+/* MODE BIN|HEX - 设置数据输出格式 */
+static int CMD_Mode(char **argv, uint8_t argc)
+{
+    if (strcmp(argv[0], "BIN") == 0)
+    {
+        LA_SetOutputMode(LA_MODE_BIN);
+    }
+    else if (strcmp(argv[0], "HEX") == 0)
+    {
+        LA_SetOutputMode(LA_MODE_HEX);
+    }
+    else
+    {
+        Serial_Printf("ERR: Unknown mode '%s'\r\n", argv[0]);
+        return -1;
+    }
+    Serial_Printf("OK: MODE %s\r\n", (LA_GetOutputMode() == LA_MODE_BIN) ? "BIN" : "HEX");
+    return 0;
+}
+
+/* COMP ON|OFF - 二进制帧游程压缩 */
+static int CMD_Comp(char **argv, uint8_t argc)
+{
+    if (strcmp(argv[0], "ON") == 0)
+    {
+        LA_SetCompression(1);
+    }
+    else if (strcmp(argv[0], "OFF") == 0)
+    {
+        LA_SetCompression(0);
+    }
+    else
+    {
+        Serial_Printf("ERR: Unknown compression '%s'\r\n", argv[0]);
+        return -1;
+    }
+    Serial_Printf("OK: COMP %s\r\n", LA_GetCompression() ? "ON" : "OFF");
+    return 0;
+}
+
+/* BAUD <rate> - 切换波特率: 按原波特率回复后切换, 2 秒内须以新波特率收到 PING, 否则恢复 */
+static int CMD_Baud(char **argv, uint8_t argc)
+{
+    uint32_t baud, actual;
+    uint16_t brr;
+    int32_t err;
+
+    if (LA_IsStreaming())
+    {
+        Serial_SendString("ERR: BAUD not available while streaming\r\n");
+        return -1;
+    }
+    if (Measure_GetPin() != MEAS_OFF)
+    {
+        Serial_SendString("ERR: BAUD not available while measuring\r\n");
+        return -1;
+    }
+    if (!CMD_Number(argv[0], 1200, 4500000, &baud))
+        return -1;
+    actual = Serial_BaudToBrr(baud, &brr);
+    /* 误差单位 0.01% */
+    err = (int32_t)(((int64_t)actual - baud) * 10000 / baud);
+    if (err > CMD_BAUD_MAX_ERR || err < -CMD_BAUD_MAX_ERR)
+    {
+        Serial_Printf("ERR: BAUD %u ACTUAL=%u error too large\r\n", baud, actual);
+        return -1;
+    }
+
+    Serial_Printf("OK: BAUD %u ACTUAL=%u ERR=%c%d.%02d%%\r\n", baud, actual,
+                  (err < 0) ? '-' : '+', (err < 0 ? -err : err) / 100, (err < 0 ? -err : err) % 100);
+    Serial_RequestBaud(brr);
+    return 0;
+}
+
+/* PING - 链路确认, BAUD 切换后的第一条命令 */
+static int CMD_Ping(char **argv, uint8_t argc)
+{
+    Serial_ConfirmBaud();
+    Serial_SendString("OK: PONG\r\n");
+    return 0;
+}
+
+/* CAL [pin] - 自校准: 采样接到 PA<pin> 的 PB1 测试信号, 测量实际采样率 */
+static int CMD_Cal(char **argv, uint8_t argc)
+{
+    uint32_t pin = 0;
+    uint32_t ref = LA_GetReferenceRate();
     
-    /* SEND - 发送数据 */
-    if (strncmp(cmd, "SEND", 4) == 0)
+    if (argc > 0 && !CMD_Number(argv[0], 0, 7, &pin))
+        return -1;
+    if (LA_GetChannelMask() != 0xFF || LA_IsTriggerEnabled())
     {
-        LA_SendData();
-        return 0;
+        Serial_SendString("ERR: CAL needs CHAN 0xFF and NOTRIG\r\n");
+        return -1;
+    }
+    if (ref == 0)
+    {
+        Serial_SendString("ERR: CAL needs the TIM3 test signal on PB1\r\n");
+        return -1;
     }
     
-    /* HELP - 帮助 */
-    if (strncmp(cmd, "HELP", 4) == 0 || strncmp(cmd, "?", 1) == 0)
-    {
-        Serial_SendString("\r\n=== Logic Analyzer Commands ===\r\n");
-        Serial_SendString("RATE <psc> <arr>  - Set sample rate\r\n");
-        Serial_SendString("COUNT <n>         - Set sample count\r\n");
-        Serial_SendString("TRIG <pin> <edge> - Set trigger (pin:0-7, edge:0=fall,1=rise)\r\n");
-        Serial_SendString("NOTRIG            - Disable trigger\r\n");
-        Serial_SendString("CAP               - Start capture\r\n");
-        Serial_SendString("STATUS            - Check status\r\n");
-        Serial_SendString("SEND              - Send captured data\r\n");
-        Serial_SendString("================================\r\n");
-        return 0;
+    /* 应答只有这一行; 结果在采完后以事件行 EVT: CAL ... 发送 */
+    Serial_Printf("OK: CALIBRATING PA%u against %uHz\r\n", pin, ref);
+    LA_StartCalibration(pin);
+    return 0;
+}
+
+/* RXSTAT - 接收统计 (流水线发送命令时检查是否丢失) */
+static int CMD_RxStat(char **argv, uint8_t argc)
+{
+    Serial_RxStats_TypeDef stats;
+    
+    Serial_GetRxStats(&stats);
+    Serial_Printf("OK: RX LINES=%u OVERFLOW=%u ORE=%u DROPPED=%u\r\n",
+                  stats.Lines, stats.Overflow, stats.Overrun, stats.Dropped);
+    return 0;
+}
+
+/* MEAS <pin> [ms] - 用 TIM5 连续测量 PA<pin> 的频率/占空比, 每 ms 毫秒发送一条统计记录 */
+static int CMD_Meas(char **argv, uint8_t argc)
+{
+    uint32_t pin, ms = MEAS_INTERVAL_DEF;
+    
+    if (!CMD_Number(argv[0], 0, 7, &pin))
+        return -1;
+    if (argc > 1 && !CMD_Number(argv[1], MEAS_INTERVAL_MIN, MEAS_INTERVAL_MAX, &ms))
+        return -1;
+    if (pin > MEAS_PIN_MAX)
+    {
+        Serial_Printf("ERR: MEAS only on PA0/PA1 (TIM5 CH1/CH2), not PA%u\r\n", pin);
+        return -1;
     }
     
-    /* 未知命令 */
-    Serial_Printf("ERR: Unknown command '%s'\r\n", cmd);
+    /* 记录在第一个窗口结束后开始发送, 不会先于本应答 */
+    Serial_Printf("OK: MEAS PA%u every %ums\r\n", pin, ms);
+    Measure_Start(pin, ms);
+    return 0;
+}
+
+/* MEAS STOP - 停止测量 */
+static int CMD_MeasStop(char **argv, uint8_t argc)
+{
+    Measure_Stop();
+    Serial_SendString("OK: MEAS STOPPED\r\n");
+    return 0;
+}
+
+/* HELP - 帮助 */
+static const char *const CMD_HelpText[] = {
+    "RATE <Hz>[k|M]    - Set sample rate, reports actual rate",
+    "RATE <psc> <arr>  - Set sample rate from raw timer values",
+    "RATE MAX          - DMA burst at bus speed (CAP only)",
+    "COUNT <n>         - Set sample count (max: see STATUS)",
+    "CHAN <mask>       - Capture only these channels, packed",
+    "TRIG <pin> <edge> - Set trigger (pin:0-7, edge:0=fall,1=rise)",
+    "TRIG POS <0-100>  - Set pre-trigger percentage",
+    "TRIG PAT <v> <m>  - Trigger on entering (PA & m) == v",
+    "TRIG ANY <m>      - Trigger on any edge of channels in m",
+    "TRIG SEQ <vA> <mA> <vB> <mB> <n> - A then B within n samples",
+    "NOTRIG            - Disable trigger",
+    "CAP               - Start capture (returns at once)",
+    "ABORT             - Stop capture, keep samples so far",
+    "STREAM            - Start continuous streaming",
+    "STOP              - Stop streaming",
+    "STATUS            - Check status (ARMED/TRIGGERED/READY)",
+    "SEND              - Send captured data",
+    "MODE <BIN|HEX>    - Set data output format",
+    "COMP <ON|OFF>     - Run-length compress binary frames",
+    "BAUD <rate>       - Switch baud rate, PING within 2s to keep it",
+    "PING              - Link check, replies OK: PONG",
+    "RXSTAT            - Received lines and lost bytes/lines",
+    "CAL [pin]         - Measure sample rate against PB1 (wired to PA<pin>)",
+    "MEAS <pin> [ms]   - Frequency/duty of PA0/PA1 every ms (default 100)",
+    "MEAS STOP         - Stop measuring",
+    "CMD;CMD;...       - Run in order, stop at first error",
+};
+
+static int CMD_Help(char **argv, uint8_t argc)
+{
+    Serial_SendString("\r\n=== Logic Analyzer Commands ===\r\n");
+    for (uint8_t i = 0; i < sizeof(CMD_HelpText) / sizeof(CMD_HelpText[0]); i++)
+    {
+        Serial_SendString((char *)CMD_HelpText[i]);
+        Serial_SendString("\r\n");
+    }
+    Serial_SendString("================================\r\n");
+    return 0;
+}
+
+static const CMD_Entry CMD_Table[] = {
+    {"RATE",   0,     1, 2, CMD_F_IDLE, CMD_Rate,    "RATE <Hz>[k|M] | <psc> <arr> | MAX"},
+    {"COUNT",  0,     1, 1, CMD_F_IDLE, CMD_Count,   "COUNT <n>"},
+    {"CHAN",   0,     1, 1, CMD_F_IDLE, CMD_Chan,    "CHAN <mask>"},
+    {"TRIG",   "POS", 1, 1, CMD_F_IDLE, CMD_TrigPos, "TRIG POS <0-100>"},
+    {"TRIG",   "PAT", 2, 2, CMD_F_IDLE, CMD_TrigPat, "TRIG PAT <val> <mask>"},
+    {"TRIG",   "ANY", 1, 1, CMD_F_IDLE, CMD_TrigAny, "TRIG ANY <mask>"},
+    {"TRIG",   "SEQ", 5, 5, CMD_F_IDLE, CMD_TrigSeq, "TRIG SEQ <valA> <maskA> <valB> <maskB> <n>"},
+    {"TRIG",   0,     2, 2, CMD_F_IDLE, CMD_Trig,    "TRIG <pin> <edge>"},
+    {"NOTRIG", 0,     0, 0, CMD_F_IDLE, CMD_NoTrig,  "NOTRIG"},
+    {"CAP",    0,     0, 0, CMD_F_IDLE, CMD_Cap,     "CAP"},
+    {"ABORT",  0,     0, 0, 0,          CMD_Abort,   "ABORT"},
+    {"STREAM", 0,     0, 0, CMD_F_IDLE, CMD_Stream,  "STREAM"},
+    {"STOP",   0,     0, 0, 0,          CMD_Stop,    "STOP"},
+    {"STATUS", 0,     0, 0, 0,          CMD_Status,  "STATUS"},
+    {"SEND",   0,     0, 0, CMD_F_IDLE, CMD_Send,    "SEND"},
+    {"MODE",   0,     1, 1, 0,          CMD_Mode,    "MODE <BIN|HEX>"},
+    {"COMP",   0,     1, 1, 0,          CMD_Comp,    "COMP <ON|OFF>"},
+    {"BAUD",   0,     1, 1, CMD_F_IDLE, CMD_Baud,    "BAUD <rate>"},
+    {"PING",   0,     0, 0, 0,          CMD_Ping,    "PING"},
+    {"RXSTAT", 0,     0, 0, 0,          CMD_RxStat,  "RXSTAT"},
+    {"CAL",    0,     0, 1, CMD_F_IDLE, CMD_Cal,     "CAL [pin]"},
+    {"MEAS",   "STOP", 0, 0, 0,         CMD_MeasStop, "MEAS STOP"},
+    {"MEAS",   0,     1, 2, 0,          CMD_Meas,    "MEAS <pin> [ms]"},
+    {"HELP",   0,     0, 0, 0,          CMD_Help,    "HELP"},
+    {"?",      0,     0, 0, 0,          CMD_Help,    "?"},
+};
+
+/**
+  * @brief  在原缓冲区内按空格/制表符切分
+  * @param  cmd: 一条命令 (会被修改)
+  * @param  tok: 输出各段首地址
+  * @retval 段数, 超过 CMD_MAX_TOKENS 时返回 CMD_MAX_TOKENS + 1
+  */
+static uint8_t CMD_Split(char *cmd, char **tok)
+{
+    uint8_t n = 0;
+
+    for (;;)
+    {
+        while (*cmd == ' ' || *cmd == '\t')
+            *cmd++ = '\0';
+        if (*cmd == '\0')
+            return n;
+        if (n == CMD_MAX_TOKENS)
+            return n + 1;
+        tok[n++] = cmd;
+        while (*cmd && *cmd != ' ' && *cmd != '\t')
+            cmd++;
+    }
+}
+
+/**
+  * @brief  查表执行一条已切分的命令
+  * @param  tok: 各段, tok[0] 为关键字
+  * @param  n: 段数 (至少为 1)
+  * @retval 0: 成功, -1: 失败 (已回复错误)
+  */
+static int CMD_Execute(char **tok, uint8_t n)
+{
+    for (uint8_t i = 0; i < sizeof(CMD_Table) / sizeof(CMD_Table[0]); i++)
+    {
+        const CMD_Entry *e = &CMD_Table[i];
+        uint8_t skip = e->Sub ? 2 : 1;
+
+        if (strcmp(tok[0], e->Name) != 0)
+            continue;
+        if (e->Sub && (n < 2 || strcmp(tok[1], e->Sub) != 0))
+            continue;
+
+        if (n > CMD_MAX_TOKENS || n - skip < e->MinArgs || n - skip > e->MaxArgs)
+        {
+            Serial_Printf("ERR: Usage: %s\r\n", e->Usage);
+            return -1;
+        }
+        if ((e->Flags & CMD_F_IDLE) && CMD_Busy())
+            return -1;
+        return e->Handler(tok + skip, n - skip);
+    }
+
+    Serial_Printf("ERR: Unknown command '%s'\r\n", tok[0]);
     return -1;
 }
+
+/**
+  * @brief  解析并执行一行命令 (可含多条, 以 ';' 分隔)
+  * @param  cmd: 命令行 (会被修改)
+  * @retval 0: 全部成功, -1: 有命令失败
+  */
+int CMD_Parse(char *cmd)
+{
+    char *tok[CMD_MAX_TOKENS];
+    char *next;
+    int result = 0;
+    uint8_t n;
+
+    for (; cmd; cmd = next)
+    {
+        next = strchr(cmd, ';');
+        if (next)
+            *next++ = '\0';
+
+        n = CMD_Split(cmd, tok);
+        if (n == 0)
+            continue;           // 空命令 (如行尾的 ';')
+        if (result < 0)
+        {
+            Serial_Printf("ERR: SKIPPED '%s'\r\n", tok[0]);
+            continue;
+        }
+        result = CMD_Execute(tok, n);
+    }
+    return result;
+}
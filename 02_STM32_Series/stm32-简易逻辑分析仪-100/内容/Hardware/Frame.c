@@ -0,0 +1,177 @@
+/**
+  ******************************************************************************
+  * @file    Frame.c
+  * @brief   二进制数据帧 - 替代十六进制文本传输, 每个采样只占1字节
+  * @note    帧格式见 Frame.h
+  ******************************************************************************
+  */
+
+#include "Frame.h"
+#include "Serial.h"
+
+/* CRC16-CCITT 查表 (多项式 0x1021) */
+static const uint16_t Frame_CRCTable[256] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+/**
+  * @brief  计算 CRC16-CCITT (可分段累加)
+  * @param  crc: 初值 (首段为 0xFFFF, 后续段为上一段结果)
+  * @param  data: 数据首地址
+  * @param  len: 数据长度
+  * @retval CRC 值
+  */
+uint16_t Frame_CRC16(uint16_t crc, const uint8_t *data, uint32_t len)
+{
+    while (len--)
+    {
+        crc = (crc << 8) ^ Frame_CRCTable[((crc >> 8) ^ *data++) & 0xFF];
+    }
+    return crc;
+}
+
+/**
+  * @brief  开始发送一帧: 发送帧头
+  * @note   数据可由 Frame_Data() 分多段发送, 各段长度之和必须等于 len,
+  *         最后调用 Frame_End() 发送校验
+  * @param  type: 帧类型
+  * @param  flags: 标志位
+  * @param  seq: 帧序号
+  * @param  chMask: 通道掩码
+  * @param  rate: 采样率 (Hz)
+  * @param  len: 数据总长度
+  * @retval 到帧头为止的 CRC, 传给 Frame_Data()/Frame_End()
+  */
+uint16_t Frame_Begin(uint8_t type, uint8_t flags, uint16_t seq, uint8_t chMask, uint32_t rate,
+                     uint32_t len)
+{
+    uint8_t header[FRAME_HEADER_SIZE];
+    
+    header[0]  = FRAME_SYNC0;
+    header[1]  = FRAME_SYNC1;
+    header[2]  = type;
+    header[3]  = flags;
+    header[4]  = (uint8_t)(seq);
+    header[5]  = (uint8_t)(seq >> 8);
+    header[6]  = chMask;
+    header[7]  = 0;
+    header[8]  = (uint8_t)(rate);
+    header[9]  = (uint8_t)(rate >> 8);
+    header[10] = (uint8_t)(rate >> 16);
+    header[11] = (uint8_t)(rate >> 24);
+    header[12] = (uint8_t)(len);
+    header[13] = (uint8_t)(len >> 8);
+    header[14] = (uint8_t)(len >> 16);
+    header[15] = (uint8_t)(len >> 24);
+    
+    Serial_SendArray(header, FRAME_HEADER_SIZE);
+    return Frame_CRC16(0xFFFF, &header[2], FRAME_HEADER_SIZE - 2);
+}
+
+/**
+  * @brief  发送时间信息 (紧接 Frame_Begin, 帧标志须含 FRAME_FLAG_TIME)
+  * @param  crc: 帧头的 CRC
+  * @param  time: 时间信息
+  * @retval 累计到时间信息为止的 CRC
+  */
+uint16_t Frame_Time(uint16_t crc, const Frame_Time_TypeDef *time)
+{
+    const uint32_t field[FRAME_TIME_SIZE / 4] = {
+        time->Clock, time->Arm, time->Trigger, time->Done, time->Period16, time->TriggerSample,
+    };
+    uint8_t block[FRAME_TIME_SIZE];
+    
+    for (uint8_t i = 0; i < FRAME_TIME_SIZE; i++)
+    {
+        block[i] = (uint8_t)(field[i / 4] >> ((i % 4) * 8));
+    }
+    return Frame_Data(crc, block, FRAME_TIME_SIZE);
+}
+
+/**
+  * @brief  发送一段帧数据
+  * @param  crc: 之前各段累计的 CRC
+  * @param  data: 数据首地址
+  * @param  len: 数据长度
+  * @retval 累计到本段为止的 CRC
+  */
+uint16_t Frame_Data(uint16_t crc, const uint8_t *data, uint32_t len)
+{
+    /* Serial_SendArray 长度为 16 位, 大块数据分段发送 */
+    while (len)
+    {
+        uint16_t n = (len > 0x8000) ? 0x8000 : len;
+        crc = Frame_CRC16(crc, data, n);
+        Serial_SendArray((uint8_t *)data, n);
+        data += n;
+        len -= n;
+    }
+    return crc;
+}
+
+/**
+  * @brief  结束一帧: 发送 CRC
+  * @param  crc: 全部数据累计的 CRC
+  * @retval 无
+  */
+void Frame_End(uint16_t crc)
+{
+    uint8_t tail[2];
+    
+    tail[0] = (uint8_t)(crc >> 8);
+    tail[1] = (uint8_t)(crc);
+    Serial_SendArray(tail, 2);
+}
+
+/**
+  * @brief  发送一帧数据
+  * @param  type: 帧类型
+  * @param  flags: 标志位
+  * @param  seq: 帧序号
+  * @param  chMask: 通道掩码
+  * @param  rate: 采样率 (Hz)
+  * @param  payload: 数据首地址
+  * @param  len: 数据长度
+  * @retval 无
+  */
+void Frame_Send(uint8_t type, uint8_t flags, uint16_t seq, uint8_t chMask, uint32_t rate,
+                const uint8_t *payload, uint32_t len)
+{
+    uint16_t crc;
+    
+    crc = Frame_Begin(type, flags, seq, chMask, rate, len);
+    crc = Frame_Data(crc, payload, len);
+    Frame_End(crc);
+}
@@ -0,0 +1,66 @@
+#ifndef __FRAME_H
+#define __FRAME_H
+
+#include <stdint.h>
+
+/*
+ * 二进制数据帧格式 (小端):
+ *  偏移  长度  内容
+ *   0     2    同步字 0xA5 0x5A
+ *   2     1    帧类型 FRAME_TYPE_xxx
+ *   3     1    标志位 FRAME_FLAG_xxx
+ *   4     2    帧序号
+ *   6     1    通道掩码 (bit0-7 对应 PA0-PA7)
+ *   7     1    保留 (0)
+ *   8     4    采样率 (Hz)
+ *  12     4    数据长度 n (字节)
+ *  16     n    数据
+ *  16+n   2    CRC16-CCITT (多项式 0x1021, 初值 0xFFFF, 高字节在前),
+ *              校验范围: 偏移2 至数据末尾
+ *
+ * 标志 FRAME_FLAG_TIME 置位时, 帧头与数据之间插入 24 字节时间信息
+ * (不计入数据长度 n, 计入 CRC, 此时数据从偏移 40 开始):
+ *   0     4    DWT 计数频率 (Hz, 即 CPU 时钟)
+ *   4     4    启动采样时的 DWT 计数
+ *   8     4    触发时的 DWT 计数 (未触发时无意义)
+ *  12     4    采样结束时的 DWT 计数
+ *  16     4    实测采样周期 (1/16 个 DWT 周期), 0 表示无法测量, 按帧头采样率计
+ *  20     4    触发点的样本序号, 0xFFFFFFFF 表示未触发
+ * DWT 计数 32 位回绕 (72MHz 时约 59.6 秒), 只应取差值
+ */
+#define FRAME_SYNC0         0xA5
+#define FRAME_SYNC1         0x5A
+#define FRAME_HEADER_SIZE   16
+
+#define FRAME_TYPE_DATA     0x01    // 单次采样数据
+#define FRAME_TYPE_STREAM   0x02    // 流式采样半区数据
+#define FRAME_TYPE_MEAS     0x03    // 频率/占空比测量记录 (见 Measure.h), 采样率字段为计数频率
+
+#define FRAME_FLAG_RLE      0x01    // 数据为游程编码 (见 Rle.h), 长度为编码后长度
+#define FRAME_FLAG_TIME     0x02    // 帧头后带时间信息
+#define FRAME_FLAG_OVERRUN  0x04    // 部分样本在处理前被 DMA 覆盖, 数据不连续
+
+#define FRAME_TIME_SIZE     24
+#define FRAME_NO_TRIGGER    0xFFFFFFFF
+
+/* 采样时间信息 (见上) */
+typedef struct
+{
+    uint32_t Clock;
+    uint32_t Arm;
+    uint32_t Trigger;
+    uint32_t Done;
+    uint32_t Period16;
+    uint32_t TriggerSample;
+} Frame_Time_TypeDef;
+
+uint16_t Frame_CRC16(uint16_t crc, const uint8_t *data, uint32_t len);
+uint16_t Frame_Begin(uint8_t type, uint8_t flags, uint16_t seq, uint8_t chMask, uint32_t rate,
+                     uint32_t len);
+uint16_t Frame_Time(uint16_t crc, const Frame_Time_TypeDef *time);
+uint16_t Frame_Data(uint16_t crc, const uint8_t *data, uint32_t len);
+void Frame_End(uint16_t crc);
+void Frame_Send(uint8_t type, uint8_t flags, uint16_t seq, uint8_t chMask, uint32_t rate,
+                const uint8_t *payload, uint32_t len);
+
+#endif
@@ -3,31 +3,167 @@
   * @file    LogicAnalyzer.c
   * @brief   简易逻辑分析仪核心模块 (调试版)
   * @note    使用 TIM2 触发 DMA 从 GPIO 端口读取数据进行高速采样
+  *          触发采样: DMA 循环写入缓冲区, TIM4 以 TIM2 更新事件为时钟对采样点计数,
+  *          先采满触发前的样本再用 EXTI 检测触发边沿, 触发后再计满触发后样本即停止.
+  *          多通道触发 (值/掩码, 任意跳变, 顺序触发) 改由 DMA 半传输/传输完成中断
+  *          用 TrigMatch 扫描刚写入的样本, 找到触发点后同样由 TIM4 计满触发后样本.
+  *          只启用部分通道时, DMA 循环写入一个小的暂存区, 每半区由中断打包进采样缓冲区,
+  *          单通道时同样的内存可存 8 倍的样本.
+  *          采样过程不阻塞主循环: 启动后由上述中断推进 CapState 状态机,
+  *          主循环调用 LA_Poll() 得知采样结束, 采样中仍可处理 STATUS / ABORT 等命令
   ******************************************************************************
   */
 
 #include "stm32f10x.h"
 #include "LogicAnalyzer.h"
 #include "Serial.h"
+#include "PingPong.h"
+#include "Frame.h"
+#include "TrigMatch.h"
+#include "Rle.h"
+#include "Pack.h"
+#include "CapState.h"
 
-/* 采样缓冲区 - 使用 SRAM 存储采样数据 */
-#define LA_BUFFER_SIZE      1024    // 缓冲区大小 (字节) - 减小以加快测试
-static uint8_t LA_SampleBuffer[LA_BUFFER_SIZE];
+#define LA_TIM_CLOCK        72000000    // TIM2 计数时钟 (Hz)
+
+/* DWT 周期计数器 (所用 CMSIS 版本未定义 DWT 结构体) */
+#define LA_DWT_CTRL         (*(volatile uint32_t *)0xE0001000)
+#define LA_DWT_CYCCNT       (*(volatile uint32_t *)0xE0001004)
+
+/* 闪存容量寄存器 (单位 KB), 用来推算芯片实际的 SRAM 容量 */
+#define LA_FLASH_SIZE_KB    (*(volatile uint16_t *)0x1FFFF7E0)
+
+/* 采样缓冲区 - 占用链接器放置的全部数据 (含栈和堆) 之后剩余的 SRAM, 启动时确定大小 */
+#define LA_SRAM_BASE        0x20000000
+#ifndef LA_SRAM_SIZE                    // SRAM 容量, 可在工程 Define 中指定; 默认按芯片容量宏
+#if defined(STM32F10X_XL)
+#define LA_SRAM_SIZE        0x18000     // 96KB
+#elif defined(STM32F10X_HD) || defined(STM32F10X_CL)
+#define LA_SRAM_SIZE        0xC000      // 48KB (RCT6)
+#elif defined(STM32F10X_MD) || defined(STM32F10X_HD_VL)
+#define LA_SRAM_SIZE        0x5000      // 20KB (C8T6)
+#elif defined(STM32F10X_MD_VL)
+#define LA_SRAM_SIZE        0x2000      // 8KB
+#else
+#define LA_SRAM_SIZE        0x1800      // 6KB
+#endif
+#endif
+#define LA_STREAM_SIZE      1024        // 流式采样只用缓冲区开头这一段 (字节), 保持每块发送延迟不变
+#define LA_DMA_MAX          65535       // DMA 一轮最多传输次数, 限制未打包采样的数量
+extern uint8_t Image$$RW_IRAM1$$ZI$$Limit[];    // 链接器生成: RW_IRAM1 区 (.data/.bss/栈/堆) 末地址
+static uint8_t *LA_SampleBuffer;
+static uint32_t LA_BufferSize;
+
+/* 通道打包暂存区 - DMA 循环写入, 每半区打包一次; 按字对齐供打包内核按字读取 */
+#define LA_STAGE_SIZE       256     // 暂存区大小 (字节), 半区须为 8 的倍数
+static uint32_t LA_StageBuffer[LA_STAGE_SIZE / 4];
 
 /* 状态变量 */
-static volatile uint8_t LA_SamplingComplete = 0;    // 采样完成标志
+static CapState_TypeDef LA_Cap;                     // 采样状态机
+static uint8_t LA_Finishing = 0;                    // 采样已结束但尚未做收尾处理 (旋转缓冲区等)
 static uint16_t LA_SampleRate_PSC = 71;             // 预分频值 (默认 72MHz/72 = 1MHz)
 static uint16_t LA_SampleRate_ARR = 99;             // 重装载值 (默认 1MHz/100 = 10kHz采样率)
-static uint16_t LA_SampleCount = 256;               // 采样数量 - 减小以加快测试
+static uint32_t LA_SampleCount = 256;               // 采样数量 - 减小以加快测试
+static Pack_TypeDef LA_Pack;                        // 通道打包参数
+static volatile uint8_t LA_Packing = 0;             // 正在进行打包采样
+static volatile uint32_t LA_PackedCount = 0;        // 已打包的样本数
+static volatile uint32_t LA_PackOverrun = 0;        // 打包来不及时被覆盖的半区数
+static uint8_t LA_DataMask = 0xFF;                  // 缓冲区中数据的通道掩码
+static uint32_t LA_DataBytes = 0;                   // 缓冲区中数据的字节数
+static uint8_t LA_Turbo = 0;                        // 极速模式: 存储器到存储器 DMA 连续搬运
+static uint32_t LA_TurboRate = 0;                   // 极速模式实测采样率 (Hz)
+static volatile uint32_t LA_TurboCycles = 0;        // 极速采样耗时 (CPU 周期)
+static volatile uint8_t LA_TurboDone = 0;           // 极速采样的 DMA 传输已完成
+
+/* 采样时间戳 (DWT 计数, 随数据帧发送, 见 Frame.h) */
+static volatile uint32_t LA_TimeArm = 0;            // 启动采样 (定时器开始计数前)
+static volatile uint32_t LA_TimeTrigger = 0;        // 触发
+static volatile uint32_t LA_TimeDone = 0;           // 采样结束
+
+/* 自校准 (CAL): 采样 PB1 上的 TIM3 测试信号, 以它为基准测量实际采样率 */
+#define LA_CAL_NONE         0xFF
+static uint8_t LA_CalPin = LA_CAL_NONE;             // 正在校准时为接测试信号的引脚
 
 /* 触发设置 */
 static uint8_t LA_TriggerPin = 0;       // 触发引脚 (0-7 对应PA0-PA7)
 static uint8_t LA_TriggerEdge = 1;      // 触发边沿 (0=下降沿, 1=上升沿)
 static uint8_t LA_TriggerEnabled = 0;   // 是否启用触发
+static uint8_t LA_TriggerPosition = 0;  // 触发前样本占比 (0-100%)
+static uint8_t LA_TriggerType = LA_TRIG_TYPE_EDGE;  // 触发类型
+static TrigMatch_TypeDef LA_Matcher;    // 多通道触发匹配器
+
+/* 触发采样过程 */
+#define LA_TRIG_IDLE        0       // 未进行触发采样
+#define LA_TRIG_PREFILL     1       // 正在采集触发前样本
+#define LA_TRIG_ARMED       2       // 等待触发
+#define LA_TRIG_POSTFILL    3       // 已触发, 正在采集触发后样本
+static volatile uint8_t LA_TriggerPhase = LA_TRIG_IDLE;
+static volatile uint16_t LA_PostTriggerCount = 0;   // 触发后样本数
+static volatile uint16_t LA_TriggerIndex = 0;       // 触发时 DMA 写入位置
+static volatile uint16_t LA_StartIndex = 0;         // 最早样本在缓冲区中的位置
+static uint16_t LA_TriggerSample = 0;               // 触发点在输出数据中的序号
+static volatile uint8_t LA_MatchActive = 0;         // 本次采样使用多通道匹配触发
+static volatile uint16_t LA_ScanIndex = 0;          // 匹配器已扫描到的缓冲区下标
+
+/* 数据输出 */
+static uint8_t LA_OutputMode = LA_MODE_HEX;         // 输出格式
+static uint16_t LA_FrameSeq = 0;                    // 二进制帧序号
+static uint8_t LA_Compress = 0;                     // 二进制帧是否游程压缩
+#define LA_RLE_CHUNK        256                     // 每次压缩的样本数
+static uint8_t LA_CompBuffer[LA_RLE_CHUNK * 2];     // 压缩输出缓冲区 (一块最坏情况翻倍)
+
+/* 流式采样 (DMA 循环模式 + 半区乒乓发送) */
+static volatile uint8_t LA_Streaming = 0;          // 是否处于流式采样
+static PingPong_TypeDef LA_Stream;                 // 双缓冲状态
 
 /* 调试计数器 */
 static volatile uint32_t LA_DMA_IRQ_Count = 0;
 
+/**
+  * @brief  按闪存容量推算芯片至少有的 SRAM 容量 (F103 系列, 同容量的 GD32 不少于此)
+  * @param  无
+  * @retval SRAM 容量 (字节)
+  */
+static uint32_t LA_ChipSramSize(void)
+{
+    uint16_t flash = LA_FLASH_SIZE_KB;
+    
+    if (flash <= 16)
+        return 0x1800;          // 6KB
+    if (flash <= 32)
+        return 0x2800;          // 10KB
+    if (flash <= 128)
+        return 0x5000;          // 20KB: x8 / xB
+    if (flash <= 256)
+        return 0xC000;          // 48KB: xC
+    if (flash <= 512)
+        return 0x10000;         // 64KB: xD / xE
+    return 0x18000;             // 96KB: xF / xG
+}
+
+/**
+  * @brief  确定采样缓冲区: 从 RW_IRAM1 区末尾 (按字对齐) 到 SRAM 末尾
+  * @note   SRAM 末尾取 LA_SRAM_SIZE 与芯片实际容量中较小的一个, 工程按大容量芯片
+  *         编译却下载到小容量芯片时缓冲区也不会越过 SRAM
+  * @param  无
+  * @retval 无
+  */
+static void LA_Arena_Init(void)
+{
+    uint32_t start = ((uint32_t)Image$$RW_IRAM1$$ZI$$Limit + 3) & ~3u;
+    uint32_t size = LA_ChipSramSize();
+    uint32_t end;
+    
+    if (size > LA_SRAM_SIZE)
+        size = LA_SRAM_SIZE;
+    end = LA_SRAM_BASE + size;
+    
+    LA_SampleBuffer = (uint8_t *)start;
+    LA_BufferSize = end > start ? end - start : 0;
+    
+    LA_DEBUG_PRINTF("[DEBUG] Sample arena: 0x%08X, %u bytes (SRAM %uKB)\r\n", start, LA_BufferSize, size / 1024);
+}
+
 /**
   * @brief  GPIO 输入初始化 (PA0-PA7 作为8通道输入)
   * @param  无
@@ -44,7 +180,7 @@ static void LA_GPIO_Init(void)
     GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
     GPIO_Init(GPIOA, &GPIO_InitStructure);
     
-    Serial_SendString("[DEBUG] GPIO Init: PA0-PA7 as input (pull-up)\r\n");
+    LA_DEBUG_PRINTF("[DEBUG] GPIO Init: PA0-PA7 as input (pull-up)\r\n");
 }
 
 /**
@@ -67,7 +203,10 @@ static void LA_TIM_Init(void)
     /* 使能 TIM2 更新事件触发 DMA 请求 */
     TIM_DMACmd(TIM2, TIM_DMA_Update, ENABLE);
     
-    Serial_Printf("[DEBUG] TIM2 Init: PSC=%d, ARR=%d\r\n", LA_SampleRate_PSC, LA_SampleRate_ARR);
+    /* 更新事件同时输出为 TRGO, 作为 TIM4 的计数时钟 */
+    TIM_SelectOutputTrigger(TIM2, TIM_TRGOSource_Update);
+    
+    LA_DEBUG_PRINTF("[DEBUG] TIM2 Init: PSC=%d, ARR=%d\r\n", LA_SampleRate_PSC, LA_SampleRate_ARR);
 }
 
 /**
@@ -108,239 +247,1478 @@ static void LA_DMA_Init(void)
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);
     
-    Serial_Printf("[DEBUG] DMA1_Ch2 Init: PeriphAddr=0x%08X, MemAddr=0x%08X, Size=%d\r\n",
+    LA_DEBUG_PRINTF("[DEBUG] DMA1_Ch2 Init: PeriphAddr=0x%08X, MemAddr=0x%08X, Size=%d\r\n",
                   (uint32_t)&(GPIOA->IDR), (uint32_t)LA_SampleBuffer, LA_SampleCount);
 }
 
 /**
-  * @brief  逻辑分析仪初始化
+  * @brief  采样计数器初始化 (TIM4 外部时钟模式, 时钟源 ITR1 = TIM2 TRGO)
+  * @note   TIM4 每计一次即 DMA 完成一次采样, 计满后产生更新中断,
+  *         用于精确地在 N 个采样后切换触发阶段
   * @param  无
   * @retval 无
   */
-void LA_Init(void)
+static void LA_Counter_Init(void)
 {
-    Serial_SendString("\r\n[DEBUG] LA_Init() start\r\n");
-    LA_GPIO_Init();
-    LA_TIM_Init();
-    LA_DMA_Init();
-    Serial_SendString("[DEBUG] LA_Init() complete\r\n\r\n");
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM4, ENABLE);
+    
+    TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+    TIM_TimeBaseStructure.TIM_Period = 0xFFFF;
+    TIM_TimeBaseStructure.TIM_Prescaler = 0;
+    TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+    TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+    TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
+    TIM_TimeBaseInit(TIM4, &TIM_TimeBaseStructure);
+    
+    TIM_ITRxExternalClockConfig(TIM4, TIM_TS_ITR1);
+    TIM_ClearITPendingBit(TIM4, TIM_IT_Update);
+    TIM_ITConfig(TIM4, TIM_IT_Update, ENABLE);
+    
+    NVIC_InitTypeDef NVIC_InitStructure;
+    NVIC_InitStructure.NVIC_IRQChannel = TIM4_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
 }
 
 /**
-  * @brief  设置采样率
-  * @param  psc: 预分频值
-  * @param  arr: 重装载值
-  * @note   采样率 = 72MHz / (psc+1) / (arr+1)
+  * @brief  启动采样计数器, 再采 n 个样本后产生中断
+  * @param  n: 采样数 (>= 2, ARR=0 时计数器不工作)
   * @retval 无
   */
-void LA_SetSampleRate(uint16_t psc, uint16_t arr)
+static void LA_Counter_Start(uint16_t n)
 {
-    LA_SampleRate_PSC = psc;
-    LA_SampleRate_ARR = arr;
+    TIM_Cmd(TIM4, DISABLE);
+    TIM_SetAutoreload(TIM4, n - 1);
+    TIM_SetCounter(TIM4, 0);
+    TIM_ClearITPendingBit(TIM4, TIM_IT_Update);
+    TIM_Cmd(TIM4, ENABLE);
 }
 
 /**
-  * @brief  设置采样数量
-  * @param  count: 采样数量 (最大 LA_BUFFER_SIZE)
+  * @brief  使能/禁止触发引脚的 EXTI 边沿中断
+  * @param  enable: 1=使能, 0=禁止
   * @retval 无
   */
-void LA_SetSampleCount(uint16_t count)
+static void LA_EXTI_Config(uint8_t enable)
 {
-    if (count > LA_BUFFER_SIZE)
-        count = LA_BUFFER_SIZE;
-    LA_SampleCount = count;
+    EXTI_InitTypeDef EXTI_InitStructure;
+    NVIC_InitTypeDef NVIC_InitStructure;
+    static const uint8_t irq[8] = {EXTI0_IRQn, EXTI1_IRQn, EXTI2_IRQn, EXTI3_IRQn,
+                                   EXTI4_IRQn, EXTI9_5_IRQn, EXTI9_5_IRQn, EXTI9_5_IRQn};
+    
+    EXTI_InitStructure.EXTI_Line = (uint32_t)1 << LA_TriggerPin;
+    EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+    EXTI_InitStructure.EXTI_Trigger = LA_TriggerEdge ? EXTI_Trigger_Rising : EXTI_Trigger_Falling;
+    EXTI_InitStructure.EXTI_LineCmd = enable ? ENABLE : DISABLE;
+    
+    if (enable)
+    {
+        RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
+        GPIO_EXTILineConfig(GPIO_PortSourceGPIOA, LA_TriggerPin);
+        EXTI_ClearITPendingBit(EXTI_InitStructure.EXTI_Line);
+    }
+    EXTI_Init(&EXTI_InitStructure);
+    
+    NVIC_InitStructure.NVIC_IRQChannel = irq[LA_TriggerPin];
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = enable ? ENABLE : DISABLE;
+    NVIC_Init(&NVIC_InitStructure);
 }
 
 /**
-  * @brief  设置触发条件
-  * @param  pin: 触发引脚 (0-7)
-  * @param  edge: 边沿 (0=下降, 1=上升)
+  * @brief  当前 DMA 写入位置
+  * @param  无
+  * @retval 下一个样本将写入的缓冲区下标
+  */
+static uint16_t LA_DMA_WriteIndex(void)
+{
+    return (LA_SampleCount - DMA_GetCurrDataCounter(DMA1_Channel2)) % LA_SampleCount;
+}
+
+/**
+  * @brief  停止触发采样 (在中断中调用), 记录最早样本的位置
+  * @param  无
   * @retval 无
   */
-void LA_SetTrigger(uint8_t pin, uint8_t edge)
+static void LA_TriggerFinish(void)
 {
-    LA_TriggerPin = pin & 0x07;
-    LA_TriggerEdge = edge;
-    LA_TriggerEnabled = 1;
+    LA_TimeDone = LA_DWT_CYCCNT;
+    TIM_Cmd(TIM2, DISABLE);
+    TIM_Cmd(TIM4, DISABLE);
+    DMA_Cmd(DMA1_Channel2, DISABLE);
+    
+    LA_StartIndex = LA_DMA_WriteIndex();
+    LA_TriggerPhase = LA_TRIG_IDLE;
+    CS_Event(&LA_Cap, CS_EV_FULL);
 }
 
 /**
-  * @brief  禁用触发
+  * @brief  检测到触发 (在 EXTI 中断中调用)
   * @param  无
   * @retval 无
   */
-void LA_DisableTrigger(void)
+static void LA_TriggerFire(void)
 {
-    LA_TriggerEnabled = 0;
+    LA_TimeTrigger = LA_DWT_CYCCNT;
+    LA_EXTI_Config(0);
+    LA_TriggerIndex = LA_DMA_WriteIndex();
+    CS_Event(&LA_Cap, CS_EV_TRIGGER);
+    
+    if (LA_PostTriggerCount < 2)
+    {
+        LA_TriggerFinish();
+    }
+    else
+    {
+        LA_TriggerPhase = LA_TRIG_POSTFILL;
+        LA_Counter_Start(LA_PostTriggerCount);
+    }
 }
 
 /**
-  * @brief  开始采样
+  * @brief  用匹配器扫描 DMA 新写入的样本 (在 DMA 半传输/传输完成中断中调用)
+  * @note   找到触发点时 DMA 已越过它若干样本, 触发后计数扣除这部分;
+  *         扣除后不足时立即停止, 此时最早的触发前样本会被覆盖一部分
   * @param  无
   * @retval 无
   */
-void LA_StartCapture(void)
+static void LA_MatchScan(void)
 {
-    Serial_SendString("[DEBUG] LA_StartCapture() called\r\n");
+    uint16_t end = LA_DMA_WriteIndex();
+    uint16_t from, len, elapsed;
+    int32_t hit = -1;
     
-    LA_SamplingComplete = 0;
-    LA_DMA_IRQ_Count = 0;
+    /* 写入位置回绕时分两段扫描 */
+    while (hit < 0 && LA_ScanIndex != end)
+    {
+        from = LA_ScanIndex;
+        len = (end > from) ? (end - from) : (LA_SampleCount - from);
+        hit = TM_Scan(&LA_Matcher, &LA_SampleBuffer[from], len);
+        LA_ScanIndex = (hit < 0) ? (from + len) % LA_SampleCount : from + hit;
+    }
     
-    /* 读取当前 GPIO 状态 */
-    uint16_t gpio_val = GPIOA->IDR & 0xFF;
-    Serial_Printf("[DEBUG] Current GPIOA IDR (low 8 bits): 0x%02X\r\n", gpio_val);
+    if (hit < 0)
+        return;
     
-    /* 停止定时器 */
-    TIM_Cmd(TIM2, DISABLE);
+    LA_TriggerIndex = LA_ScanIndex;
+    CS_Event(&LA_Cap, CS_EV_TRIGGER);
+    elapsed = (LA_DMA_WriteIndex() + LA_SampleCount - LA_TriggerIndex) % LA_SampleCount;
+    
+    /* 触发点在扫描之前, 按名义采样周期倒推时刻 */
+    LA_TimeTrigger = LA_DWT_CYCCNT - elapsed * ((uint32_t)(LA_SampleRate_PSC + 1) * (LA_SampleRate_ARR + 1));
+    
+    if (LA_PostTriggerCount < elapsed + 2)
+    {
+        LA_TriggerFinish();
+    }
+    else
+    {
+        LA_TriggerPhase = LA_TRIG_POSTFILL;
+        LA_Counter_Start(LA_PostTriggerCount - elapsed);
+    }
+}
+
+/**
+  * @brief  把循环缓冲区中的数据旋转为时间顺序 (最早样本在前)
+  * @note   三次翻转法原地旋转, 不需要额外内存
+  * @param  shift: 最早样本所在下标
+  * @retval 无
+  */
+static void LA_Rotate(uint16_t shift)
+{
+    uint8_t *lo, *hi, t;
+    uint8_t *range[3][2] = {
+        {&LA_SampleBuffer[0], &LA_SampleBuffer[shift]},
+        {&LA_SampleBuffer[shift], &LA_SampleBuffer[LA_SampleCount]},
+        {&LA_SampleBuffer[0], &LA_SampleBuffer[LA_SampleCount]},
+    };
+    
+    if (shift == 0)
+        return;
     
-    /* 重新配置定时器参数 */
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        lo = range[i][0];
+        hi = range[i][1] - 1;
+        while (lo < hi)
+        {
+            t = *lo;
+            *lo++ = *hi;
+            *hi-- = t;
+        }
+    }
+}
+
+/**
+  * @brief  停止定时器并按当前设置重新装载采样率
+  * @param  无
+  * @retval 无
+  */
+static void LA_TIM_Reload(void)
+{
+    TIM_Cmd(TIM2, DISABLE);
     TIM_SetAutoreload(TIM2, LA_SampleRate_ARR);
     TIM_PrescalerConfig(TIM2, LA_SampleRate_PSC, TIM_PSCReloadMode_Immediate);
     TIM_SetCounter(TIM2, 0);
+}
+
+/**
+  * @brief  极速采样: DMA 存储器到存储器模式连续读取 GPIOA->IDR
+  * @note   不经过 TIM2 更新请求, 每次传输完立即开始下一次, 速度只受总线限制.
+  *         样本间隔由 DMA 传输时间决定, 不与时钟对齐, 与 CPU/其他 DMA 争用总线时变长,
+  *         因此先等串口发送 DMA 结束, 采样期间 CPU 以 WFI 休眠不访问总线.
+  *         耗时由 DWT 周期计数器测量 (含约十几个周期的中断响应时间).
+  *         等待的是传输完成中断置位的 LA_TurboDone 而不是状态机: RATE MAX 测速时
+  *         没有 CS_EV_START, 状态仍为 IDLE / DONE
+  * @param  无
+  * @retval 实测采样率 (Hz)
+  */
+static uint32_t LA_TurboCapture(void)
+{
+    Serial_Flush();
     
-    /* 清除 DMA 标志 */
+    TIM_Cmd(TIM2, DISABLE);
+    DMA_Cmd(DMA1_Channel2, DISABLE);
     DMA_ClearFlag(DMA1_FLAG_TC2 | DMA1_FLAG_HT2 | DMA1_FLAG_TE2);
+    DMA_ITConfig(DMA1_Channel2, DMA_IT_HT, DISABLE);
+    DMA_ITConfig(DMA1_Channel2, DMA_IT_TC, ENABLE);
+    DMA1_Channel2->CCR &= ~DMA_CCR1_CIRC;
+    DMA1_Channel2->CCR |= DMA_CCR1_MEM2MEM;
+    DMA1_Channel2->CNDTR = LA_SampleCount;
+    DMA1_Channel2->CMAR = (uint32_t)LA_SampleBuffer;
+    DMA1_Channel2->CPAR = (uint32_t)&(GPIOA->IDR);
     
-    /* 重新配置 DMA */
-    DMA_Cmd(DMA1_Channel2, DISABLE);
-    DMA1_Channel2->CNDTR = LA_SampleCount;  // 设置传输数量
-    DMA1_Channel2->CMAR = (uint32_t)LA_SampleBuffer;  // 设置内存地址
-    DMA1_Channel2->CPAR = (uint32_t)&(GPIOA->IDR);    // 设置外设地址
+    LA_MatchActive = 0;
+    LA_TurboCycles = 0;
+    LA_TurboDone = 0;
+    LA_TimeArm = LA_DWT_CYCCNT;
     DMA_Cmd(DMA1_Channel2, ENABLE);
     
-    Serial_Printf("[DEBUG] DMA CNDTR=%d, DMA Enabled=%d\r\n", 
-                  DMA_GetCurrDataCounter(DMA1_Channel2),
-                  (DMA1_Channel2->CCR & DMA_CCR1_EN) ? 1 : 0);
+    /* 关中断下检查标志再 WFI, 避免中断恰好发生在两者之间而一直休眠 */
+    __disable_irq();
+    while (!LA_TurboDone)
+    {
+        __WFI();
+        __enable_irq();
+        __disable_irq();
+    }
+    __enable_irq();
+    
+    DMA_Cmd(DMA1_Channel2, DISABLE);
+    DMA1_Channel2->CCR &= ~DMA_CCR1_MEM2MEM;
+    
+    if (LA_TurboCycles == 0)
+        return 0;
+    return (uint64_t)LA_SampleCount * LA_TIM_CLOCK / LA_TurboCycles;
+}
+
+/**
+  * @brief  打包暂存区中刚填满的半区 (在 DMA 中断中调用), 采够后停止采样
+  * @param  half: 半区编号 (0=前半, 1=后半)
+  * @retval 无
+  */
+static void LA_PackHalf(uint8_t half)
+{
+    const uint8_t *src = (const uint8_t *)LA_StageBuffer + half * (LA_STAGE_SIZE / 2);
+    uint32_t n = LA_SampleCount - LA_PackedCount;
+    
+    if (n > LA_STAGE_SIZE / 2)
+        n = LA_STAGE_SIZE / 2;
     
-    /* 等待触发 (如果启用) - 暂时禁用触发功能进行测试 */
-    if (LA_TriggerEnabled)
+    /* 已打包样本数总是 8 的倍数, 输出从整字节开始 */
+    Pack_Run(&LA_Pack, src, n, &LA_SampleBuffer[Pack_Bytes(&LA_Pack, LA_PackedCount)]);
+    LA_PackedCount += n;
+    
+    if (LA_PackedCount >= LA_SampleCount)
     {
-        Serial_SendString("[DEBUG] Waiting for trigger...\r\n");
-        uint8_t prevState = (GPIOA->IDR >> LA_TriggerPin) & 0x01;
-        uint8_t currState;
-        uint32_t timeout = 0;
-        
-        while (timeout < 1000000)  // 添加超时
-        {
-            currState = (GPIOA->IDR >> LA_TriggerPin) & 0x01;
-            
-            if (LA_TriggerEdge == 1)  // 上升沿
-            {
-                if (prevState == 0 && currState == 1) break;
-            }
-            else  // 下降沿
-            {
-                if (prevState == 1 && currState == 0) break;
-            }
-            prevState = currState;
-            timeout++;
-        }
+        LA_TimeDone = LA_DWT_CYCCNT;
+        TIM_Cmd(TIM2, DISABLE);
+        DMA_Cmd(DMA1_Channel2, DISABLE);
+        LA_Packing = 0;
+        CS_Event(&LA_Cap, CS_EV_FULL);
+    }
+}
+
+/**
+  * @brief  启动打包采样: DMA 循环写入暂存区, 半传输/传输完成中断逐半区打包
+  * @note   打包速度跟不上采样率时, 未打包的半区会被覆盖, 计入 LA_PackOverrun,
+  *         由 STATUS / 数据头 / 帧标志报告给上位机 (见 LA_GetOverrunCount).
+  *         不支持触发. 启动后立即返回, 采够后由中断结束采样
+  * @param  无
+  * @retval 无
+  */
+static void LA_PackedCapture(void)
+{
+    LA_TIM_Reload();
+    TIM_Cmd(TIM4, DISABLE);
+    
+    DMA_Cmd(DMA1_Channel2, DISABLE);
+    DMA_ClearFlag(DMA1_FLAG_TC2 | DMA1_FLAG_HT2 | DMA1_FLAG_TE2);
+    DMA1_Channel2->CCR &= ~DMA_CCR1_MEM2MEM;
+    DMA1_Channel2->CCR |= DMA_CCR1_CIRC;
+    DMA1_Channel2->CNDTR = LA_STAGE_SIZE;
+    DMA1_Channel2->CMAR = (uint32_t)LA_StageBuffer;
+    DMA1_Channel2->CPAR = (uint32_t)&(GPIOA->IDR);
+    DMA_ITConfig(DMA1_Channel2, DMA_IT_HT, ENABLE);
+    DMA_ITConfig(DMA1_Channel2, DMA_IT_TC, ENABLE);
+    
+    LA_PackedCount = 0;
+    LA_Packing = 1;
+    DMA_Cmd(DMA1_Channel2, ENABLE);
+    LA_TimeArm = LA_DWT_CYCCNT;
+    TIM_Cmd(TIM2, ENABLE);
+}
+
+/**
+  * @brief  以十六进制文本发送一段采样数据 (每32字节换行)
+  * @param  buf: 数据首地址
+  * @param  len: 数据长度
+  * @retval 无
+  */
+static void LA_SendHex(const uint8_t *buf, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+    {
+        Serial_Printf("%02X", buf[i]);
         
-        if (timeout >= 1000000)
-        {
-            Serial_SendString("[DEBUG] Trigger timeout!\r\n");
-        }
-        else
+        /* 每32字节换行 */
+        if ((i + 1) % 32 == 0)
         {
-            Serial_SendString("[DEBUG] Triggered!\r\n");
+            Serial_SendString("\r\n");
         }
     }
+}
+
+/**
+  * @brief  以二进制帧发送一段采样数据
+  * @note   开启压缩时按 LA_RLE_CHUNK 分块做游程编码: 第一遍只求总长度写入帧头,
+  *         第二遍逐块编码逐块发送, 只需一块大小的压缩缓冲区. 编码结果不比原始数据短
+  *         (如噪声) 则照发原始数据, 由帧标志位区分. 游程在块边界处断开, 不影响解码
+  * @param  type: 帧类型
+  * @param  seq: 帧序号
+  * @param  mask: 通道掩码, 不是 0xFF 时数据为打包格式 (见 Pack.h)
+  * @param  buf: 数据首地址
+  * @param  len: 字节数
+  * @param  time: 时间信息, 0 表示不带
+  * @param  flags: 附加的帧标志 (FRAME_FLAG_OVERRUN), 压缩与时间信息的标志由本函数设置
+  * @retval 无
+  */
+static void LA_SendFrame(uint8_t type, uint16_t seq, uint8_t mask, const uint8_t *buf, uint32_t len,
+                         const Frame_Time_TypeDef *time, uint8_t flags)
+{
+    if (time)
+        flags |= FRAME_FLAG_TIME;
+    uint32_t packed = 0;
+    uint32_t off, n;
+    uint16_t crc;
     
-    /* 启动定时器开始采样 */
-    TIM_Cmd(TIM2, ENABLE);
-    Serial_SendString("[DEBUG] TIM2 started, sampling...\r\n");
-    
-    /* 等待采样完成 (阻塞方式，带超时) */
-    uint32_t wait = 0;
-    while (!LA_SamplingComplete && wait < 5000000)
+    if (LA_Compress)
     {
-        wait++;
+        for (off = 0; off < len && packed < len; off += n)
+        {
+            n = (len - off > LA_RLE_CHUNK) ? LA_RLE_CHUNK : (len - off);
+            packed += RLE_Encode(buf + off, n, LA_CompBuffer, sizeof(LA_CompBuffer));
+        }
     }
     
-    if (LA_SamplingComplete)
+    if (!LA_Compress || packed >= len)
     {
-        Serial_Printf("[DEBUG] Sampling complete! DMA IRQ count=%d\r\n", LA_DMA_IRQ_Count);
+        crc = Frame_Begin(type, flags, seq, mask, LA_GetSampleRate(), len);
+        if (time)
+            crc = Frame_Time(crc, time);
+        Frame_End(Frame_Data(crc, buf, len));
+        return;
     }
-    else
+    
+    crc = Frame_Begin(type, flags | FRAME_FLAG_RLE, seq, mask, LA_GetSampleRate(), packed);
+    if (time)
+        crc = Frame_Time(crc, time);
+    for (off = 0; off < len; off += n)
     {
-        Serial_SendString("[DEBUG] Sampling timeout!\r\n");
-        Serial_Printf("[DEBUG] DMA CNDTR remaining=%d\r\n", DMA_GetCurrDataCounter(DMA1_Channel2));
-        Serial_Printf("[DEBUG] TIM2 CNT=%d\r\n", TIM_GetCounter(TIM2));
-        
-        /* 强制完成 */
-        TIM_Cmd(TIM2, DISABLE);
-        LA_SamplingComplete = 1;
+        n = (len - off > LA_RLE_CHUNK) ? LA_RLE_CHUNK : (len - off);
+        crc = Frame_Data(crc, LA_CompBuffer, RLE_Encode(buf + off, n, LA_CompBuffer, sizeof(LA_CompBuffer)));
     }
+    Frame_End(crc);
 }
 
 /**
-  * @brief  检查采样是否完成
+  * @brief  逻辑分析仪初始化
   * @param  无
-  * @retval 1: 完成, 0: 进行中
+  * @retval 无
   */
-uint8_t LA_IsCaptureComplete(void)
+void LA_Init(void)
 {
-    return LA_SamplingComplete;
+    LA_DEBUG_PRINTF("\r\n[DEBUG] LA_Init() start\r\n");
+    LA_Arena_Init();
+    CS_Init(&LA_Cap);
+    
+    /* 采样时间戳用 DWT 周期计数器 */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    LA_DWT_CTRL |= 1;   // CYCCNTENA
+    LA_GPIO_Init();
+    Pack_Init(&LA_Pack, 0xFF);
+    LA_TIM_Init();
+    LA_DMA_Init();
+    LA_Counter_Init();
+    LA_DEBUG_PRINTF("[DEBUG] LA_Init() complete\r\n\r\n");
 }
 
 /**
-  * @brief  获取采样缓冲区指针
-  * @param  无
-  * @retval 缓冲区首地址
+  * @brief  设置采样率
+  * @param  psc: 预分频值
+  * @param  arr: 重装载值
+  * @note   采样率 = 72MHz / (psc+1) / (arr+1)
+  * @retval 无
   */
-uint8_t* LA_GetBuffer(void)
+void LA_SetSampleRate(uint16_t psc, uint16_t arr)
 {
-    return LA_SampleBuffer;
+    LA_SampleRate_PSC = psc;
+    LA_SampleRate_ARR = arr;
+    LA_Turbo = 0;
 }
 
 /**
-  * @brief  获取采样数量
-  * @param  无
-  * @retval 采样数量
+  * @brief  按频率设置采样率, 自动选择最接近的 PSC/ARR 组合
+  * @param  hz: 目标采样率 (Hz)
+  * @note   总分频 (psc+1)*(arr+1) 取最接近 72MHz/hz 的整数, 再在所有 psc 中
+  *         找乘积最接近它的组合; 误差相同时取 psc 较小者. ARR 至少为 1,
+  *         ARR=0 时计数器停止, 不产生更新事件
+  * @retval 实际采样率 (Hz)
   */
-uint16_t LA_GetSampleCount(void)
+uint32_t LA_SetSampleRateHz(uint32_t hz)
 {
-    return LA_SampleCount;
+    uint32_t div, p, a, prod, err;
+    uint32_t bestP = 1, bestA = 2, bestErr = 0xFFFFFFFF;
+    
+    if (hz == 0)
+        hz = 1;
+    div = (LA_TIM_CLOCK + hz / 2) / hz;
+    if (div < 2)
+        div = 2;
+    
+    for (p = (div + 65535) / 65536; p <= 65536; p++)
+    {
+        a = (div + p / 2) / p;
+        if (a < 2)
+            break;
+        if (a > 65536)
+            continue;
+        
+        prod = p * a;
+        err = (prod > div) ? (prod - div) : (div - prod);
+        if (err < bestErr)
+        {
+            bestErr = err;
+            bestP = p;
+            bestA = a;
+            if (err == 0)
+                break;
+        }
+    }
+    
+    LA_SetSampleRate(bestP - 1, bestA - 1);
+    return LA_GetSampleRate();
 }
 
 /**
-  * @brief  发送采样数据到PC
+  * @brief  进入极速采样模式, 并做一次采样测出实际速度
+  * @note   极速模式只用于单次采样 (CAP), 不支持触发和流式采样;
+  *         设置 RATE 后退出
   * @param  无
-  * @retval 无
+  * @retval 实测采样率 (Hz)
   */
-void LA_SendData(void)
+uint32_t LA_SetTurbo(void)
 {
-    /* 发送头标识 */
-    Serial_Printf("DATA: (count=%d)\r\n", LA_SampleCount);
-    
-    /* 发送数据 (十六进制格式) */
-    for (uint16_t i = 0; i < LA_SampleCount; i++)
+    if (LA_Streaming)
     {
-        Serial_Printf("%02X", LA_SampleBuffer[i]);
-        
-        /* 每32字节换行 */
-        if ((i + 1) % 32 == 0)
-        {
-            Serial_SendString("\r\n");
-        }
+        LA_StopStream();
     }
     
-    Serial_SendString("\r\nEND\r\n");
+    LA_Turbo = 1;
+    LA_TurboRate = LA_TurboCapture();
+    return LA_TurboRate;
 }
 
 /**
-  * @brief  DMA1 通道2 中断服务函数 (采样完成)
+  * @brief  是否处于极速采样模式
   * @param  无
+  * @retval 1: 是, 0: 否
+  */
+uint8_t LA_IsTurbo(void)
+{
+    return LA_Turbo;
+}
+
+/**
+  * @brief  设置采样数量
+  * @param  count: 采样数量 (最大 LA_GetMaxSampleCount())
+  * @note   通道打包时向下取整为 8 的倍数, 使数据正好占满整字节
   * @retval 无
   */
-void DMA1_Channel2_IRQHandler(void)
+void LA_SetSampleCount(uint32_t count)
 {
-    LA_DMA_IRQ_Count++;
-    
-    if (DMA_GetITStatus(DMA1_IT_TC2) == SET)
+    if (count > LA_GetMaxSampleCount())
+        count = LA_GetMaxSampleCount();
+    if (LA_Pack.Width < 8)
     {
-        DMA_ClearITPendingBit(DMA1_IT_TC2);
-        TIM_Cmd(TIM2, DISABLE);
-        LA_SamplingComplete = 1;
+        count &= ~7u;
+        if (count == 0)
+            count = 8;
     }
+    LA_SampleCount = count;
+}
+
+/**
+  * @brief  当前通道设置下的最大采样数量
+  * @param  无
+  * @note   8 通道时每次采样由 DMA 直接写入缓冲区, 还受 DMA 单轮传输数限制
+  * @retval 缓冲区字节数 * 8 / 每样本位数
+  */
+uint32_t LA_GetMaxSampleCount(void)
+{
+    if (LA_Pack.Width == 8)
+        return (LA_BufferSize > LA_DMA_MAX) ? LA_DMA_MAX : LA_BufferSize;
+    return LA_BufferSize * 8 / LA_Pack.Width;
+}
+
+/**
+  * @brief  获取采样缓冲区大小
+  * @param  无
+  * @retval 字节数
+  */
+uint32_t LA_GetBufferSize(void)
+{
+    return LA_BufferSize;
+}
+
+/**
+  * @brief  设置采样通道
+  * @param  mask: 通道掩码 (bit0-7 对应 PA0-PA7), 0 按 0xFF 处理
+  * @note   启用 1/2/3-4 个通道时每样本占 1/2/4 位, 采样数量上限相应变为 8/4/2 倍;
+  *         当前采样数量超过新上限时被截短
+  * @retval 无
+  */
+void LA_SetChannelMask(uint8_t mask)
+{
+    Pack_Init(&LA_Pack, mask);
+    LA_SetSampleCount(LA_SampleCount);
+}
+
+/**
+  * @brief  获取采样通道掩码
+  * @param  无
+  * @retval 通道掩码
+  */
+uint8_t LA_GetChannelMask(void)
+{
+    return LA_Pack.Mask;
+}
+
+/**
+  * @brief  设置触发条件
+  * @param  pin: 触发引脚 (0-7)
+  * @param  edge: 边沿 (0=下降, 1=上升)
+  * @retval 无
+  */
+void LA_SetTrigger(uint8_t pin, uint8_t edge)
+{
+    LA_TriggerPin = pin & 0x07;
+    LA_TriggerEdge = edge;
+    LA_TriggerType = LA_TRIG_TYPE_EDGE;
+    LA_TriggerEnabled = 1;
+}
+
+/**
+  * @brief  设置值/掩码匹配触发
+  * @param  value: 匹配值 (bit0-7 对应 PA0-PA7)
+  * @param  mask: 参与比较的通道
+  * @retval 无
+  */
+void LA_SetPatternTrigger(uint8_t value, uint8_t mask)
+{
+    TM_InitPattern(&LA_Matcher, value, mask);
+    LA_TriggerType = LA_TRIG_TYPE_PATTERN;
+    LA_TriggerEnabled = 1;
+}
+
+/**
+  * @brief  设置任意通道跳变触发
+  * @param  mask: 检测跳变的通道
+  * @retval 无
+  */
+void LA_SetAnyEdgeTrigger(uint8_t mask)
+{
+    TM_InitAnyEdge(&LA_Matcher, mask);
+    LA_TriggerType = LA_TRIG_TYPE_ANYEDGE;
+    LA_TriggerEnabled = 1;
+}
+
+/**
+  * @brief  设置两级顺序触发
+  * @param  valueA/maskA: 第一级状态
+  * @param  valueB/maskB: 第二级状态
+  * @param  window: 状态A之后允许的样本数
+  * @retval 无
+  */
+void LA_SetSequenceTrigger(uint8_t valueA, uint8_t maskA, uint8_t valueB, uint8_t maskB,
+                           uint16_t window)
+{
+    TM_InitSequence(&LA_Matcher, valueA, maskA, valueB, maskB, window);
+    LA_TriggerType = LA_TRIG_TYPE_SEQUENCE;
+    LA_TriggerEnabled = 1;
+}
+
+/**
+  * @brief  获取触发类型
+  * @param  无
+  * @retval LA_TRIG_TYPE_xxx
+  */
+uint8_t LA_GetTriggerType(void)
+{
+    return LA_TriggerType;
+}
+
+/**
+  * @brief  是否启用了触发
+  * @param  无
+  * @retval 1: 启用, 0: 禁用
+  */
+uint8_t LA_IsTriggerEnabled(void)
+{
+    return LA_TriggerEnabled;
+}
+
+/**
+  * @brief  设置触发位置
+  * @param  percent: 触发前样本占总样本数的百分比 (0-100)
+  * @retval 无
+  */
+void LA_SetTriggerPosition(uint8_t percent)
+{
+    if (percent > 100)
+        percent = 100;
+    LA_TriggerPosition = percent;
+}
+
+/**
+  * @brief  获取触发位置
+  * @param  无
+  * @retval 触发前样本占比 (%)
+  */
+uint8_t LA_GetTriggerPosition(void)
+{
+    return LA_TriggerPosition;
+}
+
+/**
+  * @brief  获取触发点在采样数据中的序号
+  * @param  无
+  * @retval 触发样本序号 (未启用触发时为0)
+  */
+uint16_t LA_GetTriggerSample(void)
+{
+    return LA_TriggerSample;
+}
+
+/**
+  * @brief  禁用触发
+  * @param  无
+  * @retval 无
+  */
+void LA_DisableTrigger(void)
+{
+    LA_TriggerEnabled = 0;
+}
+
+/**
+  * @brief  设置数据输出格式
+  * @param  mode: LA_MODE_HEX / LA_MODE_BIN
+  * @retval 无
+  */
+void LA_SetOutputMode(uint8_t mode)
+{
+    LA_OutputMode = (mode == LA_MODE_BIN) ? LA_MODE_BIN : LA_MODE_HEX;
+}
+
+/**
+  * @brief  获取数据输出格式
+  * @param  无
+  * @retval LA_MODE_HEX / LA_MODE_BIN
+  */
+uint8_t LA_GetOutputMode(void)
+{
+    return LA_OutputMode;
+}
+
+/**
+  * @brief  开启/关闭二进制帧的游程压缩
+  * @param  enable: 1=开启, 0=关闭
+  * @retval 无
+  */
+void LA_SetCompression(uint8_t enable)
+{
+    LA_Compress = enable ? 1 : 0;
+}
+
+/**
+  * @brief  二进制帧是否游程压缩
+  * @param  无
+  * @retval 1: 开启, 0: 关闭
+  */
+uint8_t LA_GetCompression(void)
+{
+    return LA_Compress;
+}
+
+/**
+  * @brief  获取当前采样率
+  * @param  无
+  * @retval 采样率 (Hz, 向下取整)
+  */
+uint32_t LA_GetSampleRate(void)
+{
+    if (LA_Turbo)
+        return LA_TurboRate;
+    return LA_TIM_CLOCK / ((uint32_t)(LA_SampleRate_PSC + 1) * (LA_SampleRate_ARR + 1));
+}
+
+/**
+  * @brief  由时间戳得出实际采样周期
+  * @note   无触发 / 打包 / 极速采样: 启动到结束的时间除以期间的样本数;
+  *         边沿触发: 触发到结束的时间除以触发后样本数 (两端都是中断响应, 延迟抵消).
+  *         多通道触发的触发时刻是倒推的, 中止的触发采样样本数不确定, 均无法测量
+  * @param  无
+  * @retval 采样周期 (1/16 个 DWT 周期), 0: 无法测量
+  */
+static uint32_t LA_MeasuredPeriod16(void)
+{
+    uint32_t cycles, samples;
+    
+    if (LA_DataMask != 0xFF)
+    {
+        /* 打包采样在半区中断中结束, 期间采了整数个半区 */
+        cycles = LA_TimeDone - LA_TimeArm;
+        samples = (LA_PackedCount + LA_STAGE_SIZE / 2 - 1) / (LA_STAGE_SIZE / 2) * (LA_STAGE_SIZE / 2);
+    }
+    else if (!LA_TriggerEnabled || LA_Turbo)
+    {
+        cycles = LA_TimeDone - LA_TimeArm;
+        samples = LA_DataBytes;
+    }
+    else if (!LA_MatchActive && LA_Cap.Triggered && LA_Cap.Result != CS_RESULT_ABORTED &&
+             LA_PostTriggerCount >= 2)
+    {
+        cycles = LA_TimeDone - LA_TimeTrigger;
+        samples = LA_PostTriggerCount;
+    }
+    else
+    {
+        return 0;
+    }
+    
+    if (samples == 0)
+        return 0;
+    return (uint64_t)cycles * 16 / samples;
+}
+
+/**
+  * @brief  最近一次采样的时间信息
+  * @param  time: 输出
+  * @retval 无
+  */
+static void LA_GetTime(Frame_Time_TypeDef *time)
+{
+    time->Clock = LA_TIM_CLOCK;
+    time->Arm = LA_TimeArm;
+    time->Trigger = LA_TimeTrigger;
+    time->Done = LA_TimeDone;
+    time->Period16 = LA_MeasuredPeriod16();
+    time->TriggerSample = FRAME_NO_TRIGGER;
+    if (LA_DataMask == 0xFF && LA_TriggerEnabled && !LA_Turbo && LA_Cap.Triggered)
+        time->TriggerSample = LA_TriggerSample;
+}
+
+/**
+  * @brief  PB1 测试信号 (TIM3 PWM) 的频率
+  * @param  无
+  * @retval 频率 (Hz), TIM3 未运行时为 0
+  */
+uint32_t LA_GetReferenceRate(void)
+{
+    if (!(TIM3->CR1 & TIM_CR1_CEN))
+        return 0;
+    return LA_TIM_CLOCK / ((uint32_t)(TIM3->PSC + 1) * (TIM3->ARR + 1));
+}
+
+/**
+  * @brief  开始自校准: 按当前采样率采样一次, 采完由 LA_Poll() 报告结果
+  * @note   须把 PB1 接到 pin, 且为 8 通道无触发采样 (由调用方检查)
+  * @param  pin: 测试信号所接的引脚 (0-7)
+  * @retval 1: 已开始, 0: 上一次采样还未结束
+  */
+uint8_t LA_StartCalibration(uint8_t pin)
+{
+    if (!LA_StartCapture())
+        return 0;
+    LA_CalPin = pin;
+    return 1;
+}
+
+/**
+  * @brief  报告自校准结果 (在主循环中调用)
+  * @note   相邻测试信号上升沿之间的平均样本数 = 实际采样率 / 参考频率.
+  *         首末上升沿的位置各有 1 个样本的量化误差, 分辨率约为 1e6 / 跨度 ppm.
+  *         DWT 一项是时间戳测得的采样周期相对名义值的偏差, 两者都以同一个 72MHz
+  *         时钟为基准, 反映的是采样时序 (如 RATE MAX 的总线争用), 而非晶振误差.
+  *         结果以事件行 "EVT: CAL ..." 发送: CAL 命令已应答过 "OK: CALIBRATING",
+  *         此时再发 OK/ERR 会被上位机当作下一条命令的应答
+  * @param  无
+  * @retval 无
+  */
+static void LA_CalReport(void)
+{
+    uint8_t bit = 1 << LA_CalPin;
+    uint32_t ref = LA_GetReferenceRate();
+    uint32_t div = (uint32_t)(LA_SampleRate_PSC + 1) * (LA_SampleRate_ARR + 1);
+    uint32_t first = 0, last = 0, edges = 0, span;
+    uint64_t nominal, measured;
+    int32_t err, dwt = 0;
+    Frame_Time_TypeDef time;
+    
+    for (uint32_t i = 1; i < LA_DataBytes; i++)
+    {
+        if ((LA_SampleBuffer[i] & bit) && !(LA_SampleBuffer[i - 1] & bit))
+        {
+            if (edges++ == 0)
+                first = i;
+            last = i;
+        }
+    }
+    
+    /* 名义采样率 (mHz): 定时器采样按 PSC/ARR 精确计算, 极速采样只有 DWT 测得的值 */
+    nominal = LA_Turbo ? (uint64_t)LA_TurboRate * 1000 : (uint64_t)LA_TIM_CLOCK * 1000 / div;
+    
+    if (edges < 3 || ref == 0 || nominal == 0)
+    {
+        Serial_Printf("EVT: CAL FAILED %u rising edges on PA%d, need 3 (PB1 -> PA%d, larger COUNT)\r\n",
+                      edges, LA_CalPin, LA_CalPin);
+        LA_CalPin = LA_CAL_NONE;
+        return;
+    }
+    LA_CalPin = LA_CAL_NONE;
+    
+    /* 实测采样率 (mHz) 及相对名义采样率的偏差 (ppm) */
+    span = last - first;
+    measured = (uint64_t)ref * span * 1000 / (edges - 1);
+    err = (int32_t)(((int64_t)measured - (int64_t)nominal) * 1000000 / (int64_t)nominal);
+    
+    /* DWT 测得的周期相对名义周期的偏差 (周期长则为正) */
+    LA_GetTime(&time);
+    if (time.Period16)
+        dwt = (int32_t)(((int64_t)time.Period16 * (int64_t)nominal - (int64_t)LA_TIM_CLOCK * 16000) * 1000000 /
+                        ((int64_t)LA_TIM_CLOCK * 16000));
+    
+    Serial_Printf("EVT: CAL REF=%uHz EDGES=%u RATE=%u.%03uHz MEASURED=%u.%03uHz ERR=%+dppm (+-%u) DWT=%+dppm\r\n",
+                  ref, edges, (uint32_t)(nominal / 1000), (uint32_t)(nominal % 1000),
+                  (uint32_t)(measured / 1000), (uint32_t)(measured % 1000), err, 1000000 / span, dwt);
+}
+
+/**
+  * @brief  采样结束后的收尾处理 (在主循环中调用, 每次采样只执行一次)
+  * @note   触发采样时把循环缓冲区旋转为时间顺序, 耗时与样本数成正比, 不放在中断中做
+  * @param  无
+  * @retval 无
+  */
+static void LA_CaptureFinish(void)
+{
+    if (!LA_Finishing || LA_Cap.State != CS_DONE)
+        return;
+    LA_Finishing = 0;
+    
+    if (LA_DataMask != 0xFF)
+    {
+        LA_DataBytes = Pack_Bytes(&LA_Pack, LA_PackedCount);
+        LA_DEBUG_PRINTF("[DEBUG] Packed %d samples into %d bytes, overrun=%u\r\n",
+                      LA_PackedCount, LA_DataBytes, LA_PackOverrun);
+    }
+    else if (LA_TriggerEnabled && !LA_Turbo)
+    {
+        LA_Rotate(LA_StartIndex);
+        LA_TriggerSample = (LA_TriggerIndex + LA_SampleCount - LA_StartIndex) % LA_SampleCount;
+        LA_DEBUG_PRINTF("[DEBUG] Trigger at sample %d%s\r\n", LA_TriggerSample,
+                      LA_Cap.Triggered ? "" : " (not triggered)");
+    }
+    
+    LA_DEBUG_PRINTF("[DEBUG] Sampling %s! DMA IRQ count=%d\r\n",
+                  (LA_Cap.Result == CS_RESULT_ABORTED) ? "aborted" : "complete", LA_DMA_IRQ_Count);
+}
+
+/**
+  * @brief  开始采样
+  * @note   未启用触发: DMA 单次模式采满 LA_SampleCount 个样本.
+  *         启用触发: DMA 循环模式连续采样, 由 TIM4 计数切换触发阶段
+  *         (采触发前样本 -> 等待 EXTI 边沿 -> 采触发后样本 -> 停止),
+  *         多通道触发则由 DMA 半传输/传输完成中断扫描样本代替 EXTI.
+  *         启动后立即返回, 之后由中断推进状态机, 主循环用 LA_Poll() 得知采样结束.
+  *         RATE MAX 的采样只需几毫秒且要求 CPU 休眠, 仍在本函数内完成
+  * @param  无
+  * @retval 1: 已开始, 0: 上一次采样还未结束
+  */
+uint8_t LA_StartCapture(void)
+{
+    uint8_t ok;
+    
+    LA_DEBUG_PRINTF("[DEBUG] LA_StartCapture() called\r\n");
+    
+    if (LA_Streaming)
+    {
+        LA_StopStream();
+    }
+    
+    __disable_irq();
+    ok = CS_Event(&LA_Cap, CS_EV_START);
+    __enable_irq();
+    if (!ok)
+        return 0;
+    
+    LA_Finishing = 1;
+    LA_CalPin = LA_CAL_NONE;
+    LA_DMA_IRQ_Count = 0;
+    LA_PackOverrun = 0;
+    LA_TriggerSample = 0;
+    LA_MatchActive = LA_TriggerEnabled && (LA_TriggerType != LA_TRIG_TYPE_EDGE);
+    
+    if (LA_Pack.Width < 8)
+    {
+        if (LA_TriggerEnabled)
+            LA_DEBUG_PRINTF("[DEBUG] Trigger ignored when channels are packed\r\n");
+        LA_MatchActive = 0;
+        LA_DataMask = LA_Pack.Mask;
+        LA_PackedCapture();
+        return 1;
+    }
+    
+    LA_DataMask = 0xFF;
+    LA_DataBytes = LA_SampleCount;
+    
+    if (LA_Turbo)
+    {
+        LA_TurboRate = LA_TurboCapture();
+        LA_DEBUG_PRINTF("[DEBUG] Turbo capture: %d samples in %u cycles (%u Hz)\r\n",
+                      LA_SampleCount, LA_TurboCycles, LA_TurboRate);
+        return 1;
+    }
+    
+    LA_DEBUG_PRINTF("[DEBUG] Current GPIOA IDR (low 8 bits): 0x%02X\r\n", GPIOA->IDR & 0xFF);
+    
+    /* 停止定时器并重新配置参数 */
+    LA_TIM_Reload();
+    TIM_Cmd(TIM4, DISABLE);
+    
+    /* 清除 DMA 标志 */
+    DMA_ClearFlag(DMA1_FLAG_TC2 | DMA1_FLAG_HT2 | DMA1_FLAG_TE2);
+    
+    /* 重新配置 DMA: 触发采样用循环模式, 边沿触发不需要 DMA 中断,
+       多通道触发用半传输/传输完成中断扫描样本; 否则单次模式 + 传输完成中断 */
+    DMA_Cmd(DMA1_Channel2, DISABLE);
+    DMA_ITConfig(DMA1_Channel2, DMA_IT_HT, DISABLE);
+    DMA1_Channel2->CCR &= ~DMA_CCR1_MEM2MEM;
+    if (LA_MatchActive)
+    {
+        DMA1_Channel2->CCR |= DMA_CCR1_CIRC;
+        DMA_ITConfig(DMA1_Channel2, DMA_IT_HT, ENABLE);
+        DMA_ITConfig(DMA1_Channel2, DMA_IT_TC, ENABLE);
+    }
+    else if (LA_TriggerEnabled)
+    {
+        DMA1_Channel2->CCR |= DMA_CCR1_CIRC;
+        DMA_ITConfig(DMA1_Channel2, DMA_IT_TC, DISABLE);
+    }
+    else
+    {
+        DMA1_Channel2->CCR &= ~DMA_CCR1_CIRC;
+        DMA_ITConfig(DMA1_Channel2, DMA_IT_TC, ENABLE);
+    }
+    DMA1_Channel2->CNDTR = LA_SampleCount;  // 设置传输数量
+    DMA1_Channel2->CMAR = (uint32_t)LA_SampleBuffer;  // 设置内存地址
+    DMA1_Channel2->CPAR = (uint32_t)&(GPIOA->IDR);    // 设置外设地址
+    DMA_Cmd(DMA1_Channel2, ENABLE);
+    
+    LA_DEBUG_PRINTF("[DEBUG] DMA CNDTR=%d, DMA Enabled=%d\r\n", 
+                  DMA_GetCurrDataCounter(DMA1_Channel2),
+                  (DMA1_Channel2->CCR & DMA_CCR1_EN) ? 1 : 0);
+    
+    /* 配置触发阶段 */
+    if (LA_MatchActive)
+    {
+        uint16_t pre = (uint32_t)LA_SampleCount * LA_TriggerPosition / 100;
+        LA_PostTriggerCount = LA_SampleCount - pre;
+        
+        LA_DEBUG_PRINTF("[DEBUG] Trigger type %d, pre=%d post=%d\r\n", LA_TriggerType,
+                      pre, LA_PostTriggerCount);
+        
+        /* 触发前样本期间匹配器只跟踪状态, 不报告触发 */
+        TM_Reset(&LA_Matcher, pre);
+        LA_ScanIndex = 0;
+        LA_TriggerPhase = LA_TRIG_ARMED;
+    }
+    else if (LA_TriggerEnabled)
+    {
+        uint16_t pre = (uint32_t)LA_SampleCount * LA_TriggerPosition / 100;
+        LA_PostTriggerCount = LA_SampleCount - pre;
+        
+        LA_DEBUG_PRINTF("[DEBUG] Trigger PA%d %s, pre=%d post=%d\r\n", LA_TriggerPin,
+                      LA_TriggerEdge ? "rising" : "falling", pre, LA_PostTriggerCount);
+        
+        if (pre < 2)
+        {
+            LA_TriggerPhase = LA_TRIG_ARMED;
+            LA_EXTI_Config(1);
+        }
+        else
+        {
+            LA_TriggerPhase = LA_TRIG_PREFILL;
+            LA_Counter_Start(pre);
+        }
+    }
+    
+    /* 启动定时器开始采样 */
+    LA_TimeArm = LA_DWT_CYCCNT;
+    TIM_Cmd(TIM2, ENABLE);
+    LA_DEBUG_PRINTF("[DEBUG] TIM2 started, sampling...\r\n");
+    return 1;
+}
+
+/**
+  * @brief  中止正在进行的采样, 保留已采到的数据
+  * @note   触发采样未触发时, 以中止时刻作为触发点返回循环缓冲区中最近的数据;
+  *         无触发采样只保留已写入的样本
+  * @param  无
+  * @retval 1: 已中止, 0: 当前没有进行中的采样
+  */
+uint8_t LA_Abort(void)
+{
+    uint8_t ok;
+    
+    __disable_irq();
+    ok = CS_Event(&LA_Cap, CS_EV_ABORT);
+    if (ok)
+    {
+        LA_TimeDone = LA_DWT_CYCCNT;
+        if (LA_Packing)
+        {
+            TIM_Cmd(TIM2, DISABLE);
+            DMA_Cmd(DMA1_Channel2, DISABLE);
+            LA_Packing = 0;
+        }
+        else if (LA_TriggerEnabled)
+        {
+            if (!LA_MatchActive)
+                LA_EXTI_Config(0);
+            if (LA_TriggerPhase != LA_TRIG_POSTFILL)
+                LA_TriggerIndex = LA_DMA_WriteIndex();
+            LA_TriggerFinish();     // 状态已是 DONE, 其中的 FULL 事件被忽略
+        }
+        else
+        {
+            TIM_Cmd(TIM2, DISABLE);
+            DMA_Cmd(DMA1_Channel2, DISABLE);
+            LA_DataBytes = LA_SampleCount - DMA_GetCurrDataCounter(DMA1_Channel2);
+        }
+    }
+    __enable_irq();
+    
+    if (ok)
+    {
+        LA_CaptureFinish();
+        if (LA_CalPin != LA_CAL_NONE)
+        {
+            LA_CalPin = LA_CAL_NONE;
+            Serial_SendString("EVT: CAL ABORTED\r\n");       // ABORT 的应答仍是 OK: ABORTED
+        }
+    }
+    return ok;
+}
+
+/**
+  * @brief  处理采样事件 (在主循环中调用)
+  * @note   采满后的通知只报告一次; 中止的采样不报告 (ABORT 命令已应答)
+  * @param  无
+  * @retval 1: 有采样刚刚采满, 0: 无
+  */
+uint8_t LA_Poll(void)
+{
+    /* 中断只会把通知从 0 置 1, 且要等下一次 START 才会再次置位, 此处无需关中断 */
+    if (!CS_TakeDone(&LA_Cap))
+        return 0;
+    
+    LA_CaptureFinish();
+    if (LA_CalPin != LA_CAL_NONE)
+    {
+        /* 校准采样只报告结果, 不自动发送数据 */
+        LA_CalReport();
+        return 0;
+    }
+    return 1;
+}
+
+/**
+  * @brief  检查采样是否完成
+  * @param  无
+  * @retval 1: 完成 (缓冲区中有数据), 0: 空闲或进行中
+  */
+uint8_t LA_IsCaptureComplete(void)
+{
+    return LA_Cap.State == CS_DONE;
+}
+
+/**
+  * @brief  是否正在采样 (此时不能修改采样参数)
+  * @param  无
+  * @retval 1: 采样中, 0: 否
+  */
+uint8_t LA_IsBusy(void)
+{
+    return CS_IsBusy(&LA_Cap);
+}
+
+/**
+  * @brief  获取采样状态
+  * @param  无
+  * @retval CS_IDLE / CS_ARMED / CS_TRIGGERED / CS_DONE / CS_UPLOADING (见 CapState.h)
+  */
+uint8_t LA_GetState(void)
+{
+    return LA_Cap.State;
+}
+
+/**
+  * @brief  最近一次采样的结束原因
+  * @param  无
+  * @retval CS_RESULT_NONE / CS_RESULT_FULL / CS_RESULT_ABORTED
+  */
+uint8_t LA_GetResult(void)
+{
+    return LA_Cap.Result;
+}
+
+/**
+  * @brief  获取采样缓冲区指针
+  * @param  无
+  * @retval 缓冲区首地址
+  */
+uint8_t* LA_GetBuffer(void)
+{
+    return LA_SampleBuffer;
+}
+
+/**
+  * @brief  获取采样数量
+  * @param  无
+  * @retval 采样数量
+  */
+uint32_t LA_GetSampleCount(void)
+{
+    return LA_SampleCount;
+}
+
+/**
+  * @brief  发送采样数据到PC
+  * @note   发送期间状态为 UPLOADING, 结束后回到 DONE, 数据可重复发送
+  * @param  无
+  * @retval 无
+  */
+void LA_SendData(void)
+{
+    uint8_t upload;
+    Frame_Time_TypeDef time;
+    
+    /* SEND 可能先于 LA_Poll() 看到采样结束 */
+    LA_CaptureFinish();
+    
+    __disable_irq();
+    upload = CS_Event(&LA_Cap, CS_EV_UPLOAD);
+    __enable_irq();
+    
+    LA_GetTime(&time);
+    if (LA_OutputMode == LA_MODE_BIN)
+    {
+        LA_SendFrame(FRAME_TYPE_DATA, LA_FrameSeq++, LA_DataMask, LA_SampleBuffer, LA_DataBytes, &time,
+                     LA_PackOverrun ? FRAME_FLAG_OVERRUN : 0);
+    }
+    else
+    {
+        /* 发送头标识 (中止的无触发采样只有已写入的样本), 时间信息同二进制帧 */
+        if (LA_DataMask != 0xFF)
+            Serial_Printf("DATA: (count=%d chan=0x%02X", LA_PackedCount, LA_DataMask);
+        else if (LA_TriggerEnabled && !LA_Turbo)
+            Serial_Printf("DATA: (count=%d trig=%d", LA_DataBytes, LA_TriggerSample);
+        else
+            Serial_Printf("DATA: (count=%d", LA_DataBytes);
+        if (LA_PackOverrun)
+            Serial_Printf(" overrun=%u", LA_GetOverrunCount());
+        Serial_Printf(" clk=%u arm=%u trigt=%u done=%u period16=%u)\r\n",
+                      time.Clock, time.Arm, time.Trigger, time.Done, time.Period16);
+        
+        /* 发送数据 (十六进制格式) */
+        LA_SendHex(LA_SampleBuffer, LA_DataBytes);
+        
+        Serial_SendString("\r\nEND\r\n");
+    }
+    
+    if (upload)
+    {
+        __disable_irq();
+        CS_Event(&LA_Cap, CS_EV_SENT);
+        __enable_irq();
+    }
+}
+
+/**
+  * @brief  开始流式采样
+  * @note   DMA 循环写入整个缓冲区, 半传输/传输完成中断把填满的半区交给
+  *         LA_StreamProcess() 发送, 另一半区同时继续采样. 持续时间不受
+  *         缓冲区大小限制, 但采样率不能超过串口发送能力, 否则会丢数据
+  * @param  无
+  * @retval 无
+  */
+void LA_StartStream(void)
+{
+    LA_TIM_Reload();
+    
+    DMA_Cmd(DMA1_Channel2, DISABLE);
+    DMA_ClearFlag(DMA1_FLAG_TC2 | DMA1_FLAG_HT2 | DMA1_FLAG_TE2);
+    
+    PP_Init(&LA_Stream, LA_STREAM_SIZE / 2);
+    
+    /* 循环模式, 开启半传输中断 */
+    DMA1_Channel2->CCR &= ~DMA_CCR1_MEM2MEM;
+    DMA1_Channel2->CCR |= DMA_CCR1_CIRC;
+    DMA1_Channel2->CNDTR = LA_STREAM_SIZE;
+    DMA1_Channel2->CMAR = (uint32_t)LA_SampleBuffer;
+    DMA1_Channel2->CPAR = (uint32_t)&(GPIOA->IDR);
+    DMA_ITConfig(DMA1_Channel2, DMA_IT_HT, ENABLE);
+    DMA_ITConfig(DMA1_Channel2, DMA_IT_TC, ENABLE);
+    
+    LA_Streaming = 1;
+    DMA_Cmd(DMA1_Channel2, ENABLE);
+    TIM_Cmd(TIM2, ENABLE);
+}
+
+/**
+  * @brief  停止流式采样 (未发送的半区直接丢弃)
+  * @param  无
+  * @retval 无
+  */
+void LA_StopStream(void)
+{
+    TIM_Cmd(TIM2, DISABLE);
+    DMA_Cmd(DMA1_Channel2, DISABLE);
+    DMA_ITConfig(DMA1_Channel2, DMA_IT_HT, DISABLE);
+    LA_Streaming = 0;
+}
+
+/**
+  * @brief  是否处于流式采样
+  * @param  无
+  * @retval 1: 流式采样中, 0: 否
+  */
+uint8_t LA_IsStreaming(void)
+{
+    return LA_Streaming;
+}
+
+/**
+  * @brief  获取上一次打包采样中被覆盖 (未打包) 的采样数
+  * @note   不为 0 时数据中间缺了若干个半区, 样本总数不变但时间不连续
+  * @param  无
+  * @retval 丢失采样数, 非打包采样为 0
+  */
+uint32_t LA_GetOverrunCount(void)
+{
+    return LA_PackOverrun * (LA_STAGE_SIZE / 2);
+}
+
+/**
+  * @brief  获取流式采样丢失的采样数
+  * @param  无
+  * @retval 丢失采样数 (发送跟不上采样时累加)
+  */
+uint32_t LA_GetDroppedCount(void)
+{
+    return LA_Stream.Dropped;
+}
+
+/**
+  * @brief  发送已填满的半区 (在主循环中调用)
+  * @note   数据在发送 (复制进串口发送缓冲区) 期间可能被 DMA 覆盖, 帧头已经发出,
+  *         此时在数据之后补发事件行 EVT: STREAM SEQ=<n> TORN, 上位机据此丢弃该块
+  * @param  无
+  * @retval 无
+  */
+void LA_StreamProcess(void)
+{
+    int8_t half;
+    uint32_t seq;
+    uint8_t intact;
+    
+    if (!LA_Streaming)
+        return;
+    
+    __disable_irq();
+    half = PP_Acquire(&LA_Stream);
+    seq = (half >= 0) ? LA_Stream.Seq[half] : 0;
+    __enable_irq();
+    
+    if (half < 0)
+        return;
+    
+    if (LA_OutputMode == LA_MODE_BIN)
+    {
+        /* 丢失的半区会占用序号, 上位机可由序号跳变得知 */
+        LA_SendFrame(FRAME_TYPE_STREAM, (uint16_t)seq, 0xFF,
+                     &LA_SampleBuffer[half * LA_Stream.HalfSize], LA_Stream.HalfSize, 0, 0);
+    }
+    else
+    {
+        Serial_Printf("STREAM: (seq=%u count=%d dropped=%u)\r\n",
+                      seq, LA_Stream.HalfSize, LA_Stream.Dropped);
+        LA_SendHex(&LA_SampleBuffer[half * LA_Stream.HalfSize], LA_Stream.HalfSize);
+        Serial_SendString("\r\nEND\r\n");
+    }
+    
+    __disable_irq();
+    intact = PP_Release(&LA_Stream, half);
+    __enable_irq();
+    
+    if (!intact)
+    {
+        Serial_Printf("EVT: STREAM SEQ=%u TORN\r\n", seq);
+    }
+}
+
+/**
+  * @brief  DMA1 通道2 中断服务函数 (采样完成 / 流式半区完成 / 多通道触发扫描 / 通道打包)
+  * @param  无
+  * @retval 无
+  */
+void DMA1_Channel2_IRQHandler(void)
+{
+    LA_DMA_IRQ_Count++;
+    
+    if (LA_Packing)
+    {
+        /* 两个标志同时挂起说明上一个半区还没打包就被覆盖了 */
+        if (DMA_GetITStatus(DMA1_IT_HT2) == SET && DMA_GetITStatus(DMA1_IT_TC2) == SET)
+        {
+            LA_PackOverrun++;
+        }
+        if (DMA_GetITStatus(DMA1_IT_HT2) == SET)
+        {
+            DMA_ClearITPendingBit(DMA1_IT_HT2);
+            LA_PackHalf(0);
+        }
+        if (LA_Packing && DMA_GetITStatus(DMA1_IT_TC2) == SET)
+        {
+            DMA_ClearITPendingBit(DMA1_IT_TC2);
+            LA_PackHalf(1);
+        }
+        return;
+    }
+    
+    if (DMA_GetITStatus(DMA1_IT_HT2) == SET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_HT2);
+        if (LA_Streaming)
+        {
+            PP_OnHalfComplete(&LA_Stream, 0);
+        }
+        else if (LA_MatchActive && LA_TriggerPhase == LA_TRIG_ARMED)
+        {
+            LA_MatchScan();
+        }
+    }
+    
+    if (DMA_GetITStatus(DMA1_IT_TC2) == SET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_TC2);
+        if (LA_Streaming)
+        {
+            PP_OnHalfComplete(&LA_Stream, 1);
+        }
+        else if (LA_MatchActive)
+        {
+            if (LA_TriggerPhase == LA_TRIG_ARMED)
+                LA_MatchScan();
+        }
+        else
+        {
+            LA_TimeDone = LA_DWT_CYCCNT;
+            if (LA_Turbo)
+            {
+                LA_TurboCycles = LA_TimeDone - LA_TimeArm;
+                LA_TurboDone = 1;
+            }
+            TIM_Cmd(TIM2, DISABLE);
+            CS_Event(&LA_Cap, CS_EV_FULL);
+        }
+    }
+}
+
+/**
+  * @brief  TIM4 中断服务函数 (采样计数到达)
+  * @param  无
+  * @retval 无
+  */
+void TIM4_IRQHandler(void)
+{
+    if (TIM_GetITStatus(TIM4, TIM_IT_Update) == SET)
+    {
+        TIM_ClearITPendingBit(TIM4, TIM_IT_Update);
+        
+        if (LA_TriggerPhase == LA_TRIG_PREFILL)
+        {
+            /* 触发前样本已采满, 开始检测触发 */
+            TIM_Cmd(TIM4, DISABLE);
+            LA_TriggerPhase = LA_TRIG_ARMED;
+            LA_EXTI_Config(1);
+        }
+        else if (LA_TriggerPhase == LA_TRIG_POSTFILL)
+        {
+            LA_TriggerFinish();
+        }
+    }
+}
+
+/**
+  * @brief  EXTI 中断服务函数 (触发引脚 PA0-PA7 边沿)
+  * @param  无
+  * @retval 无
+  */
+static void LA_EXTI_IRQ(uint32_t line)
+{
+    if (EXTI_GetITStatus(line) == SET)
+    {
+        EXTI_ClearITPendingBit(line);
+        if (LA_TriggerPhase == LA_TRIG_ARMED)
+        {
+            LA_TriggerFire();
+        }
+    }
+}
+
+void EXTI0_IRQHandler(void) { LA_EXTI_IRQ(EXTI_Line0); }
+void EXTI1_IRQHandler(void) { LA_EXTI_IRQ(EXTI_Line1); }
+void EXTI2_IRQHandler(void) { LA_EXTI_IRQ(EXTI_Line2); }
+void EXTI3_IRQHandler(void) { LA_EXTI_IRQ(EXTI_Line3); }
+void EXTI4_IRQHandler(void) { LA_EXTI_IRQ(EXTI_Line4); }
+
+void EXTI9_5_IRQHandler(void)
+{
+    LA_EXTI_IRQ(EXTI_Line5);
+    LA_EXTI_IRQ(EXTI_Line6);
+    LA_EXTI_IRQ(EXTI_Line7);
 }
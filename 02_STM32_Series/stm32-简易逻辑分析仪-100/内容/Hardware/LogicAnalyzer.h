@@ -3,22 +3,82 @@
 
 #include <stdint.h>
 
+/* 数据输出格式 */
+#define LA_MODE_HEX     0       // 十六进制文本 (兼容串口助手)
+#define LA_MODE_BIN     1       // 二进制帧 (见 Frame.h)
+
+/* 触发类型 */
+#define LA_TRIG_TYPE_EDGE       0   // 单引脚边沿 (EXTI)
+#define LA_TRIG_TYPE_PATTERN    1   // 值/掩码匹配
+#define LA_TRIG_TYPE_ANYEDGE    2   // 掩码内任一通道跳变
+#define LA_TRIG_TYPE_SEQUENCE   3   // 两级顺序触发
+
+/* 调试输出: 为 1 时在串口输出 [DEBUG] 信息. 这些信息与应答、二进制帧共用串口,
+   上位机会把它们当成应答或打乱帧, 只在单独调试固件时打开 (可在工程宏定义中设置) */
+#ifndef LA_DEBUG
+#define LA_DEBUG        0
+#endif
+
+#if LA_DEBUG
+#define LA_DEBUG_PRINTF(...)    Serial_Printf(__VA_ARGS__)
+#else
+#define LA_DEBUG_PRINTF(...)    ((void)0)
+#endif
+
 /* 初始化 */
 void LA_Init(void);
 
 /* 配置函数 */
 void LA_SetSampleRate(uint16_t psc, uint16_t arr);
-void LA_SetSampleCount(uint16_t count);
+uint32_t LA_SetSampleRateHz(uint32_t hz);
+uint32_t LA_SetTurbo(void);
+uint8_t LA_IsTurbo(void);
+void LA_SetSampleCount(uint32_t count);
+uint32_t LA_GetMaxSampleCount(void);
+uint32_t LA_GetBufferSize(void);
+void LA_SetChannelMask(uint8_t mask);
+uint8_t LA_GetChannelMask(void);
 void LA_SetTrigger(uint8_t pin, uint8_t edge);
+void LA_SetPatternTrigger(uint8_t value, uint8_t mask);
+void LA_SetAnyEdgeTrigger(uint8_t mask);
+void LA_SetSequenceTrigger(uint8_t valueA, uint8_t maskA, uint8_t valueB, uint8_t maskB,
+                           uint16_t window);
+uint8_t LA_GetTriggerType(void);
+uint8_t LA_IsTriggerEnabled(void);
+void LA_SetTriggerPosition(uint8_t percent);
+uint8_t LA_GetTriggerPosition(void);
 void LA_DisableTrigger(void);
+void LA_SetOutputMode(uint8_t mode);
+uint8_t LA_GetOutputMode(void);
+void LA_SetCompression(uint8_t enable);
+uint8_t LA_GetCompression(void);
+uint32_t LA_GetSampleRate(void);
 
-/* 采样控制 */
-void LA_StartCapture(void);
+/* 采样控制 (状态见 CapState.h) */
+uint8_t LA_StartCapture(void);
+uint8_t LA_Abort(void);
+uint8_t LA_Poll(void);
 uint8_t LA_IsCaptureComplete(void);
+uint8_t LA_IsBusy(void);
+uint8_t LA_GetState(void);
+uint8_t LA_GetResult(void);
+uint32_t LA_GetOverrunCount(void);
+
+/* 自校准 (PB1 测试信号接到 PA0-PA7 之一) */
+uint32_t LA_GetReferenceRate(void);
+uint8_t LA_StartCalibration(uint8_t pin);
+
+/* 流式采样 */
+void LA_StartStream(void);
+void LA_StopStream(void);
+uint8_t LA_IsStreaming(void);
+uint32_t LA_GetDroppedCount(void);
+void LA_StreamProcess(void);
 
 /* 数据访问 */
 uint8_t* LA_GetBuffer(void);
-uint16_t LA_GetSampleCount(void);
+uint32_t LA_GetSampleCount(void);
+uint16_t LA_GetTriggerSample(void);
 void LA_SendData(void);
 
 #endif
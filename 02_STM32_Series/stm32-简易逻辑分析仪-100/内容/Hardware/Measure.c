@@ -0,0 +1,437 @@
+/**
+  ******************************************************************************
+  * @file    Measure.c
+  * @brief   频率/占空比测量 - TIM5 PWM 输入模式, 不经过采样缓冲区
+  * @note    移植自 F407 工程的 atim_timx_pwmin_chy_process(): 被测信号的上升沿经
+  *          TI1FP1 (或 TI2FP2) 复位计数器, 同时在直接通道捕获周期; 同一输入的
+  *          下降沿在相对通道捕获高电平时间. 每次捕获在中断中累加进统计窗口,
+  *          主循环每个窗口发送一条统计记录 (格式见 Measure.h) 后清零.
+  *          TIM5_CH1/CH2 即 PA0/PA1, 不占用采样用的 TIM2/TIM4/DMA1,
+  *          可以与 CAP / STREAM 同时进行.
+  *          量程自动调整:
+  *          - 两次上升沿之间计数器溢出 (周期超出 16 位) 时预分频加倍, 同 F407 版本;
+  *            反方向由主循环在窗口结束时按最长周期一次缩小到合适的量程
+  *          - 捕获间隔短于 1/MEAS_IRQ_MAX 秒时输入分频加倍 (每 2/4/8 个周期捕获一次),
+  *            每窗口捕获次数另有上限, 达到后停止捕获到窗口结束, 中断不会占满 CPU
+  ******************************************************************************
+  */
+
+#include "stm32f10x.h"
+#include "Measure.h"
+#include "LogicAnalyzer.h"
+#include "Frame.h"
+#include "Serial.h"
+
+#define MEAS_TIM_CLOCK      72000000    // TIM5 计数时钟 (Hz)
+#define MEAS_PSC_MAX        65535       // 预分频上限, 量程约 59.6 秒
+#define MEAS_RANGE_TARGET   0xC000      // 缩小量程后最长周期不超过此计数, 留出 1/4 余量
+#define MEAS_IRQ_MAX        20000       // 每秒捕获中断次数上限
+#define MEAS_DIV_MAX        8           // 输入分频上限
+
+/* DWT 周期计数器 (LA_Init 中已开启) */
+#define MEAS_DWT_CYCCNT     (*(volatile uint32_t *)0xE0001004)
+
+/* 统计窗口的累加值: 中断中累加, 主循环在窗口结束时关中断取走并清零 */
+typedef struct
+{
+    uint32_t Captures;          // 捕获次数 (含丢弃的)
+    uint32_t Edges;
+    uint32_t Periods;
+    uint32_t PeriodSum;
+    uint32_t HighSum;
+    uint32_t PeriodMin;
+    uint32_t PeriodMax;
+    uint32_t HighMin;
+    uint32_t HighMax;
+    uint32_t LowMin;
+    uint32_t LowMax;
+    uint32_t Longest;           // 含丢弃的捕获在内的最长周期, 用于调整量程
+    uint8_t Flags;
+} Meas_Acc_TypeDef;
+
+static volatile Meas_Acc_TypeDef Meas_Acc;          // 当前窗口的统计
+static uint8_t Meas_Pin = MEAS_OFF;                 // 被测引脚
+static volatile uint16_t Meas_Psc = 0;              // 当前预分频 (量程)
+static volatile uint8_t Meas_Div = 1;               // 当前输入分频
+static volatile uint8_t Meas_Skip = 0;              // 丢弃下一次捕获 (计数器不是由上升沿清零的)
+static uint32_t Meas_Budget;                        // 每窗口捕获次数上限
+static uint32_t Meas_Interval;                      // 窗口长度 (DWT 周期)
+static uint32_t Meas_WindowStart;                   // 窗口开始时刻 (DWT)
+static uint16_t Meas_Seq = 0;                       // 二进制帧序号
+
+/* 被测引脚对应的通道: 周期在直接通道捕获, 高电平在相对通道捕获 */
+static uint16_t Meas_ItPeriod;                      // TIM_IT_CC1 / TIM_IT_CC2
+static uint16_t Meas_FlagHigh;                      // 相对通道的捕获标志
+static uint16_t Meas_FlagMissed;                    // 直接通道的重复捕获标志
+static volatile uint16_t *Meas_CcrPeriod;
+static volatile uint16_t *Meas_CcrHigh;
+
+/**
+  * @brief  清空统计窗口
+  * @param  flags: 新窗口的初始标志
+  * @retval 无
+  */
+static void Meas_ResetAcc(uint8_t flags)
+{
+    Meas_Acc.Captures = 0;
+    Meas_Acc.Edges = 0;
+    Meas_Acc.Periods = 0;
+    Meas_Acc.PeriodSum = 0;
+    Meas_Acc.HighSum = 0;
+    Meas_Acc.PeriodMin = 0xFFFFFFFF;
+    Meas_Acc.PeriodMax = 0;
+    Meas_Acc.HighMin = 0xFFFFFFFF;
+    Meas_Acc.HighMax = 0;
+    Meas_Acc.LowMin = 0xFFFFFFFF;
+    Meas_Acc.LowMax = 0;
+    Meas_Acc.Longest = 0;
+    Meas_Acc.Flags = flags;
+}
+
+/**
+  * @brief  输入分频对应的 ICxPSC 设置
+  */
+static uint16_t Meas_IcPsc(uint8_t div)
+{
+    if (div >= 8)
+        return TIM_ICPSC_DIV8;
+    if (div >= 4)
+        return TIM_ICPSC_DIV4;
+    if (div >= 2)
+        return TIM_ICPSC_DIV2;
+    return TIM_ICPSC_DIV1;
+}
+
+/**
+  * @brief  设置输入分频 (两个通道相同)
+  * @note   下一次捕获的两个值可能分属不同分频的周期, 丢弃
+  * @param  div: 1/2/4/8
+  * @retval 无
+  */
+static void Meas_SetDiv(uint8_t div)
+{
+    TIM_SetIC1Prescaler(TIM5, Meas_IcPsc(div));
+    TIM_SetIC2Prescaler(TIM5, Meas_IcPsc(div));
+    Meas_Div = div;
+    Meas_Skip = 1;
+}
+
+/**
+  * @brief  设置预分频 (量程), 清空本窗口统计 (计数单位变了)
+  * @note   UG 立即装入预分频并清零计数器, 下一次捕获的周期不是从上升沿开始的, 丢弃.
+  *         中断中或关中断时调用
+  * @param  psc: 预分频值
+  * @param  flags: 新窗口的初始标志
+  * @retval 无
+  */
+static void Meas_SetRange(uint16_t psc, uint8_t flags)
+{
+    TIM5->PSC = psc;
+    TIM5->EGR = TIM_EGR_UG;
+    Meas_Psc = psc;
+    Meas_Skip = 1;
+    Meas_ResetAcc(flags);
+}
+
+/**
+  * @brief  开始测量 (已在测量则按新参数重新开始)
+  * @param  pin: 被测引脚, 0=PA0 (TIM5_CH1), 1=PA1 (TIM5_CH2)
+  * @param  intervalMs: 统计窗口 (毫秒), 每个窗口发送一条记录
+  * @retval 1: 成功, 0: 该引脚不能测量
+  */
+uint8_t Measure_Start(uint8_t pin, uint16_t intervalMs)
+{
+    TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+    TIM_ICInitTypeDef TIM_ICInitStructure;
+    NVIC_InitTypeDef NVIC_InitStructure;
+
+    if (pin > MEAS_PIN_MAX)
+        return 0;
+    Measure_Stop();
+
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM5, ENABLE);
+
+    /* 计数器从 72MHz 开始, 满量程 65536 计数 */
+    TIM_TimeBaseStructure.TIM_Period = 0xFFFF;
+    TIM_TimeBaseStructure.TIM_Prescaler = 0;
+    TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+    TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+    TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
+    TIM_TimeBaseInit(TIM5, &TIM_TimeBaseStructure);
+
+    /* PWM 输入: 直接通道上升沿捕获周期, 相对通道下降沿捕获高电平时间 */
+    TIM_ICStructInit(&TIM_ICInitStructure);
+    TIM_ICInitStructure.TIM_Channel = (pin == 0) ? TIM_Channel_1 : TIM_Channel_2;
+    TIM_ICInitStructure.TIM_ICPolarity = TIM_ICPolarity_Rising;
+    TIM_ICInitStructure.TIM_ICSelection = TIM_ICSelection_DirectTI;
+    TIM_ICInitStructure.TIM_ICPrescaler = TIM_ICPSC_DIV1;
+    TIM_ICInitStructure.TIM_ICFilter = 0;               // 不滤波, 高频信号也能捕获
+    TIM_PWMIConfig(TIM5, &TIM_ICInitStructure);
+
+    /* 上升沿复位计数器; 复位不产生更新中断, 更新中断只表示溢出 */
+    TIM_SelectInputTrigger(TIM5, (pin == 0) ? TIM_TS_TI1FP1 : TIM_TS_TI2FP2);
+    TIM_SelectSlaveMode(TIM5, TIM_SlaveMode_Reset);
+    TIM_UpdateRequestConfig(TIM5, TIM_UpdateSource_Regular);
+
+    if (pin == 0)
+    {
+        Meas_ItPeriod = TIM_IT_CC1;
+        Meas_FlagHigh = TIM_FLAG_CC2 | TIM_FLAG_CC2OF;
+        Meas_FlagMissed = TIM_FLAG_CC1OF;
+        Meas_CcrPeriod = &TIM5->CCR1;
+        Meas_CcrHigh = &TIM5->CCR2;
+    }
+    else
+    {
+        Meas_ItPeriod = TIM_IT_CC2;
+        Meas_FlagHigh = TIM_FLAG_CC1 | TIM_FLAG_CC1OF;
+        Meas_FlagMissed = TIM_FLAG_CC2OF;
+        Meas_CcrPeriod = &TIM5->CCR2;
+        Meas_CcrHigh = &TIM5->CCR1;
+    }
+
+    Meas_Pin = pin;
+    Meas_Budget = (uint32_t)MEAS_IRQ_MAX * 2 * intervalMs / 1000;
+    Meas_Interval = (MEAS_TIM_CLOCK / 1000) * intervalMs;
+    Meas_Div = 1;
+    Meas_SetRange(0, 0);
+    TIM_ClearFlag(TIM5, 0xFFFF);
+    TIM_ITConfig(TIM5, TIM_IT_Update | Meas_ItPeriod, ENABLE);
+
+    /* 优先级低于采样和串口, 捕获值由硬件锁存, 中断晚一些不影响结果 */
+    NVIC_InitStructure.NVIC_IRQChannel = TIM5_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 2;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+
+    Meas_WindowStart = MEAS_DWT_CYCCNT;
+    TIM_Cmd(TIM5, ENABLE);
+    return 1;
+}
+
+/**
+  * @brief  停止测量
+  * @param  无
+  * @retval 无
+  */
+void Measure_Stop(void)
+{
+    if (Meas_Pin == MEAS_OFF)
+        return;
+    TIM_Cmd(TIM5, DISABLE);
+    TIM_ITConfig(TIM5, TIM_IT_Update | TIM_IT_CC1 | TIM_IT_CC2, DISABLE);
+    Meas_Pin = MEAS_OFF;
+}
+
+/**
+  * @brief  正在测量的引脚
+  * @param  无
+  * @retval 0/1, 未测量时为 MEAS_OFF
+  */
+uint8_t Measure_GetPin(void)
+{
+    return Meas_Pin;
+}
+
+/**
+  * @brief  发送一条统计记录: 二进制模式为 FRAME_TYPE_MEAS 帧, 十六进制模式为一行文本
+  * @param  rec: 记录
+  * @retval 无
+  */
+static void Meas_Send(const Measure_Record_TypeDef *rec)
+{
+    const uint32_t field[11] = {
+        rec->Window, rec->Edges, rec->Periods, rec->PeriodSum, rec->HighSum,
+        rec->PeriodMin, rec->PeriodMax, rec->HighMin, rec->HighMax, rec->LowMin, rec->LowMax,
+    };
+    uint8_t block[MEAS_RECORD_SIZE];
+    uint64_t mhz = 0;
+    uint32_t duty = 0;
+
+    if (LA_GetOutputMode() == LA_MODE_BIN)
+    {
+        for (uint8_t i = 0; i < 44; i++)
+        {
+            block[i] = (uint8_t)(field[i / 4] >> ((i % 4) * 8));
+        }
+        block[44] = rec->Pin;
+        block[45] = rec->Div;
+        block[46] = rec->Level;
+        block[47] = rec->Flags;
+        Frame_Send(FRAME_TYPE_MEAS, 0, Meas_Seq++, 1u << rec->Pin, rec->Clock, block, MEAS_RECORD_SIZE);
+        return;
+    }
+
+    /* 频率 (mHz) 与占空比 (0.01%) */
+    if (rec->PeriodSum)
+    {
+        mhz = (uint64_t)rec->Clock * 1000 * rec->Periods / rec->PeriodSum;
+        duty = (uint32_t)((uint64_t)rec->HighSum * 10000 / rec->PeriodSum);
+    }
+    Serial_Printf("MEAS: (pin=%u clk=%u window=%u edges=%u periods=%u psum=%u hsum=%u "
+                  "pmin=%u pmax=%u hmin=%u hmax=%u lmin=%u lmax=%u div=%u level=%u flags=%u) "
+                  "FREQ=%u.%03uHz DUTY=%u.%02u%%\r\n",
+                  rec->Pin, rec->Clock, rec->Window, rec->Edges, rec->Periods, rec->PeriodSum,
+                  rec->HighSum, rec->PeriodMin, rec->PeriodMax, rec->HighMin, rec->HighMax,
+                  rec->LowMin, rec->LowMax, rec->Div, rec->Level, rec->Flags,
+                  (uint32_t)(mhz / 1000), (uint32_t)(mhz % 1000), duty / 100, duty % 100);
+}
+
+/**
+  * @brief  窗口结束后调整量程和输入分频
+  * @note   预分频一次缩小到最长周期不超过 MEAS_RANGE_TARGET 的最大量程;
+  *         输入分频在最短周期的捕获间隔减半后仍有两倍余量时减半, 不会与中断中的加倍来回跳
+  * @param  acc: 刚结束窗口的统计
+  * @param  psc, div: 该窗口的预分频和输入分频
+  * @retval 无
+  */
+static void Meas_Adjust(const Meas_Acc_TypeDef *acc, uint16_t psc, uint8_t div)
+{
+    uint32_t range = (uint32_t)psc + 1;     // 分频比, 为 2 的幂
+
+    if (acc->Longest)
+    {
+        while (range > 1 && (uint64_t)acc->Longest * (psc + 1) / (range / 2) < MEAS_RANGE_TARGET)
+            range /= 2;
+    }
+    while (div > 1 && acc->Periods &&
+           (uint64_t)acc->PeriodMin * (psc + 1) * (div / 2) >= 2 * (MEAS_TIM_CLOCK / MEAS_IRQ_MAX))
+        div /= 2;
+
+    /* 中断中已经放大了量程时以中断为准 */
+    __disable_irq();
+    if (Meas_Psc == psc)
+    {
+        if (div != Meas_Div)
+            Meas_SetDiv(div);
+        if (range - 1 != psc)
+            Meas_SetRange(range - 1, 0);
+    }
+    __enable_irq();
+}
+
+/**
+  * @brief  主循环调用: 统计窗口结束时发送记录并开始下一个窗口
+  * @param  无
+  * @retval 无
+  */
+void Measure_Process(void)
+{
+    Measure_Record_TypeDef rec;
+    Meas_Acc_TypeDef acc;
+    uint32_t now;
+    uint16_t psc;
+    uint8_t div;
+
+    if (Meas_Pin == MEAS_OFF)
+        return;
+    now = MEAS_DWT_CYCCNT;
+    if (now - Meas_WindowStart < Meas_Interval)
+        return;
+
+    __disable_irq();
+    acc = Meas_Acc;
+    psc = Meas_Psc;
+    div = Meas_Div;
+    Meas_ResetAcc(0);
+    if (acc.Flags & MEAS_FLAG_PARTIAL)
+    {
+        /* 达到次数上限时停止了捕获中断, 清掉期间的标志后恢复 */
+        TIM_ClearFlag(TIM5, TIM_FLAG_CC1 | TIM_FLAG_CC2 | TIM_FLAG_CC1OF | TIM_FLAG_CC2OF);
+        TIM_ITConfig(TIM5, Meas_ItPeriod, ENABLE);
+        Meas_Skip = 1;
+    }
+    __enable_irq();
+
+    rec.Clock = MEAS_TIM_CLOCK / (psc + 1);
+    rec.Window = (now - Meas_WindowStart) / (MEAS_TIM_CLOCK / 1000000);
+    Meas_WindowStart = now;
+    rec.Edges = acc.Edges;
+    rec.Periods = acc.Periods;
+    rec.PeriodSum = acc.PeriodSum;
+    rec.HighSum = acc.HighSum;
+    rec.PeriodMin = acc.Periods ? acc.PeriodMin : 0;
+    rec.PeriodMax = acc.PeriodMax;
+    rec.HighMin = acc.Periods ? acc.HighMin : 0;
+    rec.HighMax = acc.HighMax;
+    rec.LowMin = acc.Periods ? acc.LowMin : 0;
+    rec.LowMax = acc.LowMax;
+    rec.Pin = Meas_Pin;
+    rec.Div = div;
+    rec.Level = (GPIOA->IDR >> Meas_Pin) & 1;
+    rec.Flags = acc.Flags;
+    Meas_Send(&rec);
+
+    Meas_Adjust(&acc, psc, div);
+}
+
+/**
+  * @brief  TIM5 中断服务函数 (计数器溢出 / 周期捕获)
+  * @param  无
+  * @retval 无
+  */
+void TIM5_IRQHandler(void)
+{
+    uint32_t period, high, low;
+    uint16_t sr = TIM5->SR;
+
+    /* 读到的标志一次写 0 清除 (没读到的位写 1, 不受影响) */
+    TIM5->SR = (uint16_t)~(sr & (TIM_FLAG_Update | Meas_ItPeriod | Meas_FlagHigh | Meas_FlagMissed));
+
+    /* 两次上升沿之间计数器溢出: 周期超出量程, 预分频加倍; 已是最大量程则只丢弃这个周期 */
+    if (sr & TIM_FLAG_Update)
+    {
+        if (Meas_Psc < MEAS_PSC_MAX)
+            Meas_SetRange((Meas_Psc << 1) | 1, MEAS_FLAG_RANGE);
+        else
+            Meas_Skip = 1;
+    }
+
+    /* 达到次数上限后捕获中断已关闭, 标志仍会置位, 不处理 */
+    if (!(sr & Meas_ItPeriod) || !(TIM5->DIER & Meas_ItPeriod))
+        return;
+    if (sr & Meas_FlagMissed)
+    {
+        Meas_Acc.Flags |= MEAS_FLAG_MISSED;
+    }
+
+    /* 计数器在上升沿那一拍清零, 捕获值加 1 才是计数个数 */
+    period = *Meas_CcrPeriod + 1;
+    high = *Meas_CcrHigh + 1;
+    Meas_Acc.Edges += 2 * Meas_Div;
+    if (++Meas_Acc.Captures >= Meas_Budget)
+    {
+        TIM_ITConfig(TIM5, Meas_ItPeriod, DISABLE);
+        Meas_Acc.Flags |= MEAS_FLAG_PARTIAL;
+    }
+    if (Meas_Skip)
+    {
+        Meas_Skip = 0;
+        return;
+    }
+    if (period > Meas_Acc.Longest)
+        Meas_Acc.Longest = period;
+
+    /* 捕获间隔太短: 输入分频加倍 */
+    if (Meas_Div < MEAS_DIV_MAX &&
+        period * Meas_Div < MEAS_TIM_CLOCK / MEAS_IRQ_MAX / (Meas_Psc + 1))
+    {
+        Meas_SetDiv(Meas_Div * 2);
+    }
+
+    /* 高电平须短于周期, 否则两次捕获不属于同一个周期 (如占空比接近 0 或 100%) */
+    if (high >= period)
+        return;
+    low = period - high;
+
+    Meas_Acc.Periods++;
+    Meas_Acc.PeriodSum += period;
+    Meas_Acc.HighSum += high;
+    if (period < Meas_Acc.PeriodMin) Meas_Acc.PeriodMin = period;
+    if (period > Meas_Acc.PeriodMax) Meas_Acc.PeriodMax = period;
+    if (high < Meas_Acc.HighMin) Meas_Acc.HighMin = high;
+    if (high > Meas_Acc.HighMax) Meas_Acc.HighMax = high;
+    if (low < Meas_Acc.LowMin) Meas_Acc.LowMin = low;
+    if (low > Meas_Acc.LowMax) Meas_Acc.LowMax = low;
+}
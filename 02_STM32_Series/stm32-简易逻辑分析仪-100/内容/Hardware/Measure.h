@@ -0,0 +1,64 @@
+#ifndef __MEASURE_H
+#define __MEASURE_H
+
+#include <stdint.h>
+
+/*
+ * 频率/占空比测量 (MEAS): TIM5 PWM 输入模式, 只能测 PA0 (TIM5_CH1) / PA1 (TIM5_CH2)
+ *
+ * 每个统计窗口发送一条记录. 二进制模式下为 FRAME_TYPE_MEAS 帧, 帧头的采样率字段
+ * 为计数频率 (Hz), 通道掩码为被测引脚, 数据为 48 字节记录 (小端):
+ *  偏移  长度  内容
+ *   0     4    统计时长 (us)
+ *   4     4    边沿数 (捕获次数 x 2 x 输入分频)
+ *   8     4    测得的周期数
+ *  12     4    周期之和 (计数)
+ *  16     4    高电平时间之和 (计数)
+ *  20     4    最短周期        24  4  最长周期
+ *  28     4    最短高电平      32  4  最长高电平
+ *  36     4    最短低电平      40  4  最长低电平
+ *  44     1    引脚 (0/1)
+ *  45     1    输入分频 (1/2/4/8, 每这么多个周期捕获一次)
+ *  46     1    发送时的引脚电平
+ *  47     1    标志 MEAS_FLAG_xxx
+ * 频率 = 计数频率 x 周期数 / 周期之和, 占空比 = 高电平时间之和 / 周期之和.
+ * 周期数为 0 表示窗口内没有完整周期 (电平不变或周期超出量程).
+ */
+#define MEAS_RECORD_SIZE    48
+#define MEAS_PIN_MAX        1       // 只有 PA0/PA1 接 TIM5 的 PWM 输入通道
+#define MEAS_OFF            0xFF    // 未在测量
+#define MEAS_INTERVAL_MIN   10      // 统计窗口 (ms)
+#define MEAS_INTERVAL_MAX   10000
+#define MEAS_INTERVAL_DEF   100
+
+#define MEAS_FLAG_RANGE     0x01    // 窗口内量程改变过, 统计只含改变之后的周期
+#define MEAS_FLAG_MISSED    0x02    // 有捕获未及时读取就被覆盖, 边沿数偏少
+#define MEAS_FLAG_PARTIAL   0x04    // 捕获次数达到上限, 窗口后段未统计
+
+/* 一个统计窗口的结果 (时间单位为计数, 计数频率见 Clock) */
+typedef struct
+{
+    uint32_t Clock;             // 计数频率 (Hz)
+    uint32_t Window;            // 统计时长 (us)
+    uint32_t Edges;
+    uint32_t Periods;
+    uint32_t PeriodSum;
+    uint32_t HighSum;
+    uint32_t PeriodMin;
+    uint32_t PeriodMax;
+    uint32_t HighMin;
+    uint32_t HighMax;
+    uint32_t LowMin;
+    uint32_t LowMax;
+    uint8_t Pin;
+    uint8_t Div;
+    uint8_t Level;
+    uint8_t Flags;
+} Measure_Record_TypeDef;
+
+uint8_t Measure_Start(uint8_t pin, uint16_t intervalMs);
+void Measure_Stop(void);
+uint8_t Measure_GetPin(void);
+void Measure_Process(void);
+
+#endif
@@ -0,0 +1,167 @@
+/**
+  ******************************************************************************
+  * @file    Pack.c
+  * @brief   采样通道打包 - 只采 1/2/4 个通道时把多个样本压进一个字节
+  * @note    DMA 仍按字节读取 GPIOA->IDR, 打包在 DMA 半传输/传输完成中断中进行.
+  *          内核每次读 4 个样本 (一个字): 先按掩码取出启用通道, 再用乘法把 4 个
+  *          字节里的位段一次移到一起, 单通道时每 8 个样本只需约十条指令.
+  *          打包格式须与上位机 capture_file.py 的 unpack() 保持一致.
+  ******************************************************************************
+  */
+
+#include "Pack.h"
+
+/**
+  * @brief  初始化打包参数
+  * @param  pk: 打包参数
+  * @param  mask: 通道掩码 (bit0-7 对应 PA0-PA7), 0 按 0xFF 处理
+  * @retval 无
+  */
+void Pack_Init(Pack_TypeDef *pk, uint8_t mask)
+{
+    uint8_t n = 0;
+    
+    if (mask == 0)
+        mask = 0xFF;
+    
+    for (uint16_t x = 0; x < 256; x++)
+    {
+        uint8_t out = 0, bit = 0;
+        for (uint8_t ch = 0; ch < 8; ch++)
+        {
+            if (mask & (1 << ch))
+            {
+                if (x & (1 << ch))
+                    out |= 1 << bit;
+                bit++;
+            }
+        }
+        pk->Lut[x] = out;
+    }
+    
+    for (uint8_t m = mask; m; m &= m - 1)
+        n++;
+    pk->Mask = mask;
+    pk->Width = (n <= 1) ? 1 : (n <= 2) ? 2 : (n <= 4) ? 4 : 8;
+    
+    /* 掩码恰好是一段宽度为 Width 的连续位时, 可以直接移位取出, 不必查表 */
+    pk->Shift = 0xFF;
+    for (uint8_t s = 0; s + pk->Width <= 8; s++)
+    {
+        if (mask == (uint8_t)(((1 << pk->Width) - 1) << s))
+            pk->Shift = s;
+    }
+}
+
+/**
+  * @brief  打包后的字节数
+  * @param  pk: 打包参数
+  * @param  samples: 样本数
+  * @retval 字节数 (不足一个字节的按一个字节计)
+  */
+uint32_t Pack_Bytes(const Pack_TypeDef *pk, uint32_t samples)
+{
+    return (samples * pk->Width + 7) / 8;
+}
+
+/**
+  * @brief  取出一个字 (4 个样本) 中的启用通道, 结果每字节只有低 Width 位有效
+  * @param  pk: 打包参数
+  * @param  w: 4 个样本, 第一个在最低字节
+  * @retval 4 个压缩后的样本
+  */
+static inline uint32_t Pack_Gather(const Pack_TypeDef *pk, uint32_t w)
+{
+    static const uint32_t lane[9] = {0, 0x01010101, 0x03030303, 0, 0x0F0F0F0F,
+                                     0, 0, 0, 0xFFFFFFFF};
+    
+    if (pk->Shift != 0xFF)
+        return (w >> pk->Shift) & lane[pk->Width];
+    
+    return (uint32_t)pk->Lut[w & 0xFF]
+         | (uint32_t)pk->Lut[(w >> 8) & 0xFF] << 8
+         | (uint32_t)pk->Lut[(w >> 16) & 0xFF] << 16
+         | (uint32_t)pk->Lut[w >> 24] << 24;
+}
+
+/**
+  * @brief  打包一段样本
+  * @param  pk: 打包参数
+  * @param  src: 原始样本, 须 4 字节对齐
+  * @param  n: 样本数; 不是 8 的倍数时最后一个字节的高位补 0
+  * @param  dst: 输出, 长度至少 Pack_Bytes(pk, n)
+  * @retval 写入的字节数
+  */
+uint32_t Pack_Run(const Pack_TypeDef *pk, const uint8_t *src, uint32_t n, uint8_t *dst)
+{
+    const uint32_t *w = (const uint32_t *)src;
+    uint32_t full = n & ~7u;    // 整 8 个样本的部分
+    uint8_t *out = dst;
+    uint32_t a, b, i;
+    
+    switch (pk->Width)
+    {
+    case 1:
+        /* 第 i 个样本在 bit 8i, 乘 0x01020408 后移到 bit 24+i */
+        for (i = 0; i < full; i += 8)
+        {
+            a = Pack_Gather(pk, *w++);
+            b = Pack_Gather(pk, *w++);
+            *out++ = (uint8_t)(((a * 0x01020408) >> 24) & 0x0F)
+                   | (uint8_t)(((b * 0x01020408) >> 20) & 0xF0);
+        }
+        break;
+        
+    case 2:
+        /* 第 i 个样本在 bit 8i, 乘 0x01041040 后移到 bit 24+2i */
+        for (i = 0; i < full; i += 8)
+        {
+            a = Pack_Gather(pk, *w++);
+            b = Pack_Gather(pk, *w++);
+            *out++ = (uint8_t)((a * 0x01041040) >> 24);
+            *out++ = (uint8_t)((b * 0x01041040) >> 24);
+        }
+        break;
+        
+    case 4:
+        /* 相邻两个样本合成一个字节 */
+        for (i = 0; i < full; i += 8)
+        {
+            for (uint8_t k = 0; k < 2; k++)
+            {
+                a = Pack_Gather(pk, *w++);
+                a |= a >> 4;
+                *out++ = (uint8_t)a;
+                *out++ = (uint8_t)(a >> 16);
+            }
+        }
+        break;
+        
+    default:
+        for (i = 0; i < full; i++)
+            *out++ = pk->Lut[src[i]];
+        break;
+    }
+    
+    /* 剩余不足 8 个的样本逐个处理 */
+    if (n % 8)
+    {
+        uint32_t acc = 0;
+        uint8_t bits = 0;
+        for (i = full; i < n; i++)
+        {
+            acc |= (uint32_t)pk->Lut[src[i]] << bits;
+            bits += pk->Width;
+            if (bits >= 8)
+            {
+                *out++ = (uint8_t)acc;
+                acc >>= 8;
+                bits -= 8;
+            }
+        }
+        if (bits)
+            *out++ = (uint8_t)acc;
+    }
+    
+    return out - dst;
+}
@@ -0,0 +1,25 @@
+#ifndef __PACK_H
+#define __PACK_H
+
+#include <stdint.h>
+
+/*
+ * 通道打包: 只保留通道掩码中的通道, 每个样本压成 Width 位, 一个字节放 8/Width 个样本,
+ * 先采的样本在低位. 启用通道数 1/2/3-4/5-8 对应 Width = 1/2/4/8,
+ * 启用通道按 PA 编号从低到高依次放在样本的 bit0, bit1, ...
+ * Pack_Run() 每次读一个字 (4 个样本, 第一个在最低字节), 源缓冲区须 4 字节对齐.
+ * 与逐位参考实现比较的测试见 Sim/SimPack.c
+ */
+typedef struct
+{
+    uint8_t  Lut[256];      // 样本值 -> 启用通道依次排到低位后的值
+    uint8_t  Mask;          // 通道掩码
+    uint8_t  Width;         // 每样本位数 1/2/4/8
+    uint8_t  Shift;         // 启用通道恰为连续且对齐的一段时, 其最低位编号; 否则 0xFF
+} Pack_TypeDef;
+
+void Pack_Init(Pack_TypeDef *pk, uint8_t mask);
+uint32_t Pack_Bytes(const Pack_TypeDef *pk, uint32_t samples);
+uint32_t Pack_Run(const Pack_TypeDef *pk, const uint8_t *src, uint32_t n, uint8_t *dst);
+
+#endif
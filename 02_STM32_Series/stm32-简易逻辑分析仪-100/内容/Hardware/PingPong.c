@@ -0,0 +1,114 @@
+/**
+  ******************************************************************************
+  * @file    PingPong.c
+  * @brief   双缓冲 (乒乓) 管理 - 用于连续流式采样
+  * @note    DMA 循环模式下, 半传输(HT)/传输完成(TC)中断分别表示前/后半区填满,
+  *          主循环发送已填满的半区, 同时 DMA 继续写入另一半区.
+  *          主循环来不及发送时只作废未发送的半区并累加 Dropped, DMA 不停.
+  ******************************************************************************
+  */
+
+#include "PingPong.h"
+
+/**
+  * @brief  初始化双缓冲状态
+  * @param  pp: 双缓冲结构
+  * @param  halfSize: 每个半区的采样数
+  * @retval 无
+  */
+void PP_Init(PingPong_TypeDef *pp, uint16_t halfSize)
+{
+    pp->State[0] = PP_FREE;
+    pp->State[1] = PP_FREE;
+    pp->Seq[0] = 0;
+    pp->Seq[1] = 0;
+    pp->NextSeq = 0;
+    pp->Dropped = 0;
+    pp->Torn[0] = 0;
+    pp->Torn[1] = 0;
+    pp->HalfSize = halfSize;
+}
+
+/**
+  * @brief  半区填满 (在 DMA 中断中调用)
+  * @param  pp: 双缓冲结构
+  * @param  half: 刚填满的半区 (0=前半, 1=后半)
+  * @note   此时 DMA 已开始写入另一半区, 若另一半区还未发送完,
+  *         其数据会被覆盖, 记为溢出并累加丢失采样数
+  * @retval 无
+  */
+void PP_OnHalfComplete(PingPong_TypeDef *pp, uint8_t half)
+{
+    uint8_t other = half ^ 1;
+
+    if (pp->State[other] != PP_FREE)
+    {
+        pp->Dropped += pp->HalfSize;
+
+        /* 尚未开始发送的半区直接作废; 正在发送的由主循环发送完后释放, 并告知数据不完整 */
+        if (pp->State[other] == PP_READY)
+        {
+            pp->State[other] = PP_FREE;
+        }
+        else if (pp->State[other] == PP_BUSY)
+        {
+            pp->Torn[other] = 1;
+        }
+    }
+
+    pp->Seq[half] = pp->NextSeq++;
+    pp->State[half] = PP_READY;
+}
+
+/**
+  * @brief  取出一个待发送的半区 (在主循环中调用, 调用方需关中断保护)
+  * @param  pp: 双缓冲结构
+  * @retval 半区编号 (0/1), -1 表示没有待发送数据
+  */
+int8_t PP_Acquire(PingPong_TypeDef *pp)
+{
+    int8_t half = -1;
+
+    if (pp->State[0] == PP_READY)
+    {
+        half = 0;
+    }
+    if (pp->State[1] == PP_READY)
+    {
+        /* 两个半区都就绪时先发送序号较小的 */
+        if (half < 0 || (int32_t)(pp->Seq[1] - pp->Seq[0]) < 0)
+        {
+            half = 1;
+        }
+    }
+
+    if (half >= 0)
+    {
+        pp->State[half] = PP_BUSY;
+        pp->Torn[half] = 0;
+    }
+    return half;
+}
+
+/**
+  * @brief  释放已发送完的半区 (调用方需关中断保护: 先读后写状态, 期间中断
+  *         把该半区置为 READY 会被改回 FREE, 重新填满的数据既不发送也不计入 Dropped)
+  * @param  pp: 双缓冲结构
+  * @param  half: 半区编号
+  * @note   发送用时超过一整圈时该半区已被 DMA 重新填满 (状态为 READY),
+  *         保留等待下次发送
+  * @retval 1: 发送期间数据未被改写, 0: 发送期间 DMA 已开始覆盖, 发出的数据前后不一致
+  */
+uint8_t PP_Release(PingPong_TypeDef *pp, uint8_t half)
+{
+    uint8_t intact;
+
+    half &= 0x01;
+    intact = !pp->Torn[half];
+    pp->Torn[half] = 0;
+    if (pp->State[half] == PP_BUSY)
+    {
+        pp->State[half] = PP_FREE;
+    }
+    return intact;
+}
@@ -0,0 +1,27 @@
+#ifndef __PINGPONG_H
+#define __PINGPONG_H
+
+#include <stdint.h>
+
+/* 半缓冲区状态 */
+#define PP_FREE     0       // 空闲, DMA 可写入
+#define PP_READY    1       // 已填满, 等待发送
+#define PP_BUSY     2       // 正在发送
+
+/* 双缓冲 (乒乓) 管理结构 - 用模拟循环 DMA 的测试见 Sim/SimPingPong.c */
+typedef struct
+{
+    volatile uint8_t  State[2];     // 两个半区的状态
+    volatile uint32_t Seq[2];       // 两个半区的块序号
+    volatile uint32_t NextSeq;      // 下一个填满块的序号
+    volatile uint32_t Dropped;      // 因发送不及时被覆盖的采样数
+    volatile uint8_t  Torn[2];      // 发送中 (BUSY) 被 DMA 开始覆盖
+    uint16_t HalfSize;              // 每个半区的采样数
+} PingPong_TypeDef;
+
+void PP_Init(PingPong_TypeDef *pp, uint16_t halfSize);
+void PP_OnHalfComplete(PingPong_TypeDef *pp, uint8_t half);
+int8_t PP_Acquire(PingPong_TypeDef *pp);
+uint8_t PP_Release(PingPong_TypeDef *pp, uint8_t half);
+
+#endif
@@ -0,0 +1,134 @@
+/**
+  ******************************************************************************
+  * @file    RingBuffer.c
+  * @brief   字节环形缓冲区 - 串口收发与中断/DMA之间的数据通道
+  ******************************************************************************
+  */
+
+#include <string.h>
+#include "RingBuffer.h"
+
+/**
+  * @brief  初始化环形缓冲区
+  * @param  rb: 环形缓冲区
+  * @param  buffer: 存储区
+  * @param  size: 存储区大小 (2 的幂)
+  * @retval 无
+  */
+void Ring_Init(RingBuffer_TypeDef *rb, uint8_t *buffer, uint16_t size)
+{
+    rb->Buffer = buffer;
+    rb->Mask = size - 1;
+    rb->Head = 0;
+    rb->Tail = 0;
+}
+
+/**
+  * @brief  获取已用字节数
+  * @param  rb: 环形缓冲区
+  * @retval 已用字节数
+  */
+uint16_t Ring_Used(const RingBuffer_TypeDef *rb)
+{
+    return (uint16_t)(rb->Head - rb->Tail);
+}
+
+/**
+  * @brief  获取剩余空间
+  * @param  rb: 环形缓冲区
+  * @retval 剩余字节数
+  */
+uint16_t Ring_Free(const RingBuffer_TypeDef *rb)
+{
+    return (uint16_t)(rb->Mask + 1 - Ring_Used(rb));
+}
+
+/**
+  * @brief  写入数据 (生产者调用, 不阻塞)
+  * @param  rb: 环形缓冲区
+  * @param  data: 数据首地址
+  * @param  len: 数据长度
+  * @retval 实际写入的字节数 (空间不足时小于 len)
+  */
+uint16_t Ring_Write(RingBuffer_TypeDef *rb, const uint8_t *data, uint16_t len)
+{
+    uint16_t head = rb->Head;
+    uint16_t space = Ring_Free(rb);
+    uint16_t offset, first;
+
+    if (len > space)
+        len = space;
+
+    /* 分两段拷贝: 写到存储区末尾, 再从头部继续 */
+    offset = head & rb->Mask;
+    first = rb->Mask + 1 - offset;
+    if (first > len)
+        first = len;
+    memcpy(&rb->Buffer[offset], data, first);
+    memcpy(&rb->Buffer[0], data + first, len - first);
+
+    rb->Head = head + len;
+    return len;
+}
+
+/**
+  * @brief  获取读位置起连续可读的数据 (供 DMA 直接发送)
+  * @param  rb: 环形缓冲区
+  * @param  data: 输出连续数据的首地址
+  * @retval 连续可读字节数
+  */
+uint16_t Ring_PeekContiguous(const RingBuffer_TypeDef *rb, uint8_t **data)
+{
+    uint16_t used = Ring_Used(rb);
+    uint16_t offset = rb->Tail & rb->Mask;
+    uint16_t toEnd = rb->Mask + 1 - offset;
+
+    *data = &rb->Buffer[offset];
+    return (used < toEnd) ? used : toEnd;
+}
+
+/**
+  * @brief  丢弃已读数据 (消费者调用)
+  * @param  rb: 环形缓冲区
+  * @param  len: 丢弃的字节数
+  * @retval 无
+  */
+void Ring_Skip(RingBuffer_TypeDef *rb, uint16_t len)
+{
+    rb->Tail = rb->Tail + len;
+}
+
+/**
+  * @brief  写入一个字节 (生产者调用, 供接收中断逐字节写入)
+  * @param  rb: 环形缓冲区
+  * @param  byte: 数据
+  * @retval 1: 已写入, 0: 缓冲区满
+  */
+uint8_t Ring_Put(RingBuffer_TypeDef *rb, uint8_t byte)
+{
+    uint16_t head = rb->Head;
+
+    if ((uint16_t)(head - rb->Tail) > rb->Mask)
+        return 0;
+    /* 经 volatile 写入, 保证数据先于 Head 可见 */
+    ((volatile uint8_t *)rb->Buffer)[head & rb->Mask] = byte;
+    rb->Head = head + 1;
+    return 1;
+}
+
+/**
+  * @brief  读出一个字节 (消费者调用)
+  * @param  rb: 环形缓冲区
+  * @param  byte: 输出数据
+  * @retval 1: 已读出, 0: 缓冲区空
+  */
+uint8_t Ring_Get(RingBuffer_TypeDef *rb, uint8_t *byte)
+{
+    uint16_t tail = rb->Tail;
+
+    if (rb->Head == tail)
+        return 0;
+    *byte = ((volatile uint8_t *)rb->Buffer)[tail & rb->Mask];
+    rb->Tail = tail + 1;
+    return 1;
+}
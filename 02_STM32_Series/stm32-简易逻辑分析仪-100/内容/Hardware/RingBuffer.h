@@ -0,0 +1,30 @@
+#ifndef __RINGBUFFER_H
+#define __RINGBUFFER_H
+
+#include <stdint.h>
+
+/*
+ * 字节环形缓冲区 (单生产者/单消费者, 无锁)
+ * - 容量必须为 2 的幂, 不超过 32768
+ * - Head 只由生产者修改, Tail 只由消费者修改, 两者均自由递增,
+ *   已用字节数 = Head - Tail (按 uint16_t 回绕)
+ * - 按 Serial.c 的方式分段排空的测试 (含模拟的发送 DMA) 见 Sim/SimRing.c
+ */
+typedef struct
+{
+    uint8_t *Buffer;            // 存储区
+    uint16_t Mask;              // 容量 - 1
+    volatile uint16_t Head;     // 写位置
+    volatile uint16_t Tail;     // 读位置
+} RingBuffer_TypeDef;
+
+void Ring_Init(RingBuffer_TypeDef *rb, uint8_t *buffer, uint16_t size);
+uint16_t Ring_Used(const RingBuffer_TypeDef *rb);
+uint16_t Ring_Free(const RingBuffer_TypeDef *rb);
+uint16_t Ring_Write(RingBuffer_TypeDef *rb, const uint8_t *data, uint16_t len);
+uint16_t Ring_PeekContiguous(const RingBuffer_TypeDef *rb, uint8_t **data);
+void Ring_Skip(RingBuffer_TypeDef *rb, uint16_t len);
+uint8_t Ring_Put(RingBuffer_TypeDef *rb, uint8_t byte);
+uint8_t Ring_Get(RingBuffer_TypeDef *rb, uint8_t *byte);
+
+#endif
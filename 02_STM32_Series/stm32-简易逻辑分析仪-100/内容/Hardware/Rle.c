@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    Rle.c
+  * @brief   采样数据游程编码 - 上传前压缩, 传输量随信号跳变次数而非采样数增长
+  * @note    编码格式见 Rle.h. 逻辑信号大部分时间电平不变, 一个游程只需 2-3 字节;
+  *          噪声等频繁跳变的数据会变大, 由调用方比较长度后决定是否改发原始数据.
+  *          固件只调用 RLE_Encode(); RLE_Decode() 供主机端测试核对, 上位机的解码
+  *          见 serial_link.py 的 rle_decode().
+  ******************************************************************************
+  */
+
+#include "Rle.h"
+
+/**
+  * @brief  游程编码
+  * @param  src: 原始样本
+  * @param  len: 样本数
+  * @param  dst: 输出缓冲区
+  * @param  dstSize: 输出缓冲区大小
+  * @retval 编码后字节数, 0 表示输出超过 dstSize (调用方应改发原始数据)
+  */
+uint32_t RLE_Encode(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t dstSize)
+{
+    const uint8_t *p = src;
+    const uint8_t *end = src + len;
+    uint32_t out = 0;
+    
+    while (p < end)
+    {
+        const uint8_t *run = p;
+        uint8_t value = *p++;
+        uint32_t count, need;
+        
+        while (p < end && *p == value)
+            p++;
+        count = p - run;
+        
+        /* 样本值 1 字节 + 长度每 7 位 1 字节 */
+        need = 2;
+        for (uint32_t c = count >> 7; c; c >>= 7)
+            need++;
+        if (out + need > dstSize)
+            return 0;
+        
+        dst[out++] = value;
+        while (count >= 0x80)
+        {
+            dst[out++] = (uint8_t)(count | 0x80);
+            count >>= 7;
+        }
+        dst[out++] = (uint8_t)count;
+    }
+    return out;
+}
+
+/**
+  * @brief  游程解码
+  * @param  src: 编码数据
+  * @param  len: 编码数据长度
+  * @param  dst: 输出缓冲区
+  * @param  dstSize: 输出缓冲区大小
+  * @retval 解码得到的样本数, 数据不完整或超出 dstSize 时只解出能放下的部分
+  */
+uint32_t RLE_Decode(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t dstSize)
+{
+    uint32_t in = 0;
+    uint32_t out = 0;
+    
+    while (in < len)
+    {
+        uint8_t value = src[in++];
+        uint32_t count = 0;
+        uint8_t shift = 0;
+        uint8_t b;
+        
+        do
+        {
+            if (in >= len || shift > 28)
+                return out;
+            b = src[in++];
+            count |= (uint32_t)(b & 0x7F) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        
+        while (count-- && out < dstSize)
+            dst[out++] = value;
+    }
+    return out;
+}
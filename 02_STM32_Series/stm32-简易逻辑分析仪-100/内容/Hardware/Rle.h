@@ -0,0 +1,17 @@
+#ifndef __RLE_H
+#define __RLE_H
+
+#include <stdint.h>
+
+/*
+ * 游程编码格式:
+ *  每个游程 = 样本值 (1字节) + 重复次数 (LEB128 变长整数, 每字节低7位有效,
+ *  bit7=1 表示后面还有字节, 低位组在前), 重复次数 >= 1.
+ *  1024 个样本以内的游程最多占 3 字节.
+ * 往返测试与压缩率统计见 Sim/SimRle.c
+ */
+
+uint32_t RLE_Encode(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t dstSize);
+uint32_t RLE_Decode(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t dstSize);
+
+#endif
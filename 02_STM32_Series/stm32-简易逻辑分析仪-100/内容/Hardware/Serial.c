@@ -2,7 +2,12 @@
   ******************************************************************************
   * @file    Serial.c
   * @brief   串口通信模块 - 用于逻辑分析仪与PC通信
-  * @note    基于USART1 (PA9-TX, PA10-RX), 波特率115200
+  * @note    基于USART1 (PA9-TX, PA10-RX), 上电波特率115200, 可用 BAUD 命令切换
+  *          发送: 数据先写入发送环形缓冲区, 由 DMA1 通道4 (USART1_TX) 在后台发出,
+  *                CPU 不再逐字节等待 TXE
+  *          接收: 中断只把字节写入接收环形缓冲区, 主循环用 Serial_GetLine() 取出整行,
+  *                因此连续发来的多条命令不会丢失. 缓冲区满时本行余下部分被丢弃,
+  *                并写入 SERIAL_RX_CANCEL 让主循环放弃已收到的半行
   ******************************************************************************
   */
 
@@ -11,12 +16,35 @@
 #include <stdarg.h>
 #include <string.h>
 #include "Serial.h"
+#include "RingBuffer.h"
 
-#define SERIAL_RX_BUF_SIZE  128     // 接收缓冲区大小
+#define SERIAL_RX_BUF_SIZE  256     // 接收环形缓冲区大小 (2 的幂)
+#define SERIAL_LINE_SIZE    128     // 一行命令的最大长度 (含结束符)
+#define SERIAL_RX_CANCEL    0x18    // 接收溢出标记 (CAN), 主循环见到后丢弃当前行
+#define SERIAL_TX_BUF_SIZE  1024    // 发送环形缓冲区大小 (2 的幂)
+#define SERIAL_PCLK         72000000    // USART1 时钟 (APB2)
+#define SERIAL_BAUD_TIMEOUT (SERIAL_PCLK * 2)   // 切换后等待 PING 的时间 (2s, DWT 周期)
 
-static char Serial_RxBuffer[SERIAL_RX_BUF_SIZE];   // 接收缓冲区
-static uint8_t Serial_RxIndex = 0;                 // 接收索引
-static uint8_t Serial_RxComplete = 0;              // 接收完成标志 (收到换行符)
+/* DWT 周期计数器 (所用 CMSIS 版本未定义 DWT 结构体) */
+#define SERIAL_DWT_CTRL     (*(volatile uint32_t *)0xE0001000)
+#define SERIAL_DWT_CYCCNT   (*(volatile uint32_t *)0xE0001004)
+
+static uint8_t Serial_TxStorage[SERIAL_TX_BUF_SIZE];
+static RingBuffer_TypeDef Serial_TxRing;           // 发送环形缓冲区
+static volatile uint16_t Serial_TxDmaLength = 0;   // 当前 DMA 正在发送的字节数 (0=空闲)
+static Serial_TxCallback Serial_TxDoneCallback = 0; // 发送完成回调
+
+static uint8_t Serial_RxStorage[SERIAL_RX_BUF_SIZE];
+static RingBuffer_TypeDef Serial_RxRing;           // 接收环形缓冲区 (中断写, 主循环读)
+static uint8_t Serial_RxDiscard = 0;               // 中断: 溢出后丢弃到行尾
+static char Serial_Line[SERIAL_LINE_SIZE];         // 主循环: 正在拼接的一行
+static uint8_t Serial_LineIndex = 0;
+static uint8_t Serial_LineTooLong = 0;             // 主循环: 本行超长, 丢弃到行尾
+static Serial_RxStats_TypeDef Serial_RxStats;      // 接收统计
+
+static uint16_t Serial_NextBrr = 0;                // 待切换的 BRR (0=无)
+static uint16_t Serial_PrevBrr = 0;                // 试用新波特率期间保存的原 BRR (0=不在试用期)
+static uint32_t Serial_BaudStart = 0;              // 切换时刻 (DWT)
 
 /**
   * @brief  串口初始化 (USART1, 115200-8-N-1)
@@ -53,6 +81,28 @@ void Serial_Init(void)
     USART_InitStructure.USART_WordLength = USART_WordLength_8b;
     USART_Init(USART1, &USART_InitStructure);
     
+    /* 发送 DMA 配置 (DMA1 通道4 对应 USART1_TX) */
+    Ring_Init(&Serial_RxRing, Serial_RxStorage, SERIAL_RX_BUF_SIZE);
+    Ring_Init(&Serial_TxRing, Serial_TxStorage, SERIAL_TX_BUF_SIZE);
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+    
+    DMA_InitTypeDef DMA_InitStructure;
+    DMA_DeInit(DMA1_Channel4);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&(USART1->DR);
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)Serial_TxStorage;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;                      // 内存到外设
+    DMA_InitStructure.DMA_BufferSize = 0;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;                   // 低于采样 DMA
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(DMA1_Channel4, &DMA_InitStructure);
+    DMA_ITConfig(DMA1_Channel4, DMA_IT_TC, ENABLE);
+    USART_DMACmd(USART1, USART_DMAReq_Tx, ENABLE);
+    
     /* 中断配置 */
     USART_ITConfig(USART1, USART_IT_RXNE, ENABLE);  // 开启接收中断
     
@@ -65,8 +115,183 @@ void Serial_Init(void)
     NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
     NVIC_Init(&NVIC_InitStructure);
     
+    NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel4_IRQn;
+    NVIC_Init(&NVIC_InitStructure);
+    
     /* 使能USART */
     USART_Cmd(USART1, ENABLE);
+    
+    /* 波特率切换的超时用 DWT 周期计数器计时 */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    SERIAL_DWT_CTRL |= 1;   // CYCCNTENA
+}
+
+/**
+  * @brief  计算波特率对应的 BRR
+  * @note   16 倍过采样时 BRR = PCLK / 波特率 (12 位整数 + 4 位小数), 四舍五入
+  * @param  Baud: 目标波特率
+  * @param  Brr: 输出 BRR
+  * @retval 实际波特率, 超出范围 (BRR < 16) 时为 0
+  */
+uint32_t Serial_BaudToBrr(uint32_t Baud, uint16_t *Brr)
+{
+    uint32_t div;
+    
+    if (Baud == 0)
+        return 0;
+    div = (SERIAL_PCLK + Baud / 2) / Baud;
+    if (div < 16 || div > 0xFFFF)
+        return 0;
+    *Brr = div;
+    return (SERIAL_PCLK + div / 2) / div;
+}
+
+/**
+  * @brief  当前实际波特率
+  * @param  无
+  * @retval 波特率
+  */
+uint32_t Serial_GetBaud(void)
+{
+    return (SERIAL_PCLK + USART1->BRR / 2) / USART1->BRR;
+}
+
+/**
+  * @brief  请求切换波特率, 由 Serial_BaudPoll() 在已排队的应答发完后切换
+  * @note   切换后 SERIAL_BAUD_TIMEOUT 内须调用 Serial_ConfirmBaud() (收到 PING),
+  *         否则恢复原波特率
+  * @param  Brr: 新 BRR (由 Serial_BaudToBrr 得到)
+  * @retval 无
+  */
+void Serial_RequestBaud(uint16_t Brr)
+{
+    Serial_NextBrr = Brr;
+}
+
+/**
+  * @brief  确认新波特率可用 (以新波特率收到了命令)
+  * @param  无
+  * @retval 无
+  */
+void Serial_ConfirmBaud(void)
+{
+    Serial_PrevBrr = 0;
+}
+
+/**
+  * @brief  丢弃已收到但未取走的字节和拼接中的半行 (主循环调用)
+  * @param  无
+  * @retval 无
+  */
+static void Serial_DiscardRx(void)
+{
+    Ring_Skip(&Serial_RxRing, Ring_Used(&Serial_RxRing));
+    Serial_LineIndex = 0;
+    Serial_LineTooLong = 0;
+}
+
+/**
+  * @brief  波特率切换与超时恢复 (主循环调用)
+  * @param  无
+  * @retval 无
+  */
+void Serial_BaudPoll(void)
+{
+    if (Serial_NextBrr)
+    {
+        /* 应答按原波特率发完再切换 (空闲时只有几十个字节) */
+        Serial_Flush();
+        if (!Serial_PrevBrr)
+            Serial_PrevBrr = USART1->BRR;
+        USART1->BRR = Serial_NextBrr;
+        Serial_NextBrr = 0;
+        Serial_BaudStart = SERIAL_DWT_CYCCNT;
+        Serial_DiscardRx();     // 丢弃切换时收到的不完整字节
+    }
+    else if (Serial_PrevBrr && SERIAL_DWT_CYCCNT - Serial_BaudStart > SERIAL_BAUD_TIMEOUT)
+    {
+        Serial_Flush();
+        USART1->BRR = Serial_PrevBrr;
+        Serial_PrevBrr = 0;
+        Serial_DiscardRx();
+        Serial_Printf("ERR: BAUD not confirmed, back to %u\r\n", Serial_GetBaud());
+    }
+}
+
+/**
+  * @brief  若 DMA 空闲且缓冲区有数据, 启动下一段发送
+  * @note   调用方需保证不被 DMA1 通道4 中断打断
+  * @param  无
+  * @retval 无
+  */
+static void Serial_TxKick(void)
+{
+    uint8_t *data;
+    uint16_t length;
+    
+    if (Serial_TxDmaLength != 0)
+        return;
+    
+    length = Ring_PeekContiguous(&Serial_TxRing, &data);
+    if (length == 0)
+        return;
+    
+    Serial_TxDmaLength = length;
+    DMA_Cmd(DMA1_Channel4, DISABLE);
+    DMA1_Channel4->CMAR = (uint32_t)data;
+    DMA1_Channel4->CNDTR = length;
+    DMA_Cmd(DMA1_Channel4, ENABLE);
+}
+
+/**
+  * @brief  非阻塞写入发送缓冲区
+  * @param  Data: 数据首地址
+  * @param  Length: 数据长度
+  * @retval 实际写入的字节数 (缓冲区满时小于 Length), 立即返回
+  */
+uint16_t Serial_Write(const uint8_t *Data, uint16_t Length)
+{
+    uint16_t written = Ring_Write(&Serial_TxRing, Data, Length);
+    
+    __disable_irq();
+    Serial_TxKick();
+    __enable_irq();
+    
+    return written;
+}
+
+/**
+  * @brief  设置发送完成回调 (缓冲区全部发出后在中断中调用)
+  * @note   回调在 DMA1 通道4 中断中执行, 此时发送缓冲区为空; 其中只能用
+  *         Serial_Write 追加数据 (不等待), 追加的数据发完后回调会再次执行.
+  *         最后一个字节可能还在移位寄存器中, 需要线路空闲时另查 USART TC 标志
+  * @param  Callback: 回调函数, 0 表示取消
+  * @retval 无
+  */
+void Serial_SetTxCallback(Serial_TxCallback Callback)
+{
+    Serial_TxDoneCallback = Callback;
+}
+
+/**
+  * @brief  查询是否还有数据未发送
+  * @param  无
+  * @retval 1: 发送中, 0: 空闲
+  */
+uint8_t Serial_IsTxBusy(void)
+{
+    return (Serial_TxDmaLength != 0 || Ring_Used(&Serial_TxRing) != 0);
+}
+
+/**
+  * @brief  等待发送缓冲区全部发出 (含移位寄存器中的最后一个字节)
+  * @param  无
+  * @retval 无
+  */
+void Serial_Flush(void)
+{
+    while (Serial_IsTxBusy());
+    while (USART_GetFlagStatus(USART1, USART_FLAG_TC) == RESET);
 }
 
 /**
@@ -76,21 +301,26 @@ void Serial_Init(void)
   */
 void Serial_SendByte(uint8_t Byte)
 {
-    USART_SendData(USART1, Byte);
-    while (USART_GetFlagStatus(USART1, USART_FLAG_TXE) == RESET);
+    Serial_SendArray(&Byte, 1);
 }
 
 /**
-  * @brief  发送数组
+  * @brief  发送数组 (写入发送缓冲区, 仅在缓冲区满时等待)
+  * @note   缓冲区满时忙等 DMA 发送完成中断腾出空间, 只能在主循环中调用:
+  *         在中断中调用会因 DMA1 通道4 中断无法进入而死等.
+  *         Serial_SendByte / Serial_SendString / Serial_Printf 同样如此,
+  *         中断中请用 Serial_Write (写不下的部分被丢弃)
   * @param  Array: 数组首地址
   * @param  Length: 数组长度
   * @retval 无
   */
 void Serial_SendArray(uint8_t *Array, uint16_t Length)
 {
-    for (uint16_t i = 0; i < Length; i++)
+    while (Length > 0)
     {
-        Serial_SendByte(Array[i]);
+        uint16_t written = Serial_Write(Array, Length);
+        Array += written;
+        Length -= written;
     }
 }
 
@@ -101,10 +331,7 @@ void Serial_SendArray(uint8_t *Array, uint16_t Length)
   */
 void Serial_SendString(char *String)
 {
-    while (*String)
-    {
-        Serial_SendByte(*String++);
-    }
+    Serial_SendArray((uint8_t *)String, strlen(String));
 }
 
 /**
@@ -123,43 +350,94 @@ void Serial_Printf(char *format, ...)
 }
 
 /**
-  * @brief  检查是否收到一行命令
+  * @brief  取出一行命令 (主循环调用, 不阻塞)
+  * @note   从接收缓冲区取走已到达的字节拼成一行, 空行被忽略.
+  *         超过 SERIAL_LINE_SIZE 的行整行丢弃并应答错误; 接收溢出的行整行丢弃
   * @param  无
-  * @retval 1: 收到完整命令, 0: 未收到
+  * @retval 以 '\0' 结尾的命令 (到下次调用前有效), 还没有完整的一行时为 0
   */
-uint8_t Serial_GetRxComplete(void)
+char *Serial_GetLine(void)
 {
-    if (Serial_RxComplete)
+    uint8_t data;
+    
+    while (Ring_Get(&Serial_RxRing, &data))
     {
-        Serial_RxComplete = 0;
-        return 1;
+        if (data == '\n' || data == '\r')
+        {
+            if (Serial_LineTooLong)
+            {
+                Serial_LineTooLong = 0;
+                Serial_RxStats.Dropped++;
+                Serial_SendString("ERR: Line too long\r\n");
+            }
+            else if (Serial_LineIndex > 0)
+            {
+                Serial_Line[Serial_LineIndex] = '\0';
+                Serial_LineIndex = 0;
+                Serial_RxStats.Lines++;
+                return Serial_Line;
+            }
+        }
+        else if (data == SERIAL_RX_CANCEL)
+        {
+            if (Serial_LineIndex > 0 || Serial_LineTooLong)
+                Serial_RxStats.Dropped++;
+            Serial_LineIndex = 0;
+            Serial_LineTooLong = 0;
+        }
+        else if (!Serial_LineTooLong)
+        {
+            if (Serial_LineIndex < SERIAL_LINE_SIZE - 1)
+            {
+                Serial_Line[Serial_LineIndex++] = data;
+            }
+            else
+            {
+                Serial_LineIndex = 0;
+                Serial_LineTooLong = 1;     // 丢弃到行尾
+            }
+        }
     }
     return 0;
 }
 
 /**
-  * @brief  获取接收缓冲区指针
-  * @param  无
-  * @retval 接收缓冲区首地址
+  * @brief  读取接收统计
+  * @param  Stats: 输出统计
+  * @retval 无
   */
-char* Serial_GetRxBuffer(void)
+void Serial_GetRxStats(Serial_RxStats_TypeDef *Stats)
 {
-    return Serial_RxBuffer;
+    *Stats = Serial_RxStats;
 }
 
 /**
-  * @brief  清空接收缓冲区
+  * @brief  DMA1 通道4 中断服务函数 (一段发送完成)
   * @param  无
   * @retval 无
   */
-void Serial_ClearRxBuffer(void)
+void DMA1_Channel4_IRQHandler(void)
 {
-    memset(Serial_RxBuffer, 0, SERIAL_RX_BUF_SIZE);
-    Serial_RxIndex = 0;
+    if (DMA_GetITStatus(DMA1_IT_TC4) == SET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_TC4);
+        
+        Ring_Skip(&Serial_TxRing, Serial_TxDmaLength);
+        Serial_TxDmaLength = 0;
+        Serial_TxKick();
+        
+        if (Serial_TxDmaLength == 0 && Serial_TxDoneCallback)
+        {
+            Serial_TxDoneCallback();
+        }
+    }
 }
 
 /**
   * @brief  USART1中断服务函数
+  * @note   只写接收环形缓冲区 (单生产者), 不处理命令.
+  *         缓冲区保留最后 1 字节给行结束符或 SERIAL_RX_CANCEL, 使半行总能被结束:
+  *         普通字节放不下时写入 SERIAL_RX_CANCEL, 之后丢弃到行尾
   * @param  无
   * @retval 无
   */
@@ -167,19 +445,33 @@ void USART1_IRQHandler(void)
 {
     if (USART_GetITStatus(USART1, USART_IT_RXNE) == SET)
     {
-        uint8_t data = USART_ReceiveData(USART1);
+        uint8_t data, eol;
+        uint16_t free;
         
-        if (data == '\n' || data == '\r')
+        if (USART_GetFlagStatus(USART1, USART_FLAG_ORE) == SET)
+            Serial_RxStats.Overrun++;       // 读 DR 时一并清除
+        
+        data = USART_ReceiveData(USART1);
+        eol = (data == '\n' || data == '\r');
+        free = Ring_Free(&Serial_RxRing);
+        
+        if (Serial_RxDiscard)
         {
-            if (Serial_RxIndex > 0)
-            {
-                Serial_RxBuffer[Serial_RxIndex] = '\0';
-                Serial_RxComplete = 1;
-            }
+            Serial_RxStats.Overflow++;
+            if (eol)
+                Serial_RxDiscard = 0;
+        }
+        else if (free >= 2 || (eol && free == 1))
+        {
+            Ring_Put(&Serial_RxRing, data);
         }
-        else if (Serial_RxIndex < SERIAL_RX_BUF_SIZE - 1)
+        else
         {
-            Serial_RxBuffer[Serial_RxIndex++] = data;
+            /* free 为 0 时最后一个字节必是行结束符或 CANCEL, 不会留下半行 */
+            Serial_RxStats.Overflow++;
+            if (free == 1)
+                Ring_Put(&Serial_RxRing, SERIAL_RX_CANCEL);
+            Serial_RxDiscard = !eol;
         }
         
         USART_ClearITPendingBit(USART1, USART_IT_RXNE);
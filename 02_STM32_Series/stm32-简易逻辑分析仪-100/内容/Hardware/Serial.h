@@ -3,14 +3,32 @@
 
 #include <stdint.h>
 
+typedef void (*Serial_TxCallback)(void);
+
+typedef struct
+{
+    uint32_t Lines;             // 取出的命令行数
+    uint32_t Overflow;          // 接收缓冲区满丢弃的字节数
+    uint32_t Overrun;           // 硬件溢出 (ORE) 次数, 中断来不及读 DR
+    uint32_t Dropped;           // 因溢出或超长而整行丢弃的行数
+} Serial_RxStats_TypeDef;
+
 void Serial_Init(void);
+uint32_t Serial_BaudToBrr(uint32_t Baud, uint16_t *Brr);
+uint32_t Serial_GetBaud(void);
+void Serial_RequestBaud(uint16_t Brr);
+void Serial_ConfirmBaud(void);
+void Serial_BaudPoll(void);
+uint16_t Serial_Write(const uint8_t *Data, uint16_t Length);
+void Serial_SetTxCallback(Serial_TxCallback Callback);
+uint8_t Serial_IsTxBusy(void);
+void Serial_Flush(void);
 void Serial_SendByte(uint8_t Byte);
 void Serial_SendArray(uint8_t *Array, uint16_t Length);
 void Serial_SendString(char *String);
 void Serial_Printf(char *format, ...);
 
-uint8_t Serial_GetRxComplete(void);
-char* Serial_GetRxBuffer(void);
-void Serial_ClearRxBuffer(void);
+char *Serial_GetLine(void);
+void Serial_GetRxStats(Serial_RxStats_TypeDef *Stats);
 
 #endif
@@ -0,0 +1,167 @@
+/**
+  ******************************************************************************
+  * @file    TrigMatch.c
+  * @brief   多通道触发匹配器 - 值/掩码匹配, 任意通道跳变, 两级顺序触发
+  * @note    样本值先经 256 项查找表得到状态A/B标志, 每个样本只需一次查表
+  *          和几次比较, 开销与掩码中的通道数无关.
+  *          由 DMA 半传输/传输完成中断按块调用 TM_Scan(), 跨块保持状态.
+  *          TM_Scan() 返回块内下标, 换算为采样缓冲区中的触发位置由调用方完成.
+  ******************************************************************************
+  */
+
+#include "TrigMatch.h"
+
+/**
+  * @brief  填充查找表
+  * @param  tm: 匹配器
+  * @param  valueA/maskA: 状态A
+  * @param  valueB/maskB: 状态B (maskB=0 且 valueB!=0 时表示不使用)
+  * @retval 无
+  */
+static void TM_BuildLut(TrigMatch_TypeDef *tm, uint8_t valueA, uint8_t maskA,
+                        uint8_t valueB, uint8_t maskB)
+{
+    for (uint16_t x = 0; x < 256; x++)
+    {
+        uint8_t hit = 0;
+        if ((x & maskA) == (valueA & maskA))
+            hit |= TM_HIT_A;
+        if ((x & maskB) == valueB)
+            hit |= TM_HIT_B;
+        tm->Lut[x] = hit;
+    }
+}
+
+/**
+  * @brief  初始化为值/掩码匹配
+  * @param  tm: 匹配器
+  * @param  value: 匹配值
+  * @param  mask: 参与比较的通道
+  * @note   在样本从不匹配变为匹配时触发, 已处于匹配状态时不会重复触发
+  * @retval 无
+  */
+void TM_InitPattern(TrigMatch_TypeDef *tm, uint8_t value, uint8_t mask)
+{
+    /* valueB 取 mask 之外的位, 使状态B永不成立 */
+    TM_BuildLut(tm, value, mask, 0x01, 0x00);
+    tm->Mode = TM_MODE_PATTERN;
+    tm->EdgeMask = 0;
+    tm->Window = 0;
+    TM_Reset(tm, 0);
+}
+
+/**
+  * @brief  初始化为任意通道跳变匹配
+  * @param  tm: 匹配器
+  * @param  mask: 检测跳变的通道, 其中任一通道电平变化即触发
+  * @retval 无
+  */
+void TM_InitAnyEdge(TrigMatch_TypeDef *tm, uint8_t mask)
+{
+    TM_BuildLut(tm, 0x01, 0x00, 0x01, 0x00);
+    tm->Mode = TM_MODE_ANYEDGE;
+    tm->EdgeMask = mask;
+    tm->Window = 0;
+    TM_Reset(tm, 0);
+}
+
+/**
+  * @brief  初始化为两级顺序触发
+  * @param  tm: 匹配器
+  * @param  valueA/maskA: 第一级状态
+  * @param  valueB/maskB: 第二级状态
+  * @param  window: 状态A之后的 window 个样本内出现状态B即触发 (0 按 1 处理)
+  * @note   触发点为状态B所在样本; 窗口内再次出现状态A时重新计时
+  * @retval 无
+  */
+void TM_InitSequence(TrigMatch_TypeDef *tm, uint8_t valueA, uint8_t maskA,
+                     uint8_t valueB, uint8_t maskB, uint16_t window)
+{
+    TM_BuildLut(tm, valueA, maskA, valueB & maskB, maskB);
+    tm->Mode = TM_MODE_SEQUENCE;
+    tm->EdgeMask = 0;
+    tm->Window = window ? window : 1;
+    TM_Reset(tm, 0);
+}
+
+/**
+  * @brief  清除匹配过程状态 (保留匹配条件)
+  * @param  tm: 匹配器
+  * @param  holdoff: 开头需跳过的样本数 (如触发前样本数), 期间只更新状态
+  * @retval 无
+  */
+void TM_Reset(TrigMatch_TypeDef *tm, uint32_t holdoff)
+{
+    tm->Prev = 0;
+    tm->PrevHit = 0;
+    tm->HavePrev = 0;
+    tm->Countdown = 0;
+    tm->Holdoff = holdoff;
+}
+
+/**
+  * @brief  处理一个样本
+  * @param  tm: 匹配器
+  * @param  x: 样本值
+  * @retval 1: 该样本满足触发条件, 0: 否
+  */
+static inline uint8_t TM_Step(TrigMatch_TypeDef *tm, uint8_t x)
+{
+    uint8_t hit = tm->Lut[x];
+    uint8_t match = 0;
+
+    switch (tm->Mode)
+    {
+    case TM_MODE_PATTERN:
+        /* 第一个样本没有前值, 直接匹配也算进入 */
+        match = (hit & TM_HIT_A) && !(tm->PrevHit & TM_HIT_A);
+        break;
+
+    case TM_MODE_ANYEDGE:
+        match = tm->HavePrev && ((x ^ tm->Prev) & tm->EdgeMask);
+        break;
+
+    default:
+        /* 先判状态B再判状态A, 保证B严格在A之后 */
+        if (tm->Countdown)
+        {
+            match = (hit & TM_HIT_B) != 0;
+            tm->Countdown--;
+        }
+        if (hit & TM_HIT_A)
+            tm->Countdown = tm->Window;
+        break;
+    }
+
+    tm->Prev = x;
+    tm->PrevHit = hit;
+    tm->HavePrev = 1;
+    return match;
+}
+
+/**
+  * @brief  扫描一段连续样本
+  * @param  tm: 匹配器
+  * @param  buf: 样本首地址
+  * @param  len: 样本数
+  * @note   找到匹配即返回, 其后的样本未处理; 未找到时状态延续到下一段
+  * @retval 第一个触发样本在 buf 中的下标, -1 表示未触发
+  */
+int32_t TM_Scan(TrigMatch_TypeDef *tm, const uint8_t *buf, uint16_t len)
+{
+    uint16_t i = 0;
+
+    /* 跳过期: 只跟踪状态 */
+    while (i < len && tm->Holdoff)
+    {
+        TM_Step(tm, buf[i++]);
+        tm->Holdoff--;
+    }
+
+    for (; i < len; i++)
+    {
+        if (TM_Step(tm, buf[i]))
+            return i;
+    }
+    return -1;
+}
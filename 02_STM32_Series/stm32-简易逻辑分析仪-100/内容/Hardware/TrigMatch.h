@@ -0,0 +1,36 @@
+#ifndef __TRIGMATCH_H
+#define __TRIGMATCH_H
+
+#include <stdint.h>
+
+/* 匹配方式 */
+#define TM_MODE_PATTERN     0       // 值/掩码匹配: 进入 (x & mask) == value 状态的第一个样本
+#define TM_MODE_ANYEDGE     1       // 掩码内任一通道发生跳变
+#define TM_MODE_SEQUENCE    2       // 先出现状态A, 之后 N 个样本内出现状态B
+
+/* 查找表中每个样本值的标志位 */
+#define TM_HIT_A            0x01
+#define TM_HIT_B            0x02
+
+/* 多通道触发匹配器 - 与逐位参考实现比较的测试见 Sim/SimTrigMatch.c */
+typedef struct
+{
+    uint8_t  Lut[256];      // 样本值 -> TM_HIT_A / TM_HIT_B
+    uint8_t  Mode;          // 匹配方式 TM_MODE_xxx
+    uint8_t  EdgeMask;      // ANYEDGE: 检测跳变的通道
+    uint8_t  Prev;          // 上一个样本
+    uint8_t  PrevHit;       // 上一个样本的查找表标志 (PATTERN 用于检测进入匹配)
+    uint8_t  HavePrev;      // Prev 是否有效
+    uint16_t Window;        // SEQUENCE: 状态A之后允许的样本数
+    uint16_t Countdown;     // SEQUENCE: 剩余可匹配状态B的样本数, 0=未见到A
+    uint32_t Holdoff;       // 还需跳过的样本数, 期间只更新状态不报告匹配
+} TrigMatch_TypeDef;
+
+void TM_InitPattern(TrigMatch_TypeDef *tm, uint8_t value, uint8_t mask);
+void TM_InitAnyEdge(TrigMatch_TypeDef *tm, uint8_t mask);
+void TM_InitSequence(TrigMatch_TypeDef *tm, uint8_t valueA, uint8_t maskA,
+                     uint8_t valueB, uint8_t maskB, uint16_t window);
+void TM_Reset(TrigMatch_TypeDef *tm, uint32_t holdoff);
+int32_t TM_Scan(TrigMatch_TypeDef *tm, const uint8_t *buf, uint16_t len);
+
+#endif
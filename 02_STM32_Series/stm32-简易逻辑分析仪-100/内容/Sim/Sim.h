@@ -0,0 +1,45 @@
+#ifndef __SIM_H
+#define __SIM_H
+
+#include <stdint.h>
+
+/*
+ * 主机端硬件在环模拟器 (Linux)
+ *
+ * 固件源码和标准外设库不做修改, 在 PC 上编译运行:
+ * - 外设 (0x40000000)、SRAM (0x20000000)、内核外设 (0xE0000000) 三段地址用 mmap
+ *   映射到进程中的同一地址, 固件和外设库照常读写寄存器
+ * - 定时信号 (SIGALRM) 相当于时钟: 每次推进一段虚拟时间, 按时间顺序模拟
+ *   TIM2/TIM4/TIM5、DMA1、USART1、EXTI 和 GPIOA 输入, 再像 NVIC 一样调用中断服务函数
+ * - __disable_irq / __enable_irq 屏蔽/开放该信号, 与 PRIMASK 的作用一致
+ * - USART1 的收发接到伪终端 (pty), 上位机直接连接
+ *
+ * 虚拟时间以 72MHz 时钟周期计. 固件代码本身的执行不占虚拟时间.
+ */
+
+#define SIM_CLOCK           72000000    // 系统/定时器时钟 (Hz)
+
+/* SimCore.c */
+extern volatile uint64_t Sim_Now;       // 当前虚拟时间 (周期)
+extern int Sim_PtyFd;                   // 伪终端主端
+
+void Sim_DisableIrq(void);
+void Sim_EnableIrq(void);
+void Sim_Wfi(void);
+void Sim_Dispatch(void);
+
+/* SimPeriph.c */
+void Sim_PeriphReset(void);
+void Sim_PeriphSync(void);
+uint64_t Sim_PeriphNextEvent(void);
+void Sim_PeriphRun(uint64_t t);
+void Sim_PeriphPoll(void);
+int Sim_IrqLevel(int irq);
+
+/* SimWave.c - GPIOA 输入波形 */
+int Sim_WaveLoad(const char *path);
+void Sim_WaveDefault(void);
+uint8_t Sim_WaveAt(uint64_t t);
+uint64_t Sim_WaveNextChange(uint64_t t);
+
+#endif
@@ -0,0 +1,285 @@
+/**
+  ******************************************************************************
+  * @file    SimCapState.c
+  * @brief   采样状态机测试 - 用模拟事件检查 Hardware/CapState.c
+  * @note    用法: ./capstate_test [-v]
+  *          - 转移表: 5 个状态 x 6 个事件逐一检查接受/拒绝、新状态和
+  *            Result / Notify / Triggered; 被拒绝的事件不改变任何字段
+  *          - 场景: 采样中 SEND (UPLOAD) 被拒绝, IDLE 下 ABORT 被拒绝,
+  *            超时 (一直未触发, 主循环 ABORT 后迟到的 TRIGGER / FULL 被忽略)
+  *          - 随机事件序列与下面的转移表模型逐步比较, 并检查 CS_IsBusy / CS_TakeDone
+  *          全部通过时退出码为 0, 否则为 1
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "CapState.h"
+
+#define STATES          5
+#define EVENTS          6
+#define STEPS           1000000
+
+static int Verbose;
+static int Fail;
+
+static const char *const EventName[EVENTS] = {"START", "TRIGGER", "FULL", "ABORT", "UPLOAD", "SENT"};
+
+/* 合法转移, -1 表示该事件在此状态下被忽略 */
+static const int8_t Next[STATES][EVENTS] = {
+    /*               START      TRIGGER       FULL     ABORT    UPLOAD        SENT */
+    /* IDLE */      {CS_ARMED,  -1,           -1,      -1,      -1,           -1},
+    /* ARMED */     {-1,        CS_TRIGGERED, CS_DONE, CS_DONE, -1,           -1},
+    /* TRIGGERED */ {-1,        -1,           CS_DONE, CS_DONE, -1,           -1},
+    /* DONE */      {CS_ARMED,  -1,           -1,      -1,      CS_UPLOADING, -1},
+    /* UPLOADING */ {-1,        -1,           -1,      -1,      -1,           CS_DONE},
+};
+
+/* 伪随机数 (结果可重复) */
+static uint32_t Rand(void)
+{
+    static uint32_t x = 12345;
+    x = x * 1103515245 + 12345;
+    return x >> 8;
+}
+
+/* 模型: 按转移表和各事件的附带动作更新, 返回是否接受 */
+static uint8_t Model(CapState_TypeDef *m, uint8_t event)
+{
+    int8_t next = Next[m->State][event];
+
+    if (next < 0)
+        return 0;
+    if (event == CS_EV_START)
+    {
+        m->Result = CS_RESULT_NONE;
+        m->Notify = 0;
+        m->Triggered = 0;
+    }
+    else if (event == CS_EV_TRIGGER)
+        m->Triggered = 1;
+    else if (event == CS_EV_FULL)
+    {
+        m->Result = CS_RESULT_FULL;
+        m->Notify = 1;
+    }
+    else if (event == CS_EV_ABORT)
+        m->Result = CS_RESULT_ABORTED;
+    m->State = next;
+    return 1;
+}
+
+static int Same(const CapState_TypeDef *a, const CapState_TypeDef *b)
+{
+    return a->State == b->State && a->Result == b->Result &&
+           a->Notify == b->Notify && a->Triggered == b->Triggered;
+}
+
+static void Show(const char *what, const CapState_TypeDef *cs)
+{
+    printf("  %s: %s result %u notify %u triggered %u\n",
+           what, CS_Name(cs->State), cs->Result, cs->Notify, cs->Triggered);
+}
+
+/* 从 IDLE 出发用合法事件到达 state; via_abort 时 DONE 由 ABORT 进入 */
+static void Reach(CapState_TypeDef *cs, uint8_t state, int via_abort)
+{
+    CS_Init(cs);
+    if (state == CS_IDLE)
+        return;
+    CS_Event(cs, CS_EV_START);
+    if (state == CS_TRIGGERED)
+        CS_Event(cs, CS_EV_TRIGGER);
+    if (state >= CS_DONE)
+        CS_Event(cs, via_abort ? CS_EV_ABORT : CS_EV_FULL);
+    if (state == CS_UPLOADING)
+        CS_Event(cs, CS_EV_UPLOAD);
+}
+
+/* 转移表: 每个状态 (DONE / UPLOADING 各含采满和中止两种来历) 下的每个事件 */
+static void Table(void)
+{
+    int bad = 0, legal = 0;
+
+    for (uint8_t s = 0; s < STATES; s++)
+        for (int via_abort = 0; via_abort < (s >= CS_DONE ? 2 : 1); via_abort++)
+            for (uint8_t e = 0; e < EVENTS; e++)
+            {
+                CapState_TypeDef cs, want;
+                uint8_t ok;
+
+                Reach(&cs, s, via_abort);
+                if (cs.State != s)
+                {
+                    printf("  cannot reach %s\n", CS_Name(s));
+                    bad++;
+                    break;
+                }
+                want = cs;
+                ok = CS_Event(&cs, e);
+                if (ok != Model(&want, e) || !Same(&cs, &want))
+                {
+                    printf("  %s%s + %s: %s, expected %s\n", CS_Name(s), via_abort ? " (aborted)" : "",
+                           EventName[e], ok ? "accepted" : "ignored",
+                           Next[s][e] < 0 ? "ignored" : CS_Name(Next[s][e]));
+                    Show("got", &cs);
+                    Show("want", &want);
+                    bad++;
+                }
+                legal += ok && !via_abort;
+            }
+    if (Verbose)
+        printf("  %d legal transitions\n", legal);
+    printf("%-10s %2d legal transitions  %s\n", "table", legal, bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+static int Expect(const char *name, int cond, const char *what)
+{
+    if (cond)
+        return 0;
+    printf("  %s: %s\n", name, what);
+    return 1;
+}
+
+/* 采样中 SEND: UPLOAD 被拒绝, 采样继续, 采满后才能发送 */
+static void SendWhileArmed(void)
+{
+    CapState_TypeDef cs;
+    int bad = 0;
+
+    CS_Init(&cs);
+    CS_Event(&cs, CS_EV_START);
+    bad += Expect("send", !CS_Event(&cs, CS_EV_UPLOAD), "UPLOAD accepted while ARMED");
+    bad += Expect("send", !CS_Event(&cs, CS_EV_SENT), "SENT accepted while ARMED");
+    bad += Expect("send", cs.State == CS_ARMED && CS_IsBusy(&cs), "capture no longer ARMED");
+    CS_Event(&cs, CS_EV_TRIGGER);
+    bad += Expect("send", !CS_Event(&cs, CS_EV_UPLOAD), "UPLOAD accepted while TRIGGERED");
+    bad += Expect("send", !CS_Event(&cs, CS_EV_START), "START accepted while TRIGGERED");
+    CS_Event(&cs, CS_EV_FULL);
+    bad += Expect("send", !CS_IsBusy(&cs) && CS_Event(&cs, CS_EV_UPLOAD), "UPLOAD refused after FULL");
+    bad += Expect("send", CS_Event(&cs, CS_EV_SENT) && cs.State == CS_DONE, "not DONE after SENT");
+    printf("%-10s %s\n", "send", bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+/* IDLE 下 ABORT: 被拒绝, 不产生结果; DONE / UPLOADING 下同样被拒绝 */
+static void AbortIdle(void)
+{
+    CapState_TypeDef cs;
+    int bad = 0;
+
+    CS_Init(&cs);
+    bad += Expect("abort", !CS_Event(&cs, CS_EV_ABORT), "ABORT accepted while IDLE");
+    bad += Expect("abort", cs.State == CS_IDLE && cs.Result == CS_RESULT_NONE, "IDLE changed by ABORT");
+    bad += Expect("abort", !CS_Event(&cs, CS_EV_UPLOAD), "UPLOAD accepted while IDLE (no data)");
+    Reach(&cs, CS_DONE, 0);
+    bad += Expect("abort", !CS_Event(&cs, CS_EV_ABORT) && cs.Result == CS_RESULT_FULL,
+                  "ABORT changed a finished capture");
+    Reach(&cs, CS_UPLOADING, 0);
+    bad += Expect("abort", !CS_Event(&cs, CS_EV_ABORT) && cs.State == CS_UPLOADING,
+                  "ABORT interrupted an upload");
+    printf("%-10s %s\n", "abort", bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+/*
+ * 超时: 状态机本身没有定时器, 一直等不到触发时停在 ARMED; 上位机超时后发 ABORT.
+ * 中止后迟到的 TRIGGER / FULL (中断与 ABORT 同时发生) 不得改写结果或发出采满通知
+ */
+static void Timeout(void)
+{
+    CapState_TypeDef cs;
+    int bad = 0;
+
+    CS_Init(&cs);
+    CS_Event(&cs, CS_EV_START);
+    for (int i = 0; i < 1000; i++)
+        bad += Expect("timeout", !CS_TakeDone(&cs) && cs.State == CS_ARMED, "left ARMED without an event");
+    bad += Expect("timeout", CS_Event(&cs, CS_EV_ABORT), "ABORT refused while ARMED");
+    bad += Expect("timeout", !CS_Event(&cs, CS_EV_TRIGGER), "late TRIGGER accepted");
+    bad += Expect("timeout", !CS_Event(&cs, CS_EV_FULL), "late FULL accepted");
+    bad += Expect("timeout", cs.State == CS_DONE && cs.Result == CS_RESULT_ABORTED && !cs.Triggered,
+                  "aborted result overwritten");
+    bad += Expect("timeout", !CS_TakeDone(&cs), "abort reported as capture complete");
+    // 触发后、采满前超时
+    CS_Event(&cs, CS_EV_START);
+    CS_Event(&cs, CS_EV_TRIGGER);
+    bad += Expect("timeout", CS_Event(&cs, CS_EV_ABORT) && cs.Triggered && !CS_Event(&cs, CS_EV_FULL),
+                  "abort after trigger");
+    bad += Expect("timeout", !CS_TakeDone(&cs) && CS_Event(&cs, CS_EV_UPLOAD), "aborted data not sendable");
+    printf("%-10s %s\n", "timeout", bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+/* 随机事件序列, 逐步与模型比较 */
+static void Random(void)
+{
+    CapState_TypeDef cs, m;
+    uint32_t accepted = 0, done = 0, notified = 0;
+    int bad = 0;
+
+    CS_Init(&cs);
+    CS_Init(&m);
+    for (uint32_t i = 0; i < STEPS && bad < 5; i++)
+    {
+        uint8_t e = Rand() % EVENTS, ok;
+        uint8_t from = cs.State;
+
+        ok = CS_Event(&cs, e);
+        if (ok != Model(&m, e) || !Same(&cs, &m))
+        {
+            printf("  step %u: %s + %s\n", i, CS_Name(from), EventName[e]);
+            Show("got", &cs);
+            Show("want", &m);
+            bad++;
+            cs = m;
+        }
+        accepted += ok;
+        done += ok && e == CS_EV_FULL;
+        if (CS_IsBusy(&cs) != (cs.State == CS_ARMED || cs.State == CS_TRIGGERED))
+            bad++;
+        if (Rand() % 4 == 0)
+        {
+            uint8_t n = CS_TakeDone(&cs);
+
+            if (n != m.Notify || CS_TakeDone(&cs))
+            {
+                printf("  step %u: TakeDone %u, notify was %u\n", i, n, m.Notify);
+                bad++;
+            }
+            notified += n;
+            m.Notify = 0;
+        }
+    }
+    if (Verbose)
+        printf("  random: %u accepted, %u FULL, %u notifications taken\n", accepted, done, notified);
+    printf("%-10s %7u events  %s\n", "random", STEPS, bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v")) != -1)
+    {
+        if (opt == 'v')
+            Verbose = 1;
+        else
+        {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Table();
+    SendWhileArmed();
+    AbortIdle();
+    Timeout();
+    Random();
+
+    printf(Fail ? "FAIL\n" : "PASS\n");
+    return Fail ? 1 : 0;
+}
@@ -0,0 +1,579 @@
+/**
+  ******************************************************************************
+  * @file    SimCommand.c
+  * @brief   命令解析测试 - Hardware/CommandParser.c 接桩函数单独运行
+  * @note    用法: ./command_test [-v] [-n 随机轮数]
+  *          LA_xxx / Measure_xxx / Serial_xxx 换成下面的桩函数: 设置类函数把参数
+  *          记入调用记录, 串口输出写入缓冲区. 检查:
+  *          - 用例表: 每行命令的调用记录和应答逐字比较, 含数值格式 (十进制、
+  *            前导 0 仍为十进制、0x/0X 十六进制、越界、溢出)、参数个数、
+  *            ';' 分隔与出错后跳过、采样中 BUSY
+  *          - 数值: 随机数字串交给 COUNT, 与参考实现比较接受与否和数值
+  *          - 随机命令行 (关键字、数字、杂乱字节、空白、';' 随机组合): 不崩溃
+  *            (用 -fsanitize=address 编译可检查越界), 每条非空命令恰好一行应答, 出错之后的均为 ERR: SKIPPED, 返回值与之一致
+  *          全部通过时退出码为 0, 否则为 1
+  ******************************************************************************
+  */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "CommandParser.h"
+#include "LogicAnalyzer.h"
+#include "CapState.h"
+#include "Measure.h"
+#include "Serial.h"
+
+#define OUT_SIZE        8192
+#define LINE_MAX        200
+#define MAX_COUNT       20000               // 桩函数报告的 MAXCOUNT
+
+static int Verbose;
+static int Fail;
+
+/* 伪随机数 (结果可重复) */
+static uint32_t Rand(void)
+{
+    static uint32_t x = 12345;
+    x = x * 1103515245 + 12345;
+    return x >> 8;
+}
+
+/* ------------------------------------------------------------------ 桩函数 */
+
+static char Out[OUT_SIZE];                  // 串口输出
+static char Calls[OUT_SIZE];                // 调用记录, 每次一行
+
+static struct
+{
+    uint8_t State;                          // CS_xxx, ARMED / TRIGGERED 时为 BUSY
+    uint8_t Streaming;
+    uint8_t Turbo;
+    uint8_t Mask;
+    uint8_t TrigEnabled;
+    uint8_t MeasPin;
+    uint8_t Mode;
+    uint32_t Count;
+    uint32_t Overrun;                       // 打包采样被覆盖的样本数
+} Dev;
+
+static void Append(char *buf, const char *format, va_list ap)
+{
+    size_t len = strlen(buf);
+    vsnprintf(buf + len, OUT_SIZE - len, format, ap);
+}
+
+static void Call(const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    Append(Calls, format, ap);
+    va_end(ap);
+    strcat(Calls, "\n");
+}
+
+void Serial_Printf(char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    Append(Out, format, ap);
+    va_end(ap);
+}
+
+void Serial_SendString(char *String)
+{
+    strncat(Out, String, OUT_SIZE - strlen(Out) - 1);
+}
+
+uint32_t Serial_BaudToBrr(uint32_t Baud, uint16_t *Brr)
+{
+    uint32_t brr = (72000000 + Baud / 2) / Baud;
+
+    *Brr = brr > 0xFFFF ? 0xFFFF : brr;
+    return 72000000 / *Brr;
+}
+
+void Serial_RequestBaud(uint16_t Brr) { Call("RequestBaud %u", Brr); }
+void Serial_ConfirmBaud(void) { Call("ConfirmBaud"); }
+void Serial_GetRxStats(Serial_RxStats_TypeDef *Stats) { memset(Stats, 0, sizeof(*Stats)); }
+
+void LA_SetSampleRate(uint16_t psc, uint16_t arr) { Call("SetSampleRate %u %u", psc, arr); }
+uint32_t LA_SetSampleRateHz(uint32_t hz) { Call("SetSampleRateHz %u", hz); return hz; }
+uint32_t LA_SetTurbo(void) { Call("SetTurbo"); Dev.Turbo = 1; return 24000000; }
+uint8_t LA_IsTurbo(void) { return Dev.Turbo; }
+void LA_SetSampleCount(uint32_t count) { Call("SetSampleCount %u", count); Dev.Count = count; }
+uint32_t LA_GetSampleCount(void) { return Dev.Count; }
+uint32_t LA_GetMaxSampleCount(void) { return MAX_COUNT; }
+void LA_SetChannelMask(uint8_t mask) { Call("SetChannelMask 0x%02X", mask); Dev.Mask = mask; }
+uint8_t LA_GetChannelMask(void) { return Dev.Mask; }
+void LA_SetTrigger(uint8_t pin, uint8_t edge) { Call("SetTrigger %u %u", pin, edge); }
+void LA_SetPatternTrigger(uint8_t value, uint8_t mask) { Call("SetPatternTrigger 0x%02X 0x%02X", value, mask); }
+void LA_SetAnyEdgeTrigger(uint8_t mask) { Call("SetAnyEdgeTrigger 0x%02X", mask); }
+void LA_SetSequenceTrigger(uint8_t valueA, uint8_t maskA, uint8_t valueB, uint8_t maskB, uint16_t window)
+{
+    Call("SetSequenceTrigger 0x%02X 0x%02X 0x%02X 0x%02X %u", valueA, maskA, valueB, maskB, window);
+}
+uint8_t LA_IsTriggerEnabled(void) { return Dev.TrigEnabled; }
+void LA_SetTriggerPosition(uint8_t percent) { Call("SetTriggerPosition %u", percent); }
+uint8_t LA_GetTriggerPosition(void) { return 50; }
+void LA_DisableTrigger(void) { Call("DisableTrigger"); }
+void LA_SetOutputMode(uint8_t mode) { Call("SetOutputMode %u", mode); Dev.Mode = mode; }
+uint8_t LA_GetOutputMode(void) { return Dev.Mode; }
+void LA_SetCompression(uint8_t enable) { Call("SetCompression %u", enable); }
+uint8_t LA_GetCompression(void) { return 1; }
+uint8_t LA_StartCapture(void) { Call("StartCapture"); return 1; }
+uint8_t LA_IsCaptureComplete(void) { return Dev.State == CS_DONE; }
+uint8_t LA_IsBusy(void) { return Dev.State == CS_ARMED || Dev.State == CS_TRIGGERED; }
+uint8_t LA_GetState(void) { return Dev.State; }
+uint8_t LA_GetResult(void) { return CS_RESULT_FULL; }
+uint32_t LA_GetOverrunCount(void) { return Dev.Overrun; }
+uint32_t LA_GetReferenceRate(void) { return 1000; }
+uint8_t LA_StartCalibration(uint8_t pin) { Call("StartCalibration %u", pin); return 1; }
+void LA_StartStream(void) { Call("StartStream"); }
+void LA_StopStream(void) { Call("StopStream"); }
+uint8_t LA_IsStreaming(void) { return Dev.Streaming; }
+uint32_t LA_GetDroppedCount(void) { return 0; }
+
+uint8_t LA_Abort(void)
+{
+    Call("Abort");
+    return LA_IsBusy();
+}
+
+/* 实际发送一帧数据, 这里用一行代替 */
+void LA_SendData(void)
+{
+    Call("SendData");
+    Serial_SendString("DATA\r\n");
+}
+
+uint8_t Measure_Start(uint8_t pin, uint16_t intervalMs) { Call("MeasureStart %u %u", pin, intervalMs); return 1; }
+void Measure_Stop(void) { Call("MeasureStop"); }
+uint8_t Measure_GetPin(void) { return Dev.MeasPin; }
+
+static void Reset(uint8_t state)
+{
+    memset(&Dev, 0, sizeof(Dev));
+    Dev.State = state;
+    Dev.Mask = 0xFF;
+    Dev.MeasPin = MEAS_OFF;
+    Dev.Mode = LA_MODE_BIN;
+    Out[0] = '\0';
+    Calls[0] = '\0';
+}
+
+/* 在恰好够用的堆缓冲区中执行一行命令 */
+static int Run(const char *line)
+{
+    size_t len = strlen(line);
+    char *buf = malloc(len + 1);
+    int result;
+
+    memcpy(buf, line, len + 1);
+    result = CMD_Parse(buf);
+    free(buf);
+    return result;
+}
+
+/* ------------------------------------------------------------------ 用例表 */
+
+typedef struct
+{
+    uint8_t State;                          // 执行时的采样状态
+    const char *Line;                       // 命令行
+    const char *Calls;                      // 期望的调用记录
+    const char *Out;                        // 期望的应答
+} Case_TypeDef;
+
+static const Case_TypeDef Cases[] = {
+    /* 数值格式 */
+    {CS_IDLE, "COUNT 4096", "SetSampleCount 4096\n", "OK: COUNT=4096 MAXCOUNT=20000\r\n"},
+    {CS_IDLE, "COUNT 010", "SetSampleCount 10\n", "OK: COUNT=10 MAXCOUNT=20000\r\n"},
+    {CS_IDLE, "COUNT 08", "SetSampleCount 8\n", "OK: COUNT=8 MAXCOUNT=20000\r\n"},
+    {CS_IDLE, "COUNT 0009", "SetSampleCount 9\n", "OK: COUNT=9 MAXCOUNT=20000\r\n"},
+    {CS_IDLE, "COUNT 0x10", "SetSampleCount 16\n", "OK: COUNT=16 MAXCOUNT=20000\r\n"},
+    {CS_IDLE, "COUNT 0X1f", "SetSampleCount 31\n", "OK: COUNT=31 MAXCOUNT=20000\r\n"},
+    {CS_IDLE, "COUNT 0x0010", "SetSampleCount 16\n", "OK: COUNT=16 MAXCOUNT=20000\r\n"},
+    {CS_IDLE, "COUNT 4294967295", "SetSampleCount 4294967295\n", "OK: COUNT=4294967295 MAXCOUNT=20000\r\n"},
+    {CS_IDLE, "COUNT 0xFFFFFFFF", "SetSampleCount 4294967295\n", "OK: COUNT=4294967295 MAXCOUNT=20000\r\n"},
+    {CS_IDLE, "COUNT 4294967296", "", "ERR: Bad value '4294967296' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT 0x100000000", "", "ERR: Bad value '0x100000000' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT 99999999999999999999999", "", "ERR: Bad value '99999999999999999999999' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT 0", "", "ERR: Bad value '0' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT 00", "", "ERR: Bad value '00' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT 0x", "", "ERR: Bad value '0x' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT 0x-1", "", "ERR: Bad value '0x-1' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT 0x+1", "", "ERR: Bad value '0x+1' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT 0xg", "", "ERR: Bad value '0xg' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT x10", "", "ERR: Bad value 'x10' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT -1", "", "ERR: Bad value '-1' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT +1", "", "ERR: Bad value '+1' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT 1e3", "", "ERR: Bad value '1e3' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT 10a", "", "ERR: Bad value '10a' (1-4294967295)\r\n"},
+    {CS_IDLE, "COUNT 0b101", "", "ERR: Bad value '0b101' (1-4294967295)\r\n"},
+    {CS_IDLE, "CHAN 0377", "", "ERR: Bad value '0377' (1-255)\r\n"},
+    {CS_IDLE, "CHAN 0xF0", "SetChannelMask 0xF0\n", "OK: CHAN=0xF0 MAXCOUNT=20000 COUNT=0\r\n"},
+    {CS_IDLE, "CHAN 0x100", "", "ERR: Bad value '0x100' (1-255)\r\n"},
+    {CS_IDLE, "RATE 010 071", "SetSampleRate 10 71\n", "OK: RATE PSC=10 ARR=71\r\n"},
+    {CS_IDLE, "RATE 0 0", "", "ERR: Bad value '0' (1-65535)\r\n"},
+    {CS_IDLE, "RATE 0x0 0xFFFF", "SetSampleRate 0 65535\n", "OK: RATE PSC=0 ARR=65535\r\n"},
+    {CS_IDLE, "RATE 100k", "SetSampleRateHz 100000\n", "OK: RATE 100000Hz ACTUAL=100000Hz\r\n"},
+    {CS_IDLE, "RATE 010K", "SetSampleRateHz 10000\n", "OK: RATE 10000Hz ACTUAL=10000Hz\r\n"},
+    {CS_IDLE, "RATE 36M", "SetSampleRateHz 36000000\n", "OK: RATE 36000000Hz ACTUAL=36000000Hz\r\n"},
+    {CS_IDLE, "RATE 37M", "", "ERR: Bad value '37' (1-36)\r\n"},
+    {CS_IDLE, "RATE k", "", "ERR: Bad value '' (1-36000)\r\n"},
+    {CS_IDLE, "RATE MAX", "SetTurbo\n", "OK: RATE MAX ACTUAL=24000000Hz (DMA burst, no trigger/stream)\r\n"},
+    {CS_IDLE, "TRIG POS 050", "SetTriggerPosition 50\n", "OK: TRIG POS=50%\r\n"},
+    {CS_IDLE, "TRIG POS 101", "", "ERR: Bad value '101' (0-100)\r\n"},
+    {CS_IDLE, "TRIG 07 01", "SetTrigger 7 1\n", "OK: TRIG PIN=7 EDGE=1\r\n"},
+    {CS_IDLE, "TRIG 8 1", "", "ERR: Bad value '8' (0-7)\r\n"},
+    {CS_IDLE, "TRIG PAT 0x05 0x0F", "SetPatternTrigger 0x05 0x0F\n", "OK: TRIG PAT VAL=0x05 MASK=0x0F\r\n"},
+    {CS_IDLE, "TRIG ANY 0", "", "ERR: Bad value '0' (1-255)\r\n"},
+    {CS_IDLE, "TRIG SEQ 1 1 2 3 010", "SetSequenceTrigger 0x01 0x01 0x02 0x03 10\n",
+     "OK: TRIG SEQ A=0x01/0x01 B=0x02/0x03 N=10\r\n"},
+    {CS_IDLE, "MEAS 1 0100", "MeasureStart 1 100\n", "OK: MEAS PA1 every 100ms\r\n"},
+    {CS_IDLE, "MEAS 2", "", "ERR: MEAS only on PA0/PA1 (TIM5 CH1/CH2), not PA2\r\n"},
+    {CS_IDLE, "BAUD 0115200", "RequestBaud 625\n", "OK: BAUD 115200 ACTUAL=115200 ERR=+0.00%\r\n"},
+
+    /* 参数个数、关键字、空白 */
+    {CS_IDLE, "COUNT", "", "ERR: Usage: COUNT <n>\r\n"},
+    {CS_IDLE, "COUNT 1 2", "", "ERR: Usage: COUNT <n>\r\n"},
+    {CS_IDLE, "TRIG POS", "", "ERR: Usage: TRIG POS <0-100>\r\n"},
+    {CS_IDLE, "TRIG 1 2 3 4 5 6 7 8", "", "ERR: Usage: TRIG <pin> <edge>\r\n"},
+    {CS_IDLE, "TRIG SEQ 1 1 2 3", "", "ERR: Usage: TRIG SEQ <valA> <maskA> <valB> <maskB> <n>\r\n"},
+    {CS_IDLE, "count 5", "", "ERR: Unknown command 'count'\r\n"},
+    {CS_IDLE, "MODE bin", "", "ERR: Unknown mode 'bin'\r\n"},
+    {CS_IDLE, " \tCOUNT\t 5 \t", "SetSampleCount 5\n", "OK: COUNT=5 MAXCOUNT=20000\r\n"},
+    {CS_IDLE, "", "", ""},
+    {CS_IDLE, " ; ;\t;", "", ""},
+
+    /* 多条命令 */
+    {CS_IDLE, "RATE 0 71;COUNT 4096;CAP", "SetSampleRate 0 71\nSetSampleCount 4096\nStartCapture\n",
+     "OK: RATE PSC=0 ARR=71\r\nOK: COUNT=4096 MAXCOUNT=20000\r\nOK: CAPTURING...\r\n"},
+    {CS_IDLE, ";PING;;PING;", "ConfirmBaud\nConfirmBaud\n", "OK: PONG\r\nOK: PONG\r\n"},
+    {CS_IDLE, "COUNT 010x;CAP; RATE 1k ;", "",
+     "ERR: Bad value '010x' (1-4294967295)\r\nERR: SKIPPED 'CAP'\r\nERR: SKIPPED 'RATE'\r\n"},
+    {CS_IDLE, "NOTRIG;FOO 1;NOTRIG", "DisableTrigger\n",
+     "OK: TRIGGER DISABLED\r\nERR: Unknown command 'FOO'\r\nERR: SKIPPED 'NOTRIG'\r\n"},
+
+    /* 采样中 */
+    {CS_ARMED, "COUNT 5", "", "ERR: BUSY (ARMED), send ABORT first\r\n"},
+    {CS_TRIGGERED, "SEND", "", "ERR: BUSY (TRIGGERED), send ABORT first\r\n"},
+    {CS_ARMED, "STATUS;MODE HEX", "SetOutputMode 0\n", "STATUS: ARMED\r\nOK: MODE HEX\r\n"},
+    {CS_ARMED, "ABORT", "Abort\n", "OK: ABORTED\r\n"},
+    {CS_IDLE, "ABORT", "Abort\n", "ERR: Not capturing\r\n"},
+    {CS_DONE, "SEND", "SendData\n", "DATA\r\n"},
+    {CS_DONE, "STATUS", "", "STATUS: READY MAXCOUNT=20000 DATA=FULL\r\n"},
+};
+
+static void Table(void)
+{
+    int bad = 0;
+
+    for (unsigned i = 0; i < sizeof(Cases) / sizeof(Cases[0]); i++)
+    {
+        const Case_TypeDef *c = &Cases[i];
+
+        Reset(c->State);
+        Run(c->Line);
+        if (strcmp(Calls, c->Calls) || strcmp(Out, c->Out))
+        {
+            printf("  \"%s\" (%s):\n    calls: %s    reply: %s  expected calls: %s    reply: %s",
+                   c->Line, CS_Name(c->State), Calls, Out, c->Calls, c->Out);
+            bad++;
+        }
+        else if (Verbose)
+            printf("  \"%s\" -> %s", c->Line, *Out ? Out : "(no reply)\n");
+    }
+    // 打包来不及时被覆盖的样本数只在不为 0 时出现
+    Reset(CS_DONE);
+    Dev.Overrun = 256;
+    Run("STATUS");
+    if (strcmp(Out, "STATUS: READY MAXCOUNT=20000 DATA=FULL OVERRUN=256\r\n"))
+    {
+        printf("  \"STATUS\" with overrun: %s", Out);
+        bad++;
+    }
+    printf("%-10s %3u lines  %s\n", "table", (unsigned)(sizeof(Cases) / sizeof(Cases[0])), bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+/* ------------------------------------------------------------------ 数值 */
+
+/* 参考实现: 十进制, 或 0x/0X 后至少一位十六进制数; 返回 1 并输出数值, 格式或范围错误返回 0 */
+static int RefNumber(const char *s, uint32_t min, uint32_t max, uint32_t *value)
+{
+    uint64_t v = 0;
+    int base = 10;
+
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+    {
+        base = 16;
+        s += 2;
+    }
+    if (*s == '\0')
+        return 0;
+    for (; *s; s++)
+    {
+        int d;
+
+        if (*s >= '0' && *s <= '9')
+            d = *s - '0';
+        else if (base == 16 && *s >= 'a' && *s <= 'f')
+            d = *s - 'a' + 10;
+        else if (base == 16 && *s >= 'A' && *s <= 'F')
+            d = *s - 'A' + 10;
+        else
+            return 0;
+        v = v * base + d;
+        if (v > 0xFFFFFFFFu)
+            return 0;
+    }
+    if (v < min || v > max)
+        return 0;
+    *value = v;
+    return 1;
+}
+
+/* 随机数字串: 前导 0、十六进制前缀、大小写、长度、混入非数字字符 */
+static void RandNumber(char *s)
+{
+    static const char pool[] = "0123456789abcdefABCDEFxX+- .kKM";
+    int n = 0, len;
+
+    switch (Rand() % 6)
+    {
+    case 0:
+        n = sprintf(s, "%u", Rand() % 100000);
+        break;
+    case 1:
+        n = sprintf(s, "%0*u", (int)(1 + Rand() % 12), Rand());
+        break;
+    case 2:
+        n = sprintf(s, Rand() % 2 ? "0x%0*x" : "0X%0*X", (int)(Rand() % 10), Rand() * (Rand() % 300));
+        break;
+    case 3:
+        n = sprintf(s, "%llu", (unsigned long long)Rand() << (Rand() % 40));
+        break;
+    case 4:
+        s[n++] = '0';
+        if (Rand() % 2)
+            s[n++] = "xX"[Rand() % 2];
+        break;
+    default:
+        break;
+    }
+    // 随机追加或替换几个字符
+    for (len = Rand() % 4; len > 0 && n < 30; len--)
+    {
+        if (n && Rand() % 2)
+            s[Rand() % n] = pool[Rand() % (sizeof(pool) - 1)];
+        else
+            s[n++] = pool[Rand() % (sizeof(pool) - 1)];
+    }
+    if (n == 0)
+        s[n++] = '0' + Rand() % 10;
+    s[n] = '\0';
+}
+
+static void Numbers(int rounds)
+{
+    char num[40], line[64];
+    int bad = 0, accepted = 0;
+
+    for (int r = 0; r < rounds && bad < 5; r++)
+    {
+        uint32_t want = 0, got = 0;
+        int ok, parsed;
+
+        RandNumber(num);
+        if (strchr(num, ' ') || strchr(num, '.') || strpbrk(num, "kKM"))
+            continue;                       // 空白会切分参数, '.' 与单位由 RATE 处理
+        ok = RefNumber(num, 1, 0xFFFFFFFF, &want);
+        snprintf(line, sizeof(line), "COUNT %s", num);
+        Reset(CS_IDLE);
+        Run(line);
+        parsed = sscanf(Calls, "SetSampleCount %u", &got) == 1;
+        if (parsed != ok || (ok && got != want))
+        {
+            printf("  \"%s\": %s, expected %s\n", line, parsed ? Calls : Out,
+                   ok ? "accepted" : "rejected");
+            bad++;
+        }
+        accepted += ok;
+    }
+    if (Verbose)
+        printf("  numbers: %d of %d accepted\n", accepted, rounds);
+    printf("%-10s %7d strings  %s\n", "numbers", rounds, bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+/* ------------------------------------------------------------------ 随机命令行 */
+
+static const char *const Words[] = {
+    "RATE", "COUNT", "CHAN", "TRIG", "POS", "PAT", "ANY", "SEQ", "NOTRIG", "CAP", "ABORT",
+    "STREAM", "STOP", "STATUS", "SEND", "MODE", "BIN", "HEX", "COMP", "ON", "OFF", "BAUD",
+    "PING", "RXSTAT", "CAL", "MEAS", "MAX", "k", "M", "0", "1", "7", "8", "255", "0xFF",
+    "010", "0x", "-1", "100k", "", "rate", "HELPX",
+};
+
+/* 格式正确的命令 (参数值随机, 多数在范围内), 让随机命令行不总在第一条就出错 */
+static const struct
+{
+    const char *Name;
+    uint8_t Args;
+} Templates[] = {
+    {"RATE", 1}, {"RATE", 2}, {"COUNT", 1}, {"CHAN", 1}, {"TRIG POS", 1}, {"TRIG PAT", 2},
+    {"TRIG ANY", 1}, {"TRIG SEQ", 5}, {"TRIG", 2}, {"NOTRIG", 0}, {"CAP", 0}, {"ABORT", 0},
+    {"STREAM", 0}, {"STOP", 0}, {"STATUS", 0}, {"SEND", 0}, {"MODE BIN", 0}, {"MODE HEX", 0},
+    {"COMP ON", 0}, {"COMP OFF", 0}, {"BAUD", 1}, {"PING", 0}, {"RXSTAT", 0}, {"CAL", 0},
+    {"CAL", 1}, {"MEAS STOP", 0}, {"MEAS", 1}, {"MEAS", 2},
+};
+
+static void RandLine(char *line)
+{
+    int n = 0, k;
+
+    for (k = 1 + Rand() % 4; k > 0; k--)
+    {
+        int words = 1 + Rand() % 10, blank = Rand() % 8 == 0;
+
+        if (!blank && Rand() % 2)
+        {
+            int t = Rand() % (sizeof(Templates) / sizeof(Templates[0]));
+            static const char *const fmt[] = {"%u", "%03u", "0x%x", "0X%02X"};
+
+            n += sprintf(line + n, "%s", Templates[t].Name);
+            for (int a = 0; a < Templates[t].Args; a++)
+            {
+                line[n++] = Rand() % 4 ? ' ' : '\t';
+                n += sprintf(line + n, fmt[Rand() % 4], Rand() % 8 ? Rand() % 8 : Rand() % 2000);
+            }
+            words = 0;
+        }
+        for (int w = 0; w < words && !blank && n < LINE_MAX - 40; w++)
+        {
+            char num[40];
+            const char *t = num;
+
+            if (w > 0 || Rand() % 4 == 0)
+                line[n++] = Rand() % 4 ? ' ' : '\t';
+            if (Rand() % 3 == 0)
+                RandNumber(num);
+            else if (Rand() % 8 == 0)
+            {
+                int len = 1 + Rand() % 8;
+
+                for (int i = 0; i < len; i++)
+                    num[i] = 0x21 + Rand() % 0xDF;  // 不含空白和 '\0'
+                num[len] = '\0';
+            }
+            else
+                t = Words[Rand() % (sizeof(Words) / sizeof(Words[0]))];
+            for (; *t && n < LINE_MAX - 2; t++)
+                line[n++] = (*t == ';' || *t == ' ' || *t == '?') ? '_' : *t;   // '?' 为 HELP, 应答多行
+        }
+        if (Rand() % 4 == 0)
+            line[n++] = ' ';
+        if (k > 1)
+            line[n++] = ';';
+    }
+    line[n] = '\0';
+}
+
+/* 非空命令数: 切分规则与 CMD_Parse 一致, 只用来和应答行数比较 */
+static int CountCommands(const char *line)
+{
+    int cmds = 0, word = 0;
+
+    for (;; line++)
+    {
+        if (*line == ';' || *line == '\0')
+        {
+            cmds += word;
+            word = 0;
+            if (*line == '\0')
+                return cmds;
+        }
+        else if (*line != ' ' && *line != '\t')
+            word = 1;
+    }
+}
+
+static void Fuzz(int rounds)
+{
+    char line[LINE_MAX];
+    int bad = 0, errors = 0, lines = 0, oks = 0;
+
+    for (int r = 0; r < rounds && bad < 5; r++)
+    {
+        static const uint8_t states[] = {CS_IDLE, CS_ARMED, CS_TRIGGERED, CS_DONE};
+        int cmds, result, replies = 0, failed = 0, wrong = 0;
+        char *p, *eol;
+
+        RandLine(line);
+        cmds = CountCommands(line);
+        Reset(states[Rand() % 4]);
+        Dev.Streaming = Rand() % 8 == 0;
+        result = Run(line);
+
+        for (p = Out; *p; p = eol + 2)
+        {
+            eol = strstr(p, "\r\n");
+            if (!eol)
+            {
+                wrong = 1;
+                break;
+            }
+            replies++;
+            if (failed && strncmp(p, "ERR: SKIPPED '", 14) != 0)
+                wrong = 1;
+            else if (strncmp(p, "ERR: ", 5) == 0)
+                failed = 1;
+            else if (strncmp(p, "OK: ", 4) == 0)
+                oks++;
+            else if (strncmp(p, "STATUS: ", 8) && strncmp(p, "DATA\r\n", 6))
+                wrong = 1;
+        }
+        if (wrong || replies != cmds || (result < 0) != failed)
+        {
+            printf("  \"%s\": %d commands, returned %d, reply:\n%s", line, cmds, result, Out);
+            bad++;
+        }
+        errors += failed;
+        lines += replies;
+    }
+    if (Verbose)
+        printf("  fuzz: %d reply lines, %d OK, %d command lines failed\n", lines, oks, errors);
+    printf("%-10s %7d lines  %s\n", "fuzz", rounds, bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+int main(int argc, char **argv)
+{
+    int opt, rounds = 100000;
+
+    while ((opt = getopt(argc, argv, "vn:")) != -1)
+    {
+        if (opt == 'v')
+            Verbose = 1;
+        else if (opt == 'n')
+            rounds = atoi(optarg) > 0 ? atoi(optarg) : 1;
+        else
+        {
+            fprintf(stderr, "usage: %s [-v] [-n rounds]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Table();
+    Numbers(rounds);
+    Fuzz(rounds);
+
+    printf(Fail ? "FAIL\n" : "PASS\n");
+    return Fail ? 1 : 0;
+}
@@ -0,0 +1,390 @@
+/**
+  ******************************************************************************
+  * @file    SimCore.c
+  * @brief   模拟器核心 - 地址映射、虚拟时钟、中断分发、伪终端、入口
+  * @note    SIGALRM 每 tick_us 微秒 (实际时间) 到来一次, 推进 tick_us * speed 微秒
+  *          虚拟时间: 在这段时间内按时间顺序逐个处理外设事件, 每个事件后像 NVIC
+  *          一样调用电平有效且已使能的中断服务函数 (抢占优先级数值小者先, 同级按
+  *          中断号). 中断服务函数在信号处理函数中执行, 与真实中断一样可以打断主循环
+  *          的任意位置; 主循环关中断时信号被屏蔽, 开中断后立即补发.
+  ******************************************************************************
+  */
+
+#define _GNU_SOURCE                     // posix_openpt / ptsname
+#include "stm32f10x.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <unistd.h>
+#include "Sim.h"
+
+/* 链接器符号: 固件数据区末地址, 采样缓冲区从这里到 SRAM 末尾 (RCT6 为 0x2000C000).
+   取实际固件的数据区大小 (约 5KB) */
+__asm__(".globl Image$$RW_IRAM1$$ZI$$Limit\n"
+        ".set Image$$RW_IRAM1$$ZI$$Limit, 0x20001400");
+
+#define SIM_IRQ_STORM       10000       // 同一时刻连续进入中断的上限, 超过视为标志未清除
+#define SIM_FLASH_SIZE_KB   (*(volatile uint16_t *)0x1FFFF7E0)  // 闪存容量寄存器
+
+int Firmware_Main(void);                // User/main.c 中的 main, 编译时改名
+
+/* 映射到进程中的地址段 */
+static const struct
+{
+    uintptr_t Base;
+    size_t Size;
+} Sim_Regions[] = {
+    {0x1FFFF000, 0x1000},       // 系统存储区 (闪存容量寄存器)
+    {0x20000000, 0x10000},      // SRAM
+    {0x40000000, 0x30000},      // APB1 / APB2 / AHB 外设
+    {0xE0000000, 0x100000},     // 内核外设 (DWT / NVIC / SCB / CoreDebug)
+};
+
+/* 已建模的中断 (弱引用: 固件没有定义的中断服务函数为空) */
+#define SIM_HANDLER(name)   extern void name(void) __attribute__((weak));
+SIM_HANDLER(EXTI0_IRQHandler)
+SIM_HANDLER(EXTI1_IRQHandler)
+SIM_HANDLER(EXTI2_IRQHandler)
+SIM_HANDLER(EXTI3_IRQHandler)
+SIM_HANDLER(EXTI4_IRQHandler)
+SIM_HANDLER(EXTI9_5_IRQHandler)
+SIM_HANDLER(DMA1_Channel2_IRQHandler)
+SIM_HANDLER(DMA1_Channel4_IRQHandler)
+SIM_HANDLER(TIM2_IRQHandler)
+SIM_HANDLER(TIM4_IRQHandler)
+SIM_HANDLER(TIM5_IRQHandler)
+SIM_HANDLER(USART1_IRQHandler)
+
+static const struct
+{
+    IRQn_Type Irq;
+    void (*Handler)(void);
+} Sim_Vectors[] = {
+    {EXTI0_IRQn, EXTI0_IRQHandler},
+    {EXTI1_IRQn, EXTI1_IRQHandler},
+    {EXTI2_IRQn, EXTI2_IRQHandler},
+    {EXTI3_IRQn, EXTI3_IRQHandler},
+    {EXTI4_IRQn, EXTI4_IRQHandler},
+    {DMA1_Channel2_IRQn, DMA1_Channel2_IRQHandler},
+    {DMA1_Channel4_IRQn, DMA1_Channel4_IRQHandler},
+    {EXTI9_5_IRQn, EXTI9_5_IRQHandler},
+    {TIM2_IRQn, TIM2_IRQHandler},
+    {TIM4_IRQn, TIM4_IRQHandler},
+    {TIM5_IRQn, TIM5_IRQHandler},
+    {USART1_IRQn, USART1_IRQHandler},
+};
+#define SIM_VECTORS         (sizeof(Sim_Vectors) / sizeof(Sim_Vectors[0]))
+
+volatile uint64_t Sim_Now = 0;
+int Sim_PtyFd = -1;
+
+static uint64_t Sim_Quantum;                // 每个 tick 推进的虚拟周期数
+static long Sim_TickUs;                     // tick 间隔 (实际微秒)
+static uint32_t Sim_Enabled[2];             // NVIC 中断使能 (ISER/ICER 为只写, 写入后由此记录)
+static volatile uint8_t Sim_Primask = 0;    // 主循环关中断
+static volatile uint8_t Sim_InHandler = 0;  // 正在执行中断服务函数
+static volatile uint8_t Sim_InWfi = 0;      // 主循环在 __WFI 中休眠
+static sigset_t Sim_TickSet;
+
+/**
+  * @brief  处理 NVIC 使能/禁止寄存器的写入 (写 1 有效, 读回值不被固件使用)
+  * @param  无
+  * @retval 无
+  */
+static void Sim_NvicSync(void)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        Sim_Enabled[i] |= NVIC->ISER[i];
+        Sim_Enabled[i] &= ~NVIC->ICER[i];
+        NVIC->ISER[i] = 0;
+        NVIC->ICER[i] = 0;
+        NVIC->ISPR[i] = 0;
+        NVIC->ICPR[i] = 0;
+    }
+}
+
+/**
+  * @brief  NVIC_Init 的包装 (链接时 --wrap): 写入 ISER/ICER 后立即记录
+  * @note   映射的内存不是写 1 有效, 连续两次 NVIC_Init 之间没有时钟信号时,
+  *         后一次写入会覆盖前一次, 先使能的中断就丢失了
+  */
+void __real_NVIC_Init(NVIC_InitTypeDef *init);
+void __wrap_NVIC_Init(NVIC_InitTypeDef *init)
+{
+    sigset_t old;
+
+    sigprocmask(SIG_BLOCK, &Sim_TickSet, &old);
+    __real_NVIC_Init(init);
+    Sim_NvicSync();
+    sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+/**
+  * @brief  选出应当进入的中断 (已使能且外设请求有效, 优先级最高)
+  * @param  无
+  * @retval Sim_Vectors 下标, 无则 -1
+  */
+static int Sim_Pending(void)
+{
+    int best = -1;
+
+    Sim_NvicSync();
+    Sim_PeriphSync();
+    for (int i = 0; i < (int)SIM_VECTORS; i++)
+    {
+        int irq = Sim_Vectors[i].Irq;
+        if (!Sim_Vectors[i].Handler || !(Sim_Enabled[irq >> 5] & (1u << (irq & 31))))
+            continue;
+        if (!Sim_IrqLevel(irq))
+            continue;
+        if (best < 0 || NVIC->IP[irq] < NVIC->IP[Sim_Vectors[best].Irq])
+            best = i;
+    }
+    return best;
+}
+
+/**
+  * @brief  依次执行所有待处理的中断 (不嵌套)
+  * @param  无
+  * @retval 无
+  */
+void Sim_Dispatch(void)
+{
+    for (int n = 0; n < SIM_IRQ_STORM; n++)
+    {
+        int i = Sim_Pending();
+        if (i < 0)
+            return;
+        Sim_InHandler = 1;
+        Sim_Vectors[i].Handler();
+        Sim_InHandler = 0;
+        if (Sim_Vectors[i].Irq == USART1_IRQn)
+        {
+            /* 接收中断中必然读过 DR, 读 DR 清除 RXNE 的效果在这里补上 */
+            USART1->SR &= ~(USART_FLAG_RXNE | USART_FLAG_ORE);
+        }
+    }
+    fprintf(stderr, "[SIM] IRQ %d keeps firing, flag never cleared?\n",
+            Sim_Vectors[Sim_Pending()].Irq);
+}
+
+/**
+  * @brief  关中断 (__disable_irq): 屏蔽时钟信号
+  * @note   中断服务函数中只记录状态, 信号处理期间本来就是屏蔽的
+  */
+void Sim_DisableIrq(void)
+{
+    if (!Sim_InHandler)
+        sigprocmask(SIG_BLOCK, &Sim_TickSet, NULL);
+    Sim_Primask = 1;
+}
+
+/**
+  * @brief  开中断 (__enable_irq): 先执行关中断期间挂起的中断, 再放开时钟信号
+  */
+void Sim_EnableIrq(void)
+{
+    Sim_Primask = 0;
+    if (Sim_InHandler)
+        return;
+    Sim_Dispatch();
+    sigprocmask(SIG_UNBLOCK, &Sim_TickSet, NULL);
+}
+
+/**
+  * @brief  等待中断 (__WFI): 在关中断状态下调用, 有中断挂起时返回
+  * @note   等待期间外设照常运行, 中断由之后的 __enable_irq 执行
+  */
+void Sim_Wfi(void)
+{
+    sigset_t none;
+
+    sigemptyset(&none);
+    Sim_InWfi = 1;
+    while (Sim_Pending() < 0)
+        sigsuspend(&none);
+    Sim_InWfi = 0;
+}
+
+/**
+  * @brief  推进虚拟时间到 end, 期间逐个处理外设事件
+  * @note   主循环关中断后在 __WFI 中等待时, 中断一挂起就提前结束本 tick, 让主循环
+  *         在挂起时刻醒来执行中断 (否则中断要到 tick 末尾才执行, DWT 计时多出一个 tick)
+  * @param  end: 目标时刻 (周期)
+  * @retval 无
+  */
+static void Sim_Advance(uint64_t end)
+{
+    for (;;)
+    {
+        if (!Sim_Primask)
+            Sim_Dispatch();
+
+        uint64_t t = Sim_PeriphNextEvent();
+        if (t > end)
+            break;
+        if (t > Sim_Now)
+            Sim_Now = t;
+        Sim_PeriphRun(Sim_Now);
+        if (Sim_Primask && Sim_InWfi && Sim_Pending() >= 0)
+            return;
+    }
+    Sim_Now = end;
+    Sim_PeriphRun(end);
+}
+
+/**
+  * @brief  时钟信号: 交换伪终端数据, 推进一个 tick
+  * @note   单次定时, 处理完再重新设定. 模拟一个 tick 的耗时超过 tick 间隔时
+  *         (速度倍数过大), 下一次延后同样长的时间, 保证主循环至少分到一半的
+  *         CPU 时间, 实际速度随之降低
+  */
+static void Sim_Tick(int sig)
+{
+    (void)sig;
+    int saved = errno;
+    struct timeval t0, t1;
+    struct itimerval it = {{0, 0}, {0, 0}};
+    long spent;
+
+    gettimeofday(&t0, NULL);
+    Sim_PeriphPoll();
+    Sim_Advance(Sim_Now + Sim_Quantum);
+    Sim_PeriphPoll();
+    gettimeofday(&t1, NULL);
+
+    spent = (t1.tv_sec - t0.tv_sec) * 1000000 + (t1.tv_usec - t0.tv_usec);
+    if (spent < Sim_TickUs)
+        spent = Sim_TickUs;
+    it.it_value.tv_sec = spent / 1000000;
+    it.it_value.tv_usec = spent % 1000000;
+    setitimer(ITIMER_REAL, &it, NULL);
+    errno = saved;
+}
+
+/**
+  * @brief  映射寄存器和 SRAM 地址段
+  * @param  无
+  * @retval 0: 成功, -1: 失败
+  */
+static int Sim_MapMemory(void)
+{
+    for (size_t i = 0; i < sizeof(Sim_Regions) / sizeof(Sim_Regions[0]); i++)
+    {
+        void *p = mmap((void *)Sim_Regions[i].Base, Sim_Regions[i].Size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        if (p != (void *)Sim_Regions[i].Base)
+        {
+            fprintf(stderr, "[SIM] cannot map 0x%08lX: %s\n",
+                    (unsigned long)Sim_Regions[i].Base, strerror(errno));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+  * @brief  打开伪终端, 从端设为原始模式并保持打开 (上位机断开时主端不出错)
+  * @param  link: 非空时为从端建立此名称的符号链接
+  * @retval 0: 成功, -1: 失败
+  */
+static int Sim_OpenPty(const char *link)
+{
+    struct termios tio;
+    const char *name;
+    int slave;
+
+    Sim_PtyFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (Sim_PtyFd < 0 || grantpt(Sim_PtyFd) < 0 || unlockpt(Sim_PtyFd) < 0)
+        return -1;
+    name = ptsname(Sim_PtyFd);
+    slave = open(name, O_RDWR | O_NOCTTY);
+    if (slave < 0)
+        return -1;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    fcntl(Sim_PtyFd, F_SETFL, O_NONBLOCK);
+
+    if (link)
+    {
+        unlink(link);
+        if (symlink(name, link) < 0)
+            fprintf(stderr, "[SIM] symlink %s: %s\n", link, strerror(errno));
+    }
+    fprintf(stderr, "[SIM] UART on %s%s%s\n", name, link ? " -> " : "", link ? link : "");
+    return 0;
+}
+
+static void Sim_Usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-w wave.txt] [-s speed] [-t tick_us] [-f flash_kb] [-l link]\n"
+            "  -w  GPIOA input script (default: PA0 1kHz square, others high)\n"
+            "  -s  virtual time per real time (default 1)\n"
+            "  -t  clock signal interval in real microseconds (default 100)\n"
+            "  -f  flash size register in KB, e.g. 64 for C8T6 (default 256, RCT6)\n"
+            "  -l  create a symlink to the pty, e.g. /tmp/ttyLA\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    const char *wave = NULL, *link = NULL;
+    double speed = 1.0;
+    long tick_us = 100, flash_kb = 256;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:s:t:f:l:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'w': wave = optarg; break;
+        case 's': speed = atof(optarg); break;
+        case 't': tick_us = atol(optarg); break;
+        case 'f': flash_kb = atol(optarg); break;
+        case 'l': link = optarg; break;
+        default: Sim_Usage(argv[0]); return 2;
+        }
+    }
+    if (speed <= 0 || tick_us <= 0 || flash_kb <= 0 || flash_kb > 0xFFFF)
+    {
+        Sim_Usage(argv[0]);
+        return 2;
+    }
+
+    if (Sim_MapMemory() < 0)
+        return 1;
+    SIM_FLASH_SIZE_KB = flash_kb;
+    Sim_PeriphReset();
+    if (wave ? Sim_WaveLoad(wave) < 0 : (Sim_WaveDefault(), 0))
+        return 1;
+    if (Sim_OpenPty(link) < 0)
+    {
+        perror("[SIM] pty");
+        return 1;
+    }
+
+    /* 虚拟时钟 */
+    Sim_Quantum = (uint64_t)(tick_us * speed * (SIM_CLOCK / 1000000));
+    sigemptyset(&Sim_TickSet);
+    sigaddset(&Sim_TickSet, SIGALRM);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = Sim_Tick;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGALRM, &sa, NULL);
+
+    Sim_TickUs = tick_us;
+    struct itimerval it = {{0, 0}, {tick_us / 1000000, tick_us % 1000000}};
+    setitimer(ITIMER_REAL, &it, NULL);
+
+    return Firmware_Main();
+}
@@ -0,0 +1,198 @@
+/**
+  ******************************************************************************
+  * @file    SimPack.c
+  * @brief   通道打包测试 - Hardware/Pack.c 的按字打包与逐位参考实现比较
+  * @note    用法: ./pack_test [-v]
+  *          - 参数: 全部 256 个掩码 (0 按 0xFF) 的 Width 与 Shift (连续对齐的一段才可直接移位)
+  *          - 单段: 全部 255 个掩码 x 若干长度 (含不足 8 个、不是 8 的倍数), 随机样本,
+  *            输出与参考实现逐字节相同, 返回值等于 Pack_Bytes(), 之后的字节不被改写
+  *          - 分块: 与固件 LA_PackHalf 一样按 128 样本的半区依次打包, 接在已打包数据之后,
+  *            拼起来须与整段一次打包相同
+  *          全部通过时退出码为 0, 否则为 1
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "Pack.h"
+
+#define MAX_SAMPLES     4096
+#define HALF            128                 // 与 LogicAnalyzer.c 的 LA_STAGE_SIZE / 2 一致
+#define GUARD           0xCC
+
+static int Verbose;
+static int Fail;
+
+static const uint32_t Lengths[] = {1, 3, 4, 7, 8, 9, 15, 16, 17, 31, 33, 64, 127, 128, 129, 1000};
+
+/* 伪随机数 (结果可重复) */
+static uint32_t Rand(void)
+{
+    static uint32_t x = 12345;
+    x = x * 1103515245 + 12345;
+    return x >> 8;
+}
+
+static uint8_t Popcount(uint8_t m)
+{
+    uint8_t n = 0;
+
+    for (; m; m &= m - 1)
+        n++;
+    return n;
+}
+
+/* 参考实现: 逐样本取出启用通道, 按 width 位依次写入, 先采的样本在低位 */
+static uint32_t RefPack(uint8_t mask, const uint8_t *src, uint32_t n, uint8_t *dst)
+{
+    uint8_t width = Popcount(mask) <= 1 ? 1 : Popcount(mask) <= 2 ? 2 : Popcount(mask) <= 4 ? 4 : 8;
+    uint32_t bytes = (n * width + 7) / 8;
+
+    memset(dst, 0, bytes);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uint8_t bit = 0;
+
+        for (uint8_t ch = 0; ch < 8; ch++)
+        {
+            if (!(mask >> ch & 1))
+                continue;
+            if (src[i] >> ch & 1)
+                dst[i * width / 8] |= 1 << (i * width % 8 + bit);
+            bit++;
+        }
+    }
+    return bytes;
+}
+
+/* 全部掩码的 Width / Shift */
+static void Init(void)
+{
+    Pack_TypeDef pk;
+    int bad = 0;
+
+    for (uint16_t m = 0; m < 256; m++)
+    {
+        uint8_t mask = m ? m : 0xFF;
+        uint8_t n = Popcount(mask);
+        uint8_t width = n <= 1 ? 1 : n <= 2 ? 2 : n <= 4 ? 4 : 8;
+        uint8_t shift = 0xFF;
+
+        for (uint8_t s = 0; s + width <= 8; s++)
+            if (mask == (uint8_t)(((1u << width) - 1) << s))
+                shift = s;
+        Pack_Init(&pk, m);
+        if (pk.Mask != mask || pk.Width != width || pk.Shift != shift)
+        {
+            if (bad++ < 3)
+                printf("  mask 0x%02X: Mask 0x%02X Width %u Shift %u, expected 0x%02X %u %u\n",
+                       m, pk.Mask, pk.Width, pk.Shift, mask, width, shift);
+        }
+    }
+    printf("%-10s 256 masks  %s\n", "init", bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+/* 单段: 每个掩码 x 每个长度 */
+static void Single(void)
+{
+    static uint32_t words[MAX_SAMPLES / 4];
+    static uint8_t got[MAX_SAMPLES + 16], want[MAX_SAMPLES];
+    uint8_t *src = (uint8_t *)words;
+    uint32_t cases = 0;
+    int bad = 0;
+
+    for (uint16_t mask = 1; mask < 256; mask++)
+    {
+        Pack_TypeDef pk;
+
+        Pack_Init(&pk, mask);
+        for (unsigned k = 0; k < sizeof(Lengths) / sizeof(Lengths[0]); k++)
+        {
+            uint32_t n = Lengths[k], bytes, ret;
+
+            for (uint32_t i = 0; i < MAX_SAMPLES; i++)
+                src[i] = Rand();
+            bytes = RefPack(mask, src, n, want);
+            memset(got, GUARD, sizeof(got));
+            ret = Pack_Run(&pk, src, n, got);
+            cases++;
+
+            if (ret != bytes || Pack_Bytes(&pk, n) != bytes || memcmp(got, want, bytes))
+            {
+                if (bad++ < 3)
+                    printf("  mask 0x%02X, %u samples: returned %u bytes, expected %u%s\n", mask, n, ret,
+                           bytes, ret == bytes ? ", data differs" : "");
+            }
+            else if (got[bytes] != GUARD)
+            {
+                if (bad++ < 3)
+                    printf("  mask 0x%02X, %u samples: wrote past %u bytes\n", mask, n, bytes);
+            }
+        }
+    }
+    if (Verbose)
+        printf("  %u mask/length cases\n", cases);
+    printf("%-10s %u masks x %u lengths  %s\n", "single", 255,
+           (unsigned)(sizeof(Lengths) / sizeof(Lengths[0])), bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+/* 分块: 按半区依次打包, 与整段一次打包比较 */
+static void Halves(void)
+{
+    static uint32_t words[MAX_SAMPLES / 4], stage[HALF / 4];
+    static uint8_t got[MAX_SAMPLES + 16], want[MAX_SAMPLES];
+    uint8_t *src = (uint8_t *)words;
+    int bad = 0;
+
+    for (uint16_t mask = 1; mask < 256; mask++)
+    {
+        Pack_TypeDef pk;
+        uint32_t count = 8 * (1 + Rand() % (MAX_SAMPLES / 8)), done, bytes;
+
+        Pack_Init(&pk, mask);
+        for (uint32_t i = 0; i < count; i++)
+            src[i] = (i / (1 + mask % 13)) & 1 ? Rand() : 0x55;    // 随机段与常数段交替
+        bytes = RefPack(mask, src, count, want);
+        memset(got, GUARD, sizeof(got));
+        for (done = 0; done < count; done += HALF)
+        {
+            uint32_t n = count - done > HALF ? HALF : count - done;
+
+            memcpy(stage, src + done, n);           // 暂存区 4 字节对齐
+            Pack_Run(&pk, (uint8_t *)stage, n, &got[Pack_Bytes(&pk, done)]);
+        }
+        if (memcmp(got, want, bytes) || got[bytes] != GUARD)
+        {
+            if (bad++ < 3)
+                printf("  mask 0x%02X, %u samples in halves of %u differ\n", mask, count, HALF);
+        }
+    }
+    printf("%-10s 255 masks  %s\n", "halves", bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v")) != -1)
+    {
+        if (opt == 'v')
+            Verbose = 1;
+        else
+        {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Init();
+    Single();
+    Halves();
+
+    printf(Fail ? "FAIL\n" : "PASS\n");
+    return Fail ? 1 : 0;
+}
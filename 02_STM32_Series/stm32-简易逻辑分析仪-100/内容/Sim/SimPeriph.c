@@ -0,0 +1,664 @@
+/**
+  ******************************************************************************
+  * @file    SimPeriph.c
+  * @brief   外设模型 - GPIOA 输入、TIM2/TIM4/TIM5、DMA1、USART1、EXTI、DWT
+  * @note    寄存器就是映射内存, 固件的写入在下一次 Sim_PeriphSync() 时生效:
+  *          - 只写/写 1 清除的寄存器 (DMA IFCR、NVIC ISER 等) 处理后清零
+  *          - 写 0 清除的状态寄存器 (TIM SR、USART SR) 用影子值比较得出被清除的位;
+  *            两次同步之间只看得到最后一次写入, 固件须一次写入清除所有要清的标志
+  *          - EXTI PR 写 1 清除, 读回值又是挂起位: 保留位 31 置 1 作标记,
+  *            固件写入后标记消失, 据此识别写入
+  *          - USART DR 的位 15 同样作标记: 被固件写成 0 即为发送一个字节
+  *          - 使能位 (TIM CEN、DMA EN) 与上次记录比较, 得出启动/停止
+  *          只建模本固件用到的功能: DMA 固定按字节传输, 定时器只做向上计数.
+  ******************************************************************************
+  */
+
+#include "stm32f10x.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "Sim.h"
+
+#define SIM_M2M_CYCLES      6           // 存储器到存储器 DMA 每次传输的周期数 (极速采样)
+#define SIM_EXTI_CANARY     0x80000000  // EXTI PR 写入标记
+#define SIM_DR_CANARY       0x8000      // USART DR 写入标记
+#define SIM_DWT_CTRL        (*(volatile uint32_t *)0xE0001000)
+#define SIM_DWT_CYCCNT      (*(volatile uint32_t *)0xE0001004)
+#define SIM_NEVER           UINT64_MAX
+
+static DMA_Channel_TypeDef *const Sim_DmaCh[8] = {
+    0, DMA1_Channel1, DMA1_Channel2, DMA1_Channel3, DMA1_Channel4,
+    DMA1_Channel5, DMA1_Channel6, DMA1_Channel7,
+};
+
+/* DMA 通道: 使能时锁存传输数和存储器地址 (循环模式重装用) */
+static struct
+{
+    uint8_t On;
+    uint32_t Reload;
+    uint32_t Mem;
+    uint32_t Count;             // 模拟器最后写入的 CNDTR
+    uint64_t Next;              // 存储器到存储器模式的下一次传输时刻
+} Sim_Dma[8];
+
+/* TIM2: 采样时钟 */
+static uint8_t Sim_Tim2On;
+static uint32_t Sim_Tim2Psc;    // 更新事件时装入的预分频值
+static uint64_t Sim_Tim2Next;   // 下一次更新事件
+static uint16_t Sim_TimSr[6];   // TIM1-5 SR 影子值
+
+/* TIM5: PWM 输入 (频率测量), TI1/TI2 = PA0/PA1 */
+static uint8_t Sim_Tim5On;
+static uint32_t Sim_Tim5Psc;    // 生效的预分频值
+static uint64_t Sim_Tim5Base;   // 计数器清零的时刻
+static uint64_t Sim_Tim5Time;   // 输入边沿已处理到的时刻
+static uint8_t Sim_Tim5In;      // 该时刻 TI1/TI2 的电平
+static uint8_t Sim_Tim5Count[2];    // 通道1/2 的输入分频计数
+
+/* USART1 */
+static uint16_t Sim_UsartSr;
+static uint8_t Sim_TxShift;     // 移位寄存器中的字节
+static uint8_t Sim_TxBusy;      // 移位寄存器正在发送
+static uint8_t Sim_TxHold;      // DR 中还有一个等待发送的字节
+static uint8_t Sim_TxData;
+static uint64_t Sim_TxDone;     // 当前字节发完的时刻
+static uint64_t Sim_RxNext;     // 下一个接收字节到达的时刻
+static uint8_t Sim_RxQueue[256];
+static int Sim_RxHead, Sim_RxLen;
+static uint8_t Sim_TxBuf[4096]; // 已发出、尚未写入伪终端的字节
+static int Sim_TxLen;
+
+/* EXTI / GPIOA */
+static uint32_t Sim_ExtiPending;
+static uint8_t Sim_Idr;
+static uint64_t Sim_IdrTime;
+
+/**
+  * @brief  寄存器复位值 (含 SystemInit 设置的 72MHz 时钟)
+  * @param  无
+  * @retval 无
+  */
+void Sim_PeriphReset(void)
+{
+    RCC->CR = 0x03030083;                   // HSE/PLL 已就绪
+    RCC->CFGR = 0x001D040A;                 // PLL = HSE 8MHz x9 作系统时钟, APB1 /2
+    GPIOA->CRL = GPIOA->CRH = 0x44444444;
+    GPIOB->CRL = GPIOB->CRH = 0x44444444;
+    GPIOC->CRL = GPIOC->CRH = 0x44444444;
+    USART1->SR = Sim_UsartSr = USART_FLAG_TXE | USART_FLAG_TC;
+    USART1->DR = SIM_DR_CANARY;
+    EXTI->PR = SIM_EXTI_CANARY;
+}
+
+/* ====== GPIOA ====== */
+
+/**
+  * @brief  刷新 GPIOA->IDR 到时刻 t 的输入值, 途经的边沿送给 EXTI
+  * @param  t: 时刻
+  * @retval 无
+  */
+static void Sim_GpioUpdate(uint64_t t)
+{
+    uint8_t lines = EXTI->IMR & 0xFF;
+    uint64_t e;
+
+    /* AFIO 选的不是 A 口的 EXTI 线不检测 */
+    for (int n = 0; n < 8; n++)
+        if ((AFIO->EXTICR[n >> 2] >> ((n & 3) * 4)) & 0xF)
+            lines &= ~(1u << n);
+
+    if (lines)
+    {
+        /* 逐个边沿检测 (开启 EXTI 时 Sim_PeriphNextEvent 会在每个边沿停下) */
+        for (e = Sim_WaveNextChange(Sim_IdrTime); e <= t; e = Sim_WaveNextChange(e))
+        {
+            uint8_t v = Sim_WaveAt(e);
+            uint8_t rise = v & ~Sim_Idr, fall = Sim_Idr & ~v;
+            Sim_ExtiPending |= lines & ((rise & EXTI->RTSR) | (fall & EXTI->FTSR));
+            Sim_Idr = v;
+        }
+    }
+    Sim_Idr = Sim_WaveAt(t);
+    Sim_IdrTime = t;
+    /* PA9 (TX) / PA10 (RX) 空闲为高 */
+    GPIOA->IDR = Sim_Idr | 0x0600;
+    EXTI->PR = Sim_ExtiPending | SIM_EXTI_CANARY;
+}
+
+/* ====== USART1 ====== */
+
+static uint32_t Sim_CharCycles(void)
+{
+    /* BRR = PCLK2 / 波特率, 即每位的周期数; 一个字符 10 位 */
+    uint32_t brr = USART1->BRR;
+    return (brr ? brr : 16) * 10;
+}
+
+static void Sim_UsartSetSr(uint16_t set, uint16_t clear)
+{
+    Sim_UsartSr = (Sim_UsartSr | set) & ~clear;
+    USART1->SR = Sim_UsartSr;
+}
+
+/**
+  * @brief  写 DR (固件或 DMA): 移位寄存器空闲则立即开始发送, 否则在 DR 中等待
+  */
+static void Sim_UsartWrite(uint8_t b, uint64_t t)
+{
+    if (!(USART1->CR1 & USART_CR1_UE) || !(USART1->CR1 & USART_CR1_TE))
+        return;
+    if (!Sim_TxBusy)
+    {
+        Sim_TxShift = b;
+        Sim_TxBusy = 1;
+        Sim_TxDone = t + Sim_CharCycles();
+        Sim_UsartSetSr(0, USART_FLAG_TC);
+    }
+    else
+    {
+        Sim_TxData = b;
+        Sim_TxHold = 1;
+        Sim_UsartSetSr(0, USART_FLAG_TXE);
+    }
+}
+
+/* ====== DMA1 ====== */
+
+static uint8_t Sim_Read8(uint32_t addr, uint64_t t)
+{
+    if (addr == (uint32_t)&GPIOA->IDR)
+        Sim_GpioUpdate(t);
+    return *(volatile uint8_t *)(uintptr_t)addr;
+}
+
+static void Sim_Write8(uint32_t addr, uint8_t v, uint64_t t)
+{
+    if (addr == (uint32_t)&USART1->DR)
+        Sim_UsartWrite(v, t);
+    else
+        *(volatile uint8_t *)(uintptr_t)addr = v;
+}
+
+/**
+  * @brief  DMA 通道传输一个字节, 更新剩余数和半传输/传输完成标志
+  */
+static void Sim_DmaTransfer(int ch, uint64_t t)
+{
+    DMA_Channel_TypeDef *c = Sim_DmaCh[ch];
+    uint32_t ccr = c->CCR;
+    uint32_t done = Sim_Dma[ch].Reload - c->CNDTR;
+    uint32_t mem = Sim_Dma[ch].Mem + ((ccr & DMA_CCR1_MINC) ? done : 0);
+    uint32_t shift = (ch - 1) * 4;
+
+    if (ccr & DMA_CCR1_DIR)
+        Sim_Write8(c->CPAR, *(volatile uint8_t *)(uintptr_t)mem, t);
+    else
+        *(volatile uint8_t *)(uintptr_t)mem = Sim_Read8(c->CPAR, t);
+
+    c->CNDTR--;
+    done++;
+    Sim_Dma[ch].Count = c->CNDTR;
+    if (done == Sim_Dma[ch].Reload / 2)
+        DMA1->ISR |= (DMA_ISR_GIF1 | DMA_ISR_HTIF1) << shift;
+    if (c->CNDTR == 0)
+    {
+        DMA1->ISR |= (DMA_ISR_GIF1 | DMA_ISR_TCIF1) << shift;
+        if (ccr & DMA_CCR1_CIRC)
+            c->CNDTR = Sim_Dma[ch].Count = Sim_Dma[ch].Reload;
+    }
+}
+
+/**
+  * @brief  外设发出 DMA 请求 (TIM2 更新 -> 通道2, USART1 TXE -> 通道4)
+  */
+static void Sim_DmaRequest(int ch, uint64_t t)
+{
+    DMA_Channel_TypeDef *c = Sim_DmaCh[ch];
+
+    if (Sim_Dma[ch].On && !(c->CCR & DMA_CCR1_MEM2MEM) && c->CNDTR)
+        Sim_DmaTransfer(ch, t);
+}
+
+/**
+  * @brief  USART1 发送 DMA: DR 空时向通道4 请求下一个字节
+  */
+static void Sim_UsartService(uint64_t t)
+{
+    while ((USART1->CR3 & USART_CR3_DMAT) && (Sim_UsartSr & USART_FLAG_TXE) && !Sim_TxHold &&
+           Sim_Dma[4].On && DMA1_Channel4->CNDTR)
+    {
+        uint32_t before = DMA1_Channel4->CNDTR;
+        Sim_DmaRequest(4, t);
+        if (DMA1_Channel4->CNDTR == before)
+            break;
+    }
+}
+
+/* ====== TIM2 / TIM4 ====== */
+
+/**
+  * @brief  TIM4 作为从定时器对 TRGO 计数 (外部时钟模式1, ITR1 = TIM2)
+  */
+static void Sim_Tim4Clock(void)
+{
+    if (!(TIM4->CR1 & TIM_CR1_CEN) || (TIM4->SMCR & TIM_SMCR_SMS) != 7 ||
+        (TIM4->SMCR & TIM_SMCR_TS) != TIM_TS_ITR1)
+        return;
+    if (TIM4->CNT >= TIM4->ARR)
+    {
+        TIM4->CNT = 0;
+        Sim_TimSr[4] |= TIM_SR_UIF;
+        TIM4->SR = Sim_TimSr[4];
+    }
+    else
+    {
+        TIM4->CNT++;
+    }
+}
+
+/**
+  * @brief  TIM2 更新事件: 装入预分频, 请求 DMA, 输出 TRGO
+  */
+static void Sim_Tim2Update(uint64_t t)
+{
+    Sim_Tim2Psc = TIM2->PSC;
+    Sim_TimSr[2] |= TIM_SR_UIF;
+    TIM2->SR = Sim_TimSr[2];
+    if (TIM2->DIER & TIM_DIER_UDE)
+        Sim_DmaRequest(2, t);
+    if ((TIM2->CR2 & TIM_CR2_MMS) == TIM_TRGOSource_Update)
+        Sim_Tim4Clock();
+}
+
+static uint64_t Sim_Tim2Period(void)
+{
+    return (uint64_t)(Sim_Tim2Psc + 1) * (TIM2->ARR + 1);
+}
+
+/* ====== TIM5 ====== */
+
+/**
+  * @brief  TIM5 计数器清零并装入预分频 (UG / 从模式复位), URS=0 时置更新标志
+  */
+static void Sim_Tim5Reset(uint64_t t)
+{
+    Sim_Tim5Base = t;
+    Sim_Tim5Psc = TIM5->PSC;
+    if (!(TIM5->CR1 & TIM_CR1_URS))
+    {
+        Sim_TimSr[5] |= TIM_SR_UIF;
+        TIM5->SR = Sim_TimSr[5];
+    }
+}
+
+/**
+  * @brief  TIM5 输入边沿: 通道1/2 输入捕获 (含输入分频), 然后是从模式复位
+  * @param  t: 时刻
+  * @param  rise, fall: TI1/TI2 上的上升/下降沿 (bit0 = TI1)
+  * @retval 无
+  */
+static void Sim_Tim5Edge(uint64_t t, uint8_t rise, uint8_t fall)
+{
+    uint16_t ccmr = TIM5->CCMR1, ccer = TIM5->CCER, smcr = TIM5->SMCR;
+    uint32_t cnt = (uint32_t)((t - Sim_Tim5Base) / (Sim_Tim5Psc + 1));
+
+    for (int ch = 0; ch < 2; ch++)
+    {
+        uint16_t mode = ccmr >> (ch * 8);       // CCxS / ICxPSC
+        uint8_t edge = (ccer & (TIM_CCER_CC1P << (ch * 4))) ? fall : rise;
+        int ti;
+
+        if (!(ccer & (TIM_CCER_CC1E << (ch * 4))) || (mode & 3) == 0 || (mode & 3) == 3)
+            continue;
+        ti = ((mode & 3) == 1) ? ch : 1 - ch;   // 01: 直接 TIx, 10: 相对通道的输入
+        if (!(edge & (1u << ti)))
+            continue;
+        if (++Sim_Tim5Count[ch] < (1u << ((mode >> 2) & 3)))
+            continue;
+        Sim_Tim5Count[ch] = 0;
+
+        /* 计数器在清零那一拍为 0, 捕获值为经过的计数减 1 */
+        if (Sim_TimSr[5] & (TIM_SR_CC1IF << ch))
+            Sim_TimSr[5] |= TIM_SR_CC1OF << ch;
+        *(ch ? &TIM5->CCR2 : &TIM5->CCR1) = (uint16_t)(cnt ? cnt - 1 : 0);
+        Sim_TimSr[5] |= TIM_SR_CC1IF << ch;
+    }
+    TIM5->SR = Sim_TimSr[5];
+
+    /* 复位模式, 触发输入 TI1FP1 (TS=101) / TI2FP2 (TS=110), 极性取 CC1P / CC2P */
+    if ((smcr & TIM_SMCR_SMS) == TIM_SlaveMode_Reset &&
+        ((smcr & TIM_SMCR_TS) == TIM_TS_TI1FP1 || (smcr & TIM_SMCR_TS) == TIM_TS_TI2FP2))
+    {
+        int ti = ((smcr & TIM_SMCR_TS) == TIM_TS_TI1FP1) ? 0 : 1;
+        uint8_t edge = (ccer & (TIM_CCER_CC1P << (ti * 4))) ? fall : rise;
+        if (edge & (1u << ti))
+            Sim_Tim5Reset(t);
+    }
+}
+
+/**
+  * @brief  TIM5 下一次溢出的时刻
+  */
+static uint64_t Sim_Tim5Overflow(void)
+{
+    return Sim_Tim5Base + (uint64_t)(Sim_Tim5Psc + 1) * ((uint32_t)TIM5->ARR + 1);
+}
+
+/**
+  * @brief  按时间顺序处理 TIM5 到时刻 t (含) 的溢出和输入边沿
+  */
+static void Sim_Tim5Run(uint64_t t)
+{
+    while (Sim_Tim5On)
+    {
+        uint64_t ovf = Sim_Tim5Overflow();
+        uint64_t e = Sim_WaveNextChange(Sim_Tim5Time);
+
+        if (ovf <= t && ovf <= e)
+        {
+            /* 溢出总是置更新标志 (URS 只屏蔽 UG 和从模式复位) */
+            Sim_Tim5Base = ovf;
+            Sim_Tim5Psc = TIM5->PSC;
+            Sim_TimSr[5] |= TIM_SR_UIF;
+            TIM5->SR = Sim_TimSr[5];
+            continue;
+        }
+        if (e > t)
+            break;
+        uint8_t v = Sim_WaveAt(e) & 3;
+        Sim_Tim5Edge(e, v & ~Sim_Tim5In, Sim_Tim5In & ~v);
+        Sim_Tim5In = v;
+        Sim_Tim5Time = e;
+    }
+    if (Sim_Tim5Time < t)
+        Sim_Tim5Time = t;
+}
+
+/* ====== 同步 / 调度 ====== */
+
+/**
+  * @brief  写 0 清除的状态寄存器: 固件写入的值与影子值不同, 则按写入值清除
+  */
+static uint16_t Sim_SyncRcw0(volatile uint16_t *reg, uint16_t *shadow)
+{
+    if (*reg != *shadow)
+        *shadow &= *reg;
+    *reg = *shadow;
+    return *shadow;
+}
+
+/**
+  * @brief  处理固件对寄存器的写入 (每个事件前后及每次进中断前调用)
+  * @param  无
+  * @retval 无
+  */
+void Sim_PeriphSync(void)
+{
+    uint64_t t = Sim_Now;
+
+    /* DMA1: 标志清除, 通道启动/停止 */
+    uint32_t ifcr = DMA1->IFCR;
+    if (ifcr)
+    {
+        for (int ch = 1; ch <= 7; ch++)
+            if (ifcr & (DMA_IFCR_CGIF1 << ((ch - 1) * 4)))
+                ifcr |= 0xFu << ((ch - 1) * 4);
+        DMA1->ISR &= ~ifcr;
+        DMA1->IFCR = 0;
+    }
+    for (int ch = 1; ch <= 7; ch++)
+    {
+        DMA_Channel_TypeDef *c = Sim_DmaCh[ch];
+        uint8_t on = c->CCR & DMA_CCR1_EN;
+        /* 使能期间 CNDTR/CMAR 不可写, 两者变了说明中断里关闭后重新启动过 */
+        if (on && (!Sim_Dma[ch].On || c->CNDTR != Sim_Dma[ch].Count || c->CMAR != Sim_Dma[ch].Mem))
+        {
+            Sim_Dma[ch].Reload = Sim_Dma[ch].Count = c->CNDTR;
+            Sim_Dma[ch].Mem = c->CMAR;
+            Sim_Dma[ch].Next = t + SIM_M2M_CYCLES;
+        }
+        Sim_Dma[ch].On = on;
+    }
+
+    /* TIM2 / TIM4 */
+    Sim_SyncRcw0(&TIM2->SR, &Sim_TimSr[2]);
+    Sim_SyncRcw0(&TIM4->SR, &Sim_TimSr[4]);
+    if (TIM4->EGR & TIM_EGR_UG)
+    {
+        TIM4->EGR = 0;
+        TIM4->CNT = 0;
+    }
+    if (TIM2->EGR & TIM_EGR_UG)
+    {
+        TIM2->EGR = 0;
+        TIM2->CNT = 0;
+        Sim_Tim2Update(t);
+        if (Sim_Tim2On)
+            Sim_Tim2Next = t + Sim_Tim2Period();
+    }
+    if ((TIM2->CR1 & TIM_CR1_CEN) && !Sim_Tim2On)
+    {
+        Sim_Tim2On = 1;
+        Sim_Tim2Psc = TIM2->PSC;
+        Sim_Tim2Next = t + (uint64_t)(Sim_Tim2Psc + 1) * (TIM2->ARR + 1 - TIM2->CNT);
+    }
+    else if (!(TIM2->CR1 & TIM_CR1_CEN))
+    {
+        Sim_Tim2On = 0;
+    }
+
+    /* TIM5 */
+    Sim_SyncRcw0(&TIM5->SR, &Sim_TimSr[5]);
+    if (TIM5->EGR & TIM_EGR_UG)
+    {
+        TIM5->EGR = 0;
+        Sim_Tim5Reset(t);
+    }
+    if ((TIM5->CR1 & TIM_CR1_CEN) && !Sim_Tim5On)
+    {
+        Sim_Tim5On = 1;
+        Sim_Tim5Base = Sim_Tim5Time = t;
+        Sim_Tim5Psc = TIM5->PSC;
+        Sim_Tim5In = Sim_WaveAt(t) & 3;
+        Sim_Tim5Count[0] = Sim_Tim5Count[1] = 0;
+    }
+    else if (!(TIM5->CR1 & TIM_CR1_CEN))
+    {
+        Sim_Tim5On = 0;
+    }
+
+    /* USART1: 状态位清除, 固件写 DR */
+    Sim_SyncRcw0(&USART1->SR, &Sim_UsartSr);
+    if (!(USART1->DR & SIM_DR_CANARY))
+    {
+        uint8_t b = USART1->DR;
+        USART1->DR = SIM_DR_CANARY | b;
+        Sim_UsartWrite(b, t);
+    }
+    Sim_UsartService(t);
+
+    /* EXTI: 写 1 清除挂起位 */
+    if (!(EXTI->PR & SIM_EXTI_CANARY))
+    {
+        Sim_ExtiPending &= ~EXTI->PR;
+        EXTI->PR = Sim_ExtiPending | SIM_EXTI_CANARY;
+    }
+}
+
+/**
+  * @brief  下一个外设事件的时刻
+  * @param  无
+  * @retval 时刻 (周期), 没有事件时为 UINT64_MAX
+  */
+uint64_t Sim_PeriphNextEvent(void)
+{
+    uint64_t next = SIM_NEVER;
+
+#define SIM_MIN(x)  do { uint64_t _v = (x); if (_v < next) next = _v; } while (0)
+    if (Sim_Tim2On)
+        SIM_MIN(Sim_Tim2Next);
+    for (int ch = 1; ch <= 7; ch++)
+        if (Sim_Dma[ch].On && (Sim_DmaCh[ch]->CCR & DMA_CCR1_MEM2MEM) && Sim_DmaCh[ch]->CNDTR)
+            SIM_MIN(Sim_Dma[ch].Next);
+    if (Sim_TxBusy)
+        SIM_MIN(Sim_TxDone);
+    if ((USART1->CR1 & USART_CR1_UE) && (USART1->CR1 & USART_CR1_RE) && Sim_RxLen > 0)
+        SIM_MIN(Sim_RxNext);
+    if (EXTI->IMR & 0xFF)
+        SIM_MIN(Sim_WaveNextChange(Sim_IdrTime));
+    if (Sim_Tim5On)
+    {
+        SIM_MIN(Sim_Tim5Overflow());
+        if (TIM5->CCER & (TIM_CCER_CC1E | TIM_CCER_CC2E))
+            SIM_MIN(Sim_WaveNextChange(Sim_Tim5Time));
+    }
+#undef SIM_MIN
+    return next;
+}
+
+/**
+  * @brief  处理时刻 t (含) 之前到期的事件, 并刷新 IDR / DWT
+  * @param  t: 当前时刻
+  * @retval 无
+  */
+void Sim_PeriphRun(uint64_t t)
+{
+    Sim_PeriphSync();
+
+    if (Sim_Tim2On && Sim_Tim2Next <= t)
+    {
+        Sim_Tim2Update(t);
+        Sim_Tim2Next += Sim_Tim2Period();
+        if (Sim_Tim2Next <= t)
+            Sim_Tim2Next = t + 1;
+    }
+
+    Sim_Tim5Run(t);
+
+    for (int ch = 1; ch <= 7; ch++)
+    {
+        if (Sim_Dma[ch].On && (Sim_DmaCh[ch]->CCR & DMA_CCR1_MEM2MEM) && Sim_DmaCh[ch]->CNDTR &&
+            Sim_Dma[ch].Next <= t)
+        {
+            Sim_DmaTransfer(ch, t);
+            Sim_Dma[ch].Next = t + SIM_M2M_CYCLES;
+        }
+    }
+
+    if (Sim_TxBusy && Sim_TxDone <= t)
+    {
+        if (Sim_TxLen == sizeof(Sim_TxBuf))
+        {
+            /* 上位机没有读取, 伪终端缓冲区满: 推迟 (相当于发送暂停) */
+            Sim_TxDone = t + Sim_CharCycles();
+        }
+        else
+        {
+            Sim_TxBuf[Sim_TxLen++] = Sim_TxShift;
+            if (Sim_TxHold)
+            {
+                Sim_TxShift = Sim_TxData;
+                Sim_TxHold = 0;
+                Sim_TxDone = t + Sim_CharCycles();
+                Sim_UsartSetSr(USART_FLAG_TXE, 0);
+            }
+            else
+            {
+                Sim_TxBusy = 0;
+                Sim_UsartSetSr(USART_FLAG_TC, 0);
+            }
+        }
+    }
+    Sim_UsartService(t);
+
+    if ((USART1->CR1 & USART_CR1_UE) && (USART1->CR1 & USART_CR1_RE) && Sim_RxLen > 0 &&
+        Sim_RxNext <= t)
+    {
+        uint8_t b = Sim_RxQueue[Sim_RxHead++];
+        Sim_RxLen--;
+        if (Sim_UsartSr & USART_FLAG_RXNE)
+        {
+            Sim_UsartSetSr(USART_FLAG_ORE, 0);      // 上一个字节还没读走, 本字节丢失
+        }
+        else
+        {
+            USART1->DR = SIM_DR_CANARY | b;
+            Sim_UsartSetSr(USART_FLAG_RXNE, 0);
+        }
+        Sim_RxNext = t + Sim_CharCycles();
+    }
+
+    Sim_GpioUpdate(t);
+    if (SIM_DWT_CTRL & 1)
+        SIM_DWT_CYCCNT = (uint32_t)t;
+}
+
+/**
+  * @brief  与伪终端交换数据 (每个 tick 一次, 避免逐字节系统调用)
+  * @note   收到的字节按字符时间逐个送入 DR; 发出的字节在缓冲区中攒到下一个 tick
+  * @param  无
+  * @retval 无
+  */
+void Sim_PeriphPoll(void)
+{
+    if (Sim_TxLen > 0)
+    {
+        ssize_t n = write(Sim_PtyFd, Sim_TxBuf, Sim_TxLen);
+        if (n > 0)
+        {
+            memmove(Sim_TxBuf, Sim_TxBuf + n, Sim_TxLen - n);
+            Sim_TxLen -= n;
+        }
+    }
+    if (Sim_RxLen == 0)
+    {
+        ssize_t n = read(Sim_PtyFd, Sim_RxQueue, sizeof(Sim_RxQueue));
+        if (n > 0)
+        {
+            Sim_RxHead = 0;
+            Sim_RxLen = n;
+            if (Sim_RxNext < Sim_Now)
+                Sim_RxNext = Sim_Now;
+        }
+    }
+}
+
+/**
+  * @brief  外设中断请求线的电平
+  * @param  irq: 中断号
+  * @retval 非 0: 请求有效
+  */
+int Sim_IrqLevel(int irq)
+{
+    uint32_t sr, cr;
+
+    switch (irq)
+    {
+    case EXTI0_IRQn: case EXTI1_IRQn: case EXTI2_IRQn: case EXTI3_IRQn: case EXTI4_IRQn:
+        return (Sim_ExtiPending & EXTI->IMR) & (1u << (irq - EXTI0_IRQn));
+    case EXTI9_5_IRQn:
+        return (Sim_ExtiPending & EXTI->IMR) & 0x3E0;
+    case DMA1_Channel1_IRQn: case DMA1_Channel2_IRQn: case DMA1_Channel3_IRQn:
+    case DMA1_Channel4_IRQn: case DMA1_Channel5_IRQn: case DMA1_Channel6_IRQn:
+    case DMA1_Channel7_IRQn:
+    {
+        int ch = irq - DMA1_Channel1_IRQn + 1;
+        return (DMA1->ISR >> ((ch - 1) * 4)) & Sim_DmaCh[ch]->CCR &
+               (DMA_CCR1_TCIE | DMA_CCR1_HTIE | DMA_CCR1_TEIE);
+    }
+    case TIM2_IRQn:
+        return Sim_TimSr[2] & TIM2->DIER & 0x5F;
+    case TIM4_IRQn:
+        return Sim_TimSr[4] & TIM4->DIER & 0x5F;
+    case TIM5_IRQn:
+        return Sim_TimSr[5] & TIM5->DIER & 0x5F;
+    case USART1_IRQn:
+        sr = Sim_UsartSr;
+        cr = USART1->CR1;
+        return (sr & cr & (USART_FLAG_TXE | USART_FLAG_TC | USART_FLAG_RXNE)) ||
+               ((sr & USART_FLAG_ORE) && (cr & USART_CR1_RXNEIE));
+    default:
+        return 0;
+    }
+}
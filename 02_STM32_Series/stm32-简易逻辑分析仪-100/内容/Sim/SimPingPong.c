@@ -0,0 +1,218 @@
+/**
+  ******************************************************************************
+  * @file    SimPingPong.c
+  * @brief   双缓冲测试 - 用模拟的定时器/循环 DMA 驱动 Hardware/PingPong.c
+  * @note    用法: ./pingpong_test [-v]
+  *          每个定时器周期 DMA 把样本序号写入 2*H 个样本的循环缓冲区, 写满前/后半区时
+  *          像 HT/TC 中断一样调用 PP_OnHalfComplete(). 主循环每次取出一个半区,
+  *          发送用时由场景决定, 发送完后检查数据:
+  *          - 每个填满的半区恰好是以下之一: 完整发出 (内容为 Seq*H 起的连续样本)、
+  *            计入 Dropped (未发送就被覆盖, 或发送中被覆盖)、结束时仍在等待发送
+  *          - 完整发出的块序号递增; 发送跟得上时 Dropped 为 0 且序号连续
+  *          - PP_Release() 的返回值与发送完时检查数据的结果一致 (发送中被覆盖返回 0)
+  *          另有 HT/TC/溢出的固定序列, 逐步检查状态. 全部通过时退出码为 0, 否则为 1
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "PingPong.h"
+
+#define HALF            64                  // 每个半区的样本数
+#define SAMPLES         200000              // 每个场景模拟的样本数
+
+static int Verbose;
+static int Fail;
+
+#define EXPECT(cond) do { if (!(cond)) { printf("  line %d: %s\n", __LINE__, #cond); bad++; } } while (0)
+
+/* 固定序列: 逐个事件检查状态 */
+static void Sequences(void)
+{
+    PingPong_TypeDef pp;
+    int bad = 0;
+
+    // 正常: HT -> 发送前半, TC -> 发送后半
+    PP_Init(&pp, HALF);
+    EXPECT(PP_Acquire(&pp) == -1);
+    PP_OnHalfComplete(&pp, 0);
+    EXPECT(pp.State[0] == PP_READY && pp.Seq[0] == 0);
+    EXPECT(PP_Acquire(&pp) == 0 && pp.State[0] == PP_BUSY);
+    EXPECT(PP_Acquire(&pp) == -1);
+    EXPECT(PP_Release(&pp, 0) == 1);
+    PP_OnHalfComplete(&pp, 1);
+    EXPECT(PP_Acquire(&pp) == 1 && pp.Seq[1] == 1);
+    EXPECT(PP_Release(&pp, 1) == 1);
+    EXPECT(pp.Dropped == 0 && pp.NextSeq == 2);
+
+    // 前半未取走就到 TC: DMA 已开始覆盖前半, 前半作废, 序号 0 空缺
+    PP_Init(&pp, HALF);
+    PP_OnHalfComplete(&pp, 0);
+    PP_OnHalfComplete(&pp, 1);
+    EXPECT(pp.State[0] == PP_FREE && pp.Dropped == HALF);
+    EXPECT(PP_Acquire(&pp) == 1 && pp.Seq[1] == 1);
+    EXPECT(PP_Acquire(&pp) == -1);
+    PP_Release(&pp, 1);
+
+    // 发送前半时到 TC: 前半仍由主循环持有, 只计丢失, 发完后释放
+    PP_Init(&pp, HALF);
+    PP_OnHalfComplete(&pp, 0);
+    EXPECT(PP_Acquire(&pp) == 0);
+    PP_OnHalfComplete(&pp, 1);
+    EXPECT(pp.State[0] == PP_BUSY && pp.Dropped == HALF);
+    EXPECT(PP_Release(&pp, 0) == 0);        // 发出的数据后半段已是新样本
+    EXPECT(PP_Acquire(&pp) == 1 && pp.Seq[1] == 1);
+
+    // 发送后半时又到 HT 和 TC: 后半在发送中被覆盖, 前半未取走又被覆盖
+    PP_OnHalfComplete(&pp, 0);
+    PP_OnHalfComplete(&pp, 1);
+    EXPECT(pp.State[1] == PP_READY && pp.State[0] == PP_FREE);
+    EXPECT(pp.Dropped == 3 * HALF && pp.Seq[1] == 3);
+    EXPECT(PP_Release(&pp, 1) == 0);        // 发送中被重新填满: 释放后仍等待发送
+    EXPECT(PP_Acquire(&pp) == 1 && pp.Seq[1] == 3);
+    EXPECT(PP_Release(&pp, 1) == 1);
+    EXPECT(PP_Acquire(&pp) == -1);
+
+    // 序号回绕后仍按先后取出
+    PP_Init(&pp, HALF);
+    pp.NextSeq = 0xFFFFFFFF;
+    PP_OnHalfComplete(&pp, 1);
+    EXPECT(PP_Acquire(&pp) == 1 && pp.Seq[1] == 0xFFFFFFFF);
+    PP_Release(&pp, 1);
+    PP_OnHalfComplete(&pp, 0);
+    EXPECT(PP_Acquire(&pp) == 0 && pp.Seq[0] == 0);
+
+    printf("%-10s %s\n", "sequences", bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+/* 伪随机数 (结果可重复) */
+static uint32_t Rand(void)
+{
+    static uint32_t x = 12345;
+    x = x * 1103515245 + 12345;
+    return x >> 8;
+}
+
+/*
+ * 模拟 TIM2 触发的循环 DMA 与主循环. 发送一个半区用 send_min..send_max 个样本周期,
+ * 两次取数之间主循环另有 gap 个样本周期在做别的事
+ */
+static void Stream(const char *name, uint32_t send_min, uint32_t send_max, uint32_t gap, int expect_clean)
+{
+    static uint32_t buf[2 * HALF];
+    PingPong_TypeDef pp;
+    uint32_t n, busy = 0, filled = 0, intact = 0, pending = 0, seq = 0;
+    uint32_t last_seq = 0, have_last = 0, gaps = 0, torn = 0;
+    int half = -1, bad = 0;
+
+    PP_Init(&pp, HALF);
+    memset(buf, 0xFF, sizeof(buf));
+    for (n = 0; n < SAMPLES; n++)
+    {
+        // DMA: 写满半区时进入 HT/TC 中断, 中断返回前 DMA 不会写入另一半区
+        if (n && n % HALF == 0)
+        {
+            PP_OnHalfComplete(&pp, (n / HALF - 1) & 1);
+            filled++;
+        }
+        buf[n % (2 * HALF)] = n;
+
+        // 主循环
+        if (busy)
+        {
+            if (--busy)
+                continue;
+            if (half >= 0)
+            {
+                uint32_t i, ok = 1;
+
+                for (i = 0; i < HALF; i++)
+                    ok &= buf[half * HALF + i] == seq * HALF + i;
+                if (ok)
+                {
+                    intact++;
+                    if (have_last && seq <= last_seq)
+                    {
+                        printf("  %s: block %u after %u\n", name, seq, last_seq);
+                        bad++;
+                    }
+                    gaps += have_last && seq != last_seq + 1;
+                    last_seq = seq;
+                    have_last = 1;
+                }
+                if (Verbose)
+                    printf("  %s %7u: sent half %d seq %u %s, dropped %u\n",
+                           name, n, half, seq, ok ? "intact" : "overwritten", pp.Dropped);
+                if (PP_Release(&pp, half) != ok)
+                {
+                    if (bad++ < 3)
+                        printf("  %s: seq %u %s but PP_Release returned %u\n",
+                               name, seq, ok ? "intact" : "overwritten", !ok);
+                }
+                torn += !ok;
+                half = -1;
+                busy = gap;
+                if (busy)
+                    continue;
+            }
+        }
+        half = PP_Acquire(&pp);
+        if (half >= 0)
+        {
+            seq = pp.Seq[half];
+            busy = send_min + Rand() % (send_max - send_min + 1);
+        }
+    }
+
+    // 结束时未发完 (此后没有再填满半区, 还未被覆盖) 和未取走的半区
+    if (half >= 0 && pp.NextSeq == seq + 1)
+        pending++;
+    pending += pp.State[0] == PP_READY;
+    pending += pp.State[1] == PP_READY;
+    if (intact + pp.Dropped / HALF + pending != filled || pp.Dropped % HALF)
+    {
+        printf("  %s: %u filled, %u intact + %u dropped + %u pending\n",
+               name, filled, intact, pp.Dropped / HALF, pending);
+        bad++;
+    }
+    if (expect_clean && (pp.Dropped || gaps || torn))
+    {
+        printf("  %s: dropped %u, %u sequence gaps, %u torn\n", name, pp.Dropped, gaps, torn);
+        bad++;
+    }
+    if (!expect_clean && !pp.Dropped)
+    {
+        printf("  %s: expected overruns\n", name);
+        bad++;
+    }
+    printf("%-10s %6u halves  %6u sent  %6u dropped  %6u torn  %s\n",
+           name, filled, intact, pp.Dropped / HALF, torn, bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v")) != -1)
+    {
+        if (opt == 'v')
+            Verbose = 1;
+        else
+        {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Sequences();
+    Stream("fast", 1, HALF / 2, 0, 1);
+    Stream("tight", HALF - 4, HALF - 1, 0, 1);         // 每块发送只比采样快一点
+    Stream("jitter", 1, HALF + HALF / 2, 0, 0);        // 偶尔慢于采样
+    Stream("slow", 2 * HALF, 3 * HALF, 0, 0);           // 始终慢于采样
+
+    printf(Fail ? "FAIL\n" : "PASS\n");
+    return Fail ? 1 : 0;
+}
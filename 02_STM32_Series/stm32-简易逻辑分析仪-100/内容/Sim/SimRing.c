@@ -0,0 +1,273 @@
+/**
+  ******************************************************************************
+  * @file    SimRing.c
+  * @brief   环形缓冲区测试 - 用模拟的发送 DMA 排空 Hardware/RingBuffer.c
+  * @note    用法: ./ring_test [-v]
+  *          发送: 主循环按 Serial_SendArray 的方式写入长度随机的消息 (缓冲区满时等待),
+  *          模拟的 DMA1 通道4 按 Serial_TxKick / DMA1_Channel4_IRQHandler 的方式取
+  *          Ring_PeekContiguous 的连续段, 每个串口字节时间读一个字节, 传完后
+  *          Ring_Skip 并启动下一段. 主循环与 DMA 交替的步数随机.
+  *          检查 DMA 读出的字节流与写入的完全一致 (没有被覆盖、重复或遗漏),
+  *          每段不跨过存储区末尾, 且 Head/Tail 多次回绕 uint16_t.
+  *          发送完成回调: 只在缓冲区排空、写入的字节全部发出后调用, 且每个场景都调用过;
+  *          chain 场景在回调中按 Serial_Write 的方式追加数据, 追加的数据同样须按序发出.
+  *          接收: 中断用 Ring_Put 逐字节写入, 主循环用 Ring_Get 读出, 检查满/空边界.
+  *          全部通过时退出码为 0, 否则为 1
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "RingBuffer.h"
+
+#define TX_SIZE         1024                // 与 Serial.c 的 SERIAL_TX_BUF_SIZE 一致
+#define RX_SIZE         256
+#define TX_BYTES        2000000             // 每个场景发送的字节数
+
+static int Verbose;
+static int Fail;
+
+/* 伪随机数 (结果可重复) */
+static uint32_t Rand(void)
+{
+    static uint32_t x = 12345;
+    x = x * 1103515245 + 12345;
+    return x >> 8;
+}
+
+/* 第 n 个发送字节的值 */
+static uint8_t Pattern(uint32_t n)
+{
+    return (uint8_t)(n * 7 + (n >> 8));
+}
+
+/* 模拟的发送 DMA 通道 */
+static struct
+{
+    RingBuffer_TypeDef *Ring;
+    const uint8_t *Cmar;        // 本段起始地址
+    uint16_t Length;            // 本段长度 (Serial_TxDmaLength), 0 = 空闲
+    uint16_t Cndtr;             // 剩余字节数
+    uint32_t Received;          // 已发出的字节数
+    uint32_t Segments;          // 已完成的段数
+    uint32_t Wraps;             // 在存储区末尾截断的段数
+    uint32_t Done;              // 发送完成回调次数
+    int Bad;
+} Dma;
+
+static uint32_t Sent;           // 已写入缓冲区的字节数
+static uint16_t Chain;          // 回调中追加的最大字节数, 0 = 不追加
+
+/* Serial_TxKick: DMA 空闲且有数据时启动下一段 */
+static void Dma_Kick(void)
+{
+    uint8_t *data;
+    uint16_t length;
+
+    if (Dma.Length)
+        return;
+    length = Ring_PeekContiguous(Dma.Ring, &data);
+    if (length == 0)
+        return;
+    if (data + length > Dma.Ring->Buffer + TX_SIZE)
+    {
+        printf("  segment %u bytes at offset %u runs past the buffer\n",
+               length, (unsigned)(data - Dma.Ring->Buffer));
+        Dma.Bad++;
+    }
+    Dma.Wraps += data + length == Dma.Ring->Buffer + TX_SIZE;
+    Dma.Cmar = data;
+    Dma.Length = length;
+    Dma.Cndtr = length;
+}
+
+/* 发送完成回调 (Serial_SetTxCallback): 在中断中用 Serial_Write 追加数据 */
+static void Tx_Done(void)
+{
+    uint8_t msg[64];
+    uint16_t len, i;
+
+    Dma.Done++;
+    if ((Ring_Used(Dma.Ring) != 0 || Dma.Received != Sent) && Dma.Bad++ < 3)
+        printf("  callback with %u bytes in ring, %u of %u sent\n", Ring_Used(Dma.Ring), Dma.Received, Sent);
+    if (!Chain || Sent >= TX_BYTES)
+        return;
+
+    len = 1 + Rand() % Chain;
+    for (i = 0; i < len; i++)
+        msg[i] = Pattern(Sent + i);
+    Sent += Ring_Write(Dma.Ring, msg, len);     // 缓冲区为空, 一定写得下
+    Dma_Kick();
+}
+
+/* 一个串口字节时间: 读出一个字节, 一段传完时进入传输完成中断 */
+static void Dma_Step(void)
+{
+    uint8_t byte;
+
+    if (!Dma.Length)
+        return;
+    byte = Dma.Cmar[Dma.Length - Dma.Cndtr];
+    if (byte != Pattern(Dma.Received) && Dma.Bad++ < 3)
+        printf("  byte %u: sent 0x%02X, expected 0x%02X\n", Dma.Received, byte, Pattern(Dma.Received));
+    Dma.Received++;
+    if (--Dma.Cndtr)
+        return;
+
+    // DMA1_Channel4_IRQHandler
+    Ring_Skip(Dma.Ring, Dma.Length);
+    Dma.Length = 0;
+    Dma.Segments++;
+    Dma_Kick();
+    if (!Dma.Length)
+        Tx_Done();
+}
+
+/*
+ * 发送 TX_BYTES 字节, 消息长度 1..max_msg; 主循环每写一次 DMA 走 0..max_steps 步;
+ * 发送完成回调每次追加 1..chain 字节
+ */
+static void Tx(const char *name, uint16_t max_msg, uint16_t max_steps, uint16_t chain)
+{
+    static uint8_t storage[TX_SIZE];
+    static uint8_t msg[TX_SIZE * 2];
+    RingBuffer_TypeDef rb;
+    uint32_t waits = 0, i, steps;
+
+    Ring_Init(&rb, storage, TX_SIZE);
+    rb.Head = rb.Tail = 0xFF00;         // 从接近回绕处开始
+    memset(&Dma, 0, sizeof(Dma));
+    Dma.Ring = &rb;
+    Sent = 0;
+    Chain = chain;
+
+    while (Sent < TX_BYTES)
+    {
+        uint16_t len = 1 + Rand() % max_msg, left, written;
+        const uint8_t *p = msg;
+
+        // 整条消息写完之前缓冲区不会排空, 回调不会插在消息中间
+        for (i = 0; i < len; i++)
+            msg[i] = Pattern(Sent + i);
+        Sent += len;
+
+        // Serial_SendArray: 写不下时等 DMA 腾出空间
+        for (left = len; left; left -= written, p += written)
+        {
+            written = Ring_Write(&rb, p, left);
+            if (Ring_Used(&rb) > TX_SIZE)
+            {
+                printf("  %s: %u bytes used\n", name, Ring_Used(&rb));
+                Dma.Bad++;
+            }
+            Dma_Kick();                 // Serial_Write 关中断后调用
+            if (written < left)
+            {
+                waits++;
+                Dma_Step();
+            }
+        }
+
+        steps = Rand() % (max_steps + 1);
+        while (steps--)
+            Dma_Step();
+    }
+    while (Dma.Length)
+        Dma_Step();
+
+    if (Dma.Received != Sent || Ring_Used(&rb) != 0)
+    {
+        printf("  %s: wrote %u, DMA sent %u, %u left in ring\n", name, Sent, Dma.Received, Ring_Used(&rb));
+        Dma.Bad++;
+    }
+    if (!Dma.Done)
+    {
+        printf("  %s: completion callback never called\n", name);
+        Dma.Bad++;
+    }
+    if (!Dma.Wraps)
+    {
+        printf("  %s: no segment ended at the buffer end\n", name);
+        Dma.Bad++;
+    }
+    if (Verbose || Dma.Bad)
+        printf("  %s: %u segments (%u at buffer end), %u waits for space, %u callbacks\n",
+               name, Dma.Segments, Dma.Wraps, waits, Dma.Done);
+    printf("%-10s %8u bytes  %7u segments  %s\n", name, Sent, Dma.Segments, Dma.Bad ? "FAIL" : "ok");
+    Fail += Dma.Bad != 0;
+}
+
+/* 接收: Ring_Put / Ring_Get 的满、空边界与数据顺序 */
+static void Rx(void)
+{
+    static uint8_t storage[RX_SIZE];
+    RingBuffer_TypeDef rb;
+    uint32_t put = 0, got = 0, n;
+    uint8_t byte;
+    int bad = 0;
+
+    Ring_Init(&rb, storage, RX_SIZE);
+    if (Ring_Get(&rb, &byte))
+        bad++;
+    while (Ring_Put(&rb, Pattern(put)))
+        put++;
+    if (put != RX_SIZE || Ring_Free(&rb) != 0)
+    {
+        printf("  rx: %u bytes fit, expected %u\n", put, RX_SIZE);
+        bad++;
+    }
+
+    for (n = 0; n < 200000; n++)
+    {
+        if (Rand() % 2)
+        {
+            if (Ring_Put(&rb, Pattern(put)))
+                put++;
+            else if (Ring_Used(&rb) != RX_SIZE)
+                bad++;
+        }
+        else if (Ring_Get(&rb, &byte))
+        {
+            if (byte != Pattern(got) && bad++ < 3)
+                printf("  rx: byte %u is 0x%02X, expected 0x%02X\n", got, byte, Pattern(got));
+            got++;
+        }
+        else if (Ring_Used(&rb) != 0)
+            bad++;
+    }
+    while (Ring_Get(&rb, &byte))
+        got++;
+    if (got != put)
+    {
+        printf("  rx: put %u, got %u\n", put, got);
+        bad++;
+    }
+    printf("%-10s %8u bytes  %s\n", "rx", got, bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v")) != -1)
+    {
+        if (opt == 'v')
+            Verbose = 1;
+        else
+        {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Tx("short", 8, 16, 0);              // 短应答, DMA 跟得上
+    Tx("frames", 600, 64, 0);           // 大帧, 缓冲区经常写满
+    Tx("burst", TX_SIZE * 2 - 1, 4, 0); // 单次写入超过缓冲区容量
+    Tx("chain", 32, 256, 64);           // 回调中接着发送
+    Rx();
+
+    printf(Fail ? "FAIL\n" : "PASS\n");
+    return Fail ? 1 : 0;
+}
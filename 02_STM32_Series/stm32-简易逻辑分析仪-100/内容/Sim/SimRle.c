@@ -0,0 +1,206 @@
+/**
+  ******************************************************************************
+  * @file    SimRle.c
+  * @brief   游程编码测试 - Hardware/Rle.c 的往返正确性、压缩率和编码耗时
+  * @note    用法: ./rle_test [-v] [-n 重复次数]
+  *          波形 (8 通道, 每样本 1 字节):
+  *            square   PA0 为 1kHz 方波 @100kHz, 其余通道为高 (自检接线)
+  *            uart     PA1 为 115200 波特率的随机字节 @1MHz, 其余通道为高
+  *            noise    每个样本随机 (最坏情况)
+  *            const    全部相同 (最长游程, 长度占 3 字节)
+  *          与固件 LA_SendFrame 一样按 256 样本分块编码, 输出缓冲区 512 字节.
+  *          检查: 每块解码后与原始数据一致; 输出缓冲区恰好够用时成功, 少 1 字节时返回 0;
+  *          截断的编码数据只解出完整游程. 统计压缩后/原始的字节比和每样本的
+  *          编码耗时 (主机 CPU 周期, 只用于比较, 不等于 Cortex-M3 的周期数).
+  *          往返检查全部通过时退出码为 0, 否则为 1
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "Rle.h"
+
+#define TRACE_LEN       65536
+#define CHUNK           256                 // 与 LogicAnalyzer.c 的 LA_RLE_CHUNK 一致
+
+static int Verbose;
+static int Fail;
+
+/* 伪随机数 (结果可重复) */
+static uint32_t Rand(void)
+{
+    static uint32_t x = 12345;
+    x = x * 1103515245 + 12345;
+    return x >> 8;
+}
+
+/* 计时: x86 上为 TSC 周期, 其他平台为纳秒 */
+static uint64_t Now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+static void Square(uint8_t *s, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+        s[i] = 0xFE | ((i / 50) & 1);       // 100kHz / 1kHz = 100 样本一个周期
+}
+
+static void Uart(uint8_t *s, uint32_t n)
+{
+    const double bit = 1000000.0 / 115200;  // 每位约 8.68 个样本
+    uint32_t i = 0;
+
+    while (i < n)
+    {
+        uint16_t frame = 0x200 | (uint16_t)(Rand() & 0xFF) << 1;    // 起始位 0, 8 位数据, 停止位 1
+        uint32_t idle = Rand() % 40;
+
+        for (uint32_t k = 0; k < idle && i < n; k++)
+            s[i++] = 0xFF;
+        for (uint32_t k = 0; k < (uint32_t)(10 * bit) && i < n; k++)
+            s[i++] = 0xFD | ((frame >> (uint32_t)(k / bit)) & 1) << 1;
+    }
+}
+
+static void Noise(uint8_t *s, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++)
+        s[i] = Rand();
+}
+
+static void Const(uint8_t *s, uint32_t n)
+{
+    memset(s, 0xA5, n);
+}
+
+/* 一块的往返检查, 返回编码长度 */
+static uint32_t RoundTrip(const char *name, const uint8_t *src, uint32_t n, int *bad)
+{
+    static uint8_t enc[CHUNK * 2 + 16], dec[TRACE_LEN + 1];
+    uint32_t len = RLE_Encode(src, n, enc, CHUNK * 2);
+    uint32_t out, cut;
+
+    if (len == 0)
+    {
+        if ((*bad)++ < 3)
+            printf("  %s: %u samples do not fit in %u bytes\n", name, n, CHUNK * 2);
+        return 0;
+    }
+    out = RLE_Decode(enc, len, dec, sizeof(dec));
+    if (out != n || memcmp(dec, src, n))
+    {
+        if ((*bad)++ < 3)
+            printf("  %s: %u samples -> %u bytes -> %u samples, %s\n", name, n, len, out,
+                   out == n ? "data differs" : "count differs");
+        return len;
+    }
+    // 输出缓冲区恰好够用 / 少 1 字节
+    if (RLE_Encode(src, n, enc, len) != len || RLE_Encode(src, n, enc, len - 1) != 0)
+    {
+        if ((*bad)++ < 3)
+            printf("  %s: output limit %u not exact\n", name, len);
+    }
+    // 截断的编码数据: 解出的样本是原始数据的前缀, 且不超过 dstSize
+    cut = Rand() % len;
+    out = RLE_Decode(enc, cut, dec, sizeof(dec));
+    if (out > n || memcmp(dec, src, out))
+    {
+        if ((*bad)++ < 3)
+            printf("  %s: truncated at %u bytes decodes %u samples\n", name, cut, out);
+    }
+    if (n > 1 && RLE_Decode(enc, len, dec, n - 1) != n - 1)
+    {
+        if ((*bad)++ < 3)
+            printf("  %s: decode did not stop at dstSize\n", name);
+    }
+    return len;
+}
+
+static void Trace(const char *name, void (*gen)(uint8_t *, uint32_t), int reps)
+{
+    static uint8_t s[TRACE_LEN], enc[CHUNK * 2];
+    uint64_t raw = 0, packed = 0, sink = 0, best = ~0ull;
+    uint32_t off, n;
+    int bad = 0;
+
+    gen(s, TRACE_LEN);
+    for (off = 0; off < TRACE_LEN; off += n)
+    {
+        n = (TRACE_LEN - off > CHUNK) ? CHUNK : TRACE_LEN - off;
+        packed += RoundTrip(name, s + off, n, &bad);
+        raw += n;
+    }
+    // 整段一次编码 (长游程), 输出缓冲区足够大
+    {
+        static uint8_t big[TRACE_LEN * 2], dec[TRACE_LEN];
+        uint32_t len = RLE_Encode(s, TRACE_LEN, big, sizeof(big));
+        if (!len || RLE_Decode(big, len, dec, sizeof(dec)) != TRACE_LEN || memcmp(dec, s, TRACE_LEN))
+        {
+            printf("  %s: whole trace round trip failed\n", name);
+            bad++;
+        }
+    }
+
+    // 耗时: 按块编码整段, 取 reps 次中最短的一次
+    for (int r = 0; r < reps; r++)
+    {
+        uint64_t t0 = Now();
+        for (off = 0; off < TRACE_LEN; off += CHUNK)
+            sink += RLE_Encode(s + off, CHUNK, enc, sizeof(enc));
+        t0 = Now() - t0;
+        if (t0 < best)
+            best = t0;
+    }
+    if (Verbose)
+        printf("  %s: %llu bytes encoded in %d runs\n", name, (unsigned long long)sink, reps);
+
+    printf("%-8s %7llu -> %7llu bytes  ratio %6.3f  %6.2f %s/sample  %s\n",
+           name, (unsigned long long)raw, (unsigned long long)packed, (double)packed / raw,
+           (double)best / TRACE_LEN,
+#if defined(__x86_64__) || defined(__i386__)
+           "cycles",
+#else
+           "ns",
+#endif
+           bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+int main(int argc, char **argv)
+{
+    int opt, reps = 20;
+
+    while ((opt = getopt(argc, argv, "vn:")) != -1)
+    {
+        if (opt == 'v')
+            Verbose = 1;
+        else if (opt == 'n')
+            reps = atoi(optarg) > 0 ? atoi(optarg) : 1;
+        else
+        {
+            fprintf(stderr, "usage: %s [-v] [-n repeats]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Trace("square", Square, reps);
+    Trace("uart", Uart, reps);
+    Trace("noise", Noise, reps);
+    Trace("const", Const, reps);
+
+    printf(Fail ? "FAIL\n" : "PASS\n");
+    return Fail ? 1 : 0;
+}
@@ -0,0 +1,261 @@
+/**
+  ******************************************************************************
+  * @file    SimTrigMatch.c
+  * @brief   多通道触发测试 - 用合成波形检查 Hardware/TrigMatch.c
+  * @note    用法: ./trigmatch_test [-v]
+  *          对每种匹配方式, 用逐位比较的参考实现 (不用查找表) 求出第一个触发样本,
+  *          再把同一段波形切成长度随机的块依次交给 TM_Scan (相当于 DMA 半传输/
+  *          传输完成中断), 检查报告的触发位置一致:
+  *          - 值/掩码匹配 (电平), 任意通道跳变 (边沿), 两级顺序触发, 掩码随机
+  *          - 触发样本恰好落在块的第一个/最后一个样本, 以及只有 1 个样本的块
+  *          - 触发前样本数 (holdoff): 其间的匹配不报告, 但状态照常跟踪,
+  *            触发点恰在 pre-1 / pre / pre+1 处
+  *          全部通过时退出码为 0, 否则为 1
+  ******************************************************************************
+  */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "TrigMatch.h"
+
+#define TRACE_LEN       2048
+#define ROUNDS          20000
+
+static int Verbose;
+static int Fail;
+
+/* 伪随机数 (结果可重复) */
+static uint32_t Rand(void)
+{
+    static uint32_t x = 12345;
+    x = x * 1103515245 + 12345;
+    return x >> 8;
+}
+
+/* 匹配条件 */
+typedef struct
+{
+    uint8_t Mode;
+    uint8_t ValueA, MaskA, ValueB, MaskB;
+    uint16_t Window;
+} Cond_TypeDef;
+
+static int Match(uint8_t x, uint8_t value, uint8_t mask)
+{
+    for (int ch = 0; ch < 8; ch++)
+        if ((mask >> ch & 1) && (x >> ch & 1) != (value >> ch & 1))
+            return 0;
+    return 1;
+}
+
+/* 参考实现: 第一个不早于 holdoff 的触发样本, 没有时为 -1 */
+static int32_t Reference(const Cond_TypeDef *c, const uint8_t *s, uint32_t n, uint32_t holdoff)
+{
+    int32_t lastA = -1;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        int hit = 0;
+
+        switch (c->Mode)
+        {
+        case TM_MODE_PATTERN:
+            hit = Match(s[i], c->ValueA, c->MaskA) && (i == 0 || !Match(s[i - 1], c->ValueA, c->MaskA));
+            break;
+        case TM_MODE_ANYEDGE:
+            for (int ch = 0; ch < 8 && i > 0; ch++)
+                if ((c->MaskA >> ch & 1) && (s[i] >> ch & 1) != (s[i - 1] >> ch & 1))
+                    hit = 1;
+            break;
+        default:
+            // 状态B在最近一次状态A之后的 Window 个样本内
+            hit = lastA >= 0 && i - lastA <= (c->Window ? c->Window : 1u) && Match(s[i], c->ValueB, c->MaskB);
+            if (Match(s[i], c->ValueA, c->MaskA))
+                lastA = i;
+            break;
+        }
+        if (hit && i >= holdoff)
+            return i;
+    }
+    return -1;
+}
+
+static void Init(TrigMatch_TypeDef *tm, const Cond_TypeDef *c)
+{
+    if (c->Mode == TM_MODE_PATTERN)
+        TM_InitPattern(tm, c->ValueA, c->MaskA);
+    else if (c->Mode == TM_MODE_ANYEDGE)
+        TM_InitAnyEdge(tm, c->MaskA);
+    else
+        TM_InitSequence(tm, c->ValueA, c->MaskA, c->ValueB, c->MaskB, c->Window);
+}
+
+/* 按 cut[] 中的块长依次扫描 (0 结尾, 之后为一整块), 返回触发样本在整段中的位置 */
+static int32_t Scan(const Cond_TypeDef *c, const uint8_t *s, uint32_t n, uint32_t holdoff, const uint16_t *cut)
+{
+    static TrigMatch_TypeDef tm;
+    uint32_t pos = 0;
+
+    Init(&tm, c);
+    TM_Reset(&tm, holdoff);
+    while (pos < n)
+    {
+        uint32_t len = *cut ? *cut++ : n - pos;
+        int32_t hit;
+
+        if (len > n - pos)
+            len = n - pos;
+        hit = TM_Scan(&tm, s + pos, len);
+        if (hit >= 0)
+        {
+            if ((uint32_t)hit >= len)
+                return -2;
+            return pos + hit;
+        }
+        pos += len;
+    }
+    return -1;
+}
+
+static int Compare(const char *what, const Cond_TypeDef *c, const uint8_t *s, uint32_t n,
+                   uint32_t holdoff, const uint16_t *cut)
+{
+    int32_t want = Reference(c, s, n, holdoff);
+    int32_t got = Scan(c, s, n, holdoff, cut);
+
+    if (got == want)
+        return 0;
+    printf("  %s: mode %u A=%02X/%02X B=%02X/%02X window %u holdoff %u: trigger at %d, expected %d\n",
+           what, c->Mode, c->ValueA, c->MaskA, c->ValueB, c->MaskB, c->Window, holdoff, got, want);
+    return 1;
+}
+
+/* 合成波形: 每个通道按各自的概率翻转, 平均周期从几个样本到上百个样本 */
+static void Synth(uint8_t *s, uint32_t n)
+{
+    uint16_t flip[8];
+    uint8_t x = Rand();
+
+    for (int ch = 0; ch < 8; ch++)
+        flip[ch] = 1 + Rand() % 200;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        for (int ch = 0; ch < 8; ch++)
+            if (Rand() % 1000 < flip[ch])
+                x ^= 1 << ch;
+        s[i] = x;
+    }
+}
+
+static void RandomCond(Cond_TypeDef *c, uint8_t mode)
+{
+    c->Mode = mode;
+    c->MaskA = Rand() % 4 ? Rand() : 0xFF;
+    c->ValueA = Rand();
+    c->MaskB = Rand();
+    c->ValueB = Rand();
+    c->Window = Rand() % 4 ? 1 + Rand() % 64 : Rand() % 3;
+}
+
+/* 随机波形、条件、块长与 holdoff */
+static void Random(const char *name, uint8_t mode)
+{
+    static uint8_t s[TRACE_LEN];
+    uint16_t cut[64];
+    Cond_TypeDef c;
+    int bad = 0, hits = 0;
+
+    for (int r = 0; r < ROUNDS && bad < 5; r++)
+    {
+        uint32_t n = 1 + Rand() % TRACE_LEN, holdoff = Rand() % 3 ? Rand() % n : 0, k;
+
+        Synth(s, n);
+        RandomCond(&c, mode);
+        for (k = 0; k < 63; k++)
+            cut[k] = Rand() % 4 ? 1 + Rand() % 256 : 1 + Rand() % 4;
+        cut[k] = 0;
+        bad += Compare(name, &c, s, n, holdoff, cut);
+        hits += Reference(&c, s, n, holdoff) >= 0;
+    }
+    if (Verbose)
+        printf("  %s: %d of %d rounds triggered\n", name, hits, ROUNDS);
+    printf("%-10s %6d rounds  %s\n", name, ROUNDS, bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+/*
+ * 固定波形: 触发点附近逐一切分块边界, 触发前样本数取触发点前后
+ */
+static void Boundaries(void)
+{
+    static const Cond_TypeDef conds[] = {
+        {TM_MODE_PATTERN, 0x05, 0x0F, 0, 0, 0},         // PA0-3 = 0101
+        {TM_MODE_ANYEDGE, 0x00, 0x80, 0, 0, 0},         // PA7 任一边沿
+        {TM_MODE_SEQUENCE, 0x01, 0x01, 0x02, 0x03, 5},  // PA0 高, 5 个样本内 PA1 高且 PA0 低
+    };
+    static uint8_t s[300];
+    uint16_t cut[3];
+    int bad = 0;
+
+    // 开头全 0, 第 100 个样本 PA0 高; 第 103 个样本为 0x85: PA0-3=0101 且 PA7 上升沿
+    memset(s, 0, sizeof(s));
+    s[100] = 0x01;
+    s[101] = 0x01;
+    s[103] = 0x85;
+    s[104] = 0x02;
+    for (int i = 200; i < 300; i++)
+        s[i] = 0x85;                                    // 再次进入匹配并保持
+
+    for (unsigned k = 0; k < sizeof(conds) / sizeof(conds[0]); k++)
+    {
+        const Cond_TypeDef *c = &conds[k];
+        int32_t at = Reference(c, s, sizeof(s), 0);
+
+        // 块边界放在触发点前后各 3 个样本内的每个位置, 含 1 个样本的块
+        for (int32_t b = at - 3; b <= at + 3; b++)
+        {
+            cut[0] = b;
+            cut[1] = 1;
+            cut[2] = 0;
+            bad += Compare("boundary", c, s, sizeof(s), 0, cut);
+        }
+        // 触发前样本数恰在触发点前后: 被跳过时应等到下一次进入匹配
+        for (int32_t pre = at - 1; pre <= at + 1; pre++)
+            for (int32_t b = 1; b <= 8; b++)
+            {
+                cut[0] = b;
+                cut[1] = 0;
+                bad += Compare("holdoff", c, s, sizeof(s), pre, cut);
+            }
+        // 已处于匹配状态时结束 holdoff, 值/掩码匹配不应立刻触发
+        cut[0] = 0;
+        bad += Compare("inside", c, s, sizeof(s), 250, cut);
+    }
+    printf("%-10s %s\n", "boundary", bad ? "FAIL" : "ok");
+    Fail += bad != 0;
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v")) != -1)
+    {
+        if (opt == 'v')
+            Verbose = 1;
+        else
+        {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Boundaries();
+    Random("pattern", TM_MODE_PATTERN);
+    Random("anyedge", TM_MODE_ANYEDGE);
+    Random("sequence", TM_MODE_SEQUENCE);
+
+    printf(Fail ? "FAIL\n" : "PASS\n");
+    return Fail ? 1 : 0;
+}
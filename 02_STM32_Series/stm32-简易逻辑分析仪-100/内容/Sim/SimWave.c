@@ -0,0 +1,209 @@
+/**
+  ******************************************************************************
+  * @file    SimWave.c
+  * @brief   GPIOA (PA0-PA7) 输入波形
+  * @note    波形脚本每行一条, # 之后为注释, 时间单位微秒:
+  *            clock <引脚> <频率Hz> [占空比% [相位us]]   方波, 引脚 0-7
+  *            set <时间us> <值>                          该时刻起非方波引脚的电平 (0x 开头为十六进制)
+  *            loop <周期us>                              set 序列按此周期重复
+  *          未被 set 设置前所有引脚为高 (上拉).
+  ******************************************************************************
+  */
+
+#include "stm32f10x.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Sim.h"
+
+#define SIM_WAVE_STEPS      1024        // set 行数上限
+#define SIM_US(x)           ((uint64_t)llround((x) * (SIM_CLOCK / 1000000)))
+
+static struct
+{
+    uint64_t Period;            // 0: 该引脚不是方波
+    uint64_t High;
+    uint64_t Phase;
+} Sim_Clock[8];
+
+static struct
+{
+    uint64_t Time;
+    uint8_t Value;
+} Sim_Step[SIM_WAVE_STEPS];
+
+static int Sim_Steps;
+static uint64_t Sim_Loop;       // 0: 不重复
+static uint8_t Sim_ClockMask;
+
+/**
+  * @brief  默认波形: PA0 为 1kHz 方波 (相当于自测时 PB1 接 PA0), 其余为高
+  * @param  无
+  * @retval 无
+  */
+void Sim_WaveDefault(void)
+{
+    memset(Sim_Clock, 0, sizeof(Sim_Clock));
+    Sim_Steps = 0;
+    Sim_Loop = 0;
+    Sim_Clock[0].Period = SIM_US(1000);
+    Sim_Clock[0].High = SIM_US(500);
+    Sim_ClockMask = 0x01;
+}
+
+/**
+  * @brief  读取波形脚本
+  * @param  path: 文件名
+  * @retval 0: 成功, -1: 失败 (已打印原因)
+  */
+int Sim_WaveLoad(const char *path)
+{
+    char line[128];
+    int n = 0;
+    FILE *f = fopen(path, "r");
+
+    if (!f)
+    {
+        perror(path);
+        return -1;
+    }
+    memset(Sim_Clock, 0, sizeof(Sim_Clock));
+    Sim_Steps = 0;
+    Sim_Loop = 0;
+    Sim_ClockMask = 0;
+
+    while (fgets(line, sizeof(line), f))
+    {
+        char *hash = strchr(line, '#');
+        char cmd[16];
+        double a = 0, b = 0, c = 0;
+        int fields;
+
+        n++;
+        if (hash)
+            *hash = '\0';
+        fields = sscanf(line, "%15s %lf %lf %lf", cmd, &a, &b, &c);
+        if (fields <= 0)
+            continue;
+
+        if (strcmp(cmd, "clock") == 0 && fields >= 3 && a >= 0 && a < 8 && b > 0)
+        {
+            int pin = (int)a;
+            double duty = fields >= 4 ? c : 50;
+            /* 相位在占空比之后 */
+            double phase = 0;
+            if (fields >= 4)
+                sscanf(line, "%*s %*s %*s %*s %lf", &phase);
+            Sim_Clock[pin].Period = (uint64_t)llround((double)SIM_CLOCK / b);
+            Sim_Clock[pin].High = (uint64_t)llround(Sim_Clock[pin].Period * duty / 100.0);
+            Sim_Clock[pin].Phase = SIM_US(phase);
+            if (Sim_Clock[pin].Period < 2)
+                Sim_Clock[pin].Period = 2;
+            Sim_ClockMask |= 1u << pin;
+        }
+        else if (strcmp(cmd, "set") == 0 && fields >= 2 && Sim_Steps < SIM_WAVE_STEPS)
+        {
+            char value[16];
+            if (sscanf(line, "%*s %*s %15s", value) != 1)
+                goto bad;
+            Sim_Step[Sim_Steps].Time = SIM_US(a);
+            Sim_Step[Sim_Steps].Value = (uint8_t)strtoul(value, NULL, 0);
+            if (Sim_Steps > 0 && Sim_Step[Sim_Steps].Time < Sim_Step[Sim_Steps - 1].Time)
+                goto bad;
+            Sim_Steps++;
+        }
+        else if (strcmp(cmd, "loop") == 0 && fields >= 2 && a > 0)
+        {
+            Sim_Loop = SIM_US(a);
+        }
+        else
+        {
+            goto bad;
+        }
+    }
+    fclose(f);
+    return 0;
+
+bad:
+    fprintf(stderr, "%s:%d: bad line: %s", path, n, line);
+    fclose(f);
+    return -1;
+}
+
+/**
+  * @brief  set 序列在时刻 t 的电平
+  */
+static uint8_t Sim_StepAt(uint64_t t)
+{
+    uint8_t v = 0xFF;
+
+    if (Sim_Loop)
+        t %= Sim_Loop;
+    for (int i = 0; i < Sim_Steps && Sim_Step[i].Time <= t; i++)
+        v = Sim_Step[i].Value;
+    return v;
+}
+
+/**
+  * @brief  时刻 t 的 PA0-PA7 输入电平
+  * @param  t: 时刻 (周期)
+  * @retval 8 位电平
+  */
+uint8_t Sim_WaveAt(uint64_t t)
+{
+    uint8_t v = Sim_StepAt(t) & ~Sim_ClockMask;
+
+    for (int pin = 0; pin < 8; pin++)
+    {
+        uint64_t period = Sim_Clock[pin].Period;
+        if (period && (t + period - Sim_Clock[pin].Phase % period) % period < Sim_Clock[pin].High)
+            v |= 1u << pin;
+    }
+    return v;
+}
+
+/**
+  * @brief  t 之后下一次可能变化的时刻
+  * @param  t: 时刻 (周期)
+  * @retval 时刻, 波形不再变化时为 UINT64_MAX
+  */
+uint64_t Sim_WaveNextChange(uint64_t t)
+{
+    uint64_t next = UINT64_MAX;
+
+    for (int pin = 0; pin < 8; pin++)
+    {
+        uint64_t period = Sim_Clock[pin].Period;
+        uint64_t e;
+        if (!period)
+            continue;
+        uint64_t p = (t + period - Sim_Clock[pin].Phase % period) % period;
+        e = t + (p < Sim_Clock[pin].High ? Sim_Clock[pin].High - p : period - p);
+        if (e < next)
+            next = e;
+    }
+
+    if (Sim_Steps)
+    {
+        uint64_t base = 0, tm = t, e = UINT64_MAX;
+        if (Sim_Loop)
+        {
+            tm = t % Sim_Loop;
+            base = t - tm;
+        }
+        for (int i = 0; i < Sim_Steps; i++)
+        {
+            if (Sim_Step[i].Time > tm)
+            {
+                e = base + Sim_Step[i].Time;
+                break;
+            }
+        }
+        if (e == UINT64_MAX && Sim_Loop)
+            e = base + Sim_Loop + Sim_Step[0].Time;
+        if (e < next)
+            next = e;
+    }
+    return next;
+}
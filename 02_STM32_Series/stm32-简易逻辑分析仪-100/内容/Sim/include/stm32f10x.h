@@ -0,0 +1,18 @@
+/*
+ * 模拟器用的 stm32f10x.h 包装: 先包含 Start/stm32f10x.h 取得寄存器定义和外设库,
+ * 再把中断开关和 WFI 换成模拟器的实现. core_cm3.h 中 GCC 分支的内联汇编函数
+ * 因不再被调用, 不会生成代码.
+ */
+
+#ifndef __SIM_STM32F10X_H
+#define __SIM_STM32F10X_H
+
+#include_next "stm32f10x.h"
+
+#include "Sim.h"
+
+#define __disable_irq()     Sim_DisableIrq()
+#define __enable_irq()      Sim_EnableIrq()
+#define __WFI()             Sim_Wfi()
+
+#endif
@@ -11,6 +11,7 @@
 #include "Serial.h"
 #include "LogicAnalyzer.h"
 #include "CommandParser.h"
+#include "Measure.h"
 
 /**
   * @brief  初始化测试信号输出 (PB1 - TIM3_CH4 PWM)
@@ -56,7 +57,7 @@ static void TestSignal_Init(void)
     /* 启动 TIM3 */
     TIM_Cmd(TIM3, ENABLE);
     
-    Serial_SendString("[DEBUG] TIM3 PWM on PB1 initialized (1kHz)\r\n");
+    LA_DEBUG_PRINTF("[DEBUG] TIM3 PWM on PB1 initialized (1kHz)\r\n");
 }
 
 /**
@@ -112,6 +113,7 @@ int main(void)
     Serial_SendString("  Simple Logic Analyzer v1.0\r\n");
     Serial_SendString("  GD32F103RCT6\r\n");
     Serial_SendString("================================\r\n");
+    Serial_Printf("Buffer: %u bytes, max %u samples\r\n", LA_GetBufferSize(), LA_GetMaxSampleCount());
     Serial_SendString("Type 'HELP' for commands.\r\n");
     Serial_SendString("\r\n");
     Serial_SendString("[SELF-TEST] PB1 outputs 1kHz PWM.\r\n");
@@ -120,25 +122,29 @@ int main(void)
     /* 主循环 */
     while (1)
     {
-        /* 检查是否收到串口命令 */
-        if (Serial_GetRxComplete())
+        /* 处理已收到的串口命令 (每轮一行, 其余留在接收缓冲区) */
+        char *cmd = Serial_GetLine();
+        if (cmd)
         {
-            char *cmd = Serial_GetRxBuffer();
             CMD_Parse(cmd);
-            Serial_ClearRxBuffer();
         }
         
-        /* 检查采样是否完成 (只触发一次) */
-        static uint8_t lastCaptureState = 0;
-        uint8_t currentCaptureState = LA_IsCaptureComplete();
+        /* BAUD 命令的波特率切换与超时恢复 */
+        Serial_BaudPoll();
         
-        if (currentCaptureState && !lastCaptureState)
+        /* 流式采样: 发送已填满的半区 */
+        LA_StreamProcess();
+        
+        /* 频率测量: 每个统计窗口发送一条记录 */
+        Measure_Process();
+        
+        /* 采样由中断推进, 这里只检查是否刚刚采满 (每次采样报告一次) */
+        if (LA_Poll())
         {
             Serial_SendString("CAPTURE COMPLETE\r\n");
             
             /* 自动发送数据 */
             LA_SendData();
         }
-        lastCaptureState = currentCaptureState;
     }
 }
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+波形绘制性能测试 - 测量 1k / 64k / 1M 样本时的重绘耗时
+
+用法: python bench_render.py [--width 860] [--repeat 5]
+有图形界面时在真实的 Tk 画布上绘制; 没有显示器时 (如 SSH) 改用只计数的
+假画布, 此时只测量抽取计算本身.
+"""
+
+import argparse
+import random
+import time
+
+from waveform import WaveModel, render_waveform
+
+SIZES = (1000, 64 * 1024, 1024 * 1024)
+HEIGHT = 300
+
+
+class CountingCanvas:
+    """只统计画布对象数的假画布"""
+
+    def __init__(self):
+        self.items = 0
+
+    def _create(self, *args, **kwargs):
+        self.items += 1
+
+    create_line = create_rectangle = create_text = _create
+
+    def delete(self, *args):
+        self.items = 0
+
+    def update_idletasks(self):
+        pass
+
+
+def make_samples(n, seed=1):
+    """合成 8 通道测试信号
+
+    PA0 每样本翻转 (最坏情况), PA1 16 样本周期方波, PA2 1000 样本周期方波,
+    PA3 随机噪声, PA4 稀疏突发, PA5-7 保持不变
+    """
+    rnd = random.Random(seed)
+    out = bytearray(n)
+    burst = 0
+    for i in range(n):
+        if burst == 0 and rnd.random() < 0.001:
+            burst = 200
+        v = (i & 1) | (((i >> 3) & 1) << 1) | (((i // 500) & 1) << 2)
+        v |= rnd.getrandbits(1) << 3
+        if burst:
+            v |= (burst & 1) << 4
+            burst -= 1
+        out[i] = v | 0xA0
+    return bytes(out)
+
+
+def make_canvas(width):
+    """优先使用真实 Tk 画布"""
+    try:
+        import tkinter as tk
+        root = tk.Tk()
+    except Exception:
+        return None, CountingCanvas(), "counting"
+    canvas = tk.Canvas(root, width=width, height=HEIGHT, bg="black")
+    canvas.pack()
+    root.update()
+    return root, canvas, "tk"
+
+
+def time_redraw(canvas, model, start, end, width, repeat):
+    """返回 (平均耗时 ms, 画布对象数)"""
+    best = None
+    items = 0
+    for _ in range(repeat):
+        t0 = time.perf_counter()
+        canvas.delete("all")
+        items = render_waveform(canvas, model, start, end, width, HEIGHT)
+        canvas.update_idletasks()
+        dt = time.perf_counter() - t0
+        best = dt if best is None else min(best, dt)
+    return best * 1000, items
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--width", type=int, default=860, help="画布宽度 (像素)")
+    parser.add_argument("--repeat", type=int, default=5, help="每项重复次数, 取最好成绩")
+    args = parser.parse_args()
+
+    root, canvas, kind = make_canvas(args.width)
+    print(f"canvas: {kind}, width={args.width}px, best of {args.repeat}")
+    print(f"{'samples':>10} {'index ms':>10} {'full ms':>10} {'x100 ms':>10} {'x1000 ms':>10} {'items':>7}")
+
+    for n in SIZES:
+        samples = make_samples(n)
+        t0 = time.perf_counter()
+        model = WaveModel(samples)
+        build = (time.perf_counter() - t0) * 1000
+
+        full, items = time_redraw(canvas, model, 0, n, args.width, args.repeat)
+        mid = n // 2
+        zoom100, _ = time_redraw(canvas, model, mid, mid + max(1, n // 100), args.width, args.repeat)
+        zoom1000, _ = time_redraw(canvas, model, mid, mid + max(1, n // 1000), args.width, args.repeat)
+        print(f"{n:>10} {build:>10.1f} {full:>10.1f} {zoom100:>10.1f} {zoom1000:>10.1f} {items:>7}")
+
+    if root is not None:
+        root.destroy()
+
+
+if __name__ == '__main__':
+    main()
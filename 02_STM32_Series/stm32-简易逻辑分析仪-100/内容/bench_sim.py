@@ -0,0 +1,406 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+模拟器回归测试 - 在 Sim/la_sim 上反复采样, 检查波形与触发位置, 统计吞吐量
+
+用法: python bench_sim.py [--count 1000] [--rate 100k] [--caps 200] [--speed 200] [--pipeline 2000]
+                         [--meas 50] [--stream 100] [--comp 50] [--cal 1] [--turbo 5]
+先在 Sim/ 下 make. 默认波形中 PA0 为 1kHz 方波, 其余通道为高:
+- 无触发采样: PA0 半周期应为 rate/2000 个样本, 其余通道恒为 1
+- 上升沿触发: 触发点 (COUNT * POS%) 处 PA0 应由 0 变 1, 允许 ±1 个样本
+  (边沿与采样时刻重合时, 该样本已是新电平)
+- 流水线: 不等应答连续发送 COUNT 命令, 未应答的字节数不超过接收缓冲区,
+  应答须一条不少且顺序一致, RXSTAT 不应有丢失
+- 灌满: 一次写入远超接收缓冲区的命令, 允许整行丢失, 但收到的应答
+  须都是某条已发命令的正确应答且顺序不乱, 之后 PING 仍正常
+- 测量: MEAS 0 与采样同时进行, 每条记录 (首条除外) 须为 1000Hz / 50%,
+  边沿数为周期数的 2 倍; 期间的采样数据照常检查
+- 流式采样: 以串口跟得上的采样率 STREAM, 块序号须连续, 拼接后的 PA0 半周期不变,
+  STOP 应答 DROPPED=0, 没有发送中被覆盖的事件行 EVT: STREAM ... TORN
+- 校准: 'CAL;PING' 的应答须恰为 OK: CALIBRATING 和 OK: PONG, 结果另以事件行 EVT: CAL 到达,
+  偏差不超过分辨率; 校准中 ABORT 的应答为 OK: ABORTED, 另有事件行 EVT: CAL ABORTED
+- 压缩: COMP ON 后无触发采样, 帧须带 RLE 标志且解压后的波形检查同上, 打印线上字节数/样本数
+- 极速: RATE MAX 报告的实测采样率须非 0, 之后的 CAP 帧采样率与之相同, 按该采样率检查波形
+  (样本数取 TURBO_COUNT, 保证 PA0 有几个完整的半周期)
+任一检查失败时退出码为 1.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import time
+
+import serial
+
+from serial_link import (SerialLink, FRAME_FLAG_RLE, FRAME_TYPE_MEAS, FRAME_TYPE_STREAM,
+                         MEAS_FLAG_RANGE, is_reply, parse_meas)
+
+SIM = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'Sim', 'la_sim')
+LINK = '/tmp/ttyLA_bench'
+STREAM_RATE = 8000          # 每块 512 样本 + 帧头约 8.4KB/s, 115200 波特率可以跟上
+TURBO_COUNT = 20000         # 模拟器中极速采样约 12MHz, 2万样本含 PA0 的 3 个完整半周期
+
+
+def parse_rate(text):
+    scale = {'k': 1000, 'M': 1000000}.get(text[-1], 1)
+    return int(float(text.rstrip('kM')) * scale)
+
+
+def check_free(payload, rate):
+    """PA0 相邻跳变间隔应为半个周期, 其余通道恒为高"""
+    half = rate / 2000
+    bits = [b & 1 for b in payload]
+    edges = [i for i in range(1, len(bits)) if bits[i] != bits[i - 1]]
+    gaps = [b - a for a, b in zip(edges, edges[1:])]
+    if any(abs(g - half) > 1 for g in gaps):
+        return 'PA0 half period %s, expected %g' % (sorted(set(gaps)), half)
+    if any(b & 0xFE != 0xFE for b in payload):
+        return 'PA1-PA7 not idle high'
+    return None
+
+
+def check_trigger(payload, pos):
+    """离触发点最近的上升沿; 返回 (错误, 偏差样本数)"""
+    bits = [b & 1 for b in payload]
+    rise = [i for i in range(1, len(bits)) if bits[i] and not bits[i - 1]]
+    if not rise:
+        return 'no rising edge', None
+    nearest = min(rise, key=lambda i: abs(i - pos))
+    if abs(nearest - pos) > 1:
+        return 'rising edge at %d, trigger point %d' % (nearest, pos), nearest - pos
+    return None, nearest - pos
+
+
+def pipeline(link, total, window, base):
+    """连续发送 COUNT base+i, 在途字节数不超过 window; 返回 (按序收到的 i, 错误行)"""
+    got, bad = [], []
+    pending = []            # 已发未应答命令的长度
+    sent = 0
+    idle = 0
+    while len(got) + len(bad) < total and idle < 20:
+        while sent < total and sum(pending) < window:
+            cmd = 'COUNT %d' % (base + sent)
+            link.send(cmd)
+            pending.append(len(cmd) + 1)
+            sent += 1
+        event = link.wait(lambda e: e[0] == 'line' and is_reply(e[1]), 0.1)
+        if event is None:
+            # 灌满时整行丢失, 对应的在途长度无从得知, 全部放行
+            idle += 1
+            pending = []
+            continue
+        idle = 0
+        if pending:
+            pending.pop(0)
+        line = event[1]
+        if line.startswith('OK: COUNT='):
+            got.append(int(line.split()[1].split('=')[1]) - base)
+        else:
+            bad.append(line)
+    return got, bad
+
+
+def rx_stat(link):
+    reply = link.command('RXSTAT')
+    if not reply or not reply[-1].startswith('OK: RX'):
+        return None
+    return dict(item.split('=') for item in reply[-1].split()[2:])
+
+
+def check_pipeline(link, total):
+    """流水线与灌满测试, 返回失败项数"""
+    failures = 0
+    before = rx_stat(link)
+    if before is None:
+        print('pipeline: no RXSTAT reply')
+        return 1
+    start = time.perf_counter()
+    got, bad = pipeline(link, total, 200, 100)     # 接收缓冲区 256 字节
+    elapsed = time.perf_counter() - start
+    after = rx_stat(link)
+    lost = {k: int(after[k]) - int(before[k]) for k in ('OVERFLOW', 'ORE', 'DROPPED')}
+    print('pipeline %d commands in %.2fs = %.0f commands/s, rx %s' % (
+        total, elapsed, total / elapsed, lost))
+    if got != list(range(total)) or bad or any(lost.values()):
+        failures += 1
+        print('pipeline: %d/%d in order, errors %s' % (
+            sum(1 for i, g in enumerate(got) if g == i), total, bad[:3]))
+
+    before = after
+    got, bad = pipeline(link, total, 1 << 30, 100)
+    after = rx_stat(link)
+    lost = {k: int(after[k]) - int(before[k]) for k in ('OVERFLOW', 'ORE', 'DROPPED')}
+    print('flood    %d commands, %d answered, rx %s' % (total, len(got), lost))
+    if bad or got != sorted(set(got)) or not link.ping():
+        failures += 1
+        print('flood: errors %s, order kept %s' % (bad[:3], got == sorted(set(got))))
+    return failures
+
+
+def check_meas(link, windows, rate):
+    """频率测量与采样同时进行, 返回失败项数"""
+    reply = link.command('MEAS 0 20')
+    if not reply or not reply[-1].startswith('OK: MEAS'):
+        print('meas: MEAS 0 20 -> %s' % reply)
+        return 1
+    failures = 0
+    records = []
+    for n in range(windows):
+        # 每两个窗口插入一次采样, 测量记录帧不能被当成采样数据
+        if n % 2:
+            frame = link.request_frame('CAP', 5.0)
+            error = check_free(frame['payload'], rate) if frame else 'timeout'
+            if error:
+                failures += 1
+                print('meas: capture %d: %s' % (n, error))
+        event = link.wait(lambda e: e[0] == 'frame' and e[1]['type'] == FRAME_TYPE_MEAS, 2.0)
+        if event is None:
+            failures += 1
+            print('meas: no record after %d' % len(records))
+            break
+        records.append(parse_meas(event[1]))
+    link.command('MEAS STOP')
+
+    bad = [rec for rec in records
+           if not rec['flags'] & MEAS_FLAG_RANGE and
+           (rec['freq'] is None or abs(rec['freq'] - 1000) > 1e-6 or rec['duty'] != 0.5
+            or rec['edges'] != 2 * rec['periods'] or rec['flags'])]
+    good = len(records) - len(bad)
+    print('meas     %d records, %d exact%s' % (
+        len(records), good, ', e.g. %.3fHz %.2f%%' % (
+            records[-1]['freq'] or 0, (records[-1]['duty'] or 0) * 100) if records else ''))
+    if bad or good < windows - 1:
+        failures += 1
+        for rec in bad[:3]:
+            print('meas: %s' % rec)
+    return failures
+
+
+def check_stream(link, notices, blocks):
+    """流式采样, 返回失败项数"""
+    notices.clear()
+    reply = link.command('RATE %d;STREAM' % STREAM_RATE, replies=2)
+    if len(reply) != 2 or not reply[-1].startswith('OK: STREAMING'):
+        print('stream: %s' % reply)
+        return 1
+    frames = []
+    start = time.perf_counter()
+    while len(frames) < blocks:
+        event = link.wait(lambda e: e[0] == 'frame' and e[1]['type'] == FRAME_TYPE_STREAM, 2.0)
+        if event is None:
+            break
+        frames.append(event[1])
+    elapsed = time.perf_counter() - start
+    reply = link.command('STOP')
+    dropped = reply[-1].split('DROPPED=')[-1] if reply else None
+
+    failures = 0
+    seqs = [f['seq'] for f in frames]
+    gaps = [(a, b) for a, b in zip(seqs, seqs[1:]) if b != (a + 1) & 0xFFFF]
+    print('stream   %d blocks of %s samples in %.2fs, dropped %s' % (
+        len(frames), frames[0]['wire_size'] if frames else '-', elapsed, dropped))
+    if len(frames) < blocks:
+        failures += 1
+        print('stream: only %d blocks' % len(frames))
+    if gaps:
+        failures += 1
+        print('stream: sequence gaps %s' % gaps[:3])
+    if dropped != '0':
+        failures += 1
+        print('stream: STOP -> %s' % reply)
+    torn = [line for line in notices if line.startswith('EVT: STREAM')]
+    if torn:
+        failures += 1
+        print('stream: %s' % torn[:3])
+    error = check_free(b''.join(f['payload'] for f in frames), STREAM_RATE) if frames else None
+    if error:
+        failures += 1
+        print('stream: %s' % error)
+    return failures
+
+
+def wait_notice(notices, prefix, timeout):
+    """等待以 prefix 开头的事件行 (由读线程放入 notices), 超时返回 None"""
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        for line in notices:
+            if line.startswith(prefix):
+                notices.remove(line)
+                return line
+        time.sleep(0.01)
+    return None
+
+
+def check_cal(link, notices, rounds, rate, count):
+    """自校准的应答与事件行, 返回失败项数"""
+    failures = 0
+    worst = 0
+    for n in range(rounds):
+        notices.clear()
+        reply = link.command('CAL;PING', replies=2)
+        event = wait_notice(notices, 'EVT: CAL', 2.0)
+        fields = dict(f.split('=', 1) for f in event.split() if '=' in f) if event else {}
+        if (len(reply) != 2 or not reply[0].startswith('OK: CALIBRATING') or reply[1] != 'OK: PONG'
+                or 'ERR' not in fields):
+            failures += 1
+            print('cal %d: CAL;PING -> %s, event %s' % (n, reply, event))
+            continue
+        err, res = int(fields['ERR'].rstrip('ppm')), int(event.split('(+-')[1].split(')')[0])
+        worst = max(worst, abs(err))
+        if abs(err) > res:
+            failures += 1
+            print('cal %d: %s' % (n, event))
+
+    # 采样时间远长于命令往返, 保证 ABORT 时校准还在进行
+    link.command('RATE 100;COUNT 1000', replies=2)
+    notices.clear()
+    reply = link.command('CAL')
+    abort = link.command('ABORT')
+    event = wait_notice(notices, 'EVT: CAL', 1.0)
+    if abort != ['OK: ABORTED'] or event != 'EVT: CAL ABORTED':
+        failures += 1
+        print('cal abort: CAL -> %s, ABORT -> %s, event %s' % (reply, abort, event))
+    link.command('RATE %d;COUNT %d' % (rate, count), replies=2)
+    print('cal      %d rounds, max error %d ppm, abort %s' % (rounds, worst, 'ok' if event else '-'))
+    return failures
+
+
+def check_comp(link, caps, count, rate):
+    """游程压缩下的无触发采样, 返回失败项数"""
+    reply = link.command('COMP ON')
+    if not reply or reply[-1] != 'OK: COMP ON':
+        print('comp: %s' % reply)
+        return 1
+    failures = wire = samples = 0
+    start = time.perf_counter()
+    for n in range(caps):
+        frame = link.request_frame('CAP', 5.0)
+        if frame is None:
+            error = 'timeout'
+        elif not frame['flags'] & FRAME_FLAG_RLE:
+            error = 'frame not compressed (%d bytes)' % frame['wire_size']
+        elif len(frame['payload']) != count:
+            error = '%d samples' % len(frame['payload'])
+        else:
+            error = check_free(frame['payload'], rate)
+            wire += frame['wire_size']
+            samples += count
+        if error:
+            failures += 1
+            print('capture %d (comp): %s' % (n, error))
+    elapsed = time.perf_counter() - start
+    link.command('COMP OFF')
+    print('comp     %d captures in %.2fs = %.0f captures/min, %d -> %d bytes (ratio %.3f)' % (
+        caps, elapsed, caps * 60 / elapsed, samples, wire, wire / samples if samples else 0))
+    return failures
+
+
+def check_turbo(link, caps, rate, count):
+    """RATE MAX 的实测采样率与极速采样的波形, 返回失败项数"""
+    reply = link.command('COUNT %d;RATE MAX' % TURBO_COUNT, replies=2)
+    actual = int(reply[-1].split('ACTUAL=')[1].split('Hz')[0]) if len(reply) == 2 and 'ACTUAL=' in reply[-1] else 0
+    if actual <= 0:
+        print('turbo: %s' % reply)
+        link.command('RATE %d;COUNT %d' % (rate, count), replies=2)
+        return 1
+    failures = 0
+    for n in range(caps):
+        frame = link.request_frame('CAP', 5.0)
+        if frame is None:
+            error = 'timeout'
+        elif frame['rate'] != actual:
+            error = 'frame rate %d, RATE MAX reported %d' % (frame['rate'], actual)
+        elif len(frame['payload']) != TURBO_COUNT:
+            error = '%d samples' % len(frame['payload'])
+        else:
+            error = check_free(frame['payload'], frame['rate'])
+        if error:
+            failures += 1
+            print('capture %d (turbo): %s' % (n, error))
+    link.command('RATE %d;COUNT %d' % (rate, count), replies=2)
+    print('turbo    RATE MAX ACTUAL=%dHz, %d captures  %s' % (actual, caps, 'FAIL' if failures else 'ok'))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--count', type=int, default=1000)
+    parser.add_argument('--rate', default='100k')
+    parser.add_argument('--caps', type=int, default=200)
+    parser.add_argument('--speed', type=float, default=200)
+    parser.add_argument('--pos', type=int, default=50)
+    parser.add_argument('--pipeline', type=int, default=2000)
+    parser.add_argument('--meas', type=int, default=50)
+    parser.add_argument('--stream', type=int, default=100)
+    parser.add_argument('--comp', type=int, default=50)
+    parser.add_argument('--cal', type=int, default=1)
+    parser.add_argument('--turbo', type=int, default=5)
+    args = parser.parse_args()
+    rate = parse_rate(args.rate)
+
+    proc = subprocess.Popen([SIM, '-s', str(args.speed), '-l', LINK], stderr=subprocess.DEVNULL)
+    try:
+        for _ in range(50):
+            if os.path.exists(LINK):
+                break
+            time.sleep(0.02)
+        ser = serial.Serial(LINK, 115200, timeout=0.05)
+        notices = []
+        link = SerialLink(ser, lambda e: e[0] == 'event' and notices.append(e[1]))
+        time.sleep(0.2)
+        setup = 'MODE BIN;RATE %s;COUNT %d;TRIG POS %d' % (args.rate, args.count, args.pos)
+        reply = link.command(setup, replies=4)
+        if len(reply) != 4 or not all(line.startswith('OK') for line in reply):
+            print('%s -> %s' % (setup, reply))
+            return 1
+
+        failures = 0
+        for trig in (False, True):
+            link.command('TRIG 0 1' if trig else 'NOTRIG')
+            deviation = []
+            start = time.perf_counter()
+            for n in range(args.caps):
+                frame = link.request_frame('CAP', 5.0)
+                if frame is None:
+                    error = 'timeout'
+                elif len(frame['payload']) != args.count:
+                    error = '%d samples' % len(frame['payload'])
+                elif trig:
+                    error, dev = check_trigger(frame['payload'], args.count * args.pos // 100)
+                    if dev is not None:
+                        deviation.append(dev)
+                else:
+                    error = check_free(frame['payload'], rate)
+                if error:
+                    failures += 1
+                    print('capture %d (%s): %s' % (n, 'trigger' if trig else 'free', error))
+            elapsed = time.perf_counter() - start
+            print('%-8s %d captures in %.2fs = %.0f captures/min%s' % (
+                'trigger' if trig else 'free', args.caps, elapsed, args.caps * 60 / elapsed,
+                ', trigger offset max %d samples' % max(map(abs, deviation)) if deviation else ''))
+        link.command('NOTRIG')
+        if args.cal:
+            failures += check_cal(link, notices, args.cal, rate, args.count)
+        if args.turbo:
+            failures += check_turbo(link, args.turbo, rate, args.count)
+        if args.comp:
+            failures += check_comp(link, args.comp, args.count, rate)
+        if args.meas:
+            failures += check_meas(link, args.meas, rate)
+        if args.stream:
+            failures += check_stream(link, notices, args.stream)
+            link.command('RATE %s' % args.rate)
+        if args.pipeline:
+            link.command('COUNT 100')
+            failures += check_pipeline(link, args.pipeline)
+        link.close()
+        ser.close()
+        return 1 if failures else 0
+    finally:
+        proc.terminate()
+        proc.wait()
+
+
+if __name__ == '__main__':
+    sys.exit(main())
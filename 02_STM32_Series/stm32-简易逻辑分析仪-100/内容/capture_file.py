@@ -0,0 +1,289 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+采样数据的保存与读取
+
+支持三种格式, 按扩展名区分:
+    .vcd    值变化转储 (IEEE 1364), GTKWave / PulseView 等均可打开
+    .sr     sigrok 会话文件 (srzip), PulseView 可直接打开
+    .lacap  本工具的紧凑格式: 20 字节文件头 + 通道打包 (与固件 Pack.c 一致) 的
+            原始或游程编码 (与固件 Rle.c 一致) 数据
+
+.lacap 未压缩且不打包 (启用 5 个以上通道) 时用 numpy.memmap 直接映射文件,
+几十 MB 的记录也能立即打开; 打包数据映射后一次向量化展开.
+
+样本统一为 numpy uint8 数组, 每样本一字节, bit0-7 对应 PA0-PA7.
+"""
+
+import configparser
+import io
+import re
+import struct
+import zipfile
+from collections import namedtuple
+
+import numpy as np
+
+from serial_link import rle_decode, rle_encode
+
+# 读取结果: 样本数组, 采样率 (Hz), 通道掩码
+Capture = namedtuple('Capture', 'samples rate ch_mask')
+
+LACAP_MAGIC = b'LACP'
+LACAP_VERSION = 1
+LACAP_HDR = struct.Struct('<4sBBBBIII')     # 标识, 版本, 标志, 通道掩码, 保留, 采样率, 样本数, 数据长度
+LACAP_FLAG_RLE = 0x01
+
+
+def channels_of(ch_mask):
+    return [ch for ch in range(8) if ch_mask & (1 << ch)]
+
+
+def pack_width(ch_mask):
+    """每样本位数, 与固件 Pack_Init 一致: 启用 1/2/3-4/5-8 个通道时为 1/2/4/8 (掩码为 0 按 8 位)"""
+    n = len(channels_of(ch_mask))
+    return 1 if n == 1 else 2 if n == 2 else 4 if 3 <= n <= 4 else 8
+
+
+def pack(samples, ch_mask):
+    """把每样本一字节的数据打包 (与固件 Pack_Run 一致)"""
+    samples = np.asarray(samples, dtype=np.uint8)
+    width = pack_width(ch_mask)
+    if width == 8:
+        return samples.tobytes()
+    # 启用通道依次排到低位
+    lut = np.zeros(256, dtype=np.uint8)
+    for i, ch in enumerate(channels_of(ch_mask)):
+        lut |= (((np.arange(256) >> ch) & 1) << i).astype(np.uint8)
+    per_byte = 8 // width
+    values = lut[samples]
+    pad = -len(values) % per_byte
+    values = np.concatenate([values, np.zeros(pad, dtype=np.uint8)]).reshape(-1, per_byte)
+    shifts = (np.arange(per_byte) * width).astype(np.uint8)
+    return np.bitwise_or.reduce(values << shifts, axis=1).astype(np.uint8).tobytes()
+
+
+def unpack(data, ch_mask, count=None):
+    """打包数据展开为每样本一字节, count 为样本数 (去掉末字节的填充)"""
+    data = np.frombuffer(data, dtype=np.uint8) if not isinstance(data, np.ndarray) else data
+    width = pack_width(ch_mask)
+    if width == 8:
+        return data[:count]
+    lut = np.zeros(1 << width, dtype=np.uint8)
+    for i, ch in enumerate(channels_of(ch_mask)):
+        lut |= (((np.arange(1 << width) >> i) & 1) << ch).astype(np.uint8)
+    per_byte = 8 // width
+    shifts = (np.arange(per_byte) * width).astype(np.uint8)
+    fields = (data[:, None] >> shifts) & ((1 << width) - 1)
+    return lut[fields.reshape(-1)][:count]
+
+
+# ====== .lacap ======
+
+def save_lacap(path, samples, rate, ch_mask=0xFF, compress=True):
+    samples = np.asarray(samples, dtype=np.uint8)
+    payload = pack(samples, ch_mask)
+    flags = 0
+    if compress:
+        packed = rle_encode(payload)
+        if len(packed) < len(payload):
+            flags, payload = LACAP_FLAG_RLE, packed
+    with open(path, 'wb') as f:
+        f.write(LACAP_HDR.pack(LACAP_MAGIC, LACAP_VERSION, flags, ch_mask, 0,
+                               int(round(rate)), len(samples), len(payload)))
+        f.write(payload)
+
+
+def load_lacap(path):
+    with open(path, 'rb') as f:
+        header = f.read(LACAP_HDR.size)
+    if len(header) < LACAP_HDR.size:
+        raise ValueError("文件太短")
+    magic, version, flags, ch_mask, _, rate, count, length = LACAP_HDR.unpack(header)
+    if magic != LACAP_MAGIC or version != LACAP_VERSION:
+        raise ValueError("不是 .lacap 文件或版本不支持")
+    if not length:
+        return Capture(np.zeros(0, dtype=np.uint8), rate, ch_mask)
+
+    if flags & LACAP_FLAG_RLE:
+        with open(path, 'rb') as f:
+            f.seek(LACAP_HDR.size)
+            data = np.frombuffer(rle_decode(f.read(length)), dtype=np.uint8)
+    else:
+        data = np.memmap(path, dtype=np.uint8, mode='r', offset=LACAP_HDR.size, shape=(length,))
+    samples = unpack(data, ch_mask, count)
+    if len(samples) != count:
+        raise ValueError(f"数据不完整: {len(samples)}/{count} 个样本")
+    return Capture(samples, rate, ch_mask)
+
+
+# ====== .vcd ======
+
+TIMESCALES = {'s': 1, 'ms': 1e-3, 'us': 1e-6, 'ns': 1e-9, 'ps': 1e-12, 'fs': 1e-15}
+
+
+def save_vcd(path, samples, rate, ch_mask=0xFF):
+    """时间单位取 1ps, 每个样本的时刻按采样率换算后取整"""
+    samples = np.asarray(samples, dtype=np.uint8)
+    channels = channels_of(ch_mask) or list(range(8))
+    ids = {ch: chr(ord('!') + i) for i, ch in enumerate(channels)}
+    tick = 1e12 / rate
+
+    with open(path, 'w', newline='\n') as f:
+        f.write(f"$comment\n  Acquisition with {len(channels)}/8 channels at {int(round(rate))} Hz\n$end\n")
+        f.write("$timescale 1 ps $end\n$scope module logic $end\n")
+        for ch in channels:
+            f.write(f"$var wire 1 {ids[ch]} PA{ch} $end\n")
+        f.write("$upscope $end\n$enddefinitions $end\n")
+        if not len(samples):
+            return
+
+        mask = np.uint8(sum(1 << ch for ch in channels))
+        values = samples & mask
+        change = np.flatnonzero(values[1:] != values[:-1]) + 1
+        diff = values[change] ^ values[change - 1]
+        out = io.StringIO()
+        out.write("#0\n" + ''.join(f"{(values[0] >> ch) & 1}{ids[ch]}\n" for ch in channels))
+        for pos, v, d in zip(change.tolist(), values[change].tolist(), diff.tolist()):
+            out.write(f"#{int(round(pos * tick))}\n")
+            for ch in channels:
+                if d >> ch & 1:
+                    out.write(f"{v >> ch & 1}{ids[ch]}\n")
+        # 末尾时刻标出记录长度
+        out.write(f"#{int(round(len(samples) * tick))}\n")
+        f.write(out.getvalue())
+
+
+def load_vcd(path):
+    """读取 1 位信号. 名为 PAn / Dn 的信号放到 bit n, 其余按声明顺序依次放到 bit0-7.
+    采样率取自 sigrok 风格的注释 "at ... Hz", 没有时取相邻变化时刻的最大公约数"""
+    with open(path, 'r', errors='ignore') as f:
+        text = f.read()
+    head, sep, body = text.partition('$enddefinitions')
+    if not sep:
+        raise ValueError("缺少 $enddefinitions")
+    body = body.split('$end', 1)[1] if '$end' in body else body
+
+    m = re.search(r'\$timescale\s+(\d+)\s*(s|ms|us|ns|ps|fs)\s+\$end', head)
+    timescale = int(m.group(1)) * TIMESCALES[m.group(2)] if m else 1e-9
+
+    bits = {}
+    for size, ident, name in re.findall(r'\$var\s+\S+\s+(\d+)\s+(\S+)\s+(\S+).*?\$end', head):
+        if size != '1' or ident in bits:
+            continue
+        m = re.fullmatch(r'(?:PA|D)(\d)', name)
+        used = set(bits.values())
+        bit = int(m.group(1)) if m and int(m.group(1)) not in used else \
+            next((b for b in range(8) if b not in used), None)
+        if bit is not None:
+            bits[ident] = bit
+    if not bits:
+        raise ValueError("没有 1 位信号")
+
+    # 逐条记录 (时刻, 新的样本值)
+    times = [0]
+    values = [0]
+    value = 0
+    for token in body.split():
+        if token[0] == '#':
+            t = int(token[1:])
+            if t != times[-1]:
+                times.append(t)
+                values.append(value)
+        elif token[0] in '01xXzZ' and token[1:] in bits:
+            bit = 1 << bits[token[1:]]
+            value = value | bit if token[0] == '1' else value & ~bit
+            values[-1] = value
+
+    m = re.search(r'at\s+([\d.]+)\s*([kMG]?)Hz', head)
+    if m:
+        rate = float(m.group(1)) * {'': 1, 'k': 1e3, 'M': 1e6, 'G': 1e9}[m.group(2)]
+    else:
+        steps = np.diff(np.array(times, dtype=np.int64))
+        step = int(np.gcd.reduce(steps)) if len(steps) else 1
+        rate = 1 / (max(step, 1) * timescale)
+
+    # 最后一个时刻为记录结束 (本工具和 sigrok 都这样写), 之前各段按时长展开
+    pos = np.round(np.array(times, dtype=np.float64) * timescale * rate).astype(np.int64)
+    count = int(pos[-1]) if len(pos) > 1 else 1
+    runs = np.diff(np.r_[pos[:-1], count]) if len(pos) > 1 else np.array([1])
+    samples = np.repeat(np.array(values[:len(runs)], dtype=np.uint8), np.maximum(runs, 0))
+    ch_mask = sum(1 << b for b in bits.values())
+    return Capture(samples, int(round(rate)), ch_mask)
+
+
+# ====== .sr (sigrok srzip) ======
+
+def samplerate_string(rate):
+    """与 sigrok 的 sr_samplerate_string 相同的写法, 如 "1 MHz" / "9600 Hz" """
+    rate = int(round(rate))
+    for div, unit in ((1000000000, 'GHz'), (1000000, 'MHz'), (1000, 'kHz')):
+        if rate >= div and rate % div == 0:
+            return f"{rate // div} {unit}"
+    return f"{rate} Hz"
+
+
+def parse_samplerate(text):
+    m = re.fullmatch(r'\s*([\d.]+)\s*([kMG]?)(?:Hz)?\s*', text)
+    if not m:
+        raise ValueError(f"无法识别的采样率: {text}")
+    return float(m.group(1)) * {'': 1, 'k': 1e3, 'M': 1e6, 'G': 1e9}[m.group(2)]
+
+
+def save_sr(path, samples, rate, ch_mask=0xFF):
+    """srzip 第 2 版: version + metadata + logic-1-1 (每样本 1 字节, probeN 对应 bit N-1)"""
+    samples = np.asarray(samples, dtype=np.uint8)
+    channels = channels_of(ch_mask) or list(range(8))
+    meta = ["[global]", "sigrok version=0.5.2", "", "[device 1]",
+            "capturefile=logic-1", "total probes=8", f"samplerate={samplerate_string(rate)}",
+            "total analog=0"]
+    meta += [f"probe{ch + 1}=PA{ch}" for ch in channels]
+    meta += ["unitsize=1", ""]
+    with zipfile.ZipFile(path, 'w', zipfile.ZIP_DEFLATED) as z:
+        z.writestr('version', '2')
+        z.writestr('metadata', '\n'.join(meta))
+        z.writestr('logic-1-1', samples.tobytes())
+
+
+def load_sr(path):
+    with zipfile.ZipFile(path) as z:
+        meta = configparser.ConfigParser(interpolation=None)
+        meta.read_string(z.read('metadata').decode())
+        dev = meta['device 1']
+        if int(dev.get('unitsize', '1')) != 1:
+            raise ValueError("只支持 8 个以下逻辑通道 (unitsize=1)")
+        rate = parse_samplerate(dev.get('samplerate', '0'))
+        prefix = dev.get('capturefile', 'logic-1')
+        names = [n for n in z.namelist() if n == prefix or n.startswith(prefix + '-')]
+        names.sort(key=lambda n: int(n.rsplit('-', 1)[1]) if n != prefix else 0)
+        data = b''.join(z.read(n) for n in names)
+        ch_mask = 0
+        for key in dev:
+            m = re.fullmatch(r'probe(\d+)', key)
+            if m and 1 <= int(m.group(1)) <= 8:
+                ch_mask |= 1 << (int(m.group(1)) - 1)
+    return Capture(np.frombuffer(data, dtype=np.uint8), int(round(rate)), ch_mask or 0xFF)
+
+
+# ====== 按扩展名分派 ======
+
+FILE_TYPES = [("紧凑格式", "*.lacap"), ("VCD", "*.vcd"), ("sigrok", "*.sr")]
+
+
+def save(path, samples, rate, ch_mask=0xFF):
+    ext = path.lower().rsplit('.', 1)[-1]
+    if ext == 'vcd':
+        save_vcd(path, samples, rate, ch_mask)
+    elif ext == 'sr':
+        save_sr(path, samples, rate, ch_mask)
+    else:
+        save_lacap(path, samples, rate, ch_mask)
+
+
+def load(path):
+    ext = path.lower().rsplit('.', 1)[-1]
+    if ext == 'vcd':
+        return load_vcd(path)
+    if ext == 'sr':
+        return load_sr(path)
+    return load_lacap(path)
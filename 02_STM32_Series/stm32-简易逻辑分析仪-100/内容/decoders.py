@@ -0,0 +1,328 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+协议解码 - UART / SPI / I2C / 1-Wire
+
+解码器对整段采样数据运行: 先用 NumPy 一次性求出各通道的跳变位置,
+再按跳变和采样点批量取值, 只在生成注释时按字节循环. 100 万样本的解码
+耗时在几十毫秒量级.
+
+每个解码器输出 Annotation 列表 (按起始样本排序), 上位机把它画成通道下方的注释行.
+新增解码器: 继承 Decoder, 实现 decode(), 用 @register 注册, 即可用
+"名称 参数=值 ..." 的文本创建 (见 create()).
+"""
+
+from collections import namedtuple
+
+import numpy as np
+
+# 一条注释: 样本范围 [start, end), 显示文本, 是否为错误
+Annotation = namedtuple('Annotation', 'start end text error')
+
+DECODERS = {}
+
+
+def register(cls):
+    """注册解码器, 以 cls.name 为名称"""
+    DECODERS[cls.name] = cls
+    return cls
+
+
+def create(spec):
+    """由文本创建解码器, 例如 "uart rx=0 baud=9600" / "i2c scl=1 sda=2"
+
+    参数值为整数或字符串, 未知名称或参数抛出 ValueError
+    """
+    words = spec.split()
+    if not words or words[0].lower() not in DECODERS:
+        raise ValueError(f"未知解码器, 可用: {', '.join(sorted(DECODERS))}")
+    options = {}
+    for word in words[1:]:
+        key, sep, value = word.partition('=')
+        if not sep:
+            raise ValueError(f"参数格式应为 名称=值: {word}")
+        try:
+            options[key] = int(value, 0)
+        except ValueError:
+            options[key] = value
+    try:
+        return DECODERS[words[0].lower()](**options)
+    except TypeError as e:
+        raise ValueError(str(e)) from None
+
+
+def channel_bits(samples, ch):
+    """取出一个通道的电平序列 (uint8 数组, 0/1)"""
+    data = np.frombuffer(bytes(samples), dtype=np.uint8) if not isinstance(samples, np.ndarray) else samples
+    return (data >> ch) & 1
+
+
+def edges(bits):
+    """返回 (上升沿, 下降沿) 的样本序号: 该样本与前一样本电平不同"""
+    change = np.flatnonzero(np.diff(bits)) + 1
+    rising = change[bits[change] == 1]
+    falling = change[bits[change] == 0]
+    return rising, falling
+
+
+class Decoder:
+    """解码器基类"""
+    name = ''
+
+    def decode(self, samples, rate):
+        """samples: 每样本一字节 (bit0-7 对应 PA0-PA7); rate: 采样率 Hz"""
+        raise NotImplementedError
+
+    def label(self):
+        return self.name.upper()
+
+
+@register
+class UartDecoder(Decoder):
+    """异步串口: 下降沿找起始位, 在每一位的中点取值; 检查校验位和停止位"""
+    name = 'uart'
+
+    def __init__(self, rx=0, baud=9600, bits=8, parity='none', stop=1):
+        self.rx, self.baud, self.bits, self.stop = rx, baud, bits, stop
+        self.parity = parity.lower()
+        if self.parity not in ('none', 'even', 'odd'):
+            raise ValueError("parity 应为 none / even / odd")
+
+    def label(self):
+        return f"UART PA{self.rx} {self.baud}"
+
+    def decode(self, samples, rate):
+        bits = channel_bits(samples, self.rx)
+        n = len(bits)
+        _, falling = edges(bits)
+        spb = rate / self.baud
+        nbits = 1 + self.bits + (self.parity != 'none') + self.stop
+        if spb < 2 or not len(falling):
+            return []
+
+        # 各位中点相对起始沿的偏移
+        offsets = np.round((np.arange(nbits) + 0.5) * spb).astype(np.int64)
+        weights = 1 << np.arange(self.bits)
+        out = []
+        pos = 0
+        while True:
+            i = np.searchsorted(falling, pos)
+            if i >= len(falling):
+                break
+            start = int(falling[i])
+            points = start + offsets
+            if points[-1] >= n:
+                break
+            level = bits[points]
+            end = int(start + nbits * spb)
+            if level[0]:
+                # 起始位中点为高: 毛刺, 跳过这个下降沿
+                pos = start + 1
+                continue
+            value = int(level[1:1 + self.bits] @ weights)
+            errors = []
+            if self.parity != 'none':
+                ones = int(level[1:2 + self.bits].sum())
+                if (ones & 1) != (self.parity == 'odd'):
+                    errors.append('校验错')
+            if not level[-self.stop:].all():
+                errors.append('帧错')
+            char = chr(value) if 32 <= value < 127 else ''
+            text = f"{value:02X}" + (f" '{char}'" if char else '') + (' ' + ' '.join(errors) if errors else '')
+            out.append(Annotation(start, end, text, bool(errors)))
+            # 从停止位中点之后找下一个起始沿
+            pos = int(points[-1])
+        return out
+
+
+@register
+class SpiDecoder(Decoder):
+    """SPI: 按 CPOL/CPHA 选取采样沿, 片选有效期间每 bits 个时钟组成一个字"""
+    name = 'spi'
+
+    def __init__(self, clk=0, mosi=1, miso=-1, cs=-1, cpol=0, cpha=0, bits=8, msb=1):
+        self.clk, self.mosi, self.miso, self.cs = clk, mosi, miso, cs
+        self.cpol, self.cpha, self.bits, self.msb = cpol, cpha, bits, msb
+
+    def label(self):
+        return f"SPI CLK=PA{self.clk} MOSI=PA{self.mosi}"
+
+    def decode(self, samples, rate):
+        data = np.frombuffer(bytes(samples), dtype=np.uint8)
+        clk = channel_bits(data, self.clk)
+        rising, falling = edges(clk)
+        # 模式 0/3 在上升沿采样, 模式 1/2 在下降沿采样
+        sample_at = rising if (self.cpol ^ self.cpha) == 0 else falling
+        if self.cs >= 0:
+            cs = channel_bits(data, self.cs)
+            sample_at = sample_at[cs[sample_at] == 0]
+            _, cs_start = edges(cs)
+            # 片选每次有效重新对齐字边界
+            segment = np.searchsorted(cs_start, sample_at, 'right')
+        else:
+            segment = np.zeros(len(sample_at), dtype=np.int64)
+        if not len(sample_at):
+            return []
+
+        seg_first = np.flatnonzero(np.r_[True, segment[1:] != segment[:-1]])
+        seg_len = np.diff(np.r_[seg_first, len(sample_at)])
+        rank = np.arange(len(sample_at)) - np.repeat(seg_first, seg_len)
+        keep = rank < (np.repeat(seg_len, seg_len) // self.bits) * self.bits   # 丢弃不完整的字
+        sample_at, rank = sample_at[keep], rank[keep]
+        if not len(sample_at):
+            return []
+        word_pos = rank % self.bits
+        shift = (self.bits - 1 - word_pos) if self.msb else word_pos
+        words = np.cumsum(word_pos == 0) - 1
+
+        def gather(ch):
+            bit = channel_bits(data, ch)[sample_at].astype(np.int64)
+            return np.bincount(words, weights=bit << shift).astype(np.int64)
+
+        mosi = gather(self.mosi)
+        miso = gather(self.miso) if self.miso >= 0 else None
+        starts = sample_at[word_pos == 0]
+        ends = sample_at[word_pos == self.bits - 1] + 1
+        out = []
+        for k in range(len(starts)):
+            text = f"{mosi[k]:02X}" + (f"/{miso[k]:02X}" if miso is not None else '')
+            out.append(Annotation(int(starts[k]), int(ends[k]), text, False))
+        return out
+
+
+@register
+class I2cDecoder(Decoder):
+    """I2C: SCL 高时 SDA 下降为起始, 上升为停止; SCL 上升沿取数, 每 9 位为 8 位数据 + ACK"""
+    name = 'i2c'
+
+    def __init__(self, scl=0, sda=1):
+        self.scl, self.sda = scl, sda
+
+    def label(self):
+        return f"I2C SCL=PA{self.scl} SDA=PA{self.sda}"
+
+    def decode(self, samples, rate):
+        data = np.frombuffer(bytes(samples), dtype=np.uint8)
+        scl = channel_bits(data, self.scl)
+        sda = channel_bits(data, self.sda)
+        scl_rise, _ = edges(scl)
+        sda_rise, sda_fall = edges(sda)
+        starts = sda_fall[scl[sda_fall] == 1]
+        stops = sda_rise[scl[sda_rise] == 1]
+        if not len(starts) or not len(scl_rise):
+            return []
+
+        # 每个时钟属于它之前最近的起始条件; 在起始之前或停止之后的时钟丢弃
+        seg = np.searchsorted(starts, scl_rise, 'right') - 1
+        last_stop = np.searchsorted(stops, scl_rise, 'right') - 1
+        stop_pos = stops[np.maximum(last_stop, 0)] if len(stops) else np.zeros_like(last_stop)
+        stop_pos = np.where(last_stop >= 0, stop_pos, -1)
+        valid = (seg >= 0) & (stop_pos < starts[np.maximum(seg, 0)])
+        clocks, seg = scl_rise[valid], seg[valid]
+        if not len(clocks):
+            return []
+        level = sda[clocks].astype(np.int64)
+        seg_first = np.flatnonzero(np.r_[True, seg[1:] != seg[:-1]])
+        seg_len = np.diff(np.r_[seg_first, len(clocks)])
+        rank = np.arange(len(clocks)) - np.repeat(seg_first, seg_len)
+
+        out = [Annotation(int(s), int(s) + 1, 'S', False) for s in starts]
+        out += [Annotation(int(s), int(s) + 1, 'P', False) for s in stops]
+        full = rank < (np.repeat(seg_len, seg_len) // 9) * 9
+        byte_no = rank // 9
+        pos = rank % 9
+        for k in np.flatnonzero(full & (pos == 0)):
+            bits = level[k:k + 8]
+            value = int(bits @ (1 << np.arange(7, -1, -1)))
+            nak = bool(level[k + 8])
+            if byte_no[k] == 0:
+                text = f"{value >> 1:02X} {'R' if value & 1 else 'W'}"
+            else:
+                text = f"{value:02X}"
+            text += ' NAK' if nak else ' ACK'
+            # 最后一个读字节的 NAK 是正常的, 只把写方向和地址的 NAK 标为错误
+            out.append(Annotation(int(clocks[k]), int(clocks[k + 8]) + 1, text,
+                                  nak and byte_no[k] == 0))
+        out.sort(key=lambda a: a.start)
+        return out
+
+
+def crc8_maxim(data):
+    """DS18B20 使用的 CRC8 (多项式 X^8+X^5+X^4+1, 低位在前)"""
+    crc = 0
+    for b in data:
+        for _ in range(8):
+            mix = (crc ^ b) & 1
+            crc >>= 1
+            if mix:
+                crc ^= 0x8C
+            b >>= 1
+    return crc
+
+
+@register
+class OneWireDecoder(Decoder):
+    """1-Wire: 按低电平宽度区分复位 (>=480us)、应答、0 (>=15us) 和 1 时隙, 低位在前组成字节.
+    识别 ROM/功能命令, 读暂存器 (BE) 后的 9 字节做 CRC 校验"""
+    name = 'onewire'
+
+    COMMANDS = {0x33: 'READ ROM', 0x55: 'MATCH ROM', 0xCC: 'SKIP ROM', 0xF0: 'SEARCH ROM',
+                0xEC: 'ALARM SEARCH', 0x44: 'CONVERT T', 0xBE: 'READ SCRATCHPAD',
+                0x4E: 'WRITE SCRATCHPAD', 0x48: 'COPY SCRATCHPAD', 0xB8: 'RECALL E2',
+                0xB4: 'READ POWER'}
+
+    def __init__(self, dq=0):
+        self.dq = dq
+
+    def label(self):
+        return f"1-Wire PA{self.dq}"
+
+    def decode(self, samples, rate):
+        bits = channel_bits(samples, self.dq)
+        rising, falling = edges(bits)
+        if not len(falling):
+            return []
+        # 每个低电平脉冲: 下降沿到其后第一个上升沿
+        idx = np.searchsorted(rising, falling, 'right')
+        ok = idx < len(rising)
+        low_start = falling[ok]
+        low_end = rising[idx[ok]]
+        width = (low_end - low_start) * 1e6 / rate     # 微秒
+
+        out = []
+        byte_bits = []
+        byte_start = 0
+        frame = []          # 本次复位后的字节
+        after_reset = None
+        for s, e, w in zip(low_start.tolist(), low_end.tolist(), width.tolist()):
+            if w >= 400:
+                out.append(Annotation(s, e, 'RESET', False))
+                after_reset = e
+                byte_bits, frame = [], []
+                continue
+            if after_reset is not None and w >= 50 and s - after_reset < 80e-6 * rate:
+                out.append(Annotation(s, e, 'PRESENCE', False))
+                after_reset = None
+                continue
+            after_reset = None
+            if not byte_bits:
+                byte_start = s
+            byte_bits.append(0 if w >= 15 else 1)
+            if len(byte_bits) == 8:
+                value = sum(b << k for k, b in enumerate(byte_bits))
+                frame.append(value)
+                out.append(self._byte(frame, value, byte_start, int(s + 60e-6 * rate)))
+                byte_bits = []
+        return out
+
+    def _byte(self, frame, value, start, end):
+        name = self.COMMANDS.get(value) if len(frame) <= 2 else None
+        # 跳过/匹配 ROM 后的功能命令, 或复位后的第一个字节
+        if name and (len(frame) == 1 or frame[0] == 0xCC):
+            return Annotation(start, end, f"{value:02X} {name}", False)
+        # 读暂存器: SKIP ROM, BE 之后的第 9 个数据字节是 CRC
+        if len(frame) == 11 and frame[:2] == [0xCC, 0xBE]:
+            bad = crc8_maxim(frame[2:10]) != value
+            return Annotation(start, end, f"{value:02X} CRC{' 错' if bad else ' OK'}", bad)
+        return Annotation(start, end, f"{value:02X}", False)
+
@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+模拟下位机 (仅 Linux) - 在伪终端 (pty) 上模仿固件的命令应答, 无需开发板即可调试上位机
+
+用法: python fake_device.py
+启动后打印伪终端路径 (如 /dev/pts/5), 在 viewer.py 中手动输入该串口连接.
+模拟 RATE / COUNT / CHAN / MODE / COMP / TRIG / NOTRIG / CAP / ABORT /
+STATUS / SEND / CAL / HELP: CAP 后按 采样数/采样率 的时间采满, 输出 CAPTURE COMPLETE
+并自动发送数据, 与固件一样采样期间仍可应答命令. CAL 采满后不发数据, 只发事件行
+EVT: CAL ... (中止时为 EVT: CAL ABORTED), 测得的采样率即名义值. 数据为 PA0-PA7 上频率逐位减半的方波.
+不模拟触发、打包、流式采样和频率测量 (MEAS).
+"""
+
+import os
+import pty
+import select
+import struct
+import binascii
+import threading
+import time
+import tty
+
+from serial_link import (FRAME_HDR, FRAME_SYNC, FRAME_TYPE_DATA, FRAME_FLAG_RLE, FRAME_FLAG_TIME,
+                         FRAME_TIME, FRAME_NO_TRIGGER, rle_encode)
+
+TIM_CLOCK = 72000000
+
+
+def make_frame(ftype, flags, seq, ch_mask, rate, payload, timing=None):
+    """组装二进制帧 (与固件 Frame.c 一致): 头 + [时间信息] + 数据 + CRC16-CCITT (高字节在前)
+
+    timing 为 FRAME_TIME 各字段的元组, 给出时置 FRAME_FLAG_TIME
+    """
+    if timing:
+        flags |= FRAME_FLAG_TIME
+    body = FRAME_HDR.pack(FRAME_SYNC, ftype, flags, seq, ch_mask, 0, rate, len(payload))
+    body += (FRAME_TIME.pack(*timing) if timing else b'') + payload
+    crc = binascii.crc_hqx(body[2:], 0xFFFF)
+    return body + struct.pack('>H', crc)
+
+
+class FakeDevice:
+    """命令解析与采样状态, 与固件的 CommandParser.c / LogicAnalyzer.c 对应"""
+
+    def __init__(self, fd):
+        self.fd = fd
+        self.lock = threading.Lock()
+        self.psc, self.arr = 71, 99
+        self.count = 256
+        self.max_count = 44000
+        self.binary = False
+        self.compress = False
+        self.seq = 0
+        self.state = 'IDLE'
+        self.result = None
+        self.data = b''
+        self.timing = (TIM_CLOCK, 0, 0, 0, 0, FRAME_NO_TRIGGER)
+        self.timer = None
+        self.cal = None         # 正在校准时为测试信号所接的引脚
+        self.failed = False     # 最近一条命令回复了 ERR
+        self.lines = 0          # 收到的命令行数 (RXSTAT)
+
+    def write(self, data):
+        if isinstance(data, str):
+            data = data.encode()
+        with self.lock:
+            os.write(self.fd, data)
+
+    def reply(self, text):
+        self.failed = text.startswith('ERR')
+        self.write(text + '\r\n')
+
+    def rate(self):
+        return max(1, TIM_CLOCK // ((self.psc + 1) * (self.arr + 1)))
+
+    def capture(self):
+        """生成测试波形: PAn 的周期为 2^(n+1) 个样本"""
+        start = int(time.monotonic() * self.rate())
+        self.data = bytes((start + i) & 0xFF for i in range(self.count))
+        # 时间信息: 采样周期正好是名义值, 以现在为结束时刻
+        period = (self.psc + 1) * (self.arr + 1)
+        done = int(time.monotonic() * TIM_CLOCK) & 0xFFFFFFFF
+        arm = (done - self.count * period) & 0xFFFFFFFF
+        self.timing = (TIM_CLOCK, arm, 0, done, period * 16, FRAME_NO_TRIGGER)
+
+    def finish(self):
+        """采样时间到 (相当于固件的 DMA 传输完成中断 + 主循环 LA_Poll)"""
+        if self.state not in ('ARMED', 'TRIGGERED'):
+            return
+        self.capture()
+        self.state, self.result = 'DONE', 'FULL'
+        if self.cal is not None:
+            # 校准采样只报告结果 (事件行, 不是应答), 不自动发送数据
+            rate, self.cal = self.rate(), None
+            self.write(f'EVT: CAL REF=1000Hz EDGES={self.count * 1000 // rate} RATE={rate}.000Hz '
+                       f'MEASURED={rate}.000Hz ERR=+0ppm (+-{1000000 // self.count}) DWT=+0ppm\r\n')
+            return
+        self.reply('CAPTURE COMPLETE')
+        self.send_data()
+
+    def send_data(self):
+        data = self.data
+        if self.binary:
+            flags, payload = 0, data
+            if self.compress:
+                packed = rle_encode(data)
+                if len(packed) < len(data):
+                    flags, payload = FRAME_FLAG_RLE, packed
+            self.write(make_frame(FRAME_TYPE_DATA, flags, self.seq, 0xFF, self.rate(), payload,
+                                  self.timing))
+            self.seq = (self.seq + 1) & 0xFFFF
+            return
+        clock, arm, trigger, done, period16, _ = self.timing
+        lines = [f'DATA: (count={len(data)} clk={clock} arm={arm} trigt={trigger} '
+                 f'done={done} period16={period16})']
+        for i in range(0, len(data), 32):
+            lines.append(data[i:i + 32].hex().upper())
+        lines.append('END')
+        self.write('\r\n'.join(lines) + '\r\n')
+
+    def busy(self):
+        if self.state in ('ARMED', 'TRIGGERED'):
+            self.reply(f'ERR: BUSY ({self.state}), send ABORT first')
+            return True
+        return False
+
+    def handle_line(self, line):
+        """一行中以 ';' 分隔的多条命令依次执行, 出错后其余回复 SKIPPED"""
+        failed = False
+        self.lines += 1
+        for cmd in line.split(';'):
+            words = cmd.split()
+            if not words:
+                continue
+            if failed:
+                self.reply(f"ERR: SKIPPED '{words[0]}'")
+                continue
+            self.failed = False
+            self.handle(cmd.strip())
+            failed = self.failed
+
+    def handle(self, cmd):
+        words = cmd.split()
+        if not words:
+            return
+        name, args = words[0].upper(), words[1:]
+
+        if name in ('RATE', 'COUNT', 'CHAN', 'TRIG', 'NOTRIG', 'CAP', 'SEND', 'BAUD', 'CAL') and self.busy():
+            return
+        if name == 'RATE' and len(args) == 2:
+            self.psc, self.arr = int(args[0]), int(args[1])
+            self.reply(f'OK: RATE PSC={self.psc} ARR={self.arr}')
+        elif name == 'COUNT' and args:
+            self.count = max(1, min(int(args[0]), self.max_count))
+            self.reply(f'OK: COUNT={self.count} MAXCOUNT={self.max_count}')
+        elif name == 'CHAN':
+            self.reply(f'OK: CHAN=0xFF MAXCOUNT={self.max_count} COUNT={self.count}')
+        elif name == 'MODE' and args:
+            self.binary = args[0].upper() == 'BIN'
+            self.reply('OK: MODE ' + ('BIN' if self.binary else 'HEX'))
+        elif name == 'COMP' and args:
+            self.compress = args[0].upper() == 'ON'
+            self.reply('OK: COMP ' + ('ON' if self.compress else 'OFF'))
+        elif name == 'TRIG':
+            self.reply('OK: TRIG ' + ' '.join(args))
+        elif name == 'NOTRIG':
+            self.reply('OK: TRIGGER DISABLED')
+        elif name in ('CAP', 'CAL'):
+            if name == 'CAL':
+                self.cal = int(args[0]) if args else 0
+                self.reply(f'OK: CALIBRATING PA{self.cal} against 1000Hz')
+            else:
+                self.cal = None
+                self.reply('OK: CAPTURING...')
+            self.state, self.result = 'ARMED', None
+            self.timer = threading.Timer(self.count / self.rate(), self.finish)
+            self.timer.start()
+        elif name == 'ABORT':
+            if self.state not in ('ARMED', 'TRIGGERED'):
+                self.reply('ERR: Not capturing')
+                return
+            self.timer.cancel()
+            self.capture()
+            self.state, self.result = 'DONE', 'ABORTED'
+            if self.cal is not None:
+                self.cal = None
+                self.write('EVT: CAL ABORTED\r\n')
+            self.reply('OK: ABORTED')
+        elif name == 'STATUS':
+            if self.state in ('ARMED', 'TRIGGERED'):
+                self.reply('STATUS: ' + self.state)
+            elif self.state == 'DONE':
+                self.reply(f'STATUS: READY MAXCOUNT={self.max_count} DATA={self.result}')
+            else:
+                self.reply(f'STATUS: READY MAXCOUNT={self.max_count}')
+        elif name == 'SEND':
+            self.send_data()
+        elif name == 'BAUD' and args:
+            # 伪终端没有波特率, 只模拟应答
+            self.reply(f'OK: BAUD {args[0]} ACTUAL={args[0]} ERR=+0.00%')
+        elif name == 'PING':
+            self.reply('OK: PONG')
+        elif name == 'RXSTAT':
+            # 伪终端读取不会溢出
+            self.reply(f'OK: RX LINES={self.lines} OVERFLOW=0 ORE=0 DROPPED=0')
+        elif name in ('HELP', '?'):
+            self.reply('\r\n=== Logic Analyzer Commands (fake) ===')
+            self.reply('RATE COUNT CHAN MODE COMP TRIG NOTRIG CAP ABORT STATUS SEND CAL')
+            self.reply('================================')
+        else:
+            self.reply(f"ERR: Unknown command '{cmd}'")
+
+
+def serve(fd, stop):
+    """读命令行并逐条处理, stop 置位后返回"""
+    device = FakeDevice(fd)
+    line = bytearray()
+    while not stop.is_set():
+        ready, _, _ = select.select([fd], [], [], 0.05)
+        if not ready:
+            continue
+        try:
+            chunk = os.read(fd, 256)
+        except OSError:
+            break
+        for b in chunk:
+            if b in (0x0A, 0x0D):
+                if line:
+                    device.handle_line(line.decode(errors='ignore'))
+                    line.clear()
+            else:
+                line.append(b)
+    if device.timer:
+        device.timer.cancel()
+
+
+def open_pty():
+    """创建伪终端, 返回 (主端 fd, 从端路径, 从端 fd); 从端设为原始模式, 不做换行转换.
+    从端 fd 须保持打开, 否则上位机断开时主端会读到错误"""
+    master, slave = pty.openpty()
+    tty.setraw(slave)
+    return master, os.ttyname(slave), slave
+
+
+def main():
+    master, path, _slave = open_pty()
+    print(f"模拟下位机已启动: {path}  (Ctrl+C 退出)")
+    stop = threading.Event()
+    try:
+        serve(master, stop)
+    except KeyboardInterrupt:
+        stop.set()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,388 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+串口链路 - 后台读线程 + 增量解码
+
+下位机的输出是文本行和二进制帧混在一起的字节流. 后台线程一收到数据就交给
+StreamDecoder 解码, 得到的事件放入队列, 等待应答的一方立即被唤醒,
+延迟只取决于串口传输本身, 不再固定等待.
+
+事件为 (类型, 内容) 元组:
+    ('line',  str)          一行文本 (已去掉行尾)
+    ('event', str)          下位机主动发出的事件行 'EVT: ...' (如 CAL 结果), 不是命令应答
+    ('block', [str, ...])   十六进制数据块, 从 'DATA:' / 'STREAM:' 行到 'END' 行 (含首尾)
+    ('frame', dict)         二进制帧, 见 parse_frame(); 测量记录帧 (MEAS) 见 parse_meas()
+    ('closed', None)        串口已关闭或读出错, 读线程退出
+"""
+
+import binascii
+import queue
+import re
+import struct
+import threading
+import time
+
+# 二进制数据帧 (与固件 Frame.h 一致)
+FRAME_SYNC = b'\xA5\x5A'
+FRAME_HDR = struct.Struct('<2sBBHBBII')    # 同步字, 类型, 标志, 序号, 通道掩码, 保留, 采样率, 长度
+FRAME_TYPE_DATA = 0x01
+FRAME_TYPE_STREAM = 0x02
+FRAME_TYPE_MEAS = 0x03
+FRAME_FLAG_RLE = 0x01
+FRAME_FLAG_TIME = 0x02
+FRAME_FLAG_OVERRUN = 0x04     # 部分样本在处理前被覆盖, 数据不连续
+FRAME_TIME = struct.Struct('<IIIIII')      # DWT 频率, 启动, 触发, 结束, 周期 (1/16 DWT 周期), 触发样本
+FRAME_NO_TRIGGER = 0xFFFFFFFF
+# 频率测量记录 (与固件 Measure.h 一致), 字段名同十六进制模式的 MEAS: 行
+MEAS_RECORD = struct.Struct('<11I4B')
+MEAS_FIELDS = ('window', 'edges', 'periods', 'psum', 'hsum', 'pmin', 'pmax', 'hmin', 'hmax',
+               'lmin', 'lmax', 'pin', 'div', 'level', 'flags')
+MEAS_FLAG_RANGE = 0x01      # 窗口内量程改变过
+MEAS_FLAG_MISSED = 0x02     # 有捕获被覆盖
+MEAS_FLAG_PARTIAL = 0x04    # 捕获次数达到上限
+FRAME_MAX_LEN = 1 << 20     # 超过此长度的帧头视为误同步 (固件缓冲区不到 64KB)
+BOOT_BAUD = 115200          # 下位机上电时的波特率
+
+
+_RUN = re.compile(rb'(.)\1*', re.S)
+
+
+def rle_encode(data):
+    """游程编码 (与固件 Rle.c 一致): 样本值 + LEB128 重复次数"""
+    out = bytearray()
+    for m in _RUN.finditer(bytes(data)):
+        out.append(m.group()[0])
+        count = m.end() - m.start()
+        while count >= 0x80:
+            out.append((count & 0x7F) | 0x80)
+            count >>= 7
+        out.append(count)
+    return bytes(out)
+
+
+def rle_decode(data):
+    """游程解码 (与固件 Rle.c 一致): 样本值 + LEB128 重复次数"""
+    out = bytearray()
+    i = 0
+    n = len(data)
+    while i < n:
+        value = data[i]
+        i += 1
+        count = 0
+        shift = 0
+        while i < n:
+            b = data[i]
+            i += 1
+            count |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                break
+        out.extend(bytes((value,)) * count)
+    return bytes(out)
+
+
+def parse_frame(buf):
+    """从字节缓冲区中解析一帧
+
+    返回 (frame, consumed): frame 为 dict 或 None (数据不足/校验错误),
+    consumed 为应从缓冲区头部丢弃的字节数
+    """
+    start = buf.find(FRAME_SYNC)
+    if start < 0:
+        # 保留最后一个字节, 它可能是同步字的前半
+        return None, max(0, len(buf) - 1)
+    if len(buf) - start < FRAME_HDR.size:
+        return None, start
+
+    _, ftype, flags, seq, ch_mask, _, rate, length = FRAME_HDR.unpack_from(buf, start)
+    if length > FRAME_MAX_LEN:
+        return None, start + 1
+    extra = FRAME_TIME.size if flags & FRAME_FLAG_TIME else 0
+    end = start + FRAME_HDR.size + extra + length
+    if len(buf) < end + 2:
+        return None, start
+
+    crc = binascii.crc_hqx(bytes(buf[start + 2:end]), 0xFFFF)
+    if crc != (buf[end] << 8 | buf[end + 1]):
+        # 校验失败: 跳过这个同步字继续搜索
+        return None, start + 1
+
+    payload = bytes(buf[start + FRAME_HDR.size + extra:end])
+    if flags & FRAME_FLAG_RLE:
+        payload = rle_decode(payload)
+    timing = None
+    if extra:
+        timing = dict(zip(('clock', 'arm', 'trigger', 'done', 'period16', 'trigger_sample'),
+                          FRAME_TIME.unpack_from(buf, start + FRAME_HDR.size)))
+
+    frame = {
+        'type': ftype,
+        'flags': flags,
+        'seq': seq,
+        'ch_mask': ch_mask,
+        'rate': rate,
+        'wire_size': length,
+        'payload': payload,
+        'timing': timing,
+    }
+    return frame, end + 2
+
+
+def _meas_derive(rec):
+    """由周期之和算出频率 (Hz) 与占空比 (0-1), 窗口内没有完整周期时为 None"""
+    psum = rec['psum']
+    rec['freq'] = rec['clk'] * rec['periods'] / psum if psum else None
+    rec['duty'] = rec['hsum'] / psum if psum else None
+    return rec
+
+
+def parse_meas(frame):
+    """FRAME_TYPE_MEAS 帧 -> 测量记录 dict: MEAS_FIELDS 各项 + clk (计数频率) + freq / duty"""
+    rec = dict(zip(MEAS_FIELDS, MEAS_RECORD.unpack(frame['payload'][:MEAS_RECORD.size])))
+    rec['clk'] = frame['rate']
+    return _meas_derive(rec)
+
+
+def parse_meas_line(line):
+    """十六进制模式的 'MEAS: (pin=0 clk=... flags=0) FREQ=... DUTY=...' 行 -> 同 parse_meas()"""
+    inner = line[line.index('(') + 1:line.index(')')]
+    rec = {key: int(value) for key, value in (item.split('=') for item in inner.split())}
+    return _meas_derive(rec)
+
+
+def is_data(event):
+    """采样数据事件: 十六进制数据块或 DATA/STREAM 帧 (测量记录帧随时可能到来, 不算)"""
+    return event[0] == 'block' or (event[0] == 'frame' and event[1]['type'] != FRAME_TYPE_MEAS)
+
+
+def timing_summary(timing, rate):
+    """由帧的时间信息得出 (实测采样率 Hz, 相对 rate 的偏差 ppm, 触发时刻 s, 采样耗时 s)
+
+    时间均相对启动采样时刻; 无法测量的项为 None. timing 也可以是十六进制
+    DATA: 头中 clk= / arm= / trigt= / done= / period16= 字段组成的 dict
+    """
+    clock = timing['clock']
+    measured = clock * 16 / timing['period16'] if timing['period16'] else None
+    ppm = (measured / rate - 1) * 1e6 if measured and rate else None
+    elapsed = ((timing['done'] - timing['arm']) & 0xFFFFFFFF) / clock
+    trigger = None
+    if timing.get('trigger_sample', FRAME_NO_TRIGGER) != FRAME_NO_TRIGGER:
+        trigger = ((timing['trigger'] - timing['arm']) & 0xFFFFFFFF) / clock
+    return measured, ppm, trigger, elapsed
+
+
+class StreamDecoder:
+    """文本行 / 十六进制数据块 / 二进制帧的增量解码器
+
+    每次 feed() 任意长度的数据 (可以在帧或行的中间断开), 返回已完整的事件
+    """
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.block = None       # 正在收集的十六进制数据块
+
+    def feed(self, data):
+        self.buf.extend(data)
+        events = []
+        while True:
+            item = self._next()
+            if item is None:
+                return events
+            if item[0] == 'line':
+                item = self._collect(item[1])
+            if item is not None:
+                events.append(item)
+
+    def _next(self):
+        """从缓冲区头部取出一个帧或一行, 数据不足时返回 None"""
+        buf = self.buf
+        while buf:
+            sync = buf.find(FRAME_SYNC)
+            if sync == 0:
+                frame, consumed = parse_frame(buf)
+                if frame:
+                    del buf[:consumed]
+                    return ('frame', frame)
+                if consumed == 0:
+                    return None         # 帧不完整
+                del buf[:consumed]      # 误同步, 当作文本继续
+                continue
+
+            nl = buf.find(b'\n')
+            if nl >= 0 and (sync < 0 or nl < sync):
+                text = bytes(buf[:nl])
+                del buf[:nl + 1]
+            elif sync > 0:
+                # 帧之前没有换行结尾的文本
+                text = bytes(buf[:sync])
+                del buf[:sync]
+            else:
+                return None             # 行不完整
+            line = text.decode('utf-8', errors='ignore').strip()
+            if line:
+                return ('line', line)
+        return None
+
+    def _collect(self, line):
+        """把 DATA:/STREAM: ... END 之间的行合并为一个数据块; 事件行单独成为事件"""
+        if is_event(line):
+            return ('event', line)
+        if line.startswith('DATA:') or line.startswith('STREAM:'):
+            self.block = [line]
+            return None
+        if self.block is None:
+            return ('line', line)
+        self.block.append(line)
+        if line != 'END':
+            return None
+        block, self.block = self.block, None
+        return ('block', block)
+
+
+def is_event(line):
+    """下位机主动发出的事件行 (CAL 结果等), 可能夹在任意两条应答之间"""
+    return line.startswith('EVT:')
+
+
+def is_reply(line):
+    """命令应答的最后一行: OK / ERR / STATUS, 或 HELP 末尾的分隔线; 事件行不是应答"""
+    return (line.startswith('OK') or line.startswith('ERR') or line.startswith('STATUS:')
+            or (len(line) > 3 and set(line) == {'='}))
+
+
+class SerialLink:
+    """串口后台读线程 + 事件队列
+
+    ser 只需提供 read(n) / write(data) / in_waiting, 读超时应较短 (如 50ms),
+    以便 close() 及时结束线程
+    """
+
+    def __init__(self, ser, on_event=None):
+        self.ser = ser
+        self.on_event = on_event
+        self.events = queue.Queue()
+        self.decoder = StreamDecoder()
+        self.lock = threading.Lock()        # 一次只进行一个命令/应答
+        self.running = True
+        self.thread = threading.Thread(target=self._run, daemon=True)
+        self.thread.start()
+
+    def _run(self):
+        while self.running:
+            try:
+                chunk = self.ser.read(self.ser.in_waiting or 1)
+            except Exception:
+                break
+            for event in self.decoder.feed(chunk) if chunk else ():
+                if self.on_event:
+                    self.on_event(event)
+                self.events.put(event)
+        self.running = False
+        self.events.put(('closed', None))
+
+    def close(self):
+        """停止读线程 (不关闭串口)"""
+        self.running = False
+        if self.thread is not threading.current_thread():
+            self.thread.join(1.0)
+
+    def drain(self):
+        """丢弃尚未取走的事件"""
+        try:
+            while True:
+                self.events.get_nowait()
+        except queue.Empty:
+            pass
+
+    def send(self, cmd):
+        self.ser.write((cmd + '\n').encode())
+
+    def wait(self, accept, timeout):
+        """等待满足 accept(event) 的事件, 其他事件丢弃; 超时或串口关闭返回 None"""
+        deadline = time.monotonic() + timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            try:
+                event = self.events.get(timeout=remaining)
+            except queue.Empty:
+                return None
+            if event[0] == 'closed':
+                self.events.put(event)
+                return None
+            if accept(event):
+                return event
+
+    def command(self, cmd, timeout=1.0, replies=1):
+        """发送命令, 返回应答行列表 (到第 replies 个应答行或数据块为止); 超时返回已收到的行
+
+        一行可含多条以 ';' 分隔的命令, 下位机每条回复一行, replies 取命令条数.
+        其间收到的事件行 ('event') 不计入应答, 也不放入返回的列表
+        """
+        lines = []
+        count = [0]
+
+        def accept(event):
+            kind, value = event
+            if kind == 'block':
+                lines.extend(value)
+            elif kind == 'line':
+                lines.append(value)
+                if not is_reply(value):
+                    return False
+            else:
+                return False
+            count[0] += 1
+            return count[0] >= replies
+
+        with self.lock:
+            self.drain()
+            self.send(cmd)
+            self.wait(accept, timeout)
+        return lines
+
+    def request_frame(self, cmd, timeout=3.0):
+        """发送命令并等待一帧二进制采样数据 (跳过测量记录帧), 超时返回 None"""
+        with self.lock:
+            self.drain()
+            self.send(cmd)
+            event = self.wait(lambda e: e[0] == 'frame' and is_data(e), timeout)
+        return event[1] if event else None
+
+    def ping(self, tries=3, timeout=0.3):
+        """PING 若干次, 收到 OK: PONG 返回 True"""
+        for _ in range(tries):
+            reply = self.command('PING', timeout)
+            if reply and reply[-1] == 'OK: PONG':
+                return True
+        return False
+
+    def switch_baud(self, baud):
+        """切换波特率: 下位机按原波特率应答 BAUD 后切换, 上位机随之切换并 PING 确认
+
+        PING 不通时上位机切回原波特率, 下位机 2 秒内收不到 PING 也自动恢复.
+        下位机已经是目标波特率 (如上次会话切换过) 时直接返回成功.
+        返回 (是否成功, 说明文字)
+        """
+        old = self.ser.baudrate
+        if not self.ping():
+            self.ser.baudrate = baud
+            if self.ping():
+                return True, f'already {baud}'
+            self.ser.baudrate = old
+            return False, f'no PONG at {old} or {baud}'
+        if baud == old:
+            return True, f'already {baud}'
+
+        reply = self.command(f'BAUD {baud}')
+        if not reply or not reply[-1].startswith('OK: BAUD'):
+            return False, reply[-1] if reply else 'no reply'
+        time.sleep(0.02)            # 下位机在应答发完后切换
+        self.ser.baudrate = baud
+        if self.ping():
+            return True, reply[-1]
+
+        self.ser.baudrate = old
+        restored = self.wait(lambda e: e[0] == 'line' and e[1].startswith('ERR: BAUD'), 3.0)
+        return False, restored[1] if restored else f'no PONG at {baud}'
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+记录文件测试 - capture_file.py 保存后再读取, 样本、采样率和通道掩码须不变
+
+用法: python test_capture_file.py
+全部 255 种通道掩码 x 4 种格式 (.lacap 游程压缩 / .lacap 不压缩 / .vcd / .sr)
+x 样本数 {1, 7, 33, 1000}; 采样率在 1kHz-36MHz 间轮换.
+样本只含启用的通道 (与下位机打包数据展开后一样, 未启用的位为 0),
+各通道跳变疏密不同, 含整段不变的通道. 另外检查 pack/unpack 与逐位展开一致.
+任一检查失败时退出码为 1.
+"""
+
+import os
+import sys
+import tempfile
+
+import numpy as np
+
+import capture_file
+
+LENGTHS = (1, 7, 33, 1000)
+RATES = (1000, 9600, 100000, 1000000, 24000000, 36000000)
+FORMATS = (
+    ('lacap', 'lacap', lambda p, s, r, m: capture_file.save_lacap(p, s, r, m, compress=True)),
+    ('raw', 'lacap', lambda p, s, r, m: capture_file.save_lacap(p, s, r, m, compress=False)),
+    ('vcd', 'vcd', capture_file.save),
+    ('sigrok', 'sr', capture_file.save),
+)
+
+
+def make_samples(rng, count, ch_mask):
+    """每个通道按各自的概率翻转 (0 为恒定), 只保留 ch_mask 中的通道"""
+    flip = rng.choice([0.0, 0.01, 0.1, 0.5, 1.0], size=8)
+    toggles = rng.random((count, 8)) < flip
+    bits = (np.cumsum(toggles, axis=0) + rng.integers(0, 2, size=8)) & 1
+    samples = (bits << np.arange(8)).sum(axis=1).astype(np.uint8)
+    return samples & np.uint8(ch_mask)
+
+
+def reference_unpack(data, ch_mask, count):
+    """逐样本、逐通道展开打包数据, 用于核对向量化的 unpack"""
+    channels = capture_file.channels_of(ch_mask)
+    width = capture_file.pack_width(ch_mask)
+    if width == 8:
+        return np.frombuffer(data, dtype=np.uint8)[:count]
+    out = np.zeros(count, dtype=np.uint8)
+    for n in range(count):
+        field = data[n * width // 8] >> (n * width % 8) & ((1 << width) - 1)
+        for i, ch in enumerate(channels):
+            out[n] |= (field >> i & 1) << ch
+    return out
+
+
+def main():
+    rng = np.random.default_rng(12345)
+    failures = {name: 0 for name, _, _ in FORMATS}
+    packs = 0
+
+    with tempfile.TemporaryDirectory() as tmp:
+        for ch_mask in range(1, 256):
+            for k, count in enumerate(LENGTHS):
+                samples = make_samples(rng, count, ch_mask)
+                rate = RATES[(ch_mask + k) % len(RATES)]
+
+                packed = capture_file.pack(samples, ch_mask)
+                if not (np.array_equal(capture_file.unpack(packed, ch_mask, count), samples)
+                        and np.array_equal(reference_unpack(packed, ch_mask, count), samples)):
+                    packs += 1
+                    if packs <= 3:
+                        print('pack: mask 0x%02X, %d samples' % (ch_mask, count))
+
+                for name, ext, save in FORMATS:
+                    path = os.path.join(tmp, 'cap.' + ext)
+                    save(path, samples, rate, ch_mask)
+                    cap = error = None
+                    try:
+                        cap = capture_file.load(path)
+                        if len(cap.samples) != count:
+                            error = '%d samples' % len(cap.samples)
+                        elif not np.array_equal(cap.samples, samples):
+                            first = int(np.flatnonzero(cap.samples != samples)[0])
+                            error = 'sample %d is 0x%02X, expected 0x%02X' % (
+                                first, cap.samples[first], samples[first])
+                        elif cap.rate != rate or cap.ch_mask != ch_mask:
+                            error = 'rate %s mask 0x%02X' % (cap.rate, cap.ch_mask)
+                    except Exception as e:
+                        error = repr(e)
+                    del cap
+                    os.remove(path)
+                    if error:
+                        failures[name] += 1
+                        if failures[name] <= 3:
+                            print('%s: mask 0x%02X, %d samples @ %dHz: %s' % (
+                                name, ch_mask, count, rate, error))
+
+    files = 255 * len(LENGTHS)
+    print('%-8s %d masks x %d lengths  %s' % ('pack', 255, len(LENGTHS), 'FAIL' if packs else 'ok'))
+    for name, _, _ in FORMATS:
+        print('%-8s %d files  %s' % (name, files, 'FAIL' if failures[name] else 'ok'))
+    return 1 if packs or any(failures.values()) else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+串口链路测试 - StreamDecoder 的分块解码, 以及经伪终端与 fake_device.py 的命令往返
+
+用法: python test_serial_link.py [--splits 2000]
+- 分块: 一段混合字节流 (应答行、事件行、十六进制数据块、原始/游程压缩/带时间信息的
+  二进制帧、数据里含同步字和换行的帧、校验错误的帧、未以换行结尾的文本) 先整段解码并与
+  预期事件逐项比较, 再逐字节以及按随机长度切块喂给 StreamDecoder, 结果须完全相同
+- 往返 (仅 Linux): fake_device.py 在伪终端上应答, SerialLink 经 pyserial 连接, 检查
+  单条/多条命令的应答、出错后 SKIPPED、采样中 BUSY、二进制帧与十六进制数据块、
+  CAL 的结果为事件行而不占应答、不等应答连续发送的命令按序全部应答
+任一检查失败时退出码为 1.
+"""
+
+import argparse
+import random
+import sys
+import threading
+import time
+
+import serial
+
+from fake_device import make_frame, open_pty, serve
+from serial_link import (FRAME_FLAG_RLE, FRAME_NO_TRIGGER, FRAME_TYPE_DATA, FRAME_TYPE_MEAS,
+                         FRAME_TYPE_STREAM, MEAS_RECORD, SerialLink, StreamDecoder, is_data, rle_encode)
+
+TIMING = (72000000, 1000, 2000, 3000, 7200 * 16, FRAME_NO_TRIGGER)
+
+
+def build_stream():
+    """测试字节流和整段解码应得到的事件"""
+    square = bytes(0xFE | (i // 50) & 1 for i in range(1000))
+    ramp = bytes(i & 0xFF for i in range(300))
+    tricky = (b'\xA5\x5A\r\n' * 20)[:77]          # 数据中的同步字和换行
+    meas = MEAS_RECORD.pack(*([0] * 11 + [0, 1, 0, 0]))
+    good = make_frame(FRAME_TYPE_DATA, 0, 1, 0xFF, 100000, ramp)
+    # 校验错误: 跳过同步字的第一个字节, 其余当作文本, 到下一个换行为一行
+    bad = bytearray(make_frame(FRAME_TYPE_DATA, 0, 3, 0xFF, 100000, b'corrupted payload'))
+    bad[-1] ^= 0xFF
+    assert b'\n' not in bad
+
+    parts = [
+        (b'OK: CAPTURING...\r\n', ('line', 'OK: CAPTURING...')),
+        (b'CAPTURE COMPLETE\r\n', ('line', 'CAPTURE COMPLETE')),
+        (make_frame(FRAME_TYPE_DATA, FRAME_FLAG_RLE, 7, 0xFF, 100000, rle_encode(square), TIMING),
+         ('frame', 7, FRAME_TYPE_DATA, square)),
+        (b'EVT: CAL REF=1000Hz EDGES=9\n', ('event', 'EVT: CAL REF=1000Hz EDGES=9')),
+        (b'OK: PONG\r\n', ('line', 'OK: PONG')),
+        (b'DATA: (count=64 clk=72000000)\r\n' + ramp[:32].hex().upper().encode() + b'\r\n'
+         + ramp[32:64].hex().upper().encode() + b'\r\nEND\r\n',
+         ('block', ['DATA: (count=64 clk=72000000)', ramp[:32].hex().upper(),
+                    ramp[32:64].hex().upper(), 'END'])),
+        (make_frame(FRAME_TYPE_STREAM, 0, 0xFFFF, 0xFF, 8000, tricky), ('frame', 0xFFFF, FRAME_TYPE_STREAM, tricky)),
+        (make_frame(FRAME_TYPE_MEAS, 0, 0, 0, 0, meas), ('frame', 0, FRAME_TYPE_MEAS, meas)),
+        (b'ERR: SKIPPED \'CAP\'', ('line', "ERR: SKIPPED 'CAP'")),     # 无换行, 紧接帧
+        (make_frame(FRAME_TYPE_DATA, 0, 2, 0x0F, 1000, ramp[:5]), ('frame', 2, FRAME_TYPE_DATA, ramp[:5])),
+        (bytes(bad) + b'\r\n', ('line', bad[1:].decode('utf-8', errors='ignore').strip())),
+        (b'OK: RX LINES=3\r\n', ('line', 'OK: RX LINES=3')),
+        (good, ('frame', 1, FRAME_TYPE_DATA, ramp)),
+        (b'  \r\n\r\nSTATUS: READY MAXCOUNT=44000\r\n', ('line', 'STATUS: READY MAXCOUNT=44000')),
+    ]
+    data = b''.join(p[0] for p in parts)
+    return data, [p[1] for p in parts]
+
+
+def summarize(events):
+    """把事件化为便于比较的形式: 帧只取序号、类型和解码后的数据"""
+    out = []
+    for kind, value in events:
+        if kind == 'frame':
+            out.append(('frame', value['seq'], value['type'], value['payload']))
+        else:
+            out.append((kind, value))
+    return out
+
+
+def feed(chunks):
+    decoder = StreamDecoder()
+    events = []
+    for chunk in chunks:
+        events.extend(decoder.feed(chunk))
+    return summarize(events)
+
+
+def show(events):
+    return [e[:3] + ('%d bytes' % len(e[3]),) if e[0] == 'frame' else e for e in events]
+
+
+def check_splits(rounds):
+    """整段、逐字节、随机切块解码, 返回失败项数"""
+    data, want = build_stream()
+    rng = random.Random(12345)
+    failures = 0
+
+    whole = feed([data])
+    if whole != want:
+        print('decoder: whole stream\n  got  %s\n  want %s' % (show(whole), show(want)))
+        return 1
+    if feed([data[i:i + 1] for i in range(len(data))]) != want:
+        print('decoder: byte by byte differs')
+        failures += 1
+    for n in range(rounds):
+        cuts = sorted(rng.sample(range(1, len(data)), rng.randint(1, 40)))
+        if rng.random() < 0.3:
+            cuts = sorted(set(cuts + [rng.randint(1, len(data) - 1) + d for d in (-1, 0, 1)]))
+            cuts = [c for c in cuts if 0 < c < len(data)]
+        chunks = [data[a:b] for a, b in zip([0] + cuts, cuts + [len(data)])]
+        got = feed(chunks)
+        if got != want:
+            failures += 1
+            print('decoder: split at %s\n  got  %s' % (cuts, show(got)))
+            if failures >= 3:
+                break
+    print('decoder  %d bytes, %d events, byte by byte + %d random splits  %s' % (
+        len(data), len(want), rounds, 'FAIL' if failures else 'ok'))
+    return failures
+
+
+class Session:
+    """在伪终端上运行 fake_device, 用 SerialLink 连接"""
+
+    def __enter__(self):
+        self.master, path, self.slave = open_pty()
+        self.stop = threading.Event()
+        self.thread = threading.Thread(target=serve, args=(self.master, self.stop), daemon=True)
+        self.thread.start()
+        self.ser = serial.Serial(path, 115200, timeout=0.05)
+        self.events = []
+        self.link = SerialLink(self.ser, lambda e: e[0] == 'event' and self.events.append(e[1]))
+        return self
+
+    def __exit__(self, *exc):
+        self.stop.set()
+        self.thread.join(1.0)
+        self.link.close()
+        self.ser.close()
+
+
+def expect(name, got, want):
+    if got == want:
+        return 0
+    print('%s:\n  got  %s\n  want %s' % (name, got, want))
+    return 1
+
+
+def rx_lines(link):
+    """RXSTAT 报告的已收命令行数"""
+    reply = link.command('RXSTAT')
+    return int(reply[-1].split('LINES=')[1].split()[0]) if reply else -1
+
+
+def check_round_trip():
+    """命令往返, 返回失败项数"""
+    failures = 0
+    with Session() as s:
+        link = s.link
+        failures += expect('ping', link.command('PING'), ['OK: PONG'])
+        failures += expect('setup', link.command('MODE BIN;COMP ON;RATE 71 99;COUNT 1000', replies=4),
+                           ['OK: MODE BIN', 'OK: COMP ON', 'OK: RATE PSC=71 ARR=99',
+                            'OK: COUNT=1000 MAXCOUNT=44000'])
+        failures += expect('skipped', link.command('COUNT 1000;FOO;PING', replies=3),
+                           ['OK: COUNT=1000 MAXCOUNT=44000', "ERR: Unknown command 'FOO'",
+                            "ERR: SKIPPED 'PING'"])
+
+        # 二进制帧: PA0-PA7 为逐位减半的方波, 即每个样本比前一个加 1
+        frame = link.request_frame('CAP', 2.0)
+        if frame is None:
+            failures += expect('cap', None, 'frame')
+        else:
+            p = frame['payload']
+            failures += expect('cap', (frame['type'], frame['rate'], len(p), frame['timing'] is not None,
+                                       all((b - a) & 0xFF == 1 for a, b in zip(p, p[1:]))),
+                               (FRAME_TYPE_DATA, 10000, 1000, True, True))
+
+        # 十六进制数据块: command() 返回从 DATA: 到 END 的各行
+        link.command('MODE HEX')
+        block = link.command('SEND')
+        hexdata = bytes.fromhex(''.join(block[1:-1]))
+        failures += expect('hex', (block[0].split()[1] if block else None, block[-1:], len(hexdata)),
+                           ('(count=1000', ['END'], 1000))
+
+        # 采样中: 修改参数被拒绝, STATUS / ABORT 照常, 中止后仍可 SEND
+        link.command('MODE BIN;RATE 7199 9999;COUNT 100', replies=3)
+        failures += expect('busy', [link.command(c)[-1] for c in ('CAP', 'STATUS', 'COUNT 5', 'ABORT')],
+                           ['OK: CAPTURING...', 'STATUS: ARMED', 'ERR: BUSY (ARMED), send ABORT first',
+                            'OK: ABORTED'])
+        frame = link.request_frame('SEND', 2.0)
+        failures += expect('abort', (frame is not None and is_data(('frame', frame)),
+                                     link.command('STATUS')),
+                           (True, ['STATUS: READY MAXCOUNT=44000 DATA=ABORTED']))
+
+        # CAL: 应答只有 OK: CALIBRATING, 结果为事件行; 中止时 ABORT 的应答仍是 OK: ABORTED
+        link.command('RATE 71 99;COUNT 1000', replies=2)
+        failures += expect('cal', link.command('CAL;PING', replies=2),
+                           ['OK: CALIBRATING PA0 against 1000Hz', 'OK: PONG'])
+        deadline = time.monotonic() + 2.0
+        while not s.events and time.monotonic() < deadline:
+            time.sleep(0.01)
+        failures += expect('cal event', [e.split()[2] for e in s.events], ['REF=1000Hz'])
+        s.events.clear()
+        link.command('RATE 7199 9999')
+        failures += expect('cal abort', (link.command('CAL'), link.command('ABORT')),
+                           (['OK: CALIBRATING PA0 against 1000Hz'], ['OK: ABORTED']))
+        time.sleep(0.05)
+        failures += expect('cal abort event', s.events, ['EVT: CAL ABORTED'])
+
+        # 不等应答连续发送, RXSTAT 的行数增加 200 条命令 + RXSTAT 本身
+        link.command('RATE 71 99')
+        before = rx_lines(link)
+        with link.lock:
+            link.drain()
+            for n in range(1, 201):
+                link.send('COUNT %d' % n)
+            replies = []
+            while len(replies) < 200:
+                event = link.wait(lambda e: e[0] == 'line', 1.0)
+                if event is None:
+                    break
+                replies.append(event[1])
+        failures += expect('pipeline', replies,
+                           ['OK: COUNT=%d MAXCOUNT=44000' % n for n in range(1, 201)])
+        failures += expect('rxstat', rx_lines(link) - before, 201)
+    print('fakedev  round trips  %s' % ('FAIL' if failures else 'ok'))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--splits', type=int, default=2000)
+    args = parser.parse_args()
+
+    failures = check_splits(args.splits)
+    if sys.platform.startswith('linux'):
+        failures += check_round_trip()
+    else:
+        print('fakedev  skipped (pty needs Linux)')
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
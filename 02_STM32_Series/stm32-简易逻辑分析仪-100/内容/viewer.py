@@ -7,15 +7,51 @@
 1. 通过串口与 GD32F103RCT6 通信
 2. 图形化界面设置采样参数
 3. 实时显示采样波形
+4. UART / SPI / I2C / 1-Wire 协议解码 (需要 numpy)
+5. 保存/打开 VCD、sigrok (.sr) 和紧凑格式 (.lacap) 记录 (需要 numpy)
 """
 
 import tkinter as tk
-from tkinter import ttk, messagebox, scrolledtext
+from tkinter import ttk, messagebox, scrolledtext, filedialog
 import serial
 import serial.tools.list_ports
 import threading
 import time
 
+from serial_link import (SerialLink, BOOT_BAUD, FRAME_FLAG_OVERRUN, FRAME_TYPE_MEAS, timing_summary,
+                         parse_meas, parse_meas_line, is_data)
+from waveform import WaveModel, AnnotationRow, render_waveform
+
+try:
+    import decoders
+    import capture_file
+except ImportError:     # 未安装 numpy 时只是不能解码和存取文件
+    decoders = None
+    capture_file = None
+
+
+def unpack_samples(data, ch_mask):
+    """展开通道打包的数据 (与固件 Pack.c 一致), 还原为每样本一字节, bit0-7 对应 PA0-PA7
+
+    启用 1/2/3-4 个通道时每样本 1/2/4 位, 先采的样本在字节低位,
+    启用通道按编号从低到高依次放在样本的低位
+    """
+    channels = [ch for ch in range(8) if ch_mask & (1 << ch)]
+    if not channels or len(channels) > 4:
+        return list(data)
+    width = 1 if len(channels) == 1 else 2 if len(channels) == 2 else 4
+    lut = []
+    for v in range(1 << width):
+        lut.append(sum(((v >> i) & 1) << ch for i, ch in enumerate(channels)))
+    field = (1 << width) - 1
+    per_byte = 8 // width
+    samples = []
+    for b in data:
+        for k in range(per_byte):
+            samples.append(lut[(b >> (k * width)) & field])
+    return samples
+
+
 class LogicAnalyzerGUI:
     """逻辑分析仪图形界面"""
     
@@ -26,8 +62,14 @@ class LogicAnalyzerGUI:
         self.root.minsize(800, 600)
         
         self.ser = None
+        self.link = None
         self.is_connected = False
         self.sample_data = []
+        self.wave_model = None
+        self.sample_rate = 0
+        self.ch_mask = 0xFF
+        self.decoders = []
+        self.annotation_rows = []
         
         self.create_widgets()
         self.refresh_ports()
@@ -40,7 +82,8 @@ class LogicAnalyzerGUI:
         conn_frame.pack(fill=tk.X, padx=10, pady=5)
         
         ttk.Label(conn_frame, text="串口:").pack(side=tk.LEFT)
-        self.port_combo = ttk.Combobox(conn_frame, width=15, state="readonly")
+        # 可直接输入列表中没有的串口, 如模拟下位机的伪终端
+        self.port_combo = ttk.Combobox(conn_frame, width=15)
         self.port_combo.pack(side=tk.LEFT, padx=5)
         
         ttk.Button(conn_frame, text="刷新", command=self.refresh_ports).pack(side=tk.LEFT)
@@ -54,6 +97,17 @@ class LogicAnalyzerGUI:
         self.conn_btn = ttk.Button(conn_frame, text="连接", command=self.toggle_connection)
         self.conn_btn.pack(side=tk.LEFT, padx=10)
         
+        ttk.Label(conn_frame, text="数据格式:").pack(side=tk.LEFT, padx=(20, 0))
+        self.mode_combo = ttk.Combobox(conn_frame, width=8, state="readonly",
+                                        values=["二进制", "十六进制"])
+        self.mode_combo.set("二进制")
+        self.mode_combo.pack(side=tk.LEFT, padx=5)
+        self.mode_combo.bind("<<ComboboxSelected>>", lambda e: self.set_data_mode())
+        
+        self.comp_var = tk.BooleanVar(value=True)
+        ttk.Checkbutton(conn_frame, text="压缩", variable=self.comp_var,
+                        command=self.set_data_mode).pack(side=tk.LEFT, padx=5)
+        
         self.status_label = ttk.Label(conn_frame, text="● 未连接", foreground="red")
         self.status_label.pack(side=tk.LEFT, padx=10)
         
@@ -85,6 +139,13 @@ class LogicAnalyzerGUI:
         self.count_entry.grid(row=1, column=1, padx=5)
         ttk.Button(param_frame, text="设置数量", command=self.set_count).grid(row=1, column=2, padx=10)
         
+        # 采样通道
+        ttk.Label(param_frame, text="通道掩码:").grid(row=2, column=0, sticky=tk.W)
+        self.chan_entry = ttk.Entry(param_frame, width=8)
+        self.chan_entry.insert(0, "0xFF")
+        self.chan_entry.grid(row=2, column=1, padx=5)
+        ttk.Button(param_frame, text="设置通道", command=self.set_channels).grid(row=2, column=2, padx=10)
+        
         # 触发设置
         ttk.Label(param_frame, text="触发引脚:").grid(row=1, column=3, sticky=tk.W, padx=(20, 0))
         self.trig_pin_combo = ttk.Combobox(param_frame, width=6, state="readonly",
@@ -98,8 +159,13 @@ class LogicAnalyzerGUI:
         self.trig_edge_combo.set("上升沿")
         self.trig_edge_combo.grid(row=1, column=6, padx=5)
         
-        ttk.Button(param_frame, text="设置触发", command=self.set_trigger).grid(row=1, column=7, padx=5)
-        ttk.Button(param_frame, text="禁用触发", command=self.disable_trigger).grid(row=1, column=8, padx=5)
+        ttk.Label(param_frame, text="触发前%:").grid(row=1, column=7)
+        self.trig_pos_entry = ttk.Entry(param_frame, width=5)
+        self.trig_pos_entry.insert(0, "0")
+        self.trig_pos_entry.grid(row=1, column=8, padx=5)
+        
+        ttk.Button(param_frame, text="设置触发", command=self.set_trigger).grid(row=1, column=9, padx=5)
+        ttk.Button(param_frame, text="禁用触发", command=self.disable_trigger).grid(row=1, column=10, padx=5)
         
         # ====== 控制按钮区域 ======
         ctrl_frame = ttk.Frame(self.root, padding=10)
@@ -109,9 +175,22 @@ class LogicAnalyzerGUI:
         self.cap_btn.pack(side=tk.LEFT, padx=5)
         
         ttk.Button(ctrl_frame, text="📊 获取数据", command=self.get_data).pack(side=tk.LEFT, padx=5)
+        ttk.Button(ctrl_frame, text="💾 保存", command=self.save_file).pack(side=tk.LEFT, padx=5)
+        ttk.Button(ctrl_frame, text="📂 打开", command=self.open_file).pack(side=tk.LEFT, padx=5)
         ttk.Button(ctrl_frame, text="❓ 帮助", command=self.send_help).pack(side=tk.LEFT, padx=5)
         ttk.Button(ctrl_frame, text="🗑️ 清空日志", command=self.clear_log).pack(side=tk.LEFT, padx=5)
         
+        # ====== 协议解码区域 ======
+        dec_frame = ttk.LabelFrame(self.root, text="协议解码", padding=5)
+        dec_frame.pack(fill=tk.X, padx=10)
+        
+        self.dec_entry = ttk.Entry(dec_frame, width=40)
+        self.dec_entry.insert(0, "uart rx=0 baud=9600")
+        self.dec_entry.pack(side=tk.LEFT, padx=5)
+        ttk.Button(dec_frame, text="添加解码", command=self.add_decoder).pack(side=tk.LEFT, padx=5)
+        ttk.Button(dec_frame, text="清除解码", command=self.clear_decoders).pack(side=tk.LEFT, padx=5)
+        ttk.Label(dec_frame, text="spi clk=0 mosi=1 cs=3 / i2c scl=0 sda=1 / onewire dq=0").pack(side=tk.LEFT, padx=5)
+        
         # ====== 波形显示区域 ======
         wave_frame = ttk.LabelFrame(self.root, text="波形显示 (PA0-PA7)", padding=10)
         wave_frame.pack(fill=tk.BOTH, expand=True, padx=10, pady=5)
@@ -167,14 +246,21 @@ class LogicAnalyzerGUI:
             return
             
         try:
-            self.ser = serial.Serial(port, baud, timeout=1)
-            time.sleep(0.1)
+            # 读超时要短, 断开时后台读线程才能及时退出.
+            # 下位机上电为 115200, 选了其他波特率时用 BAUD 命令协商切换
+            self.ser = serial.Serial(port, BOOT_BAUD, timeout=0.05)
             self.ser.reset_input_buffer()
+            self.link = SerialLink(self.ser, on_event=self.on_serial_event)
+            ok, text = self.link.switch_baud(baud)
+            if not ok:
+                self.log(f"波特率切换失败: {text}, 保持 {self.ser.baudrate}bps")
+                self.baud_combo.set(str(self.ser.baudrate))
             
             self.is_connected = True
             self.conn_btn.config(text="断开")
             self.status_label.config(text="● 已连接 " + port, foreground="green")
-            self.log(f"已连接到 {port} @ {baud}bps")
+            self.log(f"已连接到 {port} @ {self.ser.baudrate}bps ({text})")
+            self.set_data_mode()
             
         except Exception as e:
             messagebox.showerror("连接失败", str(e))
@@ -182,6 +268,9 @@ class LogicAnalyzerGUI:
             
     def disconnect(self):
         """断开串口"""
+        if self.link:
+            self.link.close()
+            self.link = None
         if self.ser:
             self.ser.close()
             self.ser = None
@@ -191,36 +280,74 @@ class LogicAnalyzerGUI:
         self.status_label.config(text="● 未连接", foreground="red")
         self.log("已断开连接")
         
-    def send_command(self, cmd):
-        """发送命令"""
+    def on_serial_event(self, event):
+        """后台读线程收到的每个事件都记入日志 (转到界面线程执行)"""
+        kind, value = event
+        if kind == 'line' and value.startswith('MEAS:'):
+            text = self.meas_text(parse_meas_line(value))
+        elif kind in ('line', 'event'):
+            text = value
+        elif kind == 'block':
+            text = f"{value[0]} ... {len(value) - 2} 行数据"
+        elif kind == 'frame' and value['type'] == FRAME_TYPE_MEAS:
+            text = self.meas_text(parse_meas(value))
+        elif kind == 'frame':
+            text = (f"帧 #{value['seq']} 类型={value['type']} "
+                    f"{len(value['payload'])} 样本/{value['wire_size']} 字节 @ {value['rate']}Hz")
+        else:
+            text = "串口已关闭"
+        self.root.after(0, self.log, f"接收: {text}")
+        
+    @staticmethod
+    def meas_text(rec):
+        """MEAS 测量记录的日志文字"""
+        if not rec['freq']:
+            return f"测量 PA{rec['pin']}: 无完整周期, 电平 {rec['level']}"
+        clk = rec['clk']
+        return (f"测量 PA{rec['pin']}: {rec['freq']:.3f} Hz, 占空比 {rec['duty'] * 100:.2f}%, "
+                f"高电平 {rec['hmin'] / clk * 1e6:.2f}-{rec['hmax'] / clk * 1e6:.2f} us, "
+                f"低电平 {rec['lmin'] / clk * 1e6:.2f}-{rec['lmax'] / clk * 1e6:.2f} us, "
+                f"{rec['edges']} 个边沿")
+        
+    def send_command(self, cmd, timeout=1.0, replies=1):
+        """发送命令, 返回应答行 (收到应答即返回, 不固定等待)"""
         if not self.is_connected:
             messagebox.showwarning("警告", "请先连接串口")
             return None
             
         try:
-            self.ser.reset_input_buffer()
-            self.ser.write((cmd + '\n').encode())
             self.log(f"发送: {cmd}")
-            time.sleep(0.1)
+            return self.link.command(cmd, timeout, replies)
+        except Exception as e:
+            self.log(f"通信错误: {e}")
+            return None
             
-            lines = []
-            while True:
-                line = self.ser.readline().decode('utf-8', errors='ignore').strip()
-                if not line:
-                    break
-                lines.append(line)
-                if line == 'END':
-                    break
-                    
-            for line in lines:
-                self.log(f"接收: {line}")
-                
-            return lines
+    def request_frame(self, cmd, timeout=3.0):
+        """发送命令并接收一帧二进制数据"""
+        if not self.is_connected:
+            messagebox.showwarning("警告", "请先连接串口")
+            return None
             
+        try:
+            self.log(f"发送: {cmd}")
+            frame = self.link.request_frame(cmd, timeout)
+            if frame is None:
+                self.log("接收帧超时")
+            return frame
         except Exception as e:
             self.log(f"通信错误: {e}")
             return None
             
+    def is_binary_mode(self):
+        """当前是否使用二进制帧传输"""
+        return self.mode_combo.get() == "二进制"
+        
+    def set_data_mode(self):
+        """同步数据格式到下位机"""
+        if self.is_connected:
+            self.send_command("MODE BIN" if self.is_binary_mode() else "MODE HEX")
+            self.send_command("COMP ON" if self.comp_var.get() else "COMP OFF")
+            
     def calc_rate(self):
         """计算采样率"""
         try:
@@ -247,62 +374,218 @@ class LogicAnalyzerGUI:
         count = self.count_entry.get()
         self.send_command(f"COUNT {count}")
         
+    def set_channels(self):
+        """设置采样通道 (只采部分通道时采样深度成倍增加)"""
+        self.send_command(f"CHAN {self.chan_entry.get()}")
+        
     def set_trigger(self):
         """设置触发"""
         pin = self.trig_pin_combo.current()
         edge = 1 if self.trig_edge_combo.get() == "上升沿" else 0
         self.send_command(f"TRIG {pin} {edge}")
+        self.send_command(f"TRIG POS {self.trig_pos_entry.get()}")
         
     def disable_trigger(self):
         """禁用触发"""
         self.send_command("NOTRIG")
         
+    def expected_capture_time(self):
+        """按界面上的采样率和数量估算采样耗时 (秒), 无法计算时返回 0"""
+        try:
+            return int(self.count_entry.get()) / self.ui_sample_rate()
+        except (ValueError, ZeroDivisionError):
+            return 0
+            
     def start_capture(self):
         """开始采样"""
         self.cap_btn.config(state=tk.DISABLED)
         self.log("开始采样...")
+        timeout = self.expected_capture_time() * 1.5 + 4.5
+        
+        # 采样率、数量与启动合并为一行, 一次往返; 前面出错时下位机不启动
+        cmd = f"RATE {self.psc_entry.get()} {self.arr_entry.get()};COUNT {self.count_entry.get()};CAP"
         
         def capture_thread():
-            self.send_command("CAP")
-            # 等待采样完成
-            time.sleep(0.5)
-            for _ in range(20):
-                resp = self.send_command("STATUS")
-                if resp and any('READY' in s for s in resp):
-                    break
-                time.sleep(0.2)
-            
-            # 获取数据
-            self.get_data()
+            resp = self.send_command(cmd, replies=3)
+            if resp and resp[-1].startswith('OK: CAPTURING'):
+                # 采满后下位机输出 CAPTURE COMPLETE 并自动发送数据, 数据一到就显示
+                event = self.link.wait(is_data, timeout)
+                if event is None:
+                    # 迟迟不结束 (如等不到触发) 时中止并取回已采数据
+                    self.log("采样超时, 中止并读取已采数据")
+                    self.send_command("ABORT")
+                    event = self.fetch_data()
+                self.root.after(0, self.show_data, event)
             self.root.after(0, lambda: self.cap_btn.config(state=tk.NORMAL))
             
         threading.Thread(target=capture_thread, daemon=True).start()
         
+    def fetch_data(self):
+        """发送 SEND 读取数据, 返回帧或数据块事件, 失败返回 None"""
+        if self.is_binary_mode():
+            frame = self.request_frame("SEND")
+            return ('frame', frame) if frame else None
+            
+        resp = self.send_command("SEND")
+        return ('block', resp) if resp else None
+        
+    def show_data(self, event):
+        """显示收到的帧或十六进制数据块"""
+        if event is None:
+            return
+        kind, value = event
+        if kind == 'frame':
+            self.sample_data = unpack_samples(value['payload'], value['ch_mask'])
+            self.sample_rate = value['rate']
+            self.ch_mask = value['ch_mask']
+            timing = value.get('timing')
+            if value['flags'] & FRAME_FLAG_OVERRUN:
+                self.warn_overrun(None)
+        else:
+            self.sample_data, timing = self.parse_data(value)
+            self.sample_rate = self.ui_sample_rate()
+        self.log(f"收到 {len(self.sample_data)} 个采样点")
+        if timing and self.sample_rate:
+            self.apply_timing(timing)
+        self.run_decoders()
+        self.draw_waveform()
+        
+    def warn_overrun(self, lost):
+        """打包跟不上采样率, 部分半区被覆盖: 数据中间有缺口, 提示降低采样率或增加通道"""
+        text = "采样数据不连续: 打包跟不上采样率, "
+        text += f"{lost} 个采样被覆盖" if lost is not None else "部分采样被覆盖 (STATUS 给出数量)"
+        self.log("警告: " + text)
+        messagebox.showwarning("警告", text + "\n请降低采样率或启用更多通道后重新采样")
+        
+    def apply_timing(self, timing):
+        """用下位机测得的采样周期作为时间轴, 并记录触发时刻与偏差"""
+        measured, ppm, trigger, elapsed = timing_summary(timing, self.sample_rate)
+        text = f"采样耗时 {elapsed * 1000:.3f} ms"
+        if trigger is not None:
+            text += f", 启动后 {trigger * 1000:.3f} ms 触发"
+        if measured:
+            text += f", 实测采样率 {measured:.1f} Hz ({ppm:+.0f} ppm)"
+            self.sample_rate = measured
+        self.log(text)
+        
+    def ui_sample_rate(self):
+        """界面上 PSC/ARR 对应的采样率 (Hz), 无法计算时返回 0"""
+        try:
+            return 72000000 / (int(self.psc_entry.get()) + 1) / (int(self.arr_entry.get()) + 1)
+        except (ValueError, ZeroDivisionError):
+            return 0
+            
+    def add_decoder(self):
+        """按输入框的文本添加一个解码器"""
+        if decoders is None:
+            messagebox.showerror("错误", "协议解码需要 numpy: pip install numpy")
+            return
+        try:
+            decoder = decoders.create(self.dec_entry.get())
+        except ValueError as e:
+            messagebox.showerror("错误", str(e))
+            return
+        self.decoders.append(decoder)
+        self.log(f"添加解码器: {decoder.label()}")
+        self.run_decoders()
+        self.draw_waveform()
+        
+    def clear_decoders(self):
+        """删除全部解码器"""
+        self.decoders = []
+        self.annotation_rows = []
+        self.draw_waveform()
+        
+    def run_decoders(self):
+        """对当前数据运行全部解码器, 结果作为注释行画在通道下方"""
+        self.annotation_rows = []
+        if not len(self.sample_data) or not self.decoders:
+            return
+        rate = self.sample_rate or self.ui_sample_rate()
+        if not rate:
+            self.log("采样率未知, 无法解码")
+            return
+        t0 = time.perf_counter()
+        for decoder in self.decoders:
+            annotations = decoder.decode(self.sample_data, rate)
+            self.annotation_rows.append(AnnotationRow(decoder.label(), annotations))
+            errors = sum(1 for a in annotations if a.error)
+            self.log(f"{decoder.label()}: {len(annotations)} 条注释, {errors} 个错误")
+        self.log(f"解码耗时 {(time.perf_counter() - t0) * 1000:.0f} ms")
+        
+    def save_file(self):
+        """保存当前数据, 格式按扩展名选择"""
+        if capture_file is None:
+            messagebox.showerror("错误", "保存文件需要 numpy: pip install numpy")
+            return
+        if not len(self.sample_data):
+            messagebox.showerror("错误", "没有数据")
+            return
+        path = filedialog.asksaveasfilename(defaultextension=".lacap", filetypes=capture_file.FILE_TYPES)
+        if not path:
+            return
+        rate = self.sample_rate or self.ui_sample_rate()
+        try:
+            capture_file.save(path, self.sample_data, rate, self.ch_mask)
+        except (OSError, ValueError) as e:
+            messagebox.showerror("错误", str(e))
+            return
+        self.log(f"已保存 {len(self.sample_data)} 个采样点: {path}")
+        
+    def open_file(self):
+        """打开保存的记录 (.lacap 未压缩时直接内存映射)"""
+        if capture_file is None:
+            messagebox.showerror("错误", "打开文件需要 numpy: pip install numpy")
+            return
+        path = filedialog.askopenfilename(filetypes=capture_file.FILE_TYPES + [("全部", "*.*")])
+        if not path:
+            return
+        try:
+            capture = capture_file.load(path)
+        except Exception as e:      # 文件损坏时各格式抛出的异常不同
+            messagebox.showerror("错误", f"无法打开 {path}: {e}")
+            return
+        self.sample_data = capture.samples
+        self.sample_rate = capture.rate
+        self.ch_mask = capture.ch_mask
+        self.log(f"打开 {path}: {len(self.sample_data)} 个采样点, 采样率 {capture.rate} Hz, 通道 0x{capture.ch_mask:02X}")
+        self.run_decoders()
+        self.draw_waveform()
+        
     def get_data(self):
         """获取采样数据"""
-        resp = self.send_command("SEND")
-        if resp:
-            self.sample_data = self.parse_data(resp)
-            self.log(f"收到 {len(self.sample_data)} 个采样点")
-            self.draw_waveform()
+        self.show_data(self.fetch_data())
             
     def parse_data(self, response):
-        """解析十六进制数据"""
+        """解析十六进制数据块, 返回 (样本, 头部的时间信息或 None)"""
         data = []
         in_data = False
+        ch_mask = 0xFF
+        timing = None
         
         for line in response:
             if line.startswith('DATA:'):
                 in_data = True
-                hex_str = line[5:]
-                if hex_str:
-                    data.extend(self._parse_hex_line(hex_str))
+                # 头部形如 DATA: (count=256 chan=0x01 clk=72000000 arm=... period16=...),
+                # 数据从下一行开始
+                fields = dict(item.split('=', 1) for item in line[5:].strip(' ()').split() if '=' in item)
+                if 'chan' in fields:
+                    ch_mask = int(fields['chan'], 16)
+                if 'clk' in fields:
+                    timing = {'clock': int(fields['clk']), 'arm': int(fields['arm']),
+                              'trigger': int(fields['trigt']), 'done': int(fields['done']),
+                              'period16': int(fields['period16'])}
+                    if 'trig' in fields:
+                        timing['trigger_sample'] = int(fields['trig'])
+                if 'overrun' in fields:
+                    self.warn_overrun(int(fields['overrun']))
+                self.ch_mask = ch_mask
             elif line == 'END':
                 break
             elif in_data:
                 data.extend(self._parse_hex_line(line))
                 
-        return data
+        return unpack_samples(data, ch_mask), timing
         
     def _parse_hex_line(self, line):
         """解析一行十六进制数据"""
@@ -316,10 +599,10 @@ class LogicAnalyzerGUI:
         return values
         
     def draw_waveform(self):
-        """绘制波形"""
+        """绘制波形 (按像素列抽取, 见 waveform.py)"""
         self.canvas.delete("all")
         
-        if not self.sample_data:
+        if not len(self.sample_data):
             self.canvas.create_text(400, 150, text="无数据", fill="white", font=("Arial", 20))
             return
             
@@ -329,52 +612,17 @@ class LogicAnalyzerGUI:
         if width < 10 or height < 10:
             return
             
-        num_channels = 8
-        ch_height = height / num_channels
-        
-        colors = ["#00FF00", "#FF0000", "#00FFFF", "#FFFF00", 
-                  "#FF00FF", "#FFA500", "#FFFFFF", "#00FF80"]
+        # 新数据才重建跳变索引, 滚动/缩放/改变窗口大小时直接复用
+        if self.wave_model is None or self.wave_model.samples is not self.sample_data:
+            self.wave_model = WaveModel(self.sample_data)
         
         samples = len(self.sample_data)
-        visible_samples = int(samples / self.wave_zoom)
+        visible_samples = max(1, int(samples / self.wave_zoom))
         start_idx = int(self.wave_offset * (samples - visible_samples)) if samples > visible_samples else 0
         end_idx = min(start_idx + visible_samples, samples)
         
-        if end_idx <= start_idx:
-            return
-            
-        x_scale = width / (end_idx - start_idx)
-        
-        for ch in range(num_channels):
-            y_base = ch * ch_height
-            y_low = y_base + ch_height * 0.8
-            y_high = y_base + ch_height * 0.2
-            
-            # 通道标签
-            self.canvas.create_text(30, y_base + ch_height / 2, 
-                                    text=f"PA{ch}", fill=colors[ch], font=("Arial", 9, "bold"))
-            
-            # 绘制波形
-            prev_x = 40
-            prev_y = y_low
-            
-            for i in range(start_idx, end_idx):
-                x = 40 + (i - start_idx) * x_scale
-                bit = (self.sample_data[i] >> ch) & 1
-                y = y_high if bit else y_low
-                
-                if i > start_idx:
-                    # 垂直线
-                    if prev_y != y:
-                        self.canvas.create_line(x, prev_y, x, y, fill=colors[ch])
-                    # 水平线
-                    self.canvas.create_line(prev_x, prev_y, x, prev_y, fill=colors[ch])
-                    
-                prev_x = x
-                prev_y = y
-                
-            # 最后一段
-            self.canvas.create_line(prev_x, prev_y, width - 10, prev_y, fill=colors[ch])
+        render_waveform(self.canvas, self.wave_model, start_idx, end_idx, width, height,
+                        self.annotation_rows)
             
     def scroll_wave(self, *args):
         """滚动波形"""
@@ -426,7 +674,7 @@ def main():
     
     # 窗口大小改变时重绘波形
     def on_resize(event):
-        if app.sample_data:
+        if len(app.sample_data):
             app.draw_waveform()
     app.canvas.bind("<Configure>", on_resize)
     
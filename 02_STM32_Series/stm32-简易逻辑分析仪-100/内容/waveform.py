@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+波形绘制 - 按屏幕像素抽取的分级细节 (LOD) 绘制
+
+采样数据先预处理为每个通道的跳变位置表, 绘制时每个像素列用二分查找统计
+该列覆盖的样本内有几次跳变: 0 次画平线, 1 次画一条竖线, 2 次及以上画一个
+"忙" 色块 (相邻的合并为一个). 每个通道只生成一条折线和若干色块,
+重绘耗时取决于窗口宽度, 与采样长度基本无关 (只多一次 log n 的查找).
+
+协议解码的结果 (见 decoders.py) 画在通道下方的注释行中, 同样按像素抽取:
+窄于 2 像素的注释与同一位置的后续注释合并为一个色块.
+"""
+
+from bisect import bisect_left, bisect_right
+from itertools import compress
+
+CHANNEL_COLORS = ["#00FF00", "#FF0000", "#00FFFF", "#FFFF00",
+                  "#FF00FF", "#FFA500", "#FFFFFF", "#00FF80"]
+LABEL_WIDTH = 40        # 左侧通道标签宽度 (像素)
+RIGHT_MARGIN = 10       # 右侧留白 (像素)
+ANNOTATION_COLOR = "#4080FF"
+ERROR_COLOR = "#FF4040"
+CHAR_WIDTH = 6          # 注释文字的估计字宽 (像素), 放不下时不显示文字
+
+
+class WaveModel:
+    """采样数据的跳变索引
+
+    transitions[ch] 为通道 ch 电平发生变化的样本序号 (该样本与前一个样本不同),
+    initial[ch] 为第一个样本的电平. 任一样本的电平 = 初始电平 ^ 之前的跳变次数的奇偶
+    """
+
+    def __init__(self, samples, channels=8):
+        self.samples = samples
+        self.length = len(samples)
+        self.channels = channels
+        self.initial = [0] * channels
+        self.transitions = [[] for _ in range(channels)]
+        if not self.length:
+            return
+
+        # 相邻样本异或: 把整段数据当作大整数一次算完, 避免逐样本的 Python 循环.
+        # diff[k] 非零表示样本 k+1 与样本 k 不同
+        data = bytes(samples)
+        n = len(data)
+        diff = (int.from_bytes(data[1:], 'little') ^
+                int.from_bytes(data[:-1], 'little')).to_bytes(n - 1, 'little')
+
+        for ch in range(channels):
+            bit = bytes((v >> ch) & 1 for v in range(256))
+            self.initial[ch] = (data[0] >> ch) & 1
+            self.transitions[ch] = list(compress(range(1, n), diff.translate(bit)))
+
+    def level(self, ch, pos):
+        """样本 pos 处通道 ch 的电平"""
+        return self.initial[ch] ^ (bisect_right(self.transitions[ch], pos) & 1)
+
+    def trace(self, ch, start, end, x0, x1, y_low, y_high):
+        """生成通道 ch 在样本 [start, end) 范围内的绘制数据
+
+        返回 (coords, blocks): coords 为折线坐标 [x, y, x, y, ...],
+        blocks 为忙色块的 (x_left, x_right) 列表
+        """
+        trans = self.transitions[ch]
+        y_of = (y_low, y_high)
+        span = end - start
+        scale = (x1 - x0) / span
+        lo = bisect_right(trans, start)
+        y = y_of[self.initial[ch] ^ (lo & 1)]
+        coords = [x0, y]
+        blocks = []
+
+        if span <= x1 - x0:
+            # 每个样本不少于一个像素: 逐个跳变精确绘制
+            hi = bisect_left(trans, end, lo)
+            for t in trans[lo:hi]:
+                x = x0 + (t - start) * scale
+                y_new = y_low if y == y_high else y_high
+                coords += (x, y, x, y_new)
+                y = y_new
+            coords += (x1, y)
+            return coords, blocks
+
+        # 每列多个样本: 按像素列统计跳变次数
+        columns = int(x1 - x0)
+        per_col = span / columns
+        busy_from = None
+        busy_y = y
+        for c in range(columns):
+            col_end = end if c == columns - 1 else start + int((c + 1) * per_col)
+            hi = bisect_left(trans, col_end, lo)
+            n = hi - lo
+            x = x0 + c
+            if n >= 2:
+                if busy_from is None:
+                    busy_from = x
+                    busy_y = y
+                    coords += (x, y)
+                if n & 1:
+                    y = y_low if y == y_high else y_high
+            else:
+                if busy_from is not None:
+                    # 折线沿色块上沿/下沿穿过, 在色块右端切到之后的电平
+                    blocks.append((busy_from, x))
+                    coords += (x, busy_y, x, y)
+                    busy_from = None
+                if n == 1:
+                    y_new = y_low if y == y_high else y_high
+                    coords += (x, y, x, y_new)
+                    y = y_new
+            lo = hi
+        if busy_from is not None:
+            blocks.append((busy_from, x1))
+            coords += (x1, busy_y)
+        coords += (x1, y)
+        return coords, blocks
+
+
+class AnnotationRow:
+    """一行注释: 标签 + 按起始样本排序的 Annotation 列表"""
+
+    def __init__(self, label, annotations):
+        self.label = label
+        self.items = annotations
+        self.starts = [a.start for a in annotations]
+
+    def render(self, canvas, start, end, x0, x1, y_top, y_bottom):
+        """绘制样本 [start, end) 内的注释, 返回创建的画布对象数"""
+        items = 0
+        starts = self.starts
+        n = len(starts)
+        scale = (x1 - x0) / (end - start)
+        # 起点在窗口之前的注释可能延伸进来, 从前一条开始
+        i = max(0, bisect_left(starts, start) - 1)
+        while i < n and starts[i] < end:
+            a = self.items[i]
+            if a.end <= start:
+                i += 1
+                continue
+            left = x0 + (max(a.start, start) - start) * scale
+            right = x0 + (min(a.end, end) - start) * scale
+            color = ERROR_COLOR if a.error else ANNOTATION_COLOR
+            if right - left < 2:
+                # 太窄: 跳过落在这 2 个像素内的其余注释
+                canvas.create_rectangle(left, y_top, left + 2, y_bottom, fill=color, outline="")
+                items += 1
+                i = max(i + 1, bisect_left(starts, start + (left + 2 - x0) / scale, i + 1))
+                continue
+            canvas.create_rectangle(left, y_top, right, y_bottom, outline=color)
+            items += 1
+            if right - left > len(a.text) * CHAR_WIDTH + 4:
+                canvas.create_text((left + right) / 2, (y_top + y_bottom) / 2, text=a.text,
+                                   fill=color, font=("Consolas", 8))
+                items += 1
+            i += 1
+        return items
+
+
+def render_waveform(canvas, model, start, end, width, height, rows=()):
+    """在 canvas 上绘制样本 [start, end) 的 8 个通道, 以及 rows 中的注释行
+
+    返回创建的画布对象数 (用于性能测试)
+    """
+    items = 0
+    ch_height = height / (model.channels + len(rows))
+    x0 = LABEL_WIDTH
+    x1 = width - RIGHT_MARGIN
+    if x1 - x0 < 1 or end <= start:
+        return items
+
+    for ch in range(model.channels):
+        color = CHANNEL_COLORS[ch % len(CHANNEL_COLORS)]
+        y_base = ch * ch_height
+        y_low = y_base + ch_height * 0.8
+        y_high = y_base + ch_height * 0.2
+
+        canvas.create_text(LABEL_WIDTH - 10, y_base + ch_height / 2,
+                           text=f"PA{ch}", fill=color, font=("Arial", 9, "bold"))
+        coords, blocks = model.trace(ch, start, end, x0, x1, y_low, y_high)
+        for left, right in blocks:
+            canvas.create_rectangle(left, y_high, right, y_low, fill=color, outline=color,
+                                    stipple="gray50")
+        canvas.create_line(*coords, fill=color)
+        items += 2 + len(blocks)
+
+    for k, row in enumerate(rows):
+        y_base = (model.channels + k) * ch_height
+        canvas.create_text(LABEL_WIDTH - 10, y_base + ch_height / 2, text=row.label.split()[0],
+                           fill=ANNOTATION_COLOR, font=("Arial", 8, "bold"))
+        items += 1 + row.render(canvas, start, end, x0, x1,
+                                y_base + ch_height * 0.15, y_base + ch_height * 0.85)
+    return items